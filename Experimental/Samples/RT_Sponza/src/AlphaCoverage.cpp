@@ -0,0 +1,110 @@
+#include "AlphaCoverage.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Diligent
+{
+
+bool AlphaCoverage::Init(const ImageData& Image)
+{
+    m_Levels.clear();
+
+    if (Image.Format != TEX_FORMAT_RGBA8_UNORM || Image.Width == 0 || Image.Height == 0 || Image.Mips.empty())
+        return false;
+
+    // level 0 from alpha channel
+    {
+        const auto&  Mip   = Image.Mips[0];
+        const Uint8* pData = Image.GetData() + Mip.Offset;
+
+        Level Dst;
+        Dst.Width  = Image.Width;
+        Dst.Height = Image.Height;
+        Dst.MinAlpha.resize(size_t{Dst.Width} * Dst.Height);
+
+        for (Uint32 y = 0; y < Dst.Height; ++y)
+        {
+            const Uint8* pRow = pData + size_t{y} * Mip.Stride;
+            for (Uint32 x = 0; x < Dst.Width; ++x)
+                Dst.MinAlpha[size_t{y} * Dst.Width + x] = pRow[x * 4 + 3];
+        }
+        m_Levels.push_back(std::move(Dst));
+    }
+
+    // 2x2 min filter, odd sizes are rounded up
+    while (m_Levels.back().Width > 1 || m_Levels.back().Height > 1)
+    {
+        const auto& Src = m_Levels.back();
+
+        Level Dst;
+        Dst.Width  = (Src.Width + 1) / 2;
+        Dst.Height = (Src.Height + 1) / 2;
+        Dst.MinAlpha.resize(size_t{Dst.Width} * Dst.Height);
+
+        for (Uint32 y = 0; y < Dst.Height; ++y)
+        {
+            const Uint32 y0 = y * 2;
+            const Uint32 y1 = std::min(y0 + 1, Src.Height - 1);
+            for (Uint32 x = 0; x < Dst.Width; ++x)
+            {
+                const Uint32 x0 = x * 2;
+                const Uint32 x1 = std::min(x0 + 1, Src.Width - 1);
+
+                Dst.MinAlpha[size_t{y} * Dst.Width + x] = std::min({Src.MinAlpha[size_t{y0} * Src.Width + x0], Src.MinAlpha[size_t{y0} * Src.Width + x1],
+                                                                    Src.MinAlpha[size_t{y1} * Src.Width + x0], Src.MinAlpha[size_t{y1} * Src.Width + x1]});
+            }
+        }
+        m_Levels.push_back(std::move(Dst));
+    }
+    return true;
+}
+
+bool AlphaCoverage::IsOpaque(const float2& UV0, const float2& UV1, const float2& UV2, Uint8 MinAlpha) const
+{
+    if (m_Levels.empty())
+        return false;
+
+    const float2 UVMin{std::min({UV0.x, UV1.x, UV2.x}), std::min({UV0.y, UV1.y, UV2.y})};
+    const float2 UVMax{std::max({UV0.x, UV1.x, UV2.x}), std::max({UV0.y, UV1.y, UV2.y})};
+    if (!std::isfinite(UVMin.x) || !std::isfinite(UVMin.y) || !std::isfinite(UVMax.x) || !std::isfinite(UVMax.y))
+        return false;
+
+    // find the level where the footprint is small enough
+    size_t LevelIdx = 0;
+    for (; LevelIdx + 1 < m_Levels.size(); ++LevelIdx)
+    {
+        const auto& Lvl = m_Levels[LevelIdx];
+        if ((UVMax.x - UVMin.x) * Lvl.Width <= MaxFootprint && (UVMax.y - UVMin.y) * Lvl.Height <= MaxFootprint)
+            break;
+    }
+    const auto& Lvl = m_Levels[LevelIdx];
+
+    // one texel margin covers bilinear filtering and rounding of odd sizes in the min pyramid
+    const Int64 X0 = Int64(std::floor(UVMin.x * Lvl.Width)) - 1;
+    const Int64 Y0 = Int64(std::floor(UVMin.y * Lvl.Height)) - 1;
+    const Int64 X1 = Int64(std::floor(UVMax.x * Lvl.Width)) + 1;
+    const Int64 Y1 = Int64(std::floor(UVMax.y * Lvl.Height)) + 1;
+
+    // the whole level is covered
+    if (X1 - X0 + 1 >= Int64(Lvl.Width) && Y1 - Y0 + 1 >= Int64(Lvl.Height) && LevelIdx + 1 == m_Levels.size())
+        return Lvl.MinAlpha[0] >= MinAlpha;
+
+    const auto Wrap = [](Int64 Coord, Uint32 Size) {
+        const Int64 Rem = Coord % Int64(Size);
+        return Uint32(Rem < 0 ? Rem + Size : Rem);
+    };
+
+    for (Int64 y = Y0; y <= Y1; ++y)
+    {
+        const Uint8* pRow = &Lvl.MinAlpha[size_t{Wrap(y, Lvl.Height)} * Lvl.Width];
+        for (Int64 x = X0; x <= X1; ++x)
+        {
+            if (pRow[Wrap(x, Lvl.Width)] < MinAlpha)
+                return false;
+        }
+    }
+    return true;
+}
+
+} // namespace Diligent
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "BasicMath.hpp"
+#include "TextureStreamer.hpp"
+
+namespace Diligent
+{
+
+// Pyramid of minimal alpha values of the texture.
+// Used to find triangles that have no transparent texels in the UV footprint, such triangles
+// can be traced as opaque geometry without any-hit shader invocations.
+class AlphaCoverage
+{
+public:
+    using ImageData = TextureStreamer::ImageData;
+
+    // Image must be in RGBA8 format, only the first mip level is used.
+    bool Init(const ImageData& Image);
+
+    bool IsValid() const { return !m_Levels.empty(); }
+
+    // Returns true if all texels in the triangle footprint have alpha greater or equal to MinAlpha.
+    // Footprint is conservative: UV bounding box with one texel margin on the mip level
+    // where the box is not larger than MaxFootprint texels, texture is wrapped.
+    bool IsOpaque(const float2& UV0, const float2& UV1, const float2& UV2, Uint8 MinAlpha) const;
+
+    static constexpr Uint32 MaxFootprint = 16;
+
+private:
+    struct Level
+    {
+        Uint32             Width  = 0;
+        Uint32             Height = 0;
+        std::vector<Uint8> MinAlpha;
+    };
+    std::vector<Level> m_Levels;
+};
+
+} // namespace Diligent
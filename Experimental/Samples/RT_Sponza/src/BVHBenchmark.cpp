@@ -0,0 +1,196 @@
+#include "RT_Scene.hpp"
+#include "SceneUtils.hpp"
+#include "FileWrapper.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace Diligent
+{
+namespace
+{
+#include "../assets/structures.fxh"
+} // namespace
+
+
+// World space triangles of the same instances as in TLAS.
+void RT_Scene::GetTriangleBounds(const std::vector<Uint8>& Positions, const std::vector<Uint8>& Triangles, float Time, std::vector<DE::AABB>& Bounds) const
+{
+    const auto*  pPositions    = reinterpret_cast<const float3*>(Positions.data());
+    const auto*  pTriangles    = reinterpret_cast<const PrimitiveAttribs*>(Triangles.data());
+    const Uint32 VertexCount   = Uint32(Positions.size() / sizeof(float3));
+    const Uint32 TriangleCount = Uint32(Triangles.size() / sizeof(PrimitiveAttribs));
+
+    Bounds.clear();
+    for (size_t i = 0; i < m_NodeInstances.size(); ++i)
+    {
+        if (m_NodeInstances[i] == InvalidInstanceId)
+            continue;
+
+        const auto  Transform = GetNodeTransform(i, Time);
+        const auto& Mesh      = m_Meshes[m_Nodes[i].MeshId];
+        for (Uint32 g = Mesh.FirstGeometry; g < Mesh.FirstGeometry + Mesh.GeometryCount; ++g)
+        {
+            const auto& Geom = m_Geometries[g];
+            for (Uint32 t = Geom.FirstTriangle, End = std::min(Geom.FirstTriangle + Geom.IndexCount / 3, TriangleCount); t < End; ++t)
+            {
+                const auto& Face = pTriangles[t].Face;
+                if (Face.x >= VertexCount || Face.y >= VertexCount || Face.z >= VertexCount)
+                    continue;
+
+                DE::AABB Box;
+                Box.Grow(float3::MakeVector(float4{pPositions[Face.x], 1.0f} * Transform));
+                Box.Grow(float3::MakeVector(float4{pPositions[Face.y], 1.0f} * Transform));
+                Box.Grow(float3::MakeVector(float4{pPositions[Face.z], 1.0f} * Transform));
+                Bounds.push_back(Box);
+            }
+        }
+    }
+}
+
+bool RT_Scene::RunBVHBenchmark(const char* ReportFile) noexcept
+{
+    if (m_pDevice == nullptr)
+        return false;
+
+    std::vector<Uint8> Positions;
+    std::vector<Uint8> Triangles;
+    if (!ReadBufferData(m_pDevice, m_pContext, m_PositionArena.GetBuffer(), Positions, m_PositionArena.GetSize()) ||
+        !ReadBufferData(m_pDevice, m_pContext, m_TriangleArena.GetBuffer(), Triangles, m_TriangleArena.GetSize()))
+    {
+        LOG_ERROR_MESSAGE("Failed to read scene geometry for BVH benchmark");
+        return false;
+    }
+
+    using Clock = std::chrono::high_resolution_clock;
+
+    constexpr Uint32 BuildRuns = 5;
+
+    const bool AnimateNodes = m_AnimateNodes;
+    m_AnimateNodes          = false;
+
+    std::vector<DE::AABB> Bounds;
+    GetTriangleBounds(Positions, Triangles, m_SceneTime, Bounds);
+    if (Bounds.empty())
+    {
+        LOG_ERROR_MESSAGE("Scene has no triangles for BVH benchmark");
+        m_AnimateNodes = AnimateNodes;
+        return false;
+    }
+
+    LOG_INFO_MESSAGE("BVH benchmark: ", Bounds.size(), " triangles");
+
+    DE::BVH8       BVH;
+    nlohmann::json Report;
+    Report["triangles"] = Bounds.size();
+
+    // build time with single thread and with all cores
+    std::vector<Uint32> ThreadCounts{1};
+    if (std::thread::hardware_concurrency() > 1)
+        ThreadCounts.push_back(std::thread::hardware_concurrency());
+
+    for (Uint32 ThreadCount : ThreadCounts)
+    {
+        DE::BVH8::BuildSettings Settings;
+        Settings.ThreadCount = ThreadCount;
+
+        std::vector<float> BuildTimes;
+        std::vector<float> BinaryTimes;
+        std::vector<float> CollapseTimes;
+        for (Uint32 r = 0; r < BuildRuns; ++r)
+        {
+            BVH.Build(Bounds.data(), Uint32(Bounds.size()), Settings);
+
+            const auto& Stats = BVH.GetBuildStats();
+            BuildTimes.push_back(float(Stats.BinaryBuildTime + Stats.CollapseTime));
+            BinaryTimes.push_back(float(Stats.BinaryBuildTime));
+            CollapseTimes.push_back(float(Stats.CollapseTime));
+        }
+
+        nlohmann::json Build;
+        Build["threads"]      = BVH.GetBuildStats().ThreadCount;
+        Build["buildTime"]    = GetTimeStatistics(BuildTimes);
+        Build["binaryTime"]   = GetTimeStatistics(BinaryTimes);
+        Build["collapseTime"] = GetTimeStatistics(CollapseTimes);
+        Report["builds"].push_back(Build);
+    }
+
+    // quality of the default build
+    Report["binaryNodes"] = BVH.GetBuildStats().BinaryNodeCount;
+    Report["nodes"]       = BVH.GetNodeCount();
+    Report["nodeBytes"]   = BVH.GetNodeCount() * sizeof(DE::BVH8::Node);
+    Report["maxDepth"]    = BVH.GetMaxDepth();
+    Report["sahCost"]     = BVH.ComputeSAHCost();
+
+    // SAH cost depends on the number of bins
+    for (Uint32 BinCount : {4u, 8u, 16u, 32u})
+    {
+        DE::BVH8::BuildSettings Settings;
+        Settings.BinCount = BinCount;
+
+        DE::BVH8 Temp;
+        Temp.Build(Bounds.data(), Uint32(Bounds.size()), Settings);
+
+        nlohmann::json Bins;
+        Bins["binCount"] = BinCount;
+        Bins["buildMs"]  = (Temp.GetBuildStats().BinaryBuildTime + Temp.GetBuildStats().CollapseTime) * 1000.0;
+        Bins["sahCost"]  = Temp.ComputeSAHCost();
+        Report["binCounts"].push_back(Bins);
+    }
+
+    // flat layout is copied without fixups
+    {
+        std::vector<Uint8> Data;
+
+        const auto StartTime = Clock::now();
+        BVH.Serialize(Data);
+        const auto SerializedTime = Clock::now();
+
+        DE::BVH8   Loaded;
+        const bool Succeeded = Loaded.Deserialize(Data.data(), Data.size());
+        const auto EndTime   = Clock::now();
+
+        nlohmann::json Serialization;
+        Serialization["bytes"]         = Data.size();
+        Serialization["serializeMs"]   = std::chrono::duration_cast<std::chrono::duration<double>>(SerializedTime - StartTime).count() * 1000.0;
+        Serialization["deserializeMs"] = std::chrono::duration_cast<std::chrono::duration<double>>(EndTime - SerializedTime).count() * 1000.0;
+        Serialization["valid"]         = Succeeded && Loaded.GetNodeCount() == BVH.GetNodeCount();
+        Report["serialization"]        = Serialization;
+    }
+
+    // nodes are moved as in animation mode, refit keeps the topology, so the cost is compared with the full rebuild
+    {
+        m_AnimateNodes = true;
+        GetTriangleBounds(Positions, Triangles, m_SceneTime + 1.0f, Bounds);
+
+        const auto StartTime = Clock::now();
+        BVH.Refit(Bounds.data());
+        const auto EndTime = Clock::now();
+
+        DE::BVH8 Rebuilt;
+        Rebuilt.Build(Bounds.data(), Uint32(Bounds.size()));
+
+        nlohmann::json Refit;
+        Refit["refitMs"]        = std::chrono::duration_cast<std::chrono::duration<double>>(EndTime - StartTime).count() * 1000.0;
+        Refit["sahCost"]        = BVH.ComputeSAHCost();
+        Refit["rebuildSahCost"] = Rebuilt.ComputeSAHCost();
+        Refit["rebuildMs"]      = (Rebuilt.GetBuildStats().BinaryBuildTime + Rebuilt.GetBuildStats().CollapseTime) * 1000.0;
+        Report["refit"]         = Refit;
+    }
+    m_AnimateNodes = AnimateNodes;
+
+    const String Text = Report.dump(4);
+
+    FileWrapper File{ReportFile, EFileAccessMode::Overwrite};
+    if (!File || !File->Write(Text.data(), Text.size()))
+    {
+        LOG_ERROR_MESSAGE("Failed to write BVH benchmark report '", ReportFile, '\'');
+        return false;
+    }
+
+    LOG_INFO_MESSAGE("BVH benchmark report is written to '", ReportFile, "':\n", Text);
+    return true;
+}
+
+} // namespace Diligent
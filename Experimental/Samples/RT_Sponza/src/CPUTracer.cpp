@@ -0,0 +1,690 @@
+#include "CPUTracer.hpp"
+#include "BinnedSAHBuilder.h"
+#include "DebugUtilities.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define CPU_TRACER_SSE 1
+#    include <emmintrin.h>
+#else
+#    define CPU_TRACER_SSE 0
+#endif
+
+namespace Diligent
+{
+namespace
+{
+
+// 4 lanes, one ray per lane. Comparisons return lane masks with all bits set,
+// scalar fallback is used on platforms without SSE.
+struct Float4
+{
+#if CPU_TRACER_SSE
+    __m128 v;
+
+    Float4() = default;
+    Float4(__m128 x) :
+        v{x} {}
+    explicit Float4(float x) :
+        v{_mm_set1_ps(x)} {}
+    Float4(float x, float y, float z, float w) :
+        v{_mm_setr_ps(x, y, z, w)} {}
+#else
+    float v[4];
+
+    Float4() = default;
+    explicit Float4(float x) :
+        v{x, x, x, x} {}
+    Float4(float x, float y, float z, float w) :
+        v{x, y, z, w} {}
+#endif
+};
+
+#if CPU_TRACER_SSE
+
+// clang-format off
+inline Float4 operator+(Float4 a, Float4 b)  { return _mm_add_ps(a.v, b.v); }
+inline Float4 operator-(Float4 a, Float4 b)  { return _mm_sub_ps(a.v, b.v); }
+inline Float4 operator*(Float4 a, Float4 b)  { return _mm_mul_ps(a.v, b.v); }
+inline Float4 operator/(Float4 a, Float4 b)  { return _mm_div_ps(a.v, b.v); }
+inline Float4 operator<(Float4 a, Float4 b)  { return _mm_cmplt_ps(a.v, b.v); }
+inline Float4 operator<=(Float4 a, Float4 b) { return _mm_cmple_ps(a.v, b.v); }
+inline Float4 operator>=(Float4 a, Float4 b) { return _mm_cmpge_ps(a.v, b.v); }
+inline Float4 operator&(Float4 a, Float4 b)  { return _mm_and_ps(a.v, b.v); }
+inline Float4 operator|(Float4 a, Float4 b)  { return _mm_or_ps(a.v, b.v); }
+inline Float4 AndNot(Float4 a, Float4 b)     { return _mm_andnot_ps(a.v, b.v); } // ~a & b
+inline Float4 Min(Float4 a, Float4 b)        { return _mm_min_ps(a.v, b.v); }
+inline Float4 Max(Float4 a, Float4 b)        { return _mm_max_ps(a.v, b.v); }
+inline int    MoveMask(Float4 Mask)          { return _mm_movemask_ps(Mask.v); }
+inline void   Store(float* pDst, Float4 a)   { _mm_storeu_ps(pDst, a.v); }
+// clang-format on
+
+inline Float4 Select(Float4 Mask, Float4 a, Float4 b)
+{
+    return _mm_or_ps(_mm_and_ps(Mask.v, a.v), _mm_andnot_ps(Mask.v, b.v));
+}
+
+#else
+
+inline Uint32 LaneBits(float x)
+{
+    Uint32 Bits;
+    std::memcpy(&Bits, &x, sizeof(Bits));
+    return Bits;
+}
+
+inline float LaneFromBits(Uint32 Bits)
+{
+    float x;
+    std::memcpy(&x, &Bits, sizeof(x));
+    return x;
+}
+
+template <typename OpType>
+inline Float4 PerLane(Float4 a, Float4 b, OpType Op)
+{
+    Float4 r;
+    for (int i = 0; i < 4; ++i)
+        r.v[i] = Op(a.v[i], b.v[i]);
+    return r;
+}
+
+template <typename OpType>
+inline Float4 PerLaneBits(Float4 a, Float4 b, OpType Op)
+{
+    return PerLane(a, b, [Op](float x, float y) { return LaneFromBits(Op(LaneBits(x), LaneBits(y))); });
+}
+
+inline float LaneMask(bool Cond) { return LaneFromBits(Cond ? ~0u : 0u); }
+
+// clang-format off
+inline Float4 operator+(Float4 a, Float4 b)  { return PerLane(a, b, [](float x, float y) { return x + y; }); }
+inline Float4 operator-(Float4 a, Float4 b)  { return PerLane(a, b, [](float x, float y) { return x - y; }); }
+inline Float4 operator*(Float4 a, Float4 b)  { return PerLane(a, b, [](float x, float y) { return x * y; }); }
+inline Float4 operator/(Float4 a, Float4 b)  { return PerLane(a, b, [](float x, float y) { return x / y; }); }
+inline Float4 operator<(Float4 a, Float4 b)  { return PerLane(a, b, [](float x, float y) { return LaneMask(x < y); }); }
+inline Float4 operator<=(Float4 a, Float4 b) { return PerLane(a, b, [](float x, float y) { return LaneMask(x <= y); }); }
+inline Float4 operator>=(Float4 a, Float4 b) { return PerLane(a, b, [](float x, float y) { return LaneMask(x >= y); }); }
+inline Float4 operator&(Float4 a, Float4 b)  { return PerLaneBits(a, b, [](Uint32 x, Uint32 y) { return x & y; }); }
+inline Float4 operator|(Float4 a, Float4 b)  { return PerLaneBits(a, b, [](Uint32 x, Uint32 y) { return x | y; }); }
+inline Float4 AndNot(Float4 a, Float4 b)     { return PerLaneBits(a, b, [](Uint32 x, Uint32 y) { return ~x & y; }); }
+inline Float4 Min(Float4 a, Float4 b)        { return PerLane(a, b, [](float x, float y) { return x < y ? x : y; }); }
+inline Float4 Max(Float4 a, Float4 b)        { return PerLane(a, b, [](float x, float y) { return x > y ? x : y; }); }
+inline void   Store(float* pDst, Float4 a)   { std::memcpy(pDst, a.v, sizeof(a.v)); }
+// clang-format on
+
+inline int MoveMask(Float4 Mask)
+{
+    int Bits = 0;
+    for (int i = 0; i < 4; ++i)
+        Bits |= int(LaneBits(Mask.v[i]) >> 31) << i;
+    return Bits;
+}
+
+inline Float4 Select(Float4 Mask, Float4 a, Float4 b)
+{
+    Float4 r;
+    for (int i = 0; i < 4; ++i)
+        r.v[i] = (LaneBits(Mask.v[i]) >> 31) != 0 ? a.v[i] : b.v[i];
+    return r;
+}
+
+#endif
+
+inline int BitCount4(int Mask)
+{
+    return (Mask & 1) + ((Mask >> 1) & 1) + ((Mask >> 2) & 1) + ((Mask >> 3) & 1);
+}
+
+float HalfToFloat(Uint32 Half)
+{
+    const Uint32 Sign     = (Half & 0x8000u) << 16;
+    const Uint32 Exponent = (Half >> 10) & 0x1Fu;
+    const Uint32 Mantissa = Half & 0x3FFu;
+
+    if (Exponent == 0)
+    {
+        // zero or denormal
+        const float Value = std::ldexp(float(Mantissa), -24);
+        return Sign != 0 ? -Value : Value;
+    }
+
+    const Uint32 Bits = Exponent == 0x1Fu ?
+        (Sign | 0x7F800000u | (Mantissa << 13)) :
+        (Sign | ((Exponent + 112) << 23) | (Mantissa << 13));
+
+    float Value;
+    std::memcpy(&Value, &Bits, sizeof(Value));
+    return Value;
+}
+
+float2 UnpackHalf2(Uint32 Packed)
+{
+    return float2{HalfToFloat(Packed & 0xFFFFu), HalfToFloat(Packed >> 16)};
+}
+
+// primary miss color and shading constants from Primary.rm and PrimaryOpaqueHit.rch
+const float3 SkyColor{0.412f, 0.796f, 1.0f};
+const float3 LightDir{0.0f, -1.0f, 0.0f};
+
+constexpr float ShadowRayOffset = 0.001f;
+constexpr float ShadowRayMax    = 10000.0f;
+constexpr float MinLighting     = 0.25f;
+
+} // namespace
+
+
+struct CPUTracer::RayPacket
+{
+    Float4 Ox, Oy, Oz;
+    Float4 Dx, Dy, Dz;
+    Float4 InvDx, InvDy, InvDz;
+    Float4 TMin;
+    Float4 THit; // max range, the closest hit distance after tracing
+    Float4 U, V; // barycentrics of the closest hit
+    Float4 Active;
+    Float4 Hit;
+    Uint32 PrimitiveIndex[4] = {};
+    bool   DirNegative[3]    = {}; // sign of the first ray direction, packet rays are assumed to be coherent
+
+    void SetDirection(Float4 x, Float4 y, Float4 z)
+    {
+        const Float4 One{1.0f};
+
+        Dx    = x;
+        Dy    = y;
+        Dz    = z;
+        InvDx = One / x;
+        InvDy = One / y;
+        InvDz = One / z;
+
+        float Lane[4];
+        Store(Lane, x);
+        DirNegative[0] = Lane[0] < 0.0f;
+        Store(Lane, y);
+        DirNegative[1] = Lane[0] < 0.0f;
+        Store(Lane, z);
+        DirNegative[2] = Lane[0] < 0.0f;
+    }
+
+    // Returns mask of the active rays that intersect the box before the current hit.
+    Float4 IntersectBox(const float3& BoxMin, const float3& BoxMax) const
+    {
+        const Float4 X0 = (Float4{BoxMin.x} - Ox) * InvDx;
+        const Float4 X1 = (Float4{BoxMax.x} - Ox) * InvDx;
+        const Float4 Y0 = (Float4{BoxMin.y} - Oy) * InvDy;
+        const Float4 Y1 = (Float4{BoxMax.y} - Oy) * InvDy;
+        const Float4 Z0 = (Float4{BoxMin.z} - Oz) * InvDz;
+        const Float4 Z1 = (Float4{BoxMax.z} - Oz) * InvDz;
+
+        const Float4 TNear = Max(Max(Min(X0, X1), Min(Y0, Y1)), Max(Min(Z0, Z1), TMin));
+        const Float4 TFar  = Min(Min(Max(X0, X1), Max(Y0, Y1)), Min(Max(Z0, Z1), THit));
+        return Active & (TNear <= TFar);
+    }
+
+    // Moller-Trumbore test without backface culling, same as the ray tracing pipeline without cull flags.
+    // Returns bit mask of the rays that hit the triangle.
+    int IntersectTriangle(const TriangleData& Tri)
+    {
+        const Float4 E1x{Tri.E1.x}, E1y{Tri.E1.y}, E1z{Tri.E1.z};
+        const Float4 E2x{Tri.E2.x}, E2y{Tri.E2.y}, E2z{Tri.E2.z};
+
+        const Float4 Px = Dy * E2z - Dz * E2y;
+        const Float4 Py = Dz * E2x - Dx * E2z;
+        const Float4 Pz = Dx * E2y - Dy * E2x;
+
+        // parallel rays produce NaN or infinity and fail the tests below
+        const Float4 InvDet = Float4{1.0f} / (E1x * Px + E1y * Py + E1z * Pz);
+
+        const Float4 Tx = Ox - Float4{Tri.V0.x};
+        const Float4 Ty = Oy - Float4{Tri.V0.y};
+        const Float4 Tz = Oz - Float4{Tri.V0.z};
+        const Float4 BU = (Tx * Px + Ty * Py + Tz * Pz) * InvDet;
+
+        const Float4 Qx = Ty * E1z - Tz * E1y;
+        const Float4 Qy = Tz * E1x - Tx * E1z;
+        const Float4 Qz = Tx * E1y - Ty * E1x;
+        const Float4 BV = (Dx * Qx + Dy * Qy + Dz * Qz) * InvDet;
+        const Float4 T  = (E2x * Qx + E2y * Qy + E2z * Qz) * InvDet;
+
+        const Float4 Zero{0.0f};
+        const Float4 Mask = Active & (BU >= Zero) & (BV >= Zero) & (BU + BV <= Float4{1.0f}) & (T >= TMin) & (T < THit);
+
+        const int Bits = MoveMask(Mask);
+        if (Bits == 0)
+            return 0;
+
+        THit = Select(Mask, T, THit);
+        U    = Select(Mask, BU, U);
+        V    = Select(Mask, BV, V);
+        Hit  = Hit | Mask;
+        for (int i = 0; i < 4; ++i)
+        {
+            if (Bits & (1 << i))
+                PrimitiveIndex[i] = Tri.PrimitiveIndex;
+        }
+        return Bits;
+    }
+};
+
+
+bool CPUTracer::Create(const SceneDesc& Desc, std::vector<ImageData>&& BaseColorMaps, Uint32 ThreadCount)
+{
+    m_Nodes.clear();
+    m_Triangles.clear();
+    m_BaseColorMaps.clear();
+
+    if (Desc.pPositions == nullptr || Desc.pHitVertices == nullptr || Desc.pTriangles == nullptr || Desc.pGeometries == nullptr || Desc.pInstances == nullptr)
+    {
+        LOG_ERROR_MESSAGE("CPU tracer: scene data is missing");
+        return false;
+    }
+
+    const auto StartTime = std::chrono::high_resolution_clock::now();
+
+    m_Primitives.assign(Desc.pTriangles, Desc.pTriangles + Desc.TriangleCount);
+    m_VertexUV0.resize(Desc.VertexCount);
+    for (Uint32 v = 0; v < Desc.VertexCount; ++v)
+        m_VertexUV0[v] = Desc.pHitVertices[v].UV0;
+
+    // instances are flattened, triangles are transformed to world space
+    std::vector<TriangleData> Triangles;
+    for (Uint32 i = 0; i < Desc.InstanceCount; ++i)
+    {
+        const auto& Inst = Desc.pInstances[i];
+        if (Inst.FirstGeometry + Inst.GeometryCount > Desc.GeometryCount)
+        {
+            LOG_ERROR_MESSAGE("CPU tracer: instance ", i, " references invalid geometries");
+            return false;
+        }
+
+        const auto Transform = [&Inst, &Desc](Uint32 Vertex) {
+            return float3::MakeVector(float4{Desc.pPositions[Vertex], 1.0f} * Inst.Transform);
+        };
+
+        for (Uint32 g = 0; g < Inst.GeometryCount; ++g)
+        {
+            const auto& Geom = Desc.pGeometries[Inst.FirstGeometry + g];
+            if (Geom.FirstTriangle + Geom.TriangleCount > Desc.TriangleCount)
+            {
+                LOG_ERROR_MESSAGE("CPU tracer: geometry ", Inst.FirstGeometry + g, " references invalid triangles");
+                return false;
+            }
+
+            for (Uint32 t = Geom.FirstTriangle, End = Geom.FirstTriangle + Geom.TriangleCount; t < End; ++t)
+            {
+                const auto& Face = m_Primitives[t].Face;
+                if (Face.x >= Desc.VertexCount || Face.y >= Desc.VertexCount || Face.z >= Desc.VertexCount)
+                {
+                    LOG_ERROR_MESSAGE("CPU tracer: triangle ", t, " references invalid vertices");
+                    return false;
+                }
+
+                const float3 V0 = Transform(Face.x);
+                const float3 V1 = Transform(Face.y);
+                const float3 V2 = Transform(Face.z);
+
+                TriangleData Tri;
+                Tri.V0             = V0;
+                Tri.E1             = V1 - V0;
+                Tri.E2             = V2 - V0;
+                Tri.PrimitiveIndex = t;
+                Triangles.push_back(Tri);
+            }
+        }
+    }
+
+    if (Triangles.empty())
+    {
+        LOG_ERROR_MESSAGE("CPU tracer: scene is empty");
+        return false;
+    }
+
+    m_ThreadCount = ThreadCount != 0 ? ThreadCount : std::max(std::thread::hardware_concurrency(), 1u);
+
+    BuildBVH(Triangles);
+
+    // only the first mip is sampled, as textureLod(..., 0.0) in the hit shader
+    m_BaseColorMaps.resize(BaseColorMaps.size());
+    for (size_t i = 0; i < BaseColorMaps.size(); ++i)
+    {
+        const auto& Image = BaseColorMaps[i];
+        if (Image.Mips.empty() || Image.Width == 0 || Image.Height == 0)
+            continue;
+
+        if (Image.Format != TEX_FORMAT_RGBA8_UNORM && Image.Format != TEX_FORMAT_RGBA8_UNORM_SRGB)
+        {
+            LOG_ERROR_MESSAGE("CPU tracer: base color map of material ", i, " is not in RGBA8 format");
+            continue;
+        }
+
+        auto&        Dst   = m_BaseColorMaps[i];
+        const auto&  Mip   = Image.Mips[0];
+        const Uint8* pData = Image.GetData() + Mip.Offset;
+
+        Dst.Width  = Image.Width;
+        Dst.Height = Image.Height;
+        Dst.Texels.resize(size_t{Dst.Width} * Dst.Height);
+        for (Uint32 y = 0; y < Dst.Height; ++y)
+            std::memcpy(&Dst.Texels[size_t{y} * Dst.Width], pData + size_t{y} * Mip.Stride, Dst.Width * sizeof(Uint32));
+    }
+    BaseColorMaps.clear();
+
+    m_BuildTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - StartTime).count();
+
+    LOG_INFO_MESSAGE("CPU tracer: BVH with ", m_Nodes.size(), " nodes for ", m_Triangles.size(), " triangles is built in ",
+                     Uint32(m_BuildTime * 1000.0), " ms, ", m_ThreadCount, " threads");
+    return true;
+}
+
+void CPUTracer::BuildBVH(std::vector<TriangleData>& Triangles)
+{
+    const Uint32 Count = Uint32(Triangles.size());
+
+    std::vector<DE::AABB> Bounds(Count);
+    for (Uint32 i = 0; i < Count; ++i)
+    {
+        const auto& Tri = Triangles[i];
+        Bounds[i].Grow(Tri.V0);
+        Bounds[i].Grow(Tri.V0 + Tri.E1);
+        Bounds[i].Grow(Tri.V0 + Tri.E2);
+    }
+
+    DE::BVH8::BuildSettings Settings;
+    Settings.BinCount    = BinCount;
+    Settings.LeafSize    = MaxLeafTris;
+    Settings.ThreadCount = m_ThreadCount;
+
+    DE::BinaryBVH Tree;
+    DE::BuildBinaryBVH(Bounds.data(), Count, Settings, Tree);
+
+    m_Nodes.clear();
+    m_Nodes.reserve(Tree.Nodes.size());
+    FlattenNode(Tree, 0);
+
+    // leaves reference contiguous ranges of triangles
+    m_Triangles.resize(Count);
+    for (Uint32 i = 0; i < Count; ++i)
+        m_Triangles[i] = Triangles[Tree.PrimIndices[i]];
+}
+
+Uint32 CPUTracer::FlattenNode(const DE::BinaryBVH& Tree, Uint32 TreeIndex)
+{
+    const auto&  Src       = Tree.Nodes[TreeIndex];
+    const Uint32 NodeIndex = Uint32(m_Nodes.size());
+    m_Nodes.emplace_back();
+    m_Nodes[NodeIndex].BoxMin = Src.Bounds.Min;
+    m_Nodes[NodeIndex].BoxMax = Src.Bounds.Max;
+
+    if (Src.PrimCount > 0)
+    {
+        m_Nodes[NodeIndex].RightOrFirstTri = Src.FirstPrim;
+        m_Nodes[NodeIndex].TriCount        = Uint16(Src.PrimCount);
+        return NodeIndex;
+    }
+
+    // the binary tree doesn't keep the split axis, it is restored from the child centers,
+    // the child on the lower side must follow the parent for the ordered traversal
+    const float3 LeftCenter  = Tree.Nodes[Src.Left].Bounds.Center();
+    const float3 RightCenter = Tree.Nodes[Src.Left + 1].Bounds.Center();
+    const float3 Distance{std::abs(RightCenter.x - LeftCenter.x), std::abs(RightCenter.y - LeftCenter.y), std::abs(RightCenter.z - LeftCenter.z)};
+    const Uint32 SplitAxis = Distance.x >= Distance.y && Distance.x >= Distance.z ? 0 : (Distance.y >= Distance.z ? 1 : 2);
+    const bool   Swap      = LeftCenter[SplitAxis] > RightCenter[SplitAxis];
+
+    FlattenNode(Tree, Swap ? Src.Left + 1 : Src.Left);
+    const Uint32 Right = FlattenNode(Tree, Swap ? Src.Left : Src.Left + 1);
+
+    // nodes may be reallocated by the children
+    m_Nodes[NodeIndex].RightOrFirstTri = Right;
+    m_Nodes[NodeIndex].TriCount        = 0;
+    m_Nodes[NodeIndex].SplitAxis       = Uint16(SplitAxis);
+    return NodeIndex;
+}
+
+void CPUTracer::TraceClosest(RayPacket& Packet) const
+{
+    Uint32 Stack[StackSize];
+    Uint32 Top = 0;
+    Stack[Top++] = 0;
+
+    while (Top > 0)
+    {
+        const Uint32 NodeIndex = Stack[--Top];
+        const auto&  Node      = m_Nodes[NodeIndex];
+
+        // boxes are tested when the node is popped, so nodes behind the closest hit are skipped
+        if (MoveMask(Packet.IntersectBox(Node.BoxMin, Node.BoxMax)) == 0)
+            continue;
+
+        if (Node.TriCount > 0)
+        {
+            for (Uint32 t = 0; t < Node.TriCount; ++t)
+                Packet.IntersectTriangle(m_Triangles[Node.RightOrFirstTri + t]);
+            continue;
+        }
+
+        // near child is pushed last
+        const Uint32 Left  = NodeIndex + 1;
+        const Uint32 Right = Node.RightOrFirstTri;
+        const bool   Flip  = Packet.DirNegative[Node.SplitAxis];
+        VERIFY_EXPR(Top + 2 <= StackSize);
+        Stack[Top++] = Flip ? Left : Right;
+        Stack[Top++] = Flip ? Right : Left;
+    }
+}
+
+void CPUTracer::TraceShadow(RayPacket& Packet) const
+{
+    Uint32 Stack[StackSize];
+    Uint32 Top = 0;
+    Stack[Top++] = 0;
+
+    // terminate on first hit: rays are deactivated when any triangle is found
+    while (Top > 0 && MoveMask(Packet.Active) != 0)
+    {
+        const Uint32 NodeIndex = Stack[--Top];
+        const auto&  Node      = m_Nodes[NodeIndex];
+
+        if (MoveMask(Packet.IntersectBox(Node.BoxMin, Node.BoxMax)) == 0)
+            continue;
+
+        if (Node.TriCount > 0)
+        {
+            for (Uint32 t = 0; t < Node.TriCount; ++t)
+            {
+                if (Packet.IntersectTriangle(m_Triangles[Node.RightOrFirstTri + t]) != 0)
+                    Packet.Active = AndNot(Packet.Hit, Packet.Active);
+            }
+            continue;
+        }
+
+        const Uint32 Left  = NodeIndex + 1;
+        const Uint32 Right = Node.RightOrFirstTri;
+        const bool   Flip  = Packet.DirNegative[Node.SplitAxis];
+        VERIFY_EXPR(Top + 2 <= StackSize);
+        Stack[Top++] = Flip ? Left : Right;
+        Stack[Top++] = Flip ? Right : Left;
+    }
+}
+
+float3 CPUTracer::SampleBaseColor(Uint32 PrimitiveIndex, float U, float V) const
+{
+    const auto& Prim = m_Primitives[PrimitiveIndex];
+    if (Prim.MaterialId >= m_BaseColorMaps.size() || m_BaseColorMaps[Prim.MaterialId].Texels.empty())
+        return float3{1.0f, 1.0f, 1.0f};
+
+    // barycentrics are the same as hit attributes in the hit shader
+    const float2 UV = UnpackHalf2(m_VertexUV0[Prim.Face.x]) * (1.0f - U - V) +
+        UnpackHalf2(m_VertexUV0[Prim.Face.y]) * U +
+        UnpackHalf2(m_VertexUV0[Prim.Face.z]) * V;
+
+    // bilinear filter with clamp addressing, same as the immutable sampler
+    const auto& Tex  = m_BaseColorMaps[Prim.MaterialId];
+    const int   MaxX = int(Tex.Width) - 1;
+    const int   MaxY = int(Tex.Height) - 1;
+    const float x    = clamp(UV.x * float(Tex.Width) - 0.5f, -1.0f, float(MaxX));
+    const float y    = clamp(UV.y * float(Tex.Height) - 0.5f, -1.0f, float(MaxY));
+    const float fx   = std::floor(x);
+    const float fy   = std::floor(y);
+    const float wx   = x - fx;
+    const float wy   = y - fy;
+    const int   x0   = std::max(int(fx), 0);
+    const int   y0   = std::max(int(fy), 0);
+    const int   x1   = std::min(int(fx) + 1, MaxX);
+    const int   y1   = std::min(int(fy) + 1, MaxY);
+
+    const auto Fetch = [&Tex](int tx, int ty) {
+        const Uint32 Texel = Tex.Texels[size_t(ty) * Tex.Width + size_t(tx)];
+        return float3{float(Texel & 0xFF), float((Texel >> 8) & 0xFF), float((Texel >> 16) & 0xFF)} * (1.0f / 255.0f);
+    };
+
+    const float3 Top    = Fetch(x0, y0) * (1.0f - wx) + Fetch(x1, y0) * wx;
+    const float3 Bottom = Fetch(x0, y1) * (1.0f - wx) + Fetch(x1, y1) * wx;
+    return Top * (1.0f - wy) + Bottom * wy;
+}
+
+void CPUTracer::RenderTile(const Camera& Cam, Uint32 Width, Uint32 Height, Uint32 TileX, Uint32 TileY, float3* pColor, float* pDepth, FrameStats& Stats) const
+{
+    static_assert(TileSize % 2 == 0, "tile must contain whole 2x2 packets");
+
+    const float ScaleX = 1.0f / float(std::max(Width - 1, 1u));
+    const float ScaleY = 1.0f / float(std::max(Height - 1, 1u));
+    const Uint32 EndX  = std::min(TileX + TileSize, Width);
+    const Uint32 EndY  = std::min(TileY + TileSize, Height);
+
+    for (Uint32 y = TileY; y < EndY; y += 2)
+    {
+        for (Uint32 x = TileX; x < EndX; x += 2)
+        {
+            // 2x2 pixel quad, lanes outside of the image are inactive
+            const Uint32 LaneX[4] = {x, x + 1, x, x + 1};
+            const Uint32 LaneY[4] = {y, y, y + 1, y + 1};
+
+            float Dir[3][4] = {};
+            float Valid[4]  = {};
+            for (int i = 0; i < 4; ++i)
+            {
+                if (LaneX[i] >= Width || LaneY[i] >= Height)
+                    continue;
+
+                // same as direction in RayTrace.rg
+                const float  u = float(LaneX[i]) * ScaleX;
+                const float  v = float(LaneY[i]) * ScaleY;
+                const float4 D = normalize(lerp(lerp(Cam.RayLB, Cam.RayRB, u), lerp(Cam.RayLT, Cam.RayRT, u), v));
+
+                Dir[0][i] = D.x;
+                Dir[1][i] = D.y;
+                Dir[2][i] = D.z;
+                Valid[i]  = 1.0f;
+            }
+
+            RayPacket Primary;
+            Primary.Ox = Float4{Cam.Position.x};
+            Primary.Oy = Float4{Cam.Position.y};
+            Primary.Oz = Float4{Cam.Position.z};
+            Primary.SetDirection(Float4{Dir[0][0], Dir[0][1], Dir[0][2], Dir[0][3]},
+                                 Float4{Dir[1][0], Dir[1][1], Dir[1][2], Dir[1][3]},
+                                 Float4{Dir[2][0], Dir[2][1], Dir[2][2], Dir[2][3]});
+            Primary.TMin   = Float4{Cam.NearPlane};
+            Primary.THit   = Float4{Cam.FarPlane};
+            Primary.U      = Float4{0.0f};
+            Primary.V      = Float4{0.0f};
+            Primary.Active = Float4{Valid[0], Valid[1], Valid[2], Valid[3]} >= Float4{1.0f};
+            Primary.Hit    = Float4{0.0f};
+
+            TraceClosest(Primary);
+
+            // single shadow ray from the hit point, see LightingPass() in Lighting.fxh
+            RayPacket Shadow;
+            Shadow.Ox = Primary.Ox + Primary.Dx * Primary.THit + Float4{LightDir.x * ShadowRayOffset};
+            Shadow.Oy = Primary.Oy + Primary.Dy * Primary.THit + Float4{LightDir.y * ShadowRayOffset};
+            Shadow.Oz = Primary.Oz + Primary.Dz * Primary.THit + Float4{LightDir.z * ShadowRayOffset};
+            Shadow.SetDirection(Float4{LightDir.x}, Float4{LightDir.y}, Float4{LightDir.z});
+            Shadow.TMin   = Float4{0.0f};
+            Shadow.THit   = Float4{ShadowRayMax};
+            Shadow.U      = Float4{0.0f};
+            Shadow.V      = Float4{0.0f};
+            Shadow.Active = Primary.Hit;
+            Shadow.Hit    = Float4{0.0f};
+
+            if (MoveMask(Shadow.Active) != 0)
+                TraceShadow(Shadow);
+
+            Stats.PrimaryRays += BitCount4(MoveMask(Primary.Active));
+            Stats.ShadowRays += BitCount4(MoveMask(Primary.Hit));
+
+            float THit[4], U[4], V[4];
+            Store(THit, Primary.THit);
+            Store(U, Primary.U);
+            Store(V, Primary.V);
+            const int HitBits    = MoveMask(Primary.Hit);
+            const int ShadowBits = MoveMask(Shadow.Hit);
+
+            for (int i = 0; i < 4; ++i)
+            {
+                if (LaneX[i] >= Width || LaneY[i] >= Height)
+                    continue;
+
+                const size_t Pixel = size_t{LaneY[i]} * Width + LaneX[i];
+                if (HitBits & (1 << i))
+                {
+                    const float Lighting = (ShadowBits & (1 << i)) ? MinLighting : 1.0f;
+                    pColor[Pixel]        = SampleBaseColor(Primary.PrimitiveIndex[i], U[i], V[i]) * Lighting;
+                }
+                else
+                    pColor[Pixel] = SkyColor;
+
+                // miss shader returns max range as depth
+                pDepth[Pixel] = (THit[i] - Cam.NearPlane) / Cam.FarPlane;
+            }
+        }
+    }
+}
+
+void CPUTracer::Render(const Camera& Cam, Uint32 Width, Uint32 Height, std::vector<float3>& Color, std::vector<float>& Depth)
+{
+    VERIFY_EXPR(IsCreated());
+
+    Color.resize(size_t{Width} * Height);
+    Depth.resize(size_t{Width} * Height);
+
+    const auto   StartTime = std::chrono::high_resolution_clock::now();
+    const Uint32 TilesX    = (Width + TileSize - 1) / TileSize;
+    const Uint32 TilesY    = (Height + TileSize - 1) / TileSize;
+    const Uint32 TileCount = TilesX * TilesY;
+
+    std::atomic<Uint32>     NextTile{0};
+    std::vector<FrameStats> ThreadStats(m_ThreadCount);
+
+    const auto RenderTiles = [&](Uint32 ThreadIndex) {
+        for (Uint32 t = NextTile.fetch_add(1); t < TileCount; t = NextTile.fetch_add(1))
+            RenderTile(Cam, Width, Height, (t % TilesX) * TileSize, (t / TilesX) * TileSize, Color.data(), Depth.data(), ThreadStats[ThreadIndex]);
+    };
+
+    std::vector<std::thread> Workers;
+    for (Uint32 i = 1; i < m_ThreadCount; ++i)
+        Workers.emplace_back(RenderTiles, i);
+
+    RenderTiles(0);
+
+    for (auto& Worker : Workers)
+        Worker.join();
+
+    m_LastFrame             = {};
+    m_LastFrame.RenderTime  = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - StartTime).count();
+    m_LastFrame.ThreadCount = m_ThreadCount;
+    for (auto& Stats : ThreadStats)
+    {
+        m_LastFrame.PrimaryRays += Stats.PrimaryRays;
+        m_LastFrame.ShadowRays += Stats.ShadowRays;
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "TextureStreamer.hpp"
+#include "BinnedSAHBuilder.h"
+
+namespace Diligent
+{
+
+// Software implementation of RayTrace.rg with PrimaryOpaqueHit.rch, used as a reference image and
+// to compare the hardware ray tracing with the CPU:
+//  - primary ray per pixel, color is the base color map sampled at the closest hit,
+//  - color is multiplied by the visibility of the directional light from above, but not less than 0.25.
+// All instances are flattened to world space triangles in a single binned SAH BVH,
+// rays are traced in 2x2 packets with SSE, screen tiles are distributed between all cores.
+class CPUTracer
+{
+public:
+    using ImageData = TextureStreamer::ImageData;
+
+    // Same layout as PrimitiveAttribs in structures.fxh.
+    struct Triangle
+    {
+        uint3  Face;
+        Uint32 MaterialId = 0;
+    };
+
+    // Same layout as HitVertexAttribs in structures.fxh, only UV0 is used.
+    struct HitVertex
+    {
+        Uint32 Normal = 0; // octahedral encoding, 2x snorm16
+        Uint32 UV0    = 0; // 2x half
+    };
+
+    struct Geometry
+    {
+        Uint32 FirstTriangle = 0; // same as PrimitiveOffsets
+        Uint32 TriangleCount = 0;
+    };
+
+    struct Instance
+    {
+        float4x4 Transform;
+        Uint32   FirstGeometry = 0;
+        Uint32   GeometryCount = 0;
+    };
+
+    // Data is copied by Create(), pointers may be released after the call.
+    struct SceneDesc
+    {
+        const float3*    pPositions    = nullptr;
+        const HitVertex* pHitVertices  = nullptr;
+        Uint32           VertexCount   = 0;
+        const Triangle*  pTriangles    = nullptr;
+        Uint32           TriangleCount = 0;
+        const Geometry*  pGeometries   = nullptr;
+        Uint32           GeometryCount = 0;
+        const Instance*  pInstances    = nullptr;
+        Uint32           InstanceCount = 0;
+    };
+
+    // Corner rays and clip planes from CameraAttribs.
+    struct Camera
+    {
+        float3 Position;
+        float4 RayLT; // 4 components are interpolated and normalized as in RayTrace.rg
+        float4 RayLB;
+        float4 RayRT;
+        float4 RayRB;
+        float  NearPlane = 0.1f;
+        float  FarPlane  = 1000.0f;
+    };
+
+    struct FrameStats
+    {
+        double RenderTime  = 0.0; // seconds
+        Uint64 PrimaryRays = 0;
+        Uint64 ShadowRays  = 0;
+        Uint32 ThreadCount = 0;
+
+        double GetRaysPerSecond() const { return RenderTime > 0.0 ? double(PrimaryRays + ShadowRays) / RenderTime : 0.0; }
+        double GetRaysPerSecondPerCore() const { return ThreadCount > 0 ? GetRaysPerSecond() / ThreadCount : 0.0; }
+    };
+
+    // Base color maps are per material in RGBA8 format, only the first mip is used, material without image is white.
+    // ThreadCount 0 - hardware concurrency.
+    bool Create(const SceneDesc& Desc, std::vector<ImageData>&& BaseColorMaps, Uint32 ThreadCount = 0);
+
+    bool IsCreated() const { return !m_Nodes.empty(); }
+
+    // Color is in the same linear space as the color buffer, depth is normalized as in RayTrace.rg.
+    void Render(const Camera& Cam, Uint32 Width, Uint32 Height, std::vector<float3>& Color, std::vector<float>& Depth);
+
+    const FrameStats& GetLastFrameStats() const { return m_LastFrame; }
+
+    double GetBuildTime() const { return m_BuildTime; }
+    Uint32 GetNodeCount() const { return Uint32(m_Nodes.size()); }
+    Uint32 GetTriangleCount() const { return Uint32(m_Triangles.size()); }
+    Uint32 GetThreadCount() const { return m_ThreadCount; }
+
+    static constexpr Uint32 TileSize = 16; // in pixels, must be a multiple of the packet size
+
+private:
+    // Depth-first order: left child follows the parent, leaf references TriCount triangles starting from RightOrFirstTri.
+    struct Node
+    {
+        float3 BoxMin;
+        Uint32 RightOrFirstTri = 0;
+        float3 BoxMax;
+        Uint16 TriCount  = 0; // 0 for inner node
+        Uint16 SplitAxis = 0; // children are visited in order of the ray direction along this axis
+    };
+
+    // Precomputed edges for Moller-Trumbore test, in BVH leaf order.
+    struct TriangleData
+    {
+        float3 V0;
+        float3 E1;
+        float3 E2;
+        Uint32 PrimitiveIndex = 0; // in Triangles, instance transform is already applied
+    };
+
+    struct Texture
+    {
+        Uint32              Width  = 0;
+        Uint32              Height = 0;
+        std::vector<Uint32> Texels; // RGBA8
+    };
+
+    struct RayPacket;
+
+    void   BuildBVH(std::vector<TriangleData>& Triangles);
+    Uint32 FlattenNode(const DE::BinaryBVH& Tree, Uint32 TreeIndex);
+    void   RenderTile(const Camera& Cam, Uint32 Width, Uint32 Height, Uint32 TileX, Uint32 TileY, float3* pColor, float* pDepth, FrameStats& Stats) const;
+    void   TraceClosest(RayPacket& Packet) const;
+    void   TraceShadow(RayPacket& Packet) const;
+    float3 SampleBaseColor(Uint32 PrimitiveIndex, float U, float V) const;
+
+    static constexpr Uint32 BinCount    = 16;
+    static constexpr Uint32 MaxLeafTris = 4;
+    static constexpr Uint32 StackSize   = 128; // traversal stack, DE::BuildBinaryBVH uses SAH for 64 levels and median splits below
+
+    std::vector<Node>         m_Nodes;
+    std::vector<TriangleData> m_Triangles;
+    std::vector<Triangle>     m_Primitives; // triangles in the original order, referenced by PrimitiveIndex
+    std::vector<Uint32>       m_VertexUV0;  // 2x half per vertex
+    std::vector<Texture>      m_BaseColorMaps;
+    Uint32                    m_ThreadCount = 1;
+    double                    m_BuildTime   = 0.0; // seconds
+    FrameStats                m_LastFrame;
+};
+
+} // namespace Diligent
@@ -0,0 +1,70 @@
+#include "GPUArena.hpp"
+
+#include <algorithm>
+
+namespace Diligent
+{
+
+void GPUArena::Create(IRenderDevice* pDevice, const char* Name, BIND_FLAGS BindFlags, Uint32 ElementSize)
+{
+    Release();
+
+    m_pDevice     = pDevice;
+    m_Name        = Name;
+    m_BindFlags   = BindFlags;
+    m_ElementSize = ElementSize;
+}
+
+void GPUArena::Release()
+{
+    m_pBuffer.Release();
+    m_Count    = 0;
+    m_Capacity = 0;
+}
+
+Uint32 GPUArena::Append(IDeviceContext* pContext, const void* pData, Uint32 Count)
+{
+    const Uint32 First = m_Count;
+    if (Count == 0 || pData == nullptr)
+        return First;
+
+    if (!Reserve(pContext, m_Count + Count))
+        return First;
+
+    pContext->UpdateBuffer(m_pBuffer, First * m_ElementSize, Count * m_ElementSize, pData, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_Count += Count;
+    return First;
+}
+
+bool GPUArena::Reserve(IDeviceContext* pContext, Uint32 Count)
+{
+    if (Count <= m_Capacity)
+        return true;
+
+    // the first scene is allocated exactly, the next scenes grow the arena by at least half
+    const Uint32 Capacity = m_Capacity == 0 ? Count : std::max(Count, m_Capacity + m_Capacity / 2);
+
+    BufferDesc BuffDesc;
+    BuffDesc.Name          = m_Name.c_str();
+    BuffDesc.Usage         = USAGE_DEFAULT;
+    BuffDesc.BindFlags     = m_BindFlags;
+    BuffDesc.Mode          = (m_BindFlags & BIND_SHADER_RESOURCE) ? BUFFER_MODE_RAW : BUFFER_MODE_UNDEFINED;
+    BuffDesc.uiSizeInBytes = Capacity * m_ElementSize;
+
+    RefCntAutoPtr<IBuffer> pBuffer;
+    m_pDevice->CreateBuffer(BuffDesc, nullptr, &pBuffer);
+    if (pBuffer == nullptr)
+    {
+        LOG_ERROR_MESSAGE("Failed to grow '", m_Name, "' to ", BuffDesc.uiSizeInBytes, " bytes");
+        return false;
+    }
+
+    if (m_Count > 0)
+        pContext->CopyBuffer(m_pBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, pBuffer, 0, GetSize(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    m_pBuffer  = pBuffer;
+    m_Capacity = Capacity;
+    return true;
+}
+
+} // namespace Diligent
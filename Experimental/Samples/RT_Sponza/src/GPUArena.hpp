@@ -0,0 +1,46 @@
+#pragma once
+
+#include "BasicMath.hpp"
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+
+namespace Diligent
+{
+
+// GPU buffer of fixed size elements that is linearly suballocated by the scenes, ranges are never freed.
+// When the buffer is full it is recreated with a larger size and the used range is copied on the GPU,
+// so views of the previous buffer must be bound again after Append().
+class GPUArena
+{
+public:
+    GPUArena() {}
+
+    GPUArena(const GPUArena&) = delete;
+    GPUArena& operator=(const GPUArena&) = delete;
+
+    void Create(IRenderDevice* pDevice, const char* Name, BIND_FLAGS BindFlags, Uint32 ElementSize);
+    void Release();
+
+    // Copies Count elements to the end of the arena, returns index of the first element.
+    Uint32 Append(IDeviceContext* pContext, const void* pData, Uint32 Count);
+
+    IBuffer* GetBuffer() const { return m_pBuffer; }
+    Uint32   GetCount() const { return m_Count; }
+    Uint32   GetSize() const { return m_Count * m_ElementSize; } // used bytes, the buffer may be larger
+    Uint32   GetCapacity() const { return m_Capacity; }
+
+private:
+    bool Reserve(IDeviceContext* pContext, Uint32 Count);
+
+private:
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+    RefCntAutoPtr<IBuffer>       m_pBuffer;
+    String                       m_Name;
+    BIND_FLAGS                   m_BindFlags   = BIND_NONE;
+    Uint32                       m_ElementSize = 0;
+    Uint32                       m_Count       = 0;
+    Uint32                       m_Capacity    = 0;
+};
+
+} // namespace Diligent
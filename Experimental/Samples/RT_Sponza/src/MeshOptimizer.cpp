@@ -0,0 +1,209 @@
+#include "MeshOptimizer.hpp"
+#include "DebugUtilities.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Diligent
+{
+namespace
+{
+
+constexpr Uint32 MaxCachePos = MeshOptimizer::CacheSize;
+
+// Score tables from the original paper.
+struct ScoreTables
+{
+    float Cache[MaxCachePos + 1] = {}; // last element is for vertices that are not in cache
+    float Valence[64]            = {};
+
+    ScoreTables()
+    {
+        for (Uint32 i = 0; i < MaxCachePos; ++i)
+        {
+            // the last triangle vertices have fixed score, so it doesn't matter which way it is added
+            Cache[i] = i < 3 ? 0.75f : std::pow(1.0f - float(i - 3) / float(MaxCachePos - 3), 1.5f);
+        }
+        Cache[MaxCachePos] = 0.0f;
+
+        // bonus for vertices with few remaining triangles, to close holes in the mesh
+        Valence[0] = 0.0f;
+        for (Uint32 i = 1; i < _countof(Valence); ++i)
+            Valence[i] = 2.0f / std::sqrt(float(i));
+    }
+};
+
+const ScoreTables& GetScoreTables()
+{
+    static const ScoreTables Tables;
+    return Tables;
+}
+
+} // namespace
+
+
+void MeshOptimizer::OptimizeTriangleOrder(const Uint32* pIndices, Uint32 TriangleCount, std::vector<Uint32>& TriangleOrder)
+{
+    const auto& Tables = GetScoreTables();
+
+    TriangleOrder.clear();
+    if (TriangleCount == 0)
+        return;
+
+    // indices are absolute, use local vertex numbering
+    const Uint32 IndexCount = TriangleCount * 3;
+    const Uint32 MinVertex  = *std::min_element(pIndices, pIndices + IndexCount);
+    const Uint32 MaxVertex  = *std::max_element(pIndices, pIndices + IndexCount);
+    const Uint32 VertCount  = MaxVertex - MinVertex + 1;
+
+    // vertex to triangle adjacency
+    std::vector<Uint32> AdjOffsets(VertCount + 1, 0);
+    for (Uint32 i = 0; i < IndexCount; ++i)
+        ++AdjOffsets[pIndices[i] - MinVertex + 1];
+    for (Uint32 v = 0; v < VertCount; ++v)
+        AdjOffsets[v + 1] += AdjOffsets[v];
+
+    std::vector<Uint32> AdjTriangles(IndexCount);
+    std::vector<Uint32> Remaining(VertCount, 0); // number of not emitted triangles that use the vertex
+    for (Uint32 t = 0; t < TriangleCount; ++t)
+    {
+        for (Uint32 k = 0; k < 3; ++k)
+        {
+            const Uint32 v = pIndices[t * 3 + k] - MinVertex;
+            AdjTriangles[AdjOffsets[v] + Remaining[v]++] = t;
+        }
+    }
+
+    std::vector<Uint32> CachePos(VertCount, MaxCachePos);
+    std::vector<float>  VertScore(VertCount, 0.0f);
+    std::vector<float>  TriScore(TriangleCount, 0.0f);
+    std::vector<bool>   Emitted(TriangleCount, false);
+
+    const auto ComputeVertexScore = [&](Uint32 v) {
+        const Uint32 Count = Remaining[v];
+        if (Count == 0)
+            return -1.0f;
+        return Tables.Cache[CachePos[v]] + Tables.Valence[std::min<Uint32>(Count, _countof(Tables.Valence) - 1)];
+    };
+
+    for (Uint32 v = 0; v < VertCount; ++v)
+        VertScore[v] = ComputeVertexScore(v);
+
+    for (Uint32 t = 0; t < TriangleCount; ++t)
+    {
+        for (Uint32 k = 0; k < 3; ++k)
+            TriScore[t] += VertScore[pIndices[t * 3 + k] - MinVertex];
+    }
+
+    // cache contains 3 more entries for the vertices that have been just pushed out
+    Uint32 Cache[MaxCachePos + 3];
+    Uint32 CacheCount = 0;
+
+    Uint32 BestTriangle = Uint32(std::max_element(TriScore.begin(), TriScore.end()) - TriScore.begin());
+    Uint32 Cursor       = 0; // for fallback search of not emitted triangles
+
+    TriangleOrder.reserve(TriangleCount);
+    while (TriangleOrder.size() < TriangleCount)
+    {
+        if (BestTriangle == InvalidIndex)
+        {
+            // no triangles adjacent to cached vertices, take the next not emitted triangle
+            while (Emitted[Cursor])
+                ++Cursor;
+            BestTriangle = Cursor;
+        }
+
+        const Uint32 t = BestTriangle;
+        VERIFY_EXPR(!Emitted[t]);
+        Emitted[t] = true;
+        TriangleOrder.push_back(t);
+
+        // update cache, triangle vertices are moved to the front
+        Uint32 NewCache[MaxCachePos + 3];
+        Uint32 NewCount = 0;
+        for (Uint32 k = 0; k < 3; ++k)
+        {
+            const Uint32 v = pIndices[t * 3 + k] - MinVertex;
+            NewCache[NewCount++] = v;
+
+            // remove triangle from the vertex adjacency list
+            const Uint32 First = AdjOffsets[v];
+            const Uint32 Last  = First + Remaining[v];
+            for (Uint32 a = First; a < Last; ++a)
+            {
+                if (AdjTriangles[a] == t)
+                {
+                    std::swap(AdjTriangles[a], AdjTriangles[Last - 1]);
+                    break;
+                }
+            }
+            --Remaining[v];
+        }
+        for (Uint32 c = 0; c < CacheCount; ++c)
+        {
+            const Uint32 v = Cache[c];
+            if (v != NewCache[0] && v != NewCache[1] && v != NewCache[2])
+                NewCache[NewCount++] = v;
+        }
+
+        // update scores of the cached vertices and their triangles, find the best triangle
+        BestTriangle    = InvalidIndex;
+        float BestScore = 0.0f;
+        for (Uint32 c = 0; c < NewCount; ++c)
+        {
+            const Uint32 v = NewCache[c];
+            CachePos[v]    = c < MaxCachePos ? c : MaxCachePos;
+
+            const float OldScore = VertScore[v];
+            VertScore[v]         = ComputeVertexScore(v);
+            const float Delta    = VertScore[v] - OldScore;
+
+            for (Uint32 a = AdjOffsets[v], End = AdjOffsets[v] + Remaining[v]; a < End; ++a)
+            {
+                const Uint32 Tri = AdjTriangles[a];
+                TriScore[Tri] += Delta;
+                if (TriScore[Tri] > BestScore)
+                {
+                    BestScore    = TriScore[Tri];
+                    BestTriangle = Tri;
+                }
+            }
+        }
+
+        CacheCount = std::min(NewCount, MaxCachePos);
+        std::copy(NewCache, NewCache + CacheCount, Cache);
+    }
+}
+
+void MeshOptimizer::OptimizeVertexFetch(const Uint32* pIndices, Uint32 IndexCount, std::vector<Uint32>& Remap, Uint32& NextVertex)
+{
+    for (Uint32 i = 0; i < IndexCount; ++i)
+    {
+        auto& NewIndex = Remap[pIndices[i]];
+        if (NewIndex == InvalidIndex)
+            NewIndex = NextVertex++;
+    }
+}
+
+float MeshOptimizer::ComputeACMR(const Uint32* pIndices, Uint32 IndexCount, Uint32 FIFOSize)
+{
+    if (IndexCount < 3)
+        return 0.0f;
+
+    std::vector<Uint32> FIFO(FIFOSize, InvalidIndex);
+    Uint32              Head   = 0;
+    Uint32              Misses = 0;
+
+    for (Uint32 i = 0; i < IndexCount; ++i)
+    {
+        if (std::find(FIFO.begin(), FIFO.end(), pIndices[i]) != FIFO.end())
+            continue;
+
+        FIFO[Head] = pIndices[i];
+        Head       = (Head + 1) % FIFOSize;
+        ++Misses;
+    }
+    return float(Misses) / float(IndexCount / 3);
+}
+
+} // namespace Diligent
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+// Reorders triangle lists for memory locality:
+//  - triangles are sorted for post-transform vertex cache (T. Forsyth, "Linear-Speed Vertex Cache Optimisation"),
+//    neighbouring triangles are close in memory, which also helps BVH builder and hit shaders,
+//  - vertices are sorted by the first use, so vertex fetches are mostly sequential.
+// Indices are absolute, vertices may be shared between triangle lists.
+class MeshOptimizer
+{
+public:
+    static constexpr Uint32 CacheSize = 32;
+
+    // Returns new order of triangles: TriangleOrder[i] is the index of the source triangle.
+    static void OptimizeTriangleOrder(const Uint32* pIndices, Uint32 TriangleCount, std::vector<Uint32>& TriangleOrder);
+
+    // Appends vertices that are not remapped yet in order of the first use, Remap must be filled with InvalidIndex.
+    static void OptimizeVertexFetch(const Uint32* pIndices, Uint32 IndexCount, std::vector<Uint32>& Remap, Uint32& NextVertex);
+
+    // Average cache miss ratio: number of transformed vertices per triangle with FIFO cache.
+    static float ComputeACMR(const Uint32* pIndices, Uint32 IndexCount, Uint32 FIFOSize = 16);
+
+    static constexpr Uint32 InvalidIndex = ~0u;
+};
+
+} // namespace Diligent
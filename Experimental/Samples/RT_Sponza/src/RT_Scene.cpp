@@ -1,27 +1,112 @@
 #include "RT_Scene.hpp"
+#include "TextureCompressor.hpp"
+#include "MeshOptimizer.hpp"
+#include "AlphaCoverage.hpp"
+#include "SceneUtils.hpp"
+#include "BVH8.h"
 #include "ShaderMacroHelper.hpp"
 #include "DynamicLinearAllocator.hpp"
 #include "FixedBlockMemoryAllocator.hpp"
 #include "MapHelper.hpp"
+#include "FileWrapper.hpp"
+#include "DataBlobImpl.hpp"
+#include "FileSystem.hpp"
+
+#include "tinygltf/json.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <cmath>
+#include <random>
+#include <iterator>
 
 #include "../include/VulkanUtilities/VulkanHeaders.h"
 #include "EngineFactoryVk.h"
 
-#define GLFW_EXPOSE_NATIVE_WIN32
+#if PLATFORM_WIN32
+#    define GLFW_EXPOSE_NATIVE_WIN32
+#elif PLATFORM_LINUX
+#    define GLFW_EXPOSE_NATIVE_X11
+#endif
 #include "GLFW/glfw3native.h"
 
+// Xlib macros conflict with the engine types
+#if PLATFORM_LINUX
+#    undef None
+#    undef Bool
+#    undef Status
+#    undef Success
+#    undef True
+#    undef False
+#    undef Always
+#endif
+
 namespace Diligent
 {
 namespace
 {
 #include "../assets/structures.fxh"
 static_assert(sizeof(CameraAttribs) % 16 == 0, "must be aligned by 16 bytes");
-static_assert(sizeof(MaterialAttribs) % 16 == 0, "must be aligned by 16 bytes");
+static_assert(sizeof(MaterialAttribs) == 32, "material record must be packed to 32 bytes");
 static_assert(sizeof(PrimitiveAttribs) % 16 == 0, "must be aligned by 16 bytes");
 static_assert(sizeof(PrimitiveAttribs) == sizeof(GLTF::Model::TriangleAttribs), "size mismatch");
+static_assert(sizeof(VertexAttribs) == sizeof(GLTF::Model::VertexBasicAttribs), "size mismatch");
 static_assert(sizeof(VertexAttribs) % 4 == 0, "must be aligned by 4 bytes");
+static_assert(sizeof(HitVertexAttribs) == 8, "size mismatch");
+static_assert(sizeof(float3) == 12, "BLAS vertex stride mismatch");
 static_assert(sizeof(BoxAttribs) % 16 == 0, "must be aligned by 16 bytes");
+static_assert(sizeof(PrimitiveAttribs) == sizeof(CPUTracer::Triangle), "size mismatch");
+static_assert(sizeof(HitVertexAttribs) == sizeof(CPUTracer::HitVertex), "size mismatch");
+
+
+// camera and light attribs in the frame constants ring slot
+static constexpr Uint32 FrameConstantsLightOffset = (sizeof(CameraAttribs) + 15) & ~15u;
+
+// camera path is recorded to the working directory
+static constexpr char RecordedCameraPathFile[] = "camera_path.bin";
+
+// 'G' key saves the CPU tracer image to the working directory
+static constexpr char CPUReferenceFile[] = "cpu_reference.pfm";
+
+// thread group is RayQueryGroupSize x RayQueryGroupSize, see RayQuery.csh
+static constexpr Uint32 RayQueryGroupSize = 8;
+
+// dynamic resolution, 'V' key toggles it with the default target
+static constexpr float DefaultTargetFPS    = 60.0f;
+static constexpr float MinTraceScale       = 0.5f;
+static constexpr float TraceScaleTolerance = 0.05f; // frame time deviation from the target that is ignored
+static constexpr float TraceScaleDamping   = 0.25f; // measured frame was traced a few frames ago with a different scale
+
+// light grid, see LightGrid.csh
+static constexpr Uint32 LightGridGroupSize  = 64;
+static constexpr Uint32 LightGridResolution = 32; // cells along the largest side of the scene bounds
+static constexpr Uint32 MaxLightsPerCell    = 32;
+static constexpr Uint32 DefaultLightCount   = 4096; // 'K' key toggles the lights
 
+// shadow LOD, 'H' key toggles the preset
+static constexpr float  DefaultShadowRayLength = 10000.0f;
+static constexpr float  PresetShadowDistance   = 30.0f;
+static constexpr float  PresetShadowRayLength  = 50.0f;
+static constexpr Uint32 RayCounterCount        = 4; // per frame: traced and skipped shadow rays, see Lighting.fxh
+
+// auto exposure, see ToneMapping.csh and Exposure.csh
+static constexpr Uint32 ToneMapGroupSize        = 16;
+static constexpr Uint32 HistogramSize           = 256; // bin per thread in Exposure.csh
+static constexpr float  HistogramMinLog2Lum     = -10.0f;
+static constexpr float  HistogramLog2LumRange   = 14.0f;
+static constexpr float  ExposureKeyValue        = 0.18f; // middle grey
+static constexpr float  ExposureAdaptationSpeed = 1.5f;  // per second
+
+// runtime-sized material texture array, see Material.fxh
+static constexpr Uint32 MinMaterialTextureCapacity = 256;
+
+// loaded if no scene is added with '--scene'
+static constexpr char DefaultScenePath[] = "sponza/Sponza.gltf";
 
 static constexpr SHADER_TYPE RayTracingStages =
     SHADER_TYPE_RAY_GEN | SHADER_TYPE_RAY_MISS | SHADER_TYPE_RAY_CLOSEST_HIT |
@@ -41,6 +126,7 @@ void BindAllVariables(IShaderResourceBinding* pSRB, SHADER_TYPE Stages, const ch
     }
 }
 
+// Elements that do not fit the array of the variable are skipped.
 void BindAllVariables(IShaderResourceBinding* pSRB, SHADER_TYPE Stages, const char* pName, IDeviceObject* const* ppObjects, Uint32 FirstElement, Uint32 NumElements)
 {
     for (Uint32 i = 0; i < NumElements; ++i)
@@ -53,834 +139,3520 @@ void BindAllVariables(IShaderResourceBinding* pSRB, SHADER_TYPE Stages, const ch
         if (Stages & s)
         {
             if (auto* pVar = pSRB->GetVariableByName(SHADER_TYPE(s), pName))
-                pVar->SetArray(ppObjects, FirstElement, NumElements);
+            {
+                ShaderResourceDesc Desc;
+                pVar->GetResourceDesc(Desc);
+                if (FirstElement < Desc.ArraySize)
+                    pVar->SetArray(ppObjects, FirstElement, std::min(NumElements, Desc.ArraySize - FirstElement));
+            }
         }
     }
 }
 
-} // namespace
-
-
-RT_Scene::InputControllerGLFW::InputControllerGLFW()
-{}
-
-MouseState& RT_Scene::InputControllerGLFW::EditMouseState()
-{
-    return m_MouseState;
-}
-
-void RT_Scene::InputControllerGLFW::SetKeyState(InputKeys Key, INPUT_KEY_STATE_FLAGS Flags)
+// Texture indices are the same as in GLTF::Model.
+bool ParseSceneFile(const char* Path, GLTFSceneInfo& Info)
 {
-    m_Keys[Uint32(Key)] = Flags;
-}
+    FileWrapper File{Path, EFileAccessMode::Read};
+    if (!File)
+        return false;
 
+    RefCntAutoPtr<DataBlobImpl> pData{MakeNewRCObj<DataBlobImpl>{}(0)};
+    File->Read(pData);
 
-RT_Scene::RT_Scene()
-{
-}
+    const auto* pBegin = static_cast<const char*>(pData->GetDataPtr());
+    const auto  Json   = nlohmann::json::parse(pBegin, pBegin + pData->GetSize(), nullptr, false);
+    if (Json.is_discarded())
+        return false;
 
-RT_Scene::~RT_Scene()
-{
-    if (m_Window)
+    // same as in GLTF loader
+    String BaseDir = Path;
     {
-        m_Window = nullptr;
-        glfwDestroyWindow(m_Window);
-        glfwTerminate();
+        const auto Pos = BaseDir.find_last_of("/\\");
+        BaseDir        = (Pos != String::npos ? BaseDir.substr(0, Pos) : String{}) + '/';
     }
-}
 
-bool RT_Scene::Create(uint2 wndSize) noexcept
-{
-    // create window
-    {
-        if (glfwInit() != GLFW_TRUE)
-        {
-            LOG_ERROR("glfwInit - failed");
-            return false;
-        }
+    const auto IsFileUri = [](const nlohmann::json& Uri) {
+        return Uri.is_string() && Uri.get<String>().compare(0, 5, "data:") != 0;
+    };
 
-        if (glfwVulkanSupported() != GLFW_TRUE)
+    const auto Buffers = Json.find("buffers");
+    if (Buffers != Json.end())
+    {
+        for (const auto& Buff : *Buffers)
         {
-            LOG_ERROR("Vulkan is not supported by GLFW");
-            return false;
+            const auto Uri = Buff.find("uri");
+            if (Uri != Buff.end() && IsFileUri(*Uri))
+                Info.BufferPaths.push_back(BaseDir + Uri->get<String>());
         }
+    }
 
-        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-
-        m_Window = glfwCreateWindow(int(wndSize.x),
-                                    int(wndSize.y),
-                                    "RT Scene",
-                                    nullptr,
-                                    nullptr);
-        if (m_Window == nullptr)
+    const auto Nodes = Json.find("nodes");
+    if (Nodes != Json.end())
+    {
+        for (const auto& Node : *Nodes)
         {
-            LOG_ERROR("Failed to create GLFW Window");
-            return false;
+            const auto Mesh = Node.find("mesh");
+            Info.NodeMeshes.push_back(Mesh != Node.end() && Mesh->is_number_unsigned() ? Mesh->get<int>() : -1);
         }
-
-        glfwSetWindowUserPointer(m_Window, this);
-        glfwSetWindowRefreshCallback(m_Window, &GLFW_RefreshCallback);
-        glfwSetFramebufferSizeCallback(m_Window, &GLFW_ResizeCallback);
-        glfwSetKeyCallback(m_Window, &GLFW_KeyCallback);
-        glfwSetMouseButtonCallback(m_Window, &GLFW_MouseButtonCallback);
-        glfwSetCursorPosCallback(m_Window, &GLFW_CursorPosCallback);
-        glfwSetScrollCallback(m_Window, &GLFW_MouseWheelCallback);
     }
 
-    // create device
+    const auto Materials = Json.find("materials");
+    if (Materials != Json.end())
     {
-        EngineVkCreateInfo CreateInfo;
-        CreateInfo.EnableValidation    = true;
-        CreateInfo.NumDeferredContexts = 0;
-        CreateInfo.Features.RayTracing = DEVICE_FEATURE_STATE_ENABLED;
-
-        auto* Factory    = GetEngineFactoryVk();
-        m_pEngineFactory = Factory;
-
-        IRenderDevice*  Device  = nullptr;
-        IDeviceContext* Context = nullptr;
-        Factory->CreateDeviceAndContextsVk(CreateInfo, &Device, &Context);
-        if (!Device)
-            return false;
-
-        m_pDevice  = Device;
-        m_pContext = Context;
-
-        SwapChainDesc     SCDesc;
-        Win32NativeWindow Window{glfwGetWin32Window(m_Window)};
-        Factory->CreateSwapChainVk(m_pDevice, m_pContext, SCDesc, Window, &m_pSwapChain);
-
-        if (m_pSwapChain == nullptr)
+        for (const auto& Mat : *Materials)
         {
-            LOG_ERROR("Failed to create swapchain for VR emulator");
-            return false;
+            // same as in GLTF loader, specular-glossiness diffuse texture is used as base color
+            const auto     PBR = Mat.find("pbrMetallicRoughness");
+            const auto     Ext = Mat.find("extensions");
+            nlohmann::json Texture;
+            if (PBR != Mat.end() && PBR->count("baseColorTexture"))
+                Texture = (*PBR)["baseColorTexture"];
+            else if (Ext != Mat.end() && Ext->count("KHR_materials_pbrSpecularGlossiness") && (*Ext)["KHR_materials_pbrSpecularGlossiness"].count("diffuseTexture"))
+                Texture = (*Ext)["KHR_materials_pbrSpecularGlossiness"]["diffuseTexture"];
+
+            const auto Index = Texture.find("index");
+            Info.MaterialBaseColors.push_back(Texture.is_object() && Index != Texture.end() && Index->is_number_unsigned() ? Index->get<int>() : -1);
         }
     }
 
-    m_Camera.SetPos(float3(27, 10, -2.f));
-    m_Camera.SetRotation(PI_F / 2.f, 0);
-    m_Camera.SetRotationSpeed(0.005f);
-    m_Camera.SetMoveSpeed(5.f);
-    m_Camera.SetSpeedUpScales(5.f, 10.f);
-
-    OnResize(wndSize.x, wndSize.y);
-
-    LoadScene("sponza/Sponza.gltf");
-    CreateBLAS();
-    //CreateProcBLAS();
-    CreateTLAS();
+    const auto Textures = Json.find("textures");
+    const auto Images   = Json.find("images");
+    if (Textures == Json.end() || Images == Json.end())
+        return true;
 
-    CreateRayTracingPSO();
-    CreateToneMapPSO();
-    CreateSBT();
-    BindResources();
+    for (const auto& Tex : *Textures)
+    {
+        String     FilePath;
+        const auto Source = Tex.find("source");
 
-    m_pContext->Flush();
+        if (Source != Tex.end() && Source->is_number_unsigned() && Source->get<size_t>() < Images->size())
+        {
+            const auto& Img = (*Images)[Source->get<size_t>()];
+            const auto  Uri = Img.find("uri");
 
-    m_LastUpdateTime = TimePoint::clock::now();
+            if (Uri != Img.end() && IsFileUri(*Uri))
+                FilePath = BaseDir + Uri->get<String>();
+        }
+        Info.TexturePaths.push_back(std::move(FilePath));
+    }
     return true;
 }
 
-void RT_Scene::CreateRayTracingPSO()
+// Each mesh primitive is a separate BLAS geometry. GLTF loader copies mesh data for each node,
+// nodes that reference the same glTF mesh use the geometry of the first node.
+void GetModelGeometries(const GLTF::Model&                 Model,
+                        const std::vector<int>&            NodeMeshes,
+                        std::vector<SceneCache::Geometry>& Geometries,
+                        std::vector<SceneCache::Mesh>&     Meshes,
+                        std::vector<SceneCache::Node>&     Nodes,
+                        String&                            Names)
 {
-    try
-    {
-        RayTracingPipelineStateCreateInfo PSOCreateInfo;
-
-        PSOCreateInfo.PSODesc.Name         = "Ray tracing PSO";
-        PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_RAY_TRACING;
+    const auto AddName = [&Names](const String& Name) {
+        const auto Offset = Uint32(Names.size());
+        Names += Name;
+        Names += '\0';
+        return Offset;
+    };
 
-        ShaderCreateInfo ShaderCI;
+    std::unordered_map<int, Uint32> GLTFMeshToMesh;
 
-        // Create a shader source stream factory to load shaders from files.
-        RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
-        m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
-        ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+    for (auto* node : Model.LinearNodes)
+    {
+        if (node->pMesh == nullptr)
+            continue;
 
-        ShaderMacroHelper Macros;
-        Macros.AddShaderMacro("HIT_SHADER_PER_INSTANCE", HitGroupStride);
-        Macros.AddShaderMacro("PRIMARY_RAY_INDEX", PrimaryRayIndex);
-        Macros.AddShaderMacro("SHADOW_RAY_INDEX", ShadowRayIndex);
-        Macros.AddShaderMacro("NUM_TEXTURES", int(m_MaterialColorMaps.size()));
-        Macros.AddShaderMacro("MAX_RECURSION_DEPTH", MaxRecursionDepth);
+        const int GLTFMesh = node->Index < NodeMeshes.size() ? NodeMeshes[node->Index] : -1;
+        auto      Iter     = GLTFMesh >= 0 ? GLTFMeshToMesh.find(GLTFMesh) : GLTFMeshToMesh.end();
 
-        ShaderCI.Macros         = Macros;
-        ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_GLSL_VERBATIM;
+        SceneCache::Node Node;
+        Node.Transform  = node->GetMatrix();
+        Node.NameOffset = AddName(node->Name);
 
-        // Create ray generation shader.
-        RefCntAutoPtr<IShader> pRG;
+        if (Iter != GLTFMeshToMesh.end())
         {
-            ShaderCI.Desc.ShaderType = SHADER_TYPE_RAY_GEN;
-            ShaderCI.EntryPoint      = "main";
-            ShaderCI.Desc.Name       = "Ray tracing RG";
-            ShaderCI.FilePath        = "RayTrace.rg";
-            m_pDevice->CreateShader(ShaderCI, &pRG);
-            CHECK_THROW(pRG != nullptr);
+            Node.MeshId = Iter->second;
+            Nodes.push_back(Node);
+            continue;
         }
 
-        // Create ray miss shaders.
-        RefCntAutoPtr<IShader> pPrimaryMiss;
-        RefCntAutoPtr<IShader> pShadowMiss;
-        {
-            ShaderCI.Desc.ShaderType = SHADER_TYPE_RAY_MISS;
-            ShaderCI.EntryPoint      = "main";
-
-            ShaderCI.Desc.Name = "Primary miss shader";
-            ShaderCI.FilePath  = "Primary.rm";
-            m_pDevice->CreateShader(ShaderCI, &pPrimaryMiss);
-            CHECK_THROW(pPrimaryMiss != nullptr);
-
-            ShaderCI.Desc.Name = "Shadow miss shader";
-            ShaderCI.FilePath  = "Shadow.rm";
-            m_pDevice->CreateShader(ShaderCI, &pShadowMiss);
-            CHECK_THROW(pShadowMiss != nullptr);
-        }
+        SceneCache::Mesh Mesh;
+        Mesh.FirstGeometry = Uint32(Geometries.size());
 
-        // Create ray closest hit shader.
-        RefCntAutoPtr<IShader> pPrimaryOpaqueHit;
-        RefCntAutoPtr<IShader> pShadowHit;
+        Uint32 i = 0;
+        for (auto& submesh : node->pMesh->Primitives)
         {
-            ShaderCI.Desc.ShaderType = SHADER_TYPE_RAY_CLOSEST_HIT;
-            ShaderCI.EntryPoint      = "main";
-
-            ShaderCI.Desc.Name = "Primary ray triangle opaque hit shader";
-            ShaderCI.FilePath  = "PrimaryOpaqueHit.rch";
-            m_pDevice->CreateShader(ShaderCI, &pPrimaryOpaqueHit);
-            CHECK_THROW(pPrimaryOpaqueHit != nullptr);
-
-            ShaderCI.Desc.Name = "Shadow ray triangle hit shader";
-            ShaderCI.FilePath  = "ShadowHit.rch";
-            m_pDevice->CreateShader(ShaderCI, &pShadowHit);
-            CHECK_THROW(pShadowHit != nullptr);
+            SceneCache::Geometry Geom;
+            Geom.FirstIndex    = submesh.FirstIndex;
+            Geom.IndexCount    = submesh.IndexCount;
+            Geom.VertexCount   = submesh.VertexCount;
+            Geom.FirstTriangle = submesh.FirstTriangle;
+            Geom.MaterialId    = submesh.MaterialId;
+            Geom.NameOffset    = AddName(node->Name + "_" + std::to_string(i++));
+            Geom.Opaque        = Model.Materials[submesh.MaterialId].AlphaMode == GLTF::Material::ALPHA_MODE_OPAQUE;
+            Geometries.push_back(Geom);
         }
+        Mesh.GeometryCount = Uint32(Geometries.size()) - Mesh.FirstGeometry;
 
-        const RayTracingGeneralShaderGroup GeneralShaders[] = {
-            {"Main", pRG},
-            {"PrimaryMiss", pPrimaryMiss},
-            {"ShadowMiss", pShadowMiss} //
-        };
-
-        const RayTracingTriangleHitShaderGroup TriangleHitShaders[] = {
-            {"PrimaryOpaqueHit", pPrimaryOpaqueHit},
-            {"ShadowHit", pShadowHit} //
-        };
-
-        PSOCreateInfo.pGeneralShaders        = GeneralShaders;
-        PSOCreateInfo.GeneralShaderCount     = _countof(GeneralShaders);
-        PSOCreateInfo.pTriangleHitShaders    = TriangleHitShaders;
-        PSOCreateInfo.TriangleHitShaderCount = _countof(TriangleHitShaders);
-
-        PSOCreateInfo.RayTracingPipeline.MaxRecursionDepth = MaxRecursionDepth;
-
-        PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
-
-        m_pDevice->CreateRayTracingPipelineState(PSOCreateInfo, &m_pRayTracingPSO);
-        CHECK_THROW(m_pRayTracingPSO != nullptr);
+        Node.MeshId = Uint32(Meshes.size());
+        Meshes.push_back(Mesh);
+        Nodes.push_back(Node);
 
-        m_pRayTracingPSO->CreateShaderResourceBinding(&m_pRayTracingSRB, true);
-        CHECK_THROW(m_pRayTracingSRB != nullptr);
+        if (GLTFMesh >= 0)
+            GLTFMeshToMesh.emplace(GLTFMesh, Node.MeshId);
     }
-    catch (...)
-    {}
 }
 
-void RT_Scene::CreateToneMapPSO()
+// Converts float to IEEE 754 half with rounding to nearest even, out of range values are clamped.
+Uint16 FloatToHalf(float Value)
 {
-    try
-    {
-        GraphicsPipelineStateCreateInfo PSOCreateInfo;
+    Uint32 Bits;
+    std::memcpy(&Bits, &Value, sizeof(Bits));
 
-        PSOCreateInfo.PSODesc.Name         = "Image blit PSO";
-        PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_GRAPHICS;
+    const Uint32 Sign    = (Bits >> 16) & 0x8000u;
+    const Uint32 AbsBits = Bits & 0x7FFFFFFFu;
 
-        PSOCreateInfo.GraphicsPipeline.NumRenderTargets             = 1;
-        PSOCreateInfo.GraphicsPipeline.RTVFormats[0]                = m_pSwapChain->GetDesc().ColorBufferFormat;
-        PSOCreateInfo.GraphicsPipeline.PrimitiveTopology            = PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
-        PSOCreateInfo.GraphicsPipeline.RasterizerDesc.CullMode      = CULL_MODE_NONE;
-        PSOCreateInfo.GraphicsPipeline.DepthStencilDesc.DepthEnable = False;
+    // NaN and infinity
+    if (AbsBits >= 0x7F800000u)
+        return Uint16(Sign | (AbsBits > 0x7F800000u ? 0x7E00u : 0x7C00u));
 
-        ShaderCreateInfo ShaderCI;
-
-        // Create a shader source stream factory to load shaders from files.
-        RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
-        m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
-        ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
-
-        ShaderCI.UseCombinedTextureSamplers = true;
-        ShaderCI.SourceLanguage             = SHADER_SOURCE_LANGUAGE_GLSL_VERBATIM;
+    // rounds to infinity, clamp to max half
+    if (AbsBits >= 0x477FF000u)
+        return Uint16(Sign | 0x7BFFu);
 
-        RefCntAutoPtr<IShader> pVS;
-        {
-            ShaderCI.Desc.ShaderType = SHADER_TYPE_VERTEX;
-            ShaderCI.EntryPoint      = "main";
-            ShaderCI.Desc.Name       = "Tone mapping vertex shader";
-            ShaderCI.FilePath        = "ToneMapping.vsh";
-            m_pDevice->CreateShader(ShaderCI, &pVS);
-            CHECK_THROW(pVS != nullptr);
-        }
+    // half denormals
+    if (AbsBits < 0x38800000u)
+    {
+        if (AbsBits < 0x33000000u)
+            return Uint16(Sign);
+
+        const Uint32 Exp     = AbsBits >> 23;
+        const Uint32 Mant    = (AbsBits & 0x7FFFFFu) | 0x800000u;
+        const Uint32 Shift   = 126 - Exp;
+        const Uint32 Rem     = Mant & ((1u << Shift) - 1);
+        const Uint32 HalfWay = 1u << (Shift - 1);
+        Uint32       Half    = Mant >> Shift;
+        if (Rem > HalfWay || (Rem == HalfWay && (Half & 1)))
+            ++Half;
+        return Uint16(Sign | Half);
+    }
 
-        RefCntAutoPtr<IShader> pPS;
-        {
-            ShaderCI.Desc.ShaderType = SHADER_TYPE_PIXEL;
-            ShaderCI.EntryPoint      = "main";
-            ShaderCI.Desc.Name       = "Tone mapping pixel shader";
-            ShaderCI.FilePath        = "ToneMapping.psh";
-            m_pDevice->CreateShader(ShaderCI, &pPS);
-            CHECK_THROW(pPS != nullptr);
-        }
+    // rebias exponent from 127 to 15, mantissa overflow correctly increments the exponent
+    const Uint32 Rem  = AbsBits & 0x1FFFu;
+    Uint32       Half = (AbsBits - 0x38000000u) >> 13;
+    if (Rem > 0x1000u || (Rem == 0x1000u && (Half & 1)))
+        ++Half;
+    return Uint16(Sign | Half);
+}
 
-        PSOCreateInfo.pVS = pVS;
-        PSOCreateInfo.pPS = pPS;
+// Same layout as unpackHalf2x16() in GLSL.
+Uint32 PackHalf2(float x, float y)
+{
+    return Uint32(FloatToHalf(x)) | (Uint32(FloatToHalf(y)) << 16);
+}
 
-        SamplerDesc SamLinearClampDesc{
-            FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR,
-            TEXTURE_ADDRESS_CLAMP, TEXTURE_ADDRESS_CLAMP, TEXTURE_ADDRESS_CLAMP};
+// Material texture indices are the same as in GLTF::Model.
+void GetModelMaterials(const GLTF::Model& Model, std::vector<MaterialAttribs>& Materials, std::vector<SceneCache::MaterialInfo>& MaterialInfos)
+{
+    Materials.reserve(Model.Materials.size());
+    MaterialInfos.reserve(Model.Materials.size());
 
-        ImmutableSamplerDesc ImmutableSamplers[] = {
-            {SHADER_TYPE_PIXEL, "g_ColorBuffer", SamLinearClampDesc},
-            {SHADER_TYPE_PIXEL, "g_DepthBuffer", SamLinearClampDesc}};
+    const auto PackUnorm16 = [](float x, float y) {
+        return Uint32(clamp(x, 0.0f, 1.0f) * 65535.0f + 0.5f) | (Uint32(clamp(y, 0.0f, 1.0f) * 65535.0f + 0.5f) << 16);
+    };
 
-        PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers    = ImmutableSamplers;
-        PSOCreateInfo.PSODesc.ResourceLayout.NumImmutableSamplers = _countof(ImmutableSamplers);
-        PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType  = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
+    for (auto& mat : Model.Materials)
+    {
+        const auto& Emissive = mat.Attribs.EmissiveFactor;
 
-        m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pToneMapPSO);
-        CHECK_THROW(m_pToneMapPSO != nullptr);
+        MaterialAttribs mtrAttribs;
+        mtrAttribs.BaseColorFactor   = mat.Attribs.BaseColorFactor;
+        mtrAttribs.EmissiveFactor    = uint2{PackHalf2(Emissive.x, Emissive.y), PackHalf2(Emissive.z, 0.0f)};
+        mtrAttribs.MetallicRoughness = PackUnorm16(mat.Attribs.MetallicFactor, mat.Attribs.RoughnessFactor);
+        mtrAttribs.AlphaMode         = Uint32(mat.AlphaMode);
+        Materials.push_back(mtrAttribs);
 
-        m_pToneMapPSO->CreateShaderResourceBinding(&m_pToneMapSRB, true);
-        CHECK_THROW(m_pToneMapSRB != nullptr);
+        SceneCache::MaterialInfo Info;
+        Info.BaseColorTexture = mat.TextureIds[GLTF::Material::TEXTURE_ID_BASE_COLOR];
+        Info.AlphaMode        = Uint32(mat.AlphaMode);
+        MaterialInfos.push_back(Info);
     }
-    catch (...)
-    {}
 }
 
-void RT_Scene::BindResources()
+// Octahedral normal encoding, same layout as unpackSnorm2x16() in GLSL.
+Uint32 PackOctNormal(const float3& Normal)
 {
-    using BufID = GLTF::Model::BUFFER_ID;
+    const float L1 = std::abs(Normal.x) + std::abs(Normal.y) + std::abs(Normal.z);
+    if (L1 <= 0.0f)
+        return 0;
 
-    if (m_pRayTracingSRB)
+    float x = Normal.x / L1;
+    float y = Normal.y / L1;
+    if (Normal.z < 0.0f)
     {
-        BindAllVariables(m_pRayTracingSRB, RayTracingStages, "g_TLAS", m_pTLAS);
-
-        BindAllVariables(m_pRayTracingSRB, RayTracingStages, "un_CameraAttribs", m_CameraAttribsCB);
-        BindAllVariables(m_pRayTracingSRB, RayTracingStages, "un_LightAttribs", m_LightAttribsCB);
-
-        BindAllVariables(m_pRayTracingSRB, RayTracingStages, "un_VertexAttribs", m_Model->GetBuffer(BufID::BUFFER_ID_VERTEX_BASIC_ATTRIBS)->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
-        BindAllVariables(m_pRayTracingSRB, RayTracingStages, "un_Primitives", m_Model->GetBuffer(BufID::BUFFER_ID_TRIANGLES)->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
-        BindAllVariables(m_pRayTracingSRB, RayTracingStages, "un_PrimitiveOffsets", reinterpret_cast<IDeviceObject* const*>(m_PrimitiveOffsets.data()), 0, Uint32(m_PrimitiveOffsets.size()));
-
-        BindAllVariables(m_pRayTracingSRB, RayTracingStages, "un_MaterialAttribs", m_MaterialAttribsSB->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
-        BindAllVariables(m_pRayTracingSRB, RayTracingStages, "g_MaterialColorMaps", reinterpret_cast<IDeviceObject* const*>(m_MaterialColorMaps.data()), 0, Uint32(m_MaterialColorMaps.size()));
+        const float ox = x;
+        x              = (1.0f - std::abs(y)) * (ox >= 0.0f ? 1.0f : -1.0f);
+        y              = (1.0f - std::abs(ox)) * (y >= 0.0f ? 1.0f : -1.0f);
     }
+
+    const auto ToSnorm16 = [](float v) {
+        return Uint32(Uint16(Int16(std::round(clamp(v, -1.0f, 1.0f) * 32767.0f))));
+    };
+    return ToSnorm16(x) | (ToSnorm16(y) << 16);
 }
 
-void RT_Scene::ReloadShaders()
+struct PackedVertexData
 {
-    m_pContext->WaitForIdle();
-
-    LOG_INFO_MESSAGE("============================================================\n");
-
-    RefCntAutoPtr<IPipelineState>         oldRayTracingPSO = m_pRayTracingPSO;
-    RefCntAutoPtr<IPipelineState>         oldToneMapPSO    = m_pToneMapPSO;
-    RefCntAutoPtr<IShaderResourceBinding> oldRayTracingSRB = m_pRayTracingSRB;
-    RefCntAutoPtr<IShaderResourceBinding> oldToneMapSRB    = m_pToneMapSRB;
+    std::vector<float3>           Positions;  // used by BLAS
+    std::vector<HitVertexAttribs> HitAttribs; // used by hit shaders
+    std::vector<Uint32>           UV1;        // 2x half, empty if the scene has no UV1
+};
+
+// Splits vertices into positions for BLAS and compact attributes that are fetched in hit shaders:
+// 40 bytes per vertex are reduced to 12 bytes of position and 8 bytes of normal and UV0.
+void PackVertexAttribs(const VertexAttribs* pVertices, size_t Count, PackedVertexData& Data)
+{
+    Data.Positions.resize(Count);
+    Data.HitAttribs.resize(Count);
+    Data.UV1.clear();
 
-    m_pRayTracingPSO = nullptr;
-    m_pRayTracingSRB = nullptr;
-    m_pToneMapPSO    = nullptr;
-    m_pToneMapSRB    = nullptr;
-    m_pSBT           = nullptr;
+    bool HasUV1 = false;
+    for (size_t i = 0; i < Count; ++i)
+    {
+        const auto& Vert = pVertices[i];
 
-    CreateRayTracingPSO();
-    CreateToneMapPSO();
+        Data.Positions[i]         = float3{Vert.posX, Vert.posY, Vert.posZ};
+        Data.HitAttribs[i].Normal = PackOctNormal(float3{Vert.normX, Vert.normY, Vert.normZ});
+        Data.HitAttribs[i].UV0    = PackHalf2(Vert.u0, Vert.v0);
 
-    if (m_pRayTracingPSO == nullptr)
-    {
-        m_pRayTracingPSO = oldRayTracingPSO;
-        m_pRayTracingSRB = oldRayTracingSRB;
+        HasUV1 = HasUV1 || Vert.u1 != 0.0f || Vert.v1 != 0.0f;
     }
 
-    if (m_pToneMapPSO == nullptr)
+    if (HasUV1)
     {
-        m_pToneMapPSO = oldToneMapPSO;
-        m_pToneMapSRB = oldToneMapSRB;
+        Data.UV1.resize(Count);
+        for (size_t i = 0; i < Count; ++i)
+            Data.UV1[i] = PackHalf2(pVertices[i].u1, pVertices[i].v1);
     }
-
-    BindResources();
-    CreateSBT();
 }
 
-void RT_Scene::CreateBLAS()
+// Splits geometries with alpha tested or blended materials into opaque and non-opaque parts.
+// Triangle is opaque if the base color alpha in its UV footprint always passes the alpha test,
+// triangles are reordered inside the geometry range so the opaque part goes first.
+// Coverage is indexed by MaterialInfo::BaseColorTexture.
+void SplitAlphaGeometries(const std::vector<MaterialAttribs>&          Materials,
+                          const std::vector<SceneCache::MaterialInfo>& MaterialInfos,
+                          const std::vector<AlphaCoverage>&            Coverage,
+                          const std::vector<Uint8>&                    VertexData,
+                          std::vector<Uint8>&                          IndexData,
+                          std::vector<Uint8>&                          TriangleData,
+                          std::vector<SceneCache::Geometry>&           Geometries,
+                          std::vector<SceneCache::Mesh>&               Meshes,
+                          String&                                      Names)
 {
-    struct PerInstance
-    {
-        std::vector<BLASTriangleDesc>      TriangleInfos;
-        std::vector<BLASBuildTriangleData> TriangleData;
-        std::vector<Uint32>                PrimitiveOffsets;
-        std::vector<const char*>           GeometryNames;
-    };
-    PerInstance            Opaque;
-    PerInstance            Translucent;
-    DynamicLinearAllocator TempPool{GetRawAllocator()};
-
-    Opaque.TriangleInfos.reserve(m_Model->LinearNodes.size());
-    Opaque.TriangleData.reserve(m_Model->LinearNodes.size());
-
-    IBuffer* TriangleBuffer = m_Model->GetBuffer(GLTF::Model::BUFFER_ID_TRIANGLES);
-    if (TriangleBuffer == nullptr)
+    const auto*  pVertices     = reinterpret_cast<const VertexAttribs*>(VertexData.data());
+    auto* const  pIndices      = reinterpret_cast<Uint32*>(IndexData.data());
+    auto* const  pTriangles    = reinterpret_cast<PrimitiveAttribs*>(TriangleData.data());
+    const size_t VertexCount   = VertexData.size() / sizeof(VertexAttribs);
+    const size_t IndexCount    = IndexData.size() / sizeof(Uint32);
+    const size_t TriangleCount = TriangleData.size() / sizeof(PrimitiveAttribs);
+
+    if (IndexCount == 0)
         return;
 
-    const Uint32 TriangleBufferSize = TriangleBuffer->GetDesc().uiSizeInBytes;
+    std::vector<SceneCache::Geometry> NewGeometries;
+    std::vector<Uint32>               TriOpaque;
+    std::vector<Uint32>               SrcIndices;
+    std::vector<PrimitiveAttribs>     SrcTriangles;
+    Uint32                            TotalCount  = 0;
+    Uint32                            OpaqueCount = 0;
 
-    for (auto* node : m_Model->LinearNodes)
+    NewGeometries.reserve(Geometries.size());
+    for (auto& Mesh : Meshes)
     {
-        if (node->pMesh)
+        const Uint32 FirstGeometry = Uint32(NewGeometries.size());
+
+        for (Uint32 g = Mesh.FirstGeometry; g < Mesh.FirstGeometry + Mesh.GeometryCount; ++g)
         {
-            Uint32 i = 0;
-            for (auto& submesh : node->pMesh->Primitives)
+            const auto&  Geom         = Geometries[g];
+            const Uint32 GeomTriCount = Geom.IndexCount / 3;
+
+            if (Geom.Opaque || GeomTriCount == 0 ||
+                Geom.FirstIndex + Geom.IndexCount > IndexCount || Geom.FirstTriangle + GeomTriCount > TriangleCount)
             {
-                auto&                  mat     = m_Model->Materials[submesh.MaterialId];
-                BLASTriangleDesc*      Info    = nullptr;
-                BLASBuildTriangleData* TriData = nullptr;
-                const char*            Name    = TempPool.CopyString(node->Name + "_" + std::to_string(i++));
+                NewGeometries.push_back(Geom);
+                continue;
+            }
 
-                VERIFY_EXPR((submesh.FirstTriangle + submesh.IndexCount / 3) * sizeof(PrimitiveAttribs) <= TriangleBufferSize);
+            // alpha test passes if texture alpha * alpha factor >= cutoff, blended geometry is opaque only if alpha is 1
+            const auto&  MatInfo  = MaterialInfos[Geom.MaterialId];
+            const float  Factor   = Materials[Geom.MaterialId].BaseColorFactor.w;
+            const float  Cutoff   = MatInfo.AlphaMode == GLTF::Material::ALPHA_MODE_MASK ? 0.5f : 1.0f;
+            const float  Required = Factor > 0.0f ? Cutoff / Factor : 2.0f;
+            const auto*  pCov     = MatInfo.BaseColorTexture >= 0 ? &Coverage[MatInfo.BaseColorTexture] : nullptr;
+            const Uint8  MinAlpha = Uint8(std::ceil(clamp(Required, 0.0f, 1.0f) * 255.0f));
+            Uint32*      pGeomIdx = pIndices + Geom.FirstIndex;
+            Uint32       Opaque   = 0;
+
+            TriOpaque.resize(GeomTriCount);
+            for (Uint32 t = 0; t < GeomTriCount; ++t)
+            {
+                const Uint32* pTri        = pGeomIdx + t * 3;
+                bool          IsOpaqueTri = Required <= 1.0f;
 
-                if (mat.AlphaMode == GLTF::Material::ALPHA_MODE_OPAQUE)
-                {
-                    Opaque.TriangleInfos.emplace_back();
-                    Opaque.TriangleData.emplace_back();
-                    Opaque.PrimitiveOffsets.push_back(submesh.FirstTriangle);
-                    Opaque.GeometryNames.push_back(Name);
-                    Info    = &Opaque.TriangleInfos.back();
-                    TriData = &Opaque.TriangleData.back();
-                }
-                else
+                if (IsOpaqueTri && pCov != nullptr)
                 {
-                    Translucent.TriangleInfos.emplace_back();
-                    Translucent.TriangleData.emplace_back();
-                    Translucent.PrimitiveOffsets.push_back(submesh.FirstTriangle);
-                    Translucent.GeometryNames.push_back(Name);
-                    Info    = &Translucent.TriangleInfos.back();
-                    TriData = &Translucent.TriangleData.back();
+                    if (pTri[0] < VertexCount && pTri[1] < VertexCount && pTri[2] < VertexCount && pCov->IsValid())
+                    {
+                        const auto& V0 = pVertices[pTri[0]];
+                        const auto& V1 = pVertices[pTri[1]];
+                        const auto& V2 = pVertices[pTri[2]];
+                        IsOpaqueTri    = pCov->IsOpaque(float2{V0.u0, V0.v0}, float2{V1.u0, V1.v0}, float2{V2.u0, V2.v0}, MinAlpha);
+                    }
+                    else
+                        IsOpaqueTri = false;
                 }
 
-                Info->GeometryName         = Name;
-                Info->MaxVertexCount       = submesh.VertexCount;
-                Info->VertexValueType      = VT_FLOAT32;
-                Info->VertexComponentCount = 3;
-                Info->MaxPrimitiveCount    = submesh.IndexCount / 3;
-                Info->IndexType            = submesh.HasIndices() ? VT_UINT32 : VT_UNDEFINED;
-
-                TriData->GeometryName         = Info->GeometryName;
-                TriData->pVertexBuffer        = m_Model->GetBuffer(GLTF::Model::BUFFER_ID_VERTEX_BASIC_ATTRIBS);
-                TriData->VertexStride         = sizeof(GLTF::Model::VertexBasicAttribs);
-                TriData->VertexCount          = Info->MaxVertexCount;
-                TriData->VertexValueType      = Info->VertexValueType;
-                TriData->VertexComponentCount = Info->VertexComponentCount;
-                TriData->pIndexBuffer         = submesh.HasIndices() ? m_Model->GetBuffer(GLTF::Model::BUFFER_ID_INDEX) : nullptr;
-                TriData->PrimitiveCount       = Info->MaxPrimitiveCount;
-                TriData->IndexOffset          = submesh.FirstIndex * sizeof(Uint32);
-                TriData->IndexType            = Info->IndexType;
-                TriData->Flags                = RAYTRACING_GEOMETRY_FLAG_NONE;
+                TriOpaque[t] = IsOpaqueTri ? 1 : 0;
+                Opaque += TriOpaque[t];
             }
+
+            TotalCount += GeomTriCount;
+            OpaqueCount += Opaque;
+
+            if (Opaque == 0 || Opaque == GeomTriCount)
+            {
+                NewGeometries.push_back(Geom);
+                NewGeometries.back().Opaque = Opaque == GeomTriCount;
+                continue;
+            }
+
+            // stable partition, index triples and triangle attributes must have the same order
+            PrimitiveAttribs* pGeomTris = pTriangles + Geom.FirstTriangle;
+            SrcIndices.assign(pGeomIdx, pGeomIdx + GeomTriCount * 3);
+            SrcTriangles.assign(pGeomTris, pGeomTris + GeomTriCount);
+
+            // opaque triangles are moved to the front, non-opaque triangles follow them
+            Uint32 OpaquePos = 0;
+            Uint32 AlphaPos  = Opaque;
+            for (Uint32 t = 0; t < GeomTriCount; ++t)
+            {
+                Uint32& Pos = TriOpaque[t] ? OpaquePos : AlphaPos;
+                std::copy_n(&SrcIndices[t * 3], 3, pGeomIdx + Pos * 3);
+                pGeomTris[Pos] = SrcTriangles[t];
+                ++Pos;
+            }
+
+            SceneCache::Geometry OpaquePart = Geom;
+            OpaquePart.IndexCount           = Opaque * 3;
+            OpaquePart.Opaque               = 1;
+
+            // geometry names must be unique in BLAS
+            SceneCache::Geometry AlphaPart = Geom;
+            AlphaPart.FirstIndex           = Geom.FirstIndex + Opaque * 3;
+            AlphaPart.IndexCount           = Geom.IndexCount - Opaque * 3;
+            AlphaPart.FirstTriangle        = Geom.FirstTriangle + Opaque;
+            AlphaPart.NameOffset           = Uint32(Names.size());
+            Names += String{Names.c_str() + Geom.NameOffset} + "_alpha";
+            Names += '\0';
+
+            NewGeometries.push_back(OpaquePart);
+            NewGeometries.push_back(AlphaPart);
+        }
+
+        Mesh.FirstGeometry = FirstGeometry;
+        Mesh.GeometryCount = Uint32(NewGeometries.size()) - FirstGeometry;
+    }
+
+    Geometries = std::move(NewGeometries);
+
+    if (TotalCount > 0)
+        LOG_INFO_MESSAGE("Alpha classification: ", OpaqueCount, " of ", TotalCount, " alpha tested or blended triangles are opaque");
+}
+
+// Reorders triangles of each geometry for vertex cache and then all vertices in order of the first use.
+// Geometry ranges in index and triangle buffers are not changed, so primitive offsets and BLAS geometries stay valid.
+void OptimizeGeometryLayout(const std::vector<SceneCache::Geometry>& Geometries,
+                            std::vector<Uint8>&                      VertexData,
+                            std::vector<Uint8>&                      IndexData,
+                            std::vector<Uint8>&                      TriangleData)
+{
+    auto* const  pVertices     = reinterpret_cast<VertexAttribs*>(VertexData.data());
+    auto* const  pIndices      = reinterpret_cast<Uint32*>(IndexData.data());
+    auto* const  pTriangles    = reinterpret_cast<PrimitiveAttribs*>(TriangleData.data());
+    const Uint32 VertexCount   = Uint32(VertexData.size() / sizeof(VertexAttribs));
+    const Uint32 IndexCount    = Uint32(IndexData.size() / sizeof(Uint32));
+    const Uint32 TriangleCount = Uint32(TriangleData.size() / sizeof(PrimitiveAttribs));
+
+    if (IndexCount == 0 || VertexCount == 0)
+        return;
+
+    // validate before any changes
+    const bool IsValid =
+        std::all_of(pIndices, pIndices + IndexCount, [VertexCount](Uint32 Idx) { return Idx < VertexCount; }) &&
+        std::all_of(pTriangles, pTriangles + TriangleCount, [VertexCount](const PrimitiveAttribs& Tri) {
+            return Tri.Face.x < VertexCount && Tri.Face.y < VertexCount && Tri.Face.z < VertexCount;
+        }) &&
+        std::all_of(Geometries.begin(), Geometries.end(), [&](const SceneCache::Geometry& Geom) {
+            return Geom.FirstIndex + Geom.IndexCount <= IndexCount && Geom.FirstTriangle + Geom.IndexCount / 3 <= TriangleCount;
+        });
+    if (!IsValid)
+    {
+        LOG_ERROR_MESSAGE("Scene geometry has invalid indices, geometry layout optimization is skipped");
+        return;
+    }
+
+    const float ACMRBefore = MeshOptimizer::ComputeACMR(pIndices, IndexCount);
+
+    std::vector<Uint32>           TriangleOrder;
+    std::vector<Uint32>           SrcIndices;
+    std::vector<PrimitiveAttribs> SrcTriangles;
+    std::vector<Uint32>           Remap(VertexCount, MeshOptimizer::InvalidIndex);
+    Uint32                        NextVertex = 0;
+
+    for (auto& Geom : Geometries)
+    {
+        const Uint32 GeomTriCount = Geom.IndexCount / 3;
+        if (GeomTriCount == 0)
+            continue;
+
+        Uint32*           pGeomIndices   = pIndices + Geom.FirstIndex;
+        PrimitiveAttribs* pGeomTriangles = pTriangles + Geom.FirstTriangle;
+
+        MeshOptimizer::OptimizeTriangleOrder(pGeomIndices, GeomTriCount, TriangleOrder);
+
+        // gl_PrimitiveID is the index of the triangle in BLAS geometry, triangle attributes must have the same order
+        SrcIndices.assign(pGeomIndices, pGeomIndices + GeomTriCount * 3);
+        SrcTriangles.assign(pGeomTriangles, pGeomTriangles + GeomTriCount);
+        for (Uint32 t = 0; t < GeomTriCount; ++t)
+        {
+            const Uint32 Src = TriangleOrder[t];
+            std::copy_n(&SrcIndices[Src * 3], 3, pGeomIndices + t * 3);
+            pGeomTriangles[t] = SrcTriangles[Src];
+        }
+
+        MeshOptimizer::OptimizeVertexFetch(pGeomIndices, GeomTriCount * 3, Remap, NextVertex);
+    }
+
+    // vertices that are not used by geometries are moved to the end
+    for (auto& NewIndex : Remap)
+    {
+        if (NewIndex == MeshOptimizer::InvalidIndex)
+            NewIndex = NextVertex++;
+    }
+    VERIFY_EXPR(NextVertex == VertexCount);
+
+    const std::vector<VertexAttribs> SrcVertices(pVertices, pVertices + VertexCount);
+    for (Uint32 v = 0; v < VertexCount; ++v)
+        pVertices[Remap[v]] = SrcVertices[v];
+
+    for (Uint32 i = 0; i < IndexCount; ++i)
+        pIndices[i] = Remap[pIndices[i]];
+
+    for (Uint32 t = 0; t < TriangleCount; ++t)
+    {
+        auto& Face = pTriangles[t].Face;
+        Face       = uint3{Remap[Face.x], Remap[Face.y], Remap[Face.z]};
+    }
+
+    LOG_INFO_MESSAGE("Geometry layout optimized, ACMR: ", ACMRBefore, " -> ", MeshOptimizer::ComputeACMR(pIndices, IndexCount));
+}
+
+RefCntAutoPtr<IBuffer> CreateSceneBuffer(IRenderDevice* pDevice, const char* Name, BIND_FLAGS BindFlags, const void* pData, size_t Size)
+{
+    BufferDesc BuffDesc;
+    BuffDesc.Name          = Name;
+    BuffDesc.Usage         = USAGE_IMMUTABLE;
+    BuffDesc.BindFlags     = BindFlags;
+    BuffDesc.Mode          = (BindFlags & BIND_SHADER_RESOURCE) ? BUFFER_MODE_RAW : BUFFER_MODE_UNDEFINED;
+    BuffDesc.uiSizeInBytes = Uint32(Size);
+
+    BufferData             BuffData{pData, BuffDesc.uiSizeInBytes};
+    RefCntAutoPtr<IBuffer> pBuffer;
+    pDevice->CreateBuffer(BuffDesc, &BuffData, &pBuffer);
+    VERIFY_EXPR(pBuffer != nullptr);
+    return pBuffer;
+}
+
+// Measures GPU time of one-time commands, such as scene loading steps.
+class GPUTimer
+{
+public:
+    GPUTimer(IRenderDevice* pDevice, IDeviceContext* pContext, const char* Name) :
+        m_pContext{pContext}
+    {
+        if (pDevice->GetDeviceCaps().Features.TimestampQueries != DEVICE_FEATURE_STATE_ENABLED)
+            return;
+
+        QueryDesc Desc;
+        Desc.Name = Name;
+        Desc.Type = QUERY_TYPE_TIMESTAMP;
+        pDevice->CreateQuery(Desc, &m_pBegin);
+        pDevice->CreateQuery(Desc, &m_pEnd);
+
+        if (m_pBegin != nullptr && m_pEnd != nullptr)
+            m_pContext->EndQuery(m_pBegin);
+    }
+
+    void Stop()
+    {
+        if (m_pBegin != nullptr && m_pEnd != nullptr)
+            m_pContext->EndQuery(m_pEnd);
+    }
+
+    // Waits for GPU, returns time in seconds or negative value if timestamp queries are not supported.
+    double Resolve()
+    {
+        if (m_pBegin == nullptr || m_pEnd == nullptr)
+            return -1.0;
+
+        m_pContext->WaitForIdle();
+
+        QueryDataTimestamp Begin;
+        QueryDataTimestamp End;
+        if (!m_pBegin->GetData(&Begin, sizeof(Begin)) || !m_pEnd->GetData(&End, sizeof(End)) || End.Frequency == 0)
+            return -1.0;
+
+        return double(End.Counter - Begin.Counter) / double(End.Frequency);
+    }
+
+private:
+    IDeviceContext*       m_pContext;
+    RefCntAutoPtr<IQuery> m_pBegin;
+    RefCntAutoPtr<IQuery> m_pEnd;
+};
+
+// Frustum corner rays for the ray generation shader.
+void GetCameraAttribs(const FirstPersonCamera& Camera, CameraAttribs& Attribs)
+{
+    float3 CameraWorldPos = float3::MakeVector(Camera.GetWorldMatrix()[3]);
+    auto   CameraViewProj = Camera.GetViewMatrix() * Camera.GetProjMatrix();
+
+    ViewFrustum Frustum;
+    ExtractViewFrustumPlanesFromMatrix(CameraViewProj, Frustum, false);
+
+    for (uint i = 0; i < ViewFrustum::NUM_PLANES; ++i)
+    {
+        Plane3D& plane  = Frustum.GetPlane(static_cast<ViewFrustum::PLANE_IDX>(i));
+        float    invlen = 1.0f / length(plane.Normal);
+        plane.Normal *= invlen;
+        plane.Distance *= invlen;
+    }
+
+    const auto GetPlaneIntersection = [&Frustum](ViewFrustum::PLANE_IDX lhs, ViewFrustum::PLANE_IDX rhs, float4& result) {
+        const Plane3D& lp = Frustum.GetPlane(lhs);
+        const Plane3D& rp = Frustum.GetPlane(rhs);
+
+        const float3 dir = cross(lp.Normal, rp.Normal);
+        const float  len = dot(dir, dir);
+
+        if (std::abs(len) <= 1.0e-5)
+            return false;
+
+        result = dir * (1.0f / sqrt(len));
+        return true;
+    };
+
+    // clang-format off
+    GetPlaneIntersection(ViewFrustum::BOTTOM_PLANE_IDX, ViewFrustum::LEFT_PLANE_IDX,   Attribs.FrustumRayLB);
+    GetPlaneIntersection(ViewFrustum::LEFT_PLANE_IDX,   ViewFrustum::TOP_PLANE_IDX,    Attribs.FrustumRayLT);
+    GetPlaneIntersection(ViewFrustum::RIGHT_PLANE_IDX,  ViewFrustum::BOTTOM_PLANE_IDX, Attribs.FrustumRayRB);
+    GetPlaneIntersection(ViewFrustum::TOP_PLANE_IDX,    ViewFrustum::RIGHT_PLANE_IDX,  Attribs.FrustumRayRT);
+    // clang-format on
+    Attribs.Position   = -float4{CameraWorldPos, 1.0f};
+    Attribs.ClipPlanes = float2{0.1f, 1000.0f};
+}
+
+// Portable float map, RGB rows from bottom to top.
+bool WritePFM(const char* FilePath, const std::vector<float3>& Color, Uint32 Width, Uint32 Height)
+{
+    VERIFY_EXPR(Color.size() == size_t{Width} * Height);
+
+    FileWrapper File{FilePath, EFileAccessMode::Overwrite};
+    if (!File)
+        return false;
+
+    const String Header = "PF\n" + std::to_string(Width) + " " + std::to_string(Height) + "\n-1.0\n";
+    if (!File->Write(Header.data(), Header.size()))
+        return false;
+
+    for (Uint32 y = Height; y-- > 0;)
+    {
+        if (!File->Write(&Color[size_t{y} * Width], sizeof(float3) * Width))
+            return false;
+    }
+    return true;
+}
+
+template <typename T>
+SceneCache::Array<T> ToArray(const T* pData, size_t Count)
+{
+    SceneCache::Array<T> Result;
+    Result.pData = pData;
+    Result.Count = Uint32(Count);
+    return Result;
+}
+
+} // namespace
+
+// Arrays of the single scene with indices relative to the scene, see RT_Scene::AppendScene().
+struct RT_Scene::SceneData
+{
+    template <typename T>
+    using Array = SceneCache::Array<T>;
+
+    Array<float3>                   Positions;
+    Array<HitVertexAttribs>         HitAttribs;
+    Array<Uint32>                   HitUV1; // empty if the scene has no UV1
+    Array<Uint32>                   Indices;
+    Array<PrimitiveAttribs>         Triangles;
+    Array<SceneCache::Geometry>     Geometries;
+    Array<SceneCache::Mesh>         Meshes;
+    Array<SceneCache::Node>         Nodes;
+    Array<char>                     Names;
+    Array<MaterialAttribs>          Materials;
+    Array<SceneCache::MaterialInfo> MaterialInfos;
+    Uint32                          TextureCount = 0; // MaterialInfo::BaseColorTexture is less than TextureCount
+};
+
+
+RT_Scene::InputControllerGLFW::InputControllerGLFW()
+{}
+
+MouseState& RT_Scene::InputControllerGLFW::EditMouseState()
+{
+    return m_MouseState;
+}
+
+void RT_Scene::InputControllerGLFW::SetKeyState(InputKeys Key, INPUT_KEY_STATE_FLAGS Flags)
+{
+    m_Keys[Uint32(Key)] = Flags;
+}
+
+
+RT_Scene::RT_Scene()
+{
+}
+
+void RT_Scene::AddScene(const char* Path, const float4x4& Transform)
+{
+    SceneRange Scene;
+    Scene.Path      = Path;
+    Scene.Transform = Transform;
+    m_Scenes.push_back(std::move(Scene));
+
+    // scenes that are added before the device is created are loaded by LoadScenes()
+    if (m_pDevice != nullptr)
+        LoadAddedScene(m_Scenes.back());
+}
+
+RT_Scene::~RT_Scene()
+{
+    if (m_CameraRecorder.IsActive())
+        m_CameraRecorder.Stop(RecordedCameraPathFile);
+
+    // frames in flight may still use resources
+    if (m_pContext)
+        m_pContext->WaitForIdle();
+
+    if (m_Window)
+    {
+        m_Window = nullptr;
+        glfwDestroyWindow(m_Window);
+        glfwTerminate();
+    }
+}
+
+bool RT_Scene::Create(uint2 wndSize) noexcept
+{
+    m_StartTime = TimePoint::clock::now();
+
+    // create window
+    {
+        if (glfwInit() != GLFW_TRUE)
+        {
+            LOG_ERROR("glfwInit - failed");
+            return false;
+        }
+
+        if (glfwVulkanSupported() != GLFW_TRUE)
+        {
+            LOG_ERROR("Vulkan is not supported by GLFW");
+            return false;
+        }
+
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+
+        m_Window = glfwCreateWindow(int(wndSize.x),
+                                    int(wndSize.y),
+                                    "RT Scene",
+                                    nullptr,
+                                    nullptr);
+        if (m_Window == nullptr)
+        {
+            LOG_ERROR("Failed to create GLFW Window");
+            return false;
+        }
+
+        glfwSetWindowUserPointer(m_Window, this);
+        glfwSetWindowRefreshCallback(m_Window, &GLFW_RefreshCallback);
+        glfwSetFramebufferSizeCallback(m_Window, &GLFW_ResizeCallback);
+        glfwSetKeyCallback(m_Window, &GLFW_KeyCallback);
+        glfwSetMouseButtonCallback(m_Window, &GLFW_MouseButtonCallback);
+        glfwSetCursorPosCallback(m_Window, &GLFW_CursorPosCallback);
+        glfwSetScrollCallback(m_Window, &GLFW_MouseWheelCallback);
+        glfwSetDropCallback(m_Window, &GLFW_DropCallback);
+    }
+
+    if (!CreateDevice(true, true))
+        return false;
+
+    // create swapchain
+    {
+        SwapChainDesc SCDesc;
+#if PLATFORM_WIN32
+        Win32NativeWindow Window{glfwGetWin32Window(m_Window)};
+#elif PLATFORM_LINUX
+        LinuxNativeWindow Window;
+        Window.WindowId = static_cast<Uint32>(glfwGetX11Window(m_Window));
+        Window.pDisplay = glfwGetX11Display();
+#else
+#    error Unsupported platform
+#endif
+        GetEngineFactoryVk()->CreateSwapChainVk(m_pDevice, m_pContext, SCDesc, Window, &m_pSwapChain);
+
+        if (m_pSwapChain == nullptr)
+        {
+            LOG_ERROR("Failed to create swapchain for VR emulator");
+            return false;
+        }
+        m_OutputFormat = m_pSwapChain->GetDesc().ColorBufferFormat;
+    }
+
+    return CreateScene(wndSize);
+}
+
+bool RT_Scene::CreateHeadless(uint2 Size, bool RequireRayTracing) noexcept
+{
+    m_StartTime = TimePoint::clock::now();
+
+    // validation is disabled, it distorts timings and layers may be missing on CI machines
+    if (!CreateDevice(false, RequireRayTracing))
+        return false;
+
+    // frames are tone mapped to the image that is created in OnResize() and are not copied
+    m_OutputFormat = TEX_FORMAT_RGBA8_UNORM_SRGB;
+
+    return CreateScene(Size);
+}
+
+bool RT_Scene::CreateDevice(bool EnableValidation, bool RequireRayTracing)
+{
+    // surface and swapchain are not required, device can be created with software Vulkan implementation,
+    // without ray tracing only the CPU tracer can render, e.g. with lavapipe on GPU-less CI machines
+    {
+        const auto RayTracingState = RequireRayTracing ? DEVICE_FEATURE_STATE_ENABLED : DEVICE_FEATURE_STATE_OPTIONAL;
+
+        EngineVkCreateInfo CreateInfo;
+        CreateInfo.EnableValidation                    = EnableValidation;
+        CreateInfo.NumDeferredContexts                 = 0;
+        CreateInfo.Features.RayTracing                 = RayTracingState;
+        CreateInfo.Features.RayTracing2                = DEVICE_FEATURE_STATE_OPTIONAL; // inline ray tracing for RayQuery.csh
+        CreateInfo.Features.ShaderResourceRuntimeArray = RayTracingState;               // g_MaterialColorMaps in Material.fxh
+        CreateInfo.Features.TimestampQueries           = DEVICE_FEATURE_STATE_OPTIONAL;
+
+        auto* Factory    = GetEngineFactoryVk();
+        m_pEngineFactory = Factory;
+
+        IRenderDevice*  Device  = nullptr;
+        IDeviceContext* Context = nullptr;
+        Factory->CreateDeviceAndContextsVk(CreateInfo, &Device, &Context);
+        if (!Device)
+        {
+            LOG_ERROR(RequireRayTracing ? "Failed to create Vulkan device with ray tracing support" : "Failed to create Vulkan device");
+            return false;
+        }
+
+        m_pDevice  = Device;
+        m_pContext = Context;
+
+        const auto& Features = m_pDevice->GetDeviceCaps().Features;
+        m_HasRayTracing      = Features.RayTracing == DEVICE_FEATURE_STATE_ENABLED && Features.ShaderResourceRuntimeArray == DEVICE_FEATURE_STATE_ENABLED;
+        if (!m_HasRayTracing)
+            LOG_INFO_MESSAGE("Device does not support ray tracing, BLAS, TLAS and ray tracing pipelines are not created");
+    }
+
+    {
+        FenceDesc Desc;
+        Desc.Name = "Frame fence";
+        m_pDevice->CreateFence(Desc, &m_pFrameFence);
+        if (m_pFrameFence == nullptr)
+        {
+            LOG_ERROR_MESSAGE("Failed to create frame fence");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RT_Scene::CreateScene(uint2 Size)
+{
+    m_Camera.SetPos(float3(27, 10, -2.f));
+    m_Camera.SetRotation(PI_F / 2.f, 0);
+    m_Camera.SetRotationSpeed(0.005f);
+    m_Camera.SetMoveSpeed(5.f);
+    m_Camera.SetSpeedUpScales(5.f, 10.f);
+
+    OnResize(Size.x, Size.y);
+
+    if (m_Scenes.empty())
+        AddScene(DefaultScenePath, float4x4::RotationX(PI_F) * float4x4::Scale(0.05f)); // Sponza is flipped and scaled for the default camera
+
+    LoadScenes();
+    if (m_HasRayTracing)
+    {
+        CreateBLAS();
+        //CreateProcBLAS();
+        CreateTLAS();
+    }
+    else
+        CreateNodeList();
+
+    // placeholder buffers for the disabled lights
+    SetLightCount(0);
+
+    {
+        ShaderPipelines Pipelines;
+        CreateRayTracingPSO(Pipelines);
+        CreateRayQueryPSO(Pipelines);
+        CreateLightGridPSO(Pipelines);
+        CreateToneMapPSO(Pipelines);
+        SwapPipelines(Pipelines);
+    }
+
+    m_pContext->Flush();
+
+    m_LastUpdateTime = TimePoint::clock::now();
+    return true;
+}
+
+// Implicit resource layout does not support runtime-sized arrays, so the ray tracing and ray query
+// pipelines use the explicit signature with the same scene resources.
+RefCntAutoPtr<IPipelineResourceSignature> RT_Scene::CreateSceneSignature(const char* Name, SHADER_TYPE Stages) const
+{
+    constexpr auto VarType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
+
+    std::vector<PipelineResourceDesc> Resources = {
+        {Stages, "g_TLAS", 1, SHADER_RESOURCE_TYPE_ACCEL_STRUCT, VarType},
+        {Stages, "g_ColorBuffer", 1, SHADER_RESOURCE_TYPE_TEXTURE_UAV, VarType},
+        {Stages, "g_DepthBuffer", 1, SHADER_RESOURCE_TYPE_TEXTURE_UAV, VarType},
+        {Stages, "un_CameraAttribs", 1, SHADER_RESOURCE_TYPE_CONSTANT_BUFFER, VarType},
+        {Stages, "un_LightAttribs", 1, SHADER_RESOURCE_TYPE_CONSTANT_BUFFER, VarType},
+        {Stages, "un_Lights", 1, SHADER_RESOURCE_TYPE_BUFFER_SRV, VarType},
+        {Stages, "un_LightGridCells", 1, SHADER_RESOURCE_TYPE_BUFFER_SRV, VarType},
+        {Stages, "un_RayCounters", 1, SHADER_RESOURCE_TYPE_BUFFER_UAV, VarType},
+        {Stages, "un_HitVertexAttribs", 1, SHADER_RESOURCE_TYPE_BUFFER_SRV, VarType},
+        {Stages, "un_Primitives", 1, SHADER_RESOURCE_TYPE_BUFFER_SRV, VarType},
+        {Stages, "un_PrimitiveOffsets", 1, SHADER_RESOURCE_TYPE_BUFFER_SRV, VarType},
+        {Stages, "un_MaterialAttribs", 1, SHADER_RESOURCE_TYPE_BUFFER_SRV, VarType},
+        // variable descriptor count, only the textures of the loaded materials are bound
+        {Stages, "g_MaterialColorMaps", m_MaterialTextureCapacity, SHADER_RESOURCE_TYPE_TEXTURE_SRV, VarType,
+         PIPELINE_RESOURCE_FLAG_COMBINED_SAMPLER | PIPELINE_RESOURCE_FLAG_RUNTIME_ARRAY},
+        // placeholder is bound while no scene has UV1, so pipelines do not depend on the loaded scenes
+        {Stages, "un_HitVertexUV1", 1, SHADER_RESOURCE_TYPE_BUFFER_SRV, VarType}};
+
+    PipelineResourceSignatureDesc Desc;
+    Desc.Name         = Name;
+    Desc.Resources    = Resources.data();
+    Desc.NumResources = Uint32(Resources.size());
+
+    RefCntAutoPtr<IPipelineResourceSignature> pSignature;
+    m_pDevice->CreatePipelineResourceSignature(Desc, &pSignature);
+    return pSignature;
+}
+
+void RT_Scene::ReserveMaterialTextures(Uint32 Count)
+{
+    if (Count <= m_MaterialTextureCapacity)
+        return;
+
+    // reloading pipelines read the capacity on the worker thread, so they are completed first
+    if (m_ShaderReloadTask.valid())
+    {
+        m_ShaderReloadTask.wait();
+        UpdateShaders();
+    }
+
+    // pipelines are created for the capacity with slack, so the next scenes usually use the same pipelines
+    const bool Recreate       = m_MaterialTextureCapacity > 0;
+    m_MaterialTextureCapacity = std::max(MinMaterialTextureCapacity, Count + Count / 2);
+    LOG_INFO_MESSAGE("Material texture capacity: ", m_MaterialTextureCapacity);
+
+    if (!Recreate)
+        return;
+
+    // If compilation failed the current pipelines are kept, textures over their capacity are not bound, see BindResources().
+    ShaderPipelines Pipelines;
+    CreateRayTracingPSO(Pipelines);
+    CreateRayQueryPSO(Pipelines);
+    SwapPipelines(Pipelines);
+}
+
+void RT_Scene::CreateRayTracingPSO(ShaderPipelines& Pipelines) const
+{
+    if (!m_HasRayTracing)
+        return;
+
+    try
+    {
+        RayTracingPipelineStateCreateInfo PSOCreateInfo;
+
+        PSOCreateInfo.PSODesc.Name         = "Ray tracing PSO";
+        PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_RAY_TRACING;
+
+        ShaderCreateInfo ShaderCI;
+
+        // Create a shader source stream factory to load shaders from files.
+        RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
+        m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
+        ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+
+        ShaderMacroHelper Macros;
+        Macros.AddShaderMacro("HIT_SHADER_PER_INSTANCE", HitGroupStride);
+        Macros.AddShaderMacro("PRIMARY_RAY_INDEX", PrimaryRayIndex);
+        Macros.AddShaderMacro("SHADOW_RAY_INDEX", ShadowRayIndex);
+        Macros.AddShaderMacro("MAX_RECURSION_DEPTH", MaxRecursionDepth);
+
+        ShaderCI.Macros         = Macros;
+        ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_GLSL_VERBATIM;
+
+        // Create ray generation shader.
+        RefCntAutoPtr<IShader> pRG;
+        {
+            ShaderCI.Desc.ShaderType = SHADER_TYPE_RAY_GEN;
+            ShaderCI.EntryPoint      = "main";
+            ShaderCI.Desc.Name       = "Ray tracing RG";
+            ShaderCI.FilePath        = "RayTrace.rg";
+            m_pDevice->CreateShader(ShaderCI, &pRG);
+            CHECK_THROW(pRG != nullptr);
+        }
+
+        // Create ray miss shaders.
+        RefCntAutoPtr<IShader> pPrimaryMiss;
+        RefCntAutoPtr<IShader> pShadowMiss;
+        {
+            ShaderCI.Desc.ShaderType = SHADER_TYPE_RAY_MISS;
+            ShaderCI.EntryPoint      = "main";
+
+            ShaderCI.Desc.Name = "Primary miss shader";
+            ShaderCI.FilePath  = "Primary.rm";
+            m_pDevice->CreateShader(ShaderCI, &pPrimaryMiss);
+            CHECK_THROW(pPrimaryMiss != nullptr);
+
+            ShaderCI.Desc.Name = "Shadow miss shader";
+            ShaderCI.FilePath  = "Shadow.rm";
+            m_pDevice->CreateShader(ShaderCI, &pShadowMiss);
+            CHECK_THROW(pShadowMiss != nullptr);
+        }
+
+        // Create ray closest hit shader.
+        RefCntAutoPtr<IShader> pPrimaryOpaqueHit;
+        RefCntAutoPtr<IShader> pShadowHit;
+        {
+            ShaderCI.Desc.ShaderType = SHADER_TYPE_RAY_CLOSEST_HIT;
+            ShaderCI.EntryPoint      = "main";
+
+            ShaderCI.Desc.Name = "Primary ray triangle opaque hit shader";
+            ShaderCI.FilePath  = "PrimaryOpaqueHit.rch";
+            m_pDevice->CreateShader(ShaderCI, &pPrimaryOpaqueHit);
+            CHECK_THROW(pPrimaryOpaqueHit != nullptr);
+
+            ShaderCI.Desc.Name = "Shadow ray triangle hit shader";
+            ShaderCI.FilePath  = "ShadowHit.rch";
+            m_pDevice->CreateShader(ShaderCI, &pShadowHit);
+            CHECK_THROW(pShadowHit != nullptr);
+        }
+
+        const RayTracingGeneralShaderGroup GeneralShaders[] = {
+            {"Main", pRG},
+            {"PrimaryMiss", pPrimaryMiss},
+            {"ShadowMiss", pShadowMiss} //
+        };
+
+        const RayTracingTriangleHitShaderGroup TriangleHitShaders[] = {
+            {"PrimaryOpaqueHit", pPrimaryOpaqueHit},
+            {"ShadowHit", pShadowHit} //
+        };
+
+        PSOCreateInfo.pGeneralShaders        = GeneralShaders;
+        PSOCreateInfo.GeneralShaderCount     = _countof(GeneralShaders);
+        PSOCreateInfo.pTriangleHitShaders    = TriangleHitShaders;
+        PSOCreateInfo.TriangleHitShaderCount = _countof(TriangleHitShaders);
+
+        PSOCreateInfo.RayTracingPipeline.MaxRecursionDepth = MaxRecursionDepth;
+
+        auto pSignature = CreateSceneSignature("Ray tracing signature", RayTracingStages);
+        CHECK_THROW(pSignature != nullptr);
+
+        IPipelineResourceSignature* Signatures[] = {pSignature};
+        PSOCreateInfo.ppResourceSignatures       = Signatures;
+        PSOCreateInfo.ResourceSignaturesCount    = _countof(Signatures);
+
+        m_pDevice->CreateRayTracingPipelineState(PSOCreateInfo, &Pipelines.RayTracingPSO);
+        CHECK_THROW(Pipelines.RayTracingPSO != nullptr);
+
+        pSignature->CreateShaderResourceBinding(&Pipelines.RayTracingSRB, true);
+        CHECK_THROW(Pipelines.RayTracingSRB != nullptr);
+
+        Pipelines.RayTracingTextureCapacity = m_MaterialTextureCapacity;
+    }
+    catch (...)
+    {}
+}
+
+void RT_Scene::CreateRayQueryPSO(ShaderPipelines& Pipelines) const
+{
+    if (!m_HasRayTracing || m_pDevice->GetDeviceCaps().Features.RayTracing2 != DEVICE_FEATURE_STATE_ENABLED)
+        return;
+
+    try
+    {
+        ComputePipelineStateCreateInfo PSOCreateInfo;
+
+        PSOCreateInfo.PSODesc.Name         = "Ray query PSO";
+        PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+
+        ShaderCreateInfo ShaderCI;
+
+        RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
+        m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
+        ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+
+        ShaderMacroHelper Macros;
+        Macros.AddShaderMacro("GROUP_SIZE", RayQueryGroupSize);
+
+        ShaderCI.Macros         = Macros;
+        ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_GLSL_VERBATIM;
+
+        RefCntAutoPtr<IShader> pCS;
+        {
+            ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
+            ShaderCI.EntryPoint      = "main";
+            ShaderCI.Desc.Name       = "Ray query CS";
+            ShaderCI.FilePath        = "RayQuery.csh";
+            m_pDevice->CreateShader(ShaderCI, &pCS);
+            CHECK_THROW(pCS != nullptr);
+        }
+
+        PSOCreateInfo.pCS = pCS;
+
+        auto pSignature = CreateSceneSignature("Ray query signature", SHADER_TYPE_COMPUTE);
+        CHECK_THROW(pSignature != nullptr);
+
+        IPipelineResourceSignature* Signatures[] = {pSignature};
+        PSOCreateInfo.ppResourceSignatures       = Signatures;
+        PSOCreateInfo.ResourceSignaturesCount    = _countof(Signatures);
+
+        m_pDevice->CreateComputePipelineState(PSOCreateInfo, &Pipelines.RayQueryPSO);
+        CHECK_THROW(Pipelines.RayQueryPSO != nullptr);
+
+        pSignature->CreateShaderResourceBinding(&Pipelines.RayQuerySRB, true);
+        CHECK_THROW(Pipelines.RayQuerySRB != nullptr);
+
+        Pipelines.RayQueryTextureCapacity = m_MaterialTextureCapacity;
+    }
+    catch (...)
+    {}
+}
+
+void RT_Scene::CreateLightGridPSO(ShaderPipelines& Pipelines) const
+{
+    try
+    {
+        ComputePipelineStateCreateInfo PSOCreateInfo;
+
+        PSOCreateInfo.PSODesc.Name         = "Light grid PSO";
+        PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+
+        ShaderCreateInfo ShaderCI;
+
+        RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
+        m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
+        ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+
+        ShaderMacroHelper Macros;
+        Macros.AddShaderMacro("GROUP_SIZE", LightGridGroupSize);
+
+        ShaderCI.Macros         = Macros;
+        ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_GLSL_VERBATIM;
+
+        RefCntAutoPtr<IShader> pCS;
+        {
+            ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
+            ShaderCI.EntryPoint      = "main";
+            ShaderCI.Desc.Name       = "Light grid CS";
+            ShaderCI.FilePath        = "LightGrid.csh";
+            m_pDevice->CreateShader(ShaderCI, &pCS);
+            CHECK_THROW(pCS != nullptr);
+        }
+
+        PSOCreateInfo.pCS = pCS;
+
+        PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
+
+        m_pDevice->CreateComputePipelineState(PSOCreateInfo, &Pipelines.LightGridPSO);
+        CHECK_THROW(Pipelines.LightGridPSO != nullptr);
+
+        Pipelines.LightGridPSO->CreateShaderResourceBinding(&Pipelines.LightGridSRB, true);
+        CHECK_THROW(Pipelines.LightGridSRB != nullptr);
+    }
+    catch (...)
+    {}
+}
+
+void RT_Scene::CreateToneMapPSO(ShaderPipelines& Pipelines) const
+{
+    try
+    {
+        ComputePipelineStateCreateInfo PSOCreateInfo;
+
+        PSOCreateInfo.PSODesc.Name         = "Tone mapping PSO";
+        PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+
+        ShaderCreateInfo ShaderCI;
+
+        // Create a shader source stream factory to load shaders from files.
+        RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
+        m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
+        ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+
+        // swapchain may have BGRA format, tone mapped image is copied to it without conversion
+        const bool OutputBGRA = m_OutputFormat == TEX_FORMAT_BGRA8_UNORM || m_OutputFormat == TEX_FORMAT_BGRA8_UNORM_SRGB;
+
+        ShaderMacroHelper Macros;
+        Macros.AddShaderMacro("GROUP_SIZE", ToneMapGroupSize);
+        Macros.AddShaderMacro("HISTOGRAM_SIZE", HistogramSize);
+        if (OutputBGRA)
+            Macros.AddShaderMacro("OUTPUT_BGRA", 1);
+
+        ShaderCI.Macros                     = Macros;
+        ShaderCI.UseCombinedTextureSamplers = true;
+        ShaderCI.SourceLanguage             = SHADER_SOURCE_LANGUAGE_GLSL_VERBATIM;
+
+        RefCntAutoPtr<IShader> pCS;
+        {
+            ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
+            ShaderCI.EntryPoint      = "main";
+            ShaderCI.Desc.Name       = "Tone mapping CS";
+            ShaderCI.FilePath        = "ToneMapping.csh";
+            m_pDevice->CreateShader(ShaderCI, &pCS);
+            CHECK_THROW(pCS != nullptr);
+        }
+
+        PSOCreateInfo.pCS = pCS;
+
+        SamplerDesc SamLinearClampDesc{
+            FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR,
+            TEXTURE_ADDRESS_CLAMP, TEXTURE_ADDRESS_CLAMP, TEXTURE_ADDRESS_CLAMP};
+
+        ImmutableSamplerDesc ImmutableSamplers[] = {
+            {SHADER_TYPE_COMPUTE, "g_ColorBuffer", SamLinearClampDesc},
+            {SHADER_TYPE_COMPUTE, "g_DepthBuffer", SamLinearClampDesc}};
+
+        PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers    = ImmutableSamplers;
+        PSOCreateInfo.PSODesc.ResourceLayout.NumImmutableSamplers = _countof(ImmutableSamplers);
+        PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType  = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
+
+        m_pDevice->CreateComputePipelineState(PSOCreateInfo, &Pipelines.ToneMapPSO);
+        CHECK_THROW(Pipelines.ToneMapPSO != nullptr);
+
+        Pipelines.ToneMapPSO->CreateShaderResourceBinding(&Pipelines.ToneMapSRB, true);
+        CHECK_THROW(Pipelines.ToneMapSRB != nullptr);
+
+        // exposure for the next frame
+        RefCntAutoPtr<IShader> pExposureCS;
+        {
+            ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
+            ShaderCI.EntryPoint      = "main";
+            ShaderCI.Desc.Name       = "Exposure CS";
+            ShaderCI.FilePath        = "Exposure.csh";
+            m_pDevice->CreateShader(ShaderCI, &pExposureCS);
+            CHECK_THROW(pExposureCS != nullptr);
+        }
+
+        PSOCreateInfo.PSODesc.Name                                = "Exposure PSO";
+        PSOCreateInfo.pCS                                         = pExposureCS;
+        PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers    = nullptr;
+        PSOCreateInfo.PSODesc.ResourceLayout.NumImmutableSamplers = 0;
+
+        m_pDevice->CreateComputePipelineState(PSOCreateInfo, &Pipelines.ExposurePSO);
+        CHECK_THROW(Pipelines.ExposurePSO != nullptr);
+
+        Pipelines.ExposurePSO->CreateShaderResourceBinding(&Pipelines.ExposureSRB, true);
+        CHECK_THROW(Pipelines.ExposureSRB != nullptr);
+    }
+    catch (...)
+    {}
+}
+
+void RT_Scene::BindResources()
+{
+    // ray tracing and ray query pipelines use the same scene resources
+    // the merged layout is bound only while the benchmark compares it with the per-mesh BLAS
+    const bool Merged = m_pMergedLayout != nullptr && m_pMergedLayout->Active;
+
+    // textures over the capacity of the signature are bound when the pipelines are recreated, see ReserveMaterialTextures()
+    const auto BindSceneResources = [this, Merged](IShaderResourceBinding* pSRB, SHADER_TYPE Stages, Uint32 TextureCapacity) {
+        BindAllVariables(pSRB, Stages, "g_TLAS", Merged ? m_pMergedLayout->TLAS.GetTLAS() : m_TLAS.GetTLAS());
+
+        BindAllVariables(pSRB, Stages, "un_CameraAttribs", m_CameraAttribsCB);
+        BindAllVariables(pSRB, Stages, "un_LightAttribs", m_LightAttribsCB);
+        BindAllVariables(pSRB, Stages, "un_Lights", m_LightsBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+        BindAllVariables(pSRB, Stages, "un_LightGridCells", m_LightGridCells->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+        BindAllVariables(pSRB, Stages, "un_RayCounters", m_RayCounters->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+
+        BindAllVariables(pSRB, Stages, "un_HitVertexAttribs", m_HitAttribsArena.GetBuffer()->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+        BindAllVariables(pSRB, Stages, "un_HitVertexUV1", m_HitUV1Arena.GetCount() > 0 ? m_HitUV1Arena.GetBuffer()->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE) : m_EmptyUV1->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+        BindAllVariables(pSRB, Stages, "un_Primitives", m_TriangleArena.GetBuffer()->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+        BindAllVariables(pSRB, Stages, "un_PrimitiveOffsets", Merged ? m_pMergedLayout->PrimitiveOffsets : m_PrimitiveOffsets);
+
+        BindAllVariables(pSRB, Stages, "un_MaterialAttribs", m_MaterialArena.GetBuffer()->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+        BindAllVariables(pSRB, Stages, "g_MaterialColorMaps", reinterpret_cast<IDeviceObject* const*>(m_MaterialColorMaps.data()), 0,
+                         std::min(Uint32(m_MaterialColorMaps.size()), TextureCapacity));
+    };
+
+    if (m_pRayTracingSRB)
+        BindSceneResources(m_pRayTracingSRB, RayTracingStages, m_RayTracingTextureCapacity);
+
+    if (m_pRayQuerySRB)
+        BindSceneResources(m_pRayQuerySRB, SHADER_TYPE_COMPUTE, m_RayQueryTextureCapacity);
+
+    if (m_pLightGridSRB)
+    {
+        BindAllVariables(m_pLightGridSRB, SHADER_TYPE_COMPUTE, "un_LightAttribs", m_LightAttribsCB);
+        BindAllVariables(m_pLightGridSRB, SHADER_TYPE_COMPUTE, "un_Lights", m_LightsBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+        BindAllVariables(m_pLightGridSRB, SHADER_TYPE_COMPUTE, "un_LightGridCells", m_LightGridCells->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+    }
+
+    // trace size for the reconstruction and histogram range
+    if (m_pToneMapSRB)
+    {
+        BindAllVariables(m_pToneMapSRB, SHADER_TYPE_COMPUTE, "un_CameraAttribs", m_CameraAttribsCB);
+        BindAllVariables(m_pToneMapSRB, SHADER_TYPE_COMPUTE, "un_Histogram", m_Histogram->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+        BindAllVariables(m_pToneMapSRB, SHADER_TYPE_COMPUTE, "un_Exposure", m_Exposure->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+    }
+
+    if (m_pExposureSRB)
+    {
+        BindAllVariables(m_pExposureSRB, SHADER_TYPE_COMPUTE, "un_CameraAttribs", m_CameraAttribsCB);
+        BindAllVariables(m_pExposureSRB, SHADER_TYPE_COMPUTE, "un_Histogram", m_Histogram->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+        BindAllVariables(m_pExposureSRB, SHADER_TYPE_COMPUTE, "un_Exposure", m_Exposure->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+    }
+}
+
+void RT_Scene::ReloadShaders()
+{
+    if (m_ShaderReloadTask.valid())
+    {
+        LOG_INFO_MESSAGE("Shader reloading is already in progress");
+        return;
+    }
+
+    LOG_INFO_MESSAGE("============================================================\n");
+
+    // Pipelines are compiled on a worker thread, the current pipelines are used for rendering until
+    // the new ones are ready. Only render device methods are used here, they are thread-safe.
+    m_ShaderReloadTask = std::async(std::launch::async, [this]() {
+        ShaderPipelines Pipelines;
+        CreateRayTracingPSO(Pipelines);
+        CreateRayQueryPSO(Pipelines);
+        CreateLightGridPSO(Pipelines);
+        CreateToneMapPSO(Pipelines);
+        return Pipelines;
+    });
+}
+
+void RT_Scene::UpdateShaders()
+{
+    if (!m_ShaderReloadTask.valid() ||
+        m_ShaderReloadTask.wait_for(std::chrono::seconds{0}) != std::future_status::ready)
+        return;
+
+    auto Pipelines = m_ShaderReloadTask.get();
+    SwapPipelines(Pipelines);
+}
+
+void RT_Scene::SwapPipelines(ShaderPipelines& Pipelines)
+{
+    // Old pipelines may still be referenced by frames in flight, the device keeps them
+    // in the release queue until these frames are completed on the GPU.
+    // If compilation failed the old pipeline is kept.
+    bool Rebind = false;
+    if (Pipelines.RayTracingPSO != nullptr && Pipelines.RayTracingSRB != nullptr)
+    {
+        m_pRayTracingPSO            = std::move(Pipelines.RayTracingPSO);
+        m_pRayTracingSRB            = std::move(Pipelines.RayTracingSRB);
+        m_RayTracingTextureCapacity = Pipelines.RayTracingTextureCapacity;
+
+        CreateSBT();
+        Rebind = true;
+    }
+
+    if (Pipelines.RayQueryPSO != nullptr && Pipelines.RayQuerySRB != nullptr)
+    {
+        m_pRayQueryPSO            = std::move(Pipelines.RayQueryPSO);
+        m_pRayQuerySRB            = std::move(Pipelines.RayQuerySRB);
+        m_RayQueryTextureCapacity = Pipelines.RayQueryTextureCapacity;
+        Rebind                    = true;
+    }
+
+    if (Pipelines.LightGridPSO != nullptr && Pipelines.LightGridSRB != nullptr)
+    {
+        m_pLightGridPSO  = std::move(Pipelines.LightGridPSO);
+        m_pLightGridSRB  = std::move(Pipelines.LightGridSRB);
+        m_LightGridDirty = m_LightCount > 0;
+        Rebind           = true;
+    }
+
+    // tone mapping and exposure share the histogram layout, so they are replaced together
+    if (Pipelines.ToneMapPSO != nullptr && Pipelines.ToneMapSRB != nullptr &&
+        Pipelines.ExposurePSO != nullptr && Pipelines.ExposureSRB != nullptr)
+    {
+        m_pToneMapPSO  = std::move(Pipelines.ToneMapPSO);
+        m_pToneMapSRB  = std::move(Pipelines.ToneMapSRB);
+        m_pExposurePSO = std::move(Pipelines.ExposurePSO);
+        m_pExposureSRB = std::move(Pipelines.ExposureSRB);
+        Rebind         = true;
+    }
+
+    if (Rebind)
+        BindResources();
+}
+
+// Meshes before FirstMesh keep their BLAS, primitive offsets are recreated for all geometries.
+void RT_Scene::CreateBLAS(Uint32 FirstMesh)
+{
+    if (m_PositionArena.GetCount() == 0 || m_TriangleArena.GetCount() == 0 || FirstMesh >= m_Meshes.size())
+        return;
+
+    const Uint32 TriangleBufferSize = m_TriangleArena.GetSize();
+
+    struct PerMesh
+    {
+        std::vector<BLASTriangleDesc>      TriangleInfos;
+        std::vector<BLASBuildTriangleData> TriangleData;
+    };
+    std::vector<PerMesh> MeshData(m_Meshes.size());
+    std::vector<Uint32>  PrimitiveOffsets;
+    PrimitiveOffsets.reserve(m_Geometries.size());
+
+    for (auto& submesh : m_Geometries)
+        PrimitiveOffsets.push_back(submesh.FirstTriangle);
+
+    // create AS, one per unique mesh
+    m_MeshBLAS.resize(m_Meshes.size());
+    Uint32 ScratchSize = 0;
+
+    for (size_t m = FirstMesh; m < m_Meshes.size(); ++m)
+    {
+        const auto& Mesh = m_Meshes[m];
+        auto&       Data = MeshData[m];
+
+        // indices are relative to the first vertex of the scene, meshes of the scene use its vertex range
+        const auto  SceneIt = std::upper_bound(m_Scenes.begin(), m_Scenes.end(), Uint32(m), [](Uint32 Mesh, const SceneRange& Scene) { return Mesh < Scene.FirstMesh; });
+        const auto& Scene   = *std::prev(SceneIt);
+
+        Data.TriangleInfos.resize(Mesh.GeometryCount);
+        Data.TriangleData.resize(Mesh.GeometryCount);
+
+        for (Uint32 g = 0; g < Mesh.GeometryCount; ++g)
+        {
+            const auto& submesh    = m_Geometries[Mesh.FirstGeometry + g];
+            auto&       Info       = Data.TriangleInfos[g];
+            auto&       TriData    = Data.TriangleData[g];
+            const bool  HasIndices = submesh.IndexCount > 0 && m_IndexArena.GetCount() > 0;
+
+            VERIFY_EXPR((submesh.FirstTriangle + submesh.IndexCount / 3) * sizeof(PrimitiveAttribs) <= TriangleBufferSize);
+
+            Info.GeometryName         = m_SceneNames.c_str() + submesh.NameOffset;
+            Info.MaxVertexCount       = Scene.VertexCount;
+            Info.VertexValueType      = VT_FLOAT32;
+            Info.VertexComponentCount = 3;
+            Info.MaxPrimitiveCount    = submesh.IndexCount / 3;
+            Info.IndexType            = HasIndices ? VT_UINT32 : VT_UNDEFINED;
+
+            TriData.GeometryName         = Info.GeometryName;
+            TriData.pVertexBuffer        = m_PositionArena.GetBuffer();
+            TriData.VertexOffset         = Scene.FirstVertex * sizeof(float3);
+            TriData.VertexStride         = sizeof(float3);
+            TriData.VertexCount          = Info.MaxVertexCount;
+            TriData.VertexValueType      = Info.VertexValueType;
+            TriData.VertexComponentCount = Info.VertexComponentCount;
+            TriData.pIndexBuffer         = HasIndices ? m_IndexArena.GetBuffer() : nullptr;
+            TriData.PrimitiveCount       = Info.MaxPrimitiveCount;
+            TriData.IndexOffset          = submesh.FirstIndex * sizeof(Uint32);
+            TriData.IndexType            = Info.IndexType;
+            TriData.Flags                = submesh.Opaque ? RAYTRACING_GEOMETRY_FLAG_OPAQUE : RAYTRACING_GEOMETRY_FLAG_NONE;
+        }
+
+        const String Name = String{"Mesh BLAS "} + std::to_string(m);
+
+        BottomLevelASDesc ASDesc;
+        ASDesc.Name          = Name.c_str();
+        ASDesc.Flags         = RAYTRACING_BUILD_AS_PREFER_FAST_TRACE | RAYTRACING_BUILD_AS_ALLOW_COMPACTION;
+        ASDesc.pTriangles    = Data.TriangleInfos.data();
+        ASDesc.TriangleCount = Uint32(Data.TriangleInfos.size());
+        m_pDevice->CreateBLAS(ASDesc, &m_MeshBLAS[m]);
+        VERIFY_EXPR(m_MeshBLAS[m] != nullptr);
+
+        ScratchSize = max(ScratchSize, m_MeshBLAS[m]->GetScratchBufferSizes().Build);
+    }
+
+    // create scratch buffer, it is shared between all builds
+    RefCntAutoPtr<IBuffer> ScratchBuffer;
+    BufferDesc             BuffDesc;
+    BuffDesc.Name          = "BLAS Scratch Buffer";
+    BuffDesc.Usage         = USAGE_DEFAULT;
+    BuffDesc.BindFlags     = BIND_RAY_TRACING;
+    BuffDesc.uiSizeInBytes = ScratchSize;
+    m_pDevice->CreateBuffer(BuffDesc, nullptr, &ScratchBuffer);
+    VERIFY_EXPR(ScratchBuffer != nullptr);
+
+    // buffer for compacted sizes
+    RefCntAutoPtr<IBuffer> CompactedSizeBuffer;
+    BuffDesc.Name          = "BLAS compacted size";
+    BuffDesc.Usage         = USAGE_DEFAULT;
+    BuffDesc.BindFlags     = BIND_UNORDERED_ACCESS;
+    BuffDesc.Mode          = BUFFER_MODE_RAW;
+    BuffDesc.uiSizeInBytes = Uint32(sizeof(Uint64) * (m_MeshBLAS.size() - FirstMesh));
+    m_pDevice->CreateBuffer(BuffDesc, nullptr, &CompactedSizeBuffer);
+    VERIFY_EXPR(CompactedSizeBuffer != nullptr);
+
+    // build AS
+    BuildBLASAttribs Attribs;
+    Attribs.BLASTransitionMode          = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+    Attribs.GeometryTransitionMode      = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+    Attribs.pScratchBuffer              = ScratchBuffer;
+    Attribs.ScratchBufferTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+
+    GPUTimer BuildTimer{m_pDevice, m_pContext, "BLAS build"};
+    for (size_t m = FirstMesh; m < m_MeshBLAS.size(); ++m)
+    {
+        Attribs.pBLAS             = m_MeshBLAS[m];
+        Attribs.pTriangleData     = MeshData[m].TriangleData.data();
+        Attribs.TriangleDataCount = Uint32(MeshData[m].TriangleData.size());
+        m_pContext->BuildBLAS(Attribs);
+
+        WriteBLASCompactedSizeAttribs SizeAttribs;
+        SizeAttribs.pBLAS                = m_MeshBLAS[m];
+        SizeAttribs.pDestBuffer          = CompactedSizeBuffer;
+        SizeAttribs.DestBufferOffset     = Uint32(sizeof(Uint64) * (m - FirstMesh));
+        SizeAttribs.BLASTransitionMode   = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        SizeAttribs.BufferTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        m_pContext->WriteBLASCompactedSize(SizeAttribs);
+    }
+    BuildTimer.Stop();
+
+    m_PrimitiveOffsets = CreateSceneBuffer(m_pDevice, "Primitive offsets", BIND_SHADER_RESOURCE, PrimitiveOffsets.data(), PrimitiveOffsets.size() * sizeof(PrimitiveOffsets[0]))
+                             ->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE);
+
+    // compact, the original AS is released after the copy, the device keeps it until the copy is completed
+    std::vector<Uint8> CompactedSizes;
+    if (!ReadBufferData(m_pDevice, m_pContext, CompactedSizeBuffer, CompactedSizes))
+    {
+        LOG_ERROR_MESSAGE("Failed to read BLAS compacted sizes, BLAS compaction is skipped");
+        return;
+    }
+    m_BuildTimings.BLASBuild = BuildTimer.Resolve();
+
+    GPUTimer CompactTimer{m_pDevice, m_pContext, "BLAS compaction"};
+    Uint64   TotalSize = 0;
+    for (size_t m = FirstMesh; m < m_MeshBLAS.size(); ++m)
+    {
+        Uint64 CompactedSize = 0;
+        std::memcpy(&CompactedSize, CompactedSizes.data() + sizeof(Uint64) * (m - FirstMesh), sizeof(CompactedSize));
+        if (CompactedSize == 0)
+            continue;
+
+        const String Name = String{"Compacted mesh BLAS "} + std::to_string(m);
+
+        BottomLevelASDesc ASDesc;
+        ASDesc.Name          = Name.c_str();
+        ASDesc.CompactedSize = CompactedSize;
+
+        RefCntAutoPtr<IBottomLevelAS> pCompactedBLAS;
+        m_pDevice->CreateBLAS(ASDesc, &pCompactedBLAS);
+        if (pCompactedBLAS == nullptr)
+            continue;
+
+        CopyBLASAttribs CopyAttribs;
+        CopyAttribs.pSrc              = m_MeshBLAS[m];
+        CopyAttribs.pDst              = pCompactedBLAS;
+        CopyAttribs.Mode              = COPY_AS_MODE_COMPACT;
+        CopyAttribs.SrcTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        CopyAttribs.DstTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        m_pContext->CopyBLAS(CopyAttribs);
+
+        m_MeshBLAS[m] = std::move(pCompactedBLAS);
+        TotalSize += CompactedSize;
+    }
+    CompactTimer.Stop();
+    m_BuildTimings.BLASCompact = CompactTimer.Resolve();
+    m_MeshBLASSize             = (FirstMesh == 0 ? 0 : m_MeshBLASSize) + TotalSize;
+
+    LOG_INFO_MESSAGE("Created ", m_MeshBLAS.size() - FirstMesh, " BLAS for ", m_Geometries.size() - m_Meshes[FirstMesh].FirstGeometry, " geometries, compacted size: ", TotalSize / 1024,
+                     " Kb, GPU build: ", m_BuildTimings.BLASBuild * 1000.0, " ms, compaction: ", m_BuildTimings.BLASCompact * 1000.0, " ms");
+}
+
+// Nodes before FirstNode are already in the TLAS, the TLAS is recreated by Update() when the instance count exceeds the capacity.
+void RT_Scene::CreateTLAS(Uint32 FirstNode)
+{
+    if (FirstNode == 0)
+    {
+        TLASManager::Settings Settings;
+        Settings.HitGroupStride = HitGroupStride;
+
+        if (!m_TLAS.Create(m_pDevice, "TLAS", Uint32(m_Nodes.size()), Settings))
+            return;
+    }
+
+    m_NodeInstances.resize(m_Nodes.size(), InvalidInstanceId);
+
+    for (size_t i = FirstNode; i < m_Nodes.size(); ++i)
+    {
+        const auto& Node = m_Nodes[i];
+        const auto& Mesh = m_Meshes[Node.MeshId];
+        if (m_MeshBLAS[Node.MeshId] == nullptr)
+            continue;
+
+        // node names are not unique
+        const String Name = String{m_SceneNames.c_str() + Node.NameOffset} + "_" + std::to_string(i);
+
+        // CustomId is the index of the first geometry in the primitive offsets buffer
+        m_NodeInstances[i] = m_TLAS.AddInstance(Name.c_str(), m_MeshBLAS[Node.MeshId], Mesh.FirstGeometry, RAYTRACING_INSTANCE_NONE, GetNodeTransform(i, 0.0f));
+    }
+
+    GPUTimer BuildTimer{m_pDevice, m_pContext, "TLAS build"};
+    m_TLAS.Update(m_pContext);
+    BuildTimer.Stop();
+    m_BuildTimings.TLASBuild = BuildTimer.Resolve();
+}
+
+// Without ray tracing the CPU tracer and the light grid use the same nodes as CreateTLAS(), ids are not TLAS instances.
+void RT_Scene::CreateNodeList()
+{
+    m_NodeInstances.assign(m_Nodes.size(), InvalidInstanceId);
+
+    for (size_t i = 0; i < m_Nodes.size(); ++i)
+    {
+        if (m_Meshes[m_Nodes[i].MeshId].GeometryCount > 0)
+            m_NodeInstances[i] = TLASManager::InstanceId(i);
+    }
+}
+
+// Triangles of all nodes are transformed to world space and merged into one opaque and one non-opaque BLAS,
+// each BLAS is a single TLAS instance with identity transform. Hit shaders read object space normals from the
+// same attribute buffers, so shading is not correct for transformed nodes, only memory and timings are compared.
+bool RT_Scene::CreateMergedBLASLayout()
+{
+    std::vector<Uint8> Positions;
+    std::vector<Uint8> Triangles;
+    if (!ReadBufferData(m_pDevice, m_pContext, m_PositionArena.GetBuffer(), Positions, m_PositionArena.GetSize()) ||
+        !ReadBufferData(m_pDevice, m_pContext, m_TriangleArena.GetBuffer(), Triangles, m_TriangleArena.GetSize()))
+    {
+        LOG_ERROR_MESSAGE("Failed to read scene geometry for the merged BLAS layout");
+        return false;
+    }
+
+    const auto*  pPositions    = reinterpret_cast<const float3*>(Positions.data());
+    const auto*  pTriangles    = reinterpret_cast<const PrimitiveAttribs*>(Triangles.data());
+    const Uint32 VertexCount   = Uint32(Positions.size() / sizeof(float3));
+    const Uint32 TriangleCount = Uint32(Triangles.size() / sizeof(PrimitiveAttribs));
+
+    // geometry per node and scene geometry, vertices are not indexed
+    struct MergedGeometry
+    {
+        Uint32 SceneGeometry = 0;
+        Uint32 FirstVertex   = 0;
+        Uint32 TriangleCount = 0;
+    };
+    std::array<std::vector<MergedGeometry>, 2> Geometries; // opaque, non-opaque
+    std::vector<float3>                        Vertices;
+
+    for (size_t i = 0; i < m_NodeInstances.size(); ++i)
+    {
+        if (m_NodeInstances[i] == InvalidInstanceId)
+            continue;
+
+        const auto  Transform = GetNodeTransform(i, 0.0f);
+        const auto& Mesh      = m_Meshes[m_Nodes[i].MeshId];
+        for (Uint32 g = Mesh.FirstGeometry; g < Mesh.FirstGeometry + Mesh.GeometryCount; ++g)
+        {
+            const auto&  Geom  = m_Geometries[g];
+            const Uint32 First = std::min(Geom.FirstTriangle, TriangleCount);
+            const Uint32 Count = std::min(Geom.IndexCount / 3, TriangleCount - First);
+            if (Count == 0)
+                continue;
+
+            Geometries[Geom.Opaque ? 0 : 1].push_back({g, Uint32(Vertices.size()), Count});
+
+            for (Uint32 t = First; t < First + Count; ++t)
+            {
+                const auto& Face = pTriangles[t].Face;
+                for (Uint32 v : {Face.x, Face.y, Face.z})
+                    Vertices.push_back(v < VertexCount ? float3::MakeVector(float4{pPositions[v], 1.0f} * Transform) : float3{});
+            }
+        }
+    }
+
+    if (Vertices.empty())
+        return false;
+
+    std::unique_ptr<MergedBLASLayout> pLayout{new MergedBLASLayout{}};
+
+    auto pVertexBuffer = CreateSceneBuffer(m_pDevice, "Merged BLAS vertices", BIND_RAY_TRACING, Vertices.data(), Vertices.size() * sizeof(Vertices[0]));
+
+    // geometry names must be unique in BLAS
+    std::vector<String> Names;
+    for (auto& List : Geometries)
+    {
+        for (size_t g = 0; g < List.size(); ++g)
+            Names.push_back("Geometry " + std::to_string(g));
+    }
+
+    RefCntAutoPtr<IBuffer> CompactedSizeBuffer;
+    {
+        BufferDesc BuffDesc;
+        BuffDesc.Name          = "Merged BLAS compacted size";
+        BuffDesc.Usage         = USAGE_DEFAULT;
+        BuffDesc.BindFlags     = BIND_UNORDERED_ACCESS;
+        BuffDesc.Mode          = BUFFER_MODE_RAW;
+        BuffDesc.uiSizeInBytes = Uint32(sizeof(Uint64) * Geometries.size());
+        m_pDevice->CreateBuffer(BuffDesc, nullptr, &CompactedSizeBuffer);
+        VERIFY_EXPR(CompactedSizeBuffer != nullptr);
+    }
+
+    GPUTimer BuildTimer{m_pDevice, m_pContext, "Merged BLAS build"};
+    size_t   NameIndex = 0;
+    for (size_t b = 0; b < Geometries.size(); ++b)
+    {
+        const auto& List = Geometries[b];
+
+        std::vector<BLASTriangleDesc>      TriangleInfos(List.size());
+        std::vector<BLASBuildTriangleData> TriangleData(List.size());
+        for (size_t g = 0; g < List.size(); ++g)
+        {
+            auto& Info    = TriangleInfos[g];
+            auto& TriData = TriangleData[g];
+
+            Info.GeometryName         = Names[NameIndex++].c_str();
+            Info.MaxVertexCount       = List[g].TriangleCount * 3;
+            Info.VertexValueType      = VT_FLOAT32;
+            Info.VertexComponentCount = 3;
+            Info.MaxPrimitiveCount    = List[g].TriangleCount;
+            Info.IndexType            = VT_UNDEFINED;
+
+            TriData.GeometryName         = Info.GeometryName;
+            TriData.pVertexBuffer        = pVertexBuffer;
+            TriData.VertexOffset         = List[g].FirstVertex * sizeof(float3);
+            TriData.VertexStride         = sizeof(float3);
+            TriData.VertexCount          = Info.MaxVertexCount;
+            TriData.VertexValueType      = Info.VertexValueType;
+            TriData.VertexComponentCount = Info.VertexComponentCount;
+            TriData.PrimitiveCount       = Info.MaxPrimitiveCount;
+            TriData.Flags                = b == 0 ? RAYTRACING_GEOMETRY_FLAG_OPAQUE : RAYTRACING_GEOMETRY_FLAG_NONE;
+        }
+
+        RefCntAutoPtr<IBottomLevelAS> pBLAS;
+        if (List.size())
+        {
+            BottomLevelASDesc ASDesc;
+            ASDesc.Name          = b == 0 ? "Merged opaque BLAS" : "Merged non-opaque BLAS";
+            ASDesc.Flags         = RAYTRACING_BUILD_AS_PREFER_FAST_TRACE | RAYTRACING_BUILD_AS_ALLOW_COMPACTION;
+            ASDesc.pTriangles    = TriangleInfos.data();
+            ASDesc.TriangleCount = Uint32(TriangleInfos.size());
+            m_pDevice->CreateBLAS(ASDesc, &pBLAS);
+        }
+        pLayout->BLAS.push_back(pBLAS);
+        if (pBLAS == nullptr)
+            continue;
+
+        // each BLAS has its own scratch buffer, the layout is built once
+        BufferDesc BuffDesc;
+        BuffDesc.Name          = "Merged BLAS scratch buffer";
+        BuffDesc.Usage         = USAGE_DEFAULT;
+        BuffDesc.BindFlags     = BIND_RAY_TRACING;
+        BuffDesc.uiSizeInBytes = pBLAS->GetScratchBufferSizes().Build;
+
+        RefCntAutoPtr<IBuffer> ScratchBuffer;
+        m_pDevice->CreateBuffer(BuffDesc, nullptr, &ScratchBuffer);
+        VERIFY_EXPR(ScratchBuffer != nullptr);
+
+        BuildBLASAttribs Attribs;
+        Attribs.pBLAS                       = pBLAS;
+        Attribs.BLASTransitionMode          = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        Attribs.GeometryTransitionMode      = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        Attribs.pTriangleData               = TriangleData.data();
+        Attribs.TriangleDataCount           = Uint32(TriangleData.size());
+        Attribs.pScratchBuffer              = ScratchBuffer;
+        Attribs.ScratchBufferTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        m_pContext->BuildBLAS(Attribs);
+
+        WriteBLASCompactedSizeAttribs SizeAttribs;
+        SizeAttribs.pBLAS                = pBLAS;
+        SizeAttribs.pDestBuffer          = CompactedSizeBuffer;
+        SizeAttribs.DestBufferOffset     = Uint32(sizeof(Uint64) * b);
+        SizeAttribs.BLASTransitionMode   = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        SizeAttribs.BufferTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        m_pContext->WriteBLASCompactedSize(SizeAttribs);
+    }
+    BuildTimer.Stop();
+
+    std::vector<Uint8> CompactedSizes;
+    if (!ReadBufferData(m_pDevice, m_pContext, CompactedSizeBuffer, CompactedSizes))
+    {
+        LOG_ERROR_MESSAGE("Failed to read compacted sizes of the merged BLAS layout");
+        return false;
+    }
+    pLayout->BuildTime = BuildTimer.Resolve();
+
+    GPUTimer CompactTimer{m_pDevice, m_pContext, "Merged BLAS compaction"};
+    for (size_t b = 0; b < pLayout->BLAS.size(); ++b)
+    {
+        Uint64 CompactedSize = 0;
+        std::memcpy(&CompactedSize, CompactedSizes.data() + sizeof(Uint64) * b, sizeof(CompactedSize));
+        if (pLayout->BLAS[b] == nullptr || CompactedSize == 0)
+            continue;
+
+        BottomLevelASDesc ASDesc;
+        ASDesc.Name          = b == 0 ? "Compacted merged opaque BLAS" : "Compacted merged non-opaque BLAS";
+        ASDesc.CompactedSize = CompactedSize;
+
+        RefCntAutoPtr<IBottomLevelAS> pCompactedBLAS;
+        m_pDevice->CreateBLAS(ASDesc, &pCompactedBLAS);
+        if (pCompactedBLAS == nullptr)
+            continue;
+
+        CopyBLASAttribs CopyAttribs;
+        CopyAttribs.pSrc              = pLayout->BLAS[b];
+        CopyAttribs.pDst              = pCompactedBLAS;
+        CopyAttribs.Mode              = COPY_AS_MODE_COMPACT;
+        CopyAttribs.SrcTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        CopyAttribs.DstTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        m_pContext->CopyBLAS(CopyAttribs);
+
+        pLayout->BLAS[b] = std::move(pCompactedBLAS);
+        pLayout->CompactedSize += CompactedSize;
+    }
+    CompactTimer.Stop();
+    pLayout->CompactTime = CompactTimer.Resolve();
+
+    // merged geometries are appended to the scene primitive offsets, CustomId of the instance is the first of them
+    std::vector<Uint32> PrimitiveOffsets;
+    for (auto& Geom : m_Geometries)
+        PrimitiveOffsets.push_back(Geom.FirstTriangle);
+
+    TLASManager::Settings Settings;
+    Settings.HitGroupStride = HitGroupStride;
+
+    if (!pLayout->TLAS.Create(m_pDevice, "Merged TLAS", Uint32(pLayout->BLAS.size()), Settings))
+        return false;
+
+    for (size_t b = 0; b < pLayout->BLAS.size(); ++b)
+    {
+        if (pLayout->BLAS[b] == nullptr)
+            continue;
+
+        pLayout->TLAS.AddInstance(b == 0 ? "Opaque" : "NonOpaque", pLayout->BLAS[b], Uint32(PrimitiveOffsets.size()), RAYTRACING_INSTANCE_NONE, float4x4::Identity());
+
+        for (auto& Geom : Geometries[b])
+            PrimitiveOffsets.push_back(m_Geometries[Geom.SceneGeometry].FirstTriangle);
+
+        pLayout->GeometryCount += Uint32(Geometries[b].size());
+    }
+    pLayout->TLAS.Update(m_pContext);
+
+    pLayout->PrimitiveOffsets = CreateSceneBuffer(m_pDevice, "Merged primitive offsets", BIND_SHADER_RESOURCE, PrimitiveOffsets.data(), PrimitiveOffsets.size() * sizeof(PrimitiveOffsets[0]))
+                                    ->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE);
+
+    LOG_INFO_MESSAGE("Created merged BLAS layout: ", pLayout->GeometryCount, " geometries, compacted size: ", pLayout->CompactedSize / 1024,
+                     " Kb (per-mesh BLAS: ", m_MeshBLASSize / 1024, " Kb), GPU build: ", pLayout->BuildTime * 1000.0, " ms");
+
+    m_pMergedLayout = std::move(pLayout);
+    return true;
+}
+
+void RT_Scene::UseMergedBLASLayout(bool Enable)
+{
+    if (m_pMergedLayout == nullptr || m_pMergedLayout->Active == Enable)
+        return;
+
+    m_pMergedLayout->Active = Enable;
+    BindResources();
+    CreateSBT();
+}
+
+// Scene transform is already applied to the node transform, see AppendScene().
+float4x4 RT_Scene::GetNodeTransform(size_t NodeIndex, float Time) const
+{
+    if (!m_AnimateNodes)
+        return m_Nodes[NodeIndex].Transform;
+
+    // move nodes up and down with different phases to test TLAS refit
+    const float Offset = std::sin(Time * 2.0f + float(NodeIndex)) * 0.5f;
+    return m_Nodes[NodeIndex].Transform * float4x4::Translation(0.0f, Offset, 0.0f);
+}
+
+void RT_Scene::UpdateTLAS()
+{
+    // merged layout is static
+    if (m_pMergedLayout != nullptr && m_pMergedLayout->Active)
+        return;
+
+    if (m_AnimateNodes)
+    {
+        for (size_t i = 0; i < m_NodeInstances.size(); ++i)
+        {
+            if (m_NodeInstances[i] != InvalidInstanceId)
+                m_TLAS.SetTransform(m_NodeInstances[i], GetNodeTransform(i, m_SceneTime));
+        }
+    }
+
+    if (m_TLAS.Update(m_pContext) == TLASManager::EUpdateResult::InstancesChanged)
+    {
+        BindResources();
+        CreateSBT();
+    }
+}
+
+void RT_Scene::CreateSBT()
+{
+    ShaderBindingTableDesc SBTDesc;
+    SBTDesc.Name = "SBT";
+    SBTDesc.pPSO = m_pRayTracingPSO;
+    m_pDevice->CreateSBT(SBTDesc, &m_pSBT);
+
+    if (m_pSBT != nullptr)
+    {
+        // clang-format off
+        m_pSBT->BindRayGenShader("Main");
+        m_pSBT->BindMissShader("PrimaryMiss", PrimaryRayIndex);
+        m_pSBT->BindMissShader("ShadowMiss",  ShadowRayIndex);
+
+        const auto& TLAS = (m_pMergedLayout != nullptr && m_pMergedLayout->Active) ? m_pMergedLayout->TLAS : m_TLAS;
+        for (Uint32 i = 0; i < TLAS.GetInstanceCount(); ++i)
+        {
+            m_pSBT->BindHitGroups(TLAS.GetTLAS(), TLAS.GetInstanceName(i), PrimaryRayIndex, "PrimaryOpaqueHit");
+            m_pSBT->BindHitGroups(TLAS.GetTLAS(), TLAS.GetInstanceName(i), ShadowRayIndex,  "ShadowHit");
+        }
+        // clang-format on
+    }
+}
+
+void RT_Scene::LoadScenes()
+{
+    // create default resources
+    {
+        static constexpr Uint32  TexDim = 8;
+        static const SamplerDesc Sam_LinearClamp{
+            FILTER_TYPE_LINEAR,
+            FILTER_TYPE_LINEAR,
+            FILTER_TYPE_LINEAR,
+            TEXTURE_ADDRESS_CLAMP,
+            TEXTURE_ADDRESS_CLAMP,
+            TEXTURE_ADDRESS_CLAMP};
+
+        TextureDesc TexDesc;
+        TexDesc.Name      = "White texture for RT Scene";
+        TexDesc.Type      = RESOURCE_DIM_TEX_2D;
+        TexDesc.Usage     = USAGE_IMMUTABLE;
+        TexDesc.BindFlags = BIND_SHADER_RESOURCE;
+        TexDesc.Width     = TexDim;
+        TexDesc.Height    = TexDim;
+        TexDesc.Format    = TEX_FORMAT_RGBA8_UNORM;
+        TexDesc.MipLevels = 1;
+        std::vector<Uint32>     Data(TexDim * TexDim, 0xFFFFFFFF);
+        TextureSubResData       Level0Data{Data.data(), TexDim * 4};
+        TextureData             InitData{&Level0Data, 1};
+        RefCntAutoPtr<ITexture> pWhiteTex;
+        m_pDevice->CreateTexture(TexDesc, &InitData, &pWhiteTex);
+        m_pWhiteTexSRV = pWhiteTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+
+        TexDesc.Name = "Black texture for RT Scene";
+        for (auto& c : Data) c = 0;
+        RefCntAutoPtr<ITexture> pBlackTex;
+        m_pDevice->CreateTexture(TexDesc, &InitData, &pBlackTex);
+        m_pBlackTexSRV = pBlackTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+
+        TexDesc.Name = "Default normal map for RT Scene";
+        for (auto& c : Data) c = 0x00FF7F7F;
+        RefCntAutoPtr<ITexture> pDefaultNormalMap;
+        m_pDevice->CreateTexture(TexDesc, &InitData, &pDefaultNormalMap);
+        m_pDefaultNormalMapSRV = pDefaultNormalMap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+
+        StateTransitionDesc Barriers[] = {
+            {pWhiteTex, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, true},
+            {pBlackTex, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, true},
+            {pDefaultNormalMap, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, true}};
+
+        m_pContext->TransitionResourceStates(_countof(Barriers), Barriers);
+
+        RefCntAutoPtr<ISampler> pDefaultSampler;
+        m_pDevice->CreateSampler(Sam_LinearClamp, &pDefaultSampler);
+        m_pWhiteTexSRV->SetSampler(pDefaultSampler);
+        m_pBlackTexSRV->SetSampler(pDefaultSampler);
+        m_pDefaultNormalMapSRV->SetSampler(pDefaultSampler);
+    }
+
+    const auto LoadStartTime = TimePoint::clock::now();
+
+    // without ray tracing the geometry is only read back by the CPU tracer
+    const BIND_FLAGS RayTracingBind = m_HasRayTracing ? BIND_RAY_TRACING : BIND_NONE;
+
+    m_PositionArena.Create(m_pDevice, "Scene positions", RayTracingBind, sizeof(float3));
+    m_HitAttribsArena.Create(m_pDevice, "Scene hit attribs", BIND_SHADER_RESOURCE, sizeof(HitVertexAttribs));
+    m_HitUV1Arena.Create(m_pDevice, "Scene hit UV1", BIND_SHADER_RESOURCE, sizeof(Uint32));
+    m_IndexArena.Create(m_pDevice, "Scene indices", BIND_INDEX_BUFFER | RayTracingBind, sizeof(Uint32));
+    m_TriangleArena.Create(m_pDevice, "Scene triangles", BIND_SHADER_RESOURCE, sizeof(PrimitiveAttribs));
+    m_MaterialArena.Create(m_pDevice, "Material attribs buffer", BIND_SHADER_RESOURCE, sizeof(MaterialAttribs));
+
+    const Uint32 EmptyUV1 = 0;
+    m_EmptyUV1            = CreateSceneBuffer(m_pDevice, "Empty hit UV1", BIND_SHADER_RESOURCE, &EmptyUV1, sizeof(EmptyUV1));
+
+    // textures of all scenes are loaded by the same streamer, request ids are global
+    TextureRequests TexRequests;
+    for (auto& Scene : m_Scenes)
+        LoadScene(Scene, TexRequests);
+
+    StartTextureStreaming(std::move(TexRequests));
+
+    // pipelines are created after the scene is loaded
+    ReserveMaterialTextures(Uint32(m_MaterialColorMaps.size()));
+
+    // create buffers, constants are written to the staging ring and copied to the uniform buffers on the GPU timeline
+    {
+        BufferDesc BuffDesc;
+        BuffDesc.Name          = "Camera attribs buffer";
+        BuffDesc.uiSizeInBytes = sizeof(CameraAttribs);
+        BuffDesc.Usage         = USAGE_DEFAULT;
+        BuffDesc.BindFlags     = BIND_UNIFORM_BUFFER;
+
+        m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_CameraAttribsCB);
+        VERIFY_EXPR(m_CameraAttribsCB != nullptr);
+
+        BuffDesc.Name          = "Light attribs buffer";
+        BuffDesc.uiSizeInBytes = sizeof(LightAttribs);
+        m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_LightAttribsCB);
+        VERIFY_EXPR(m_LightAttribsCB != nullptr);
+
+        m_FrameConstantsSlotSize = Align(Uint32(FrameConstantsLightOffset + sizeof(LightAttribs)), 256u);
+
+        BuffDesc.Name           = "Frame constants ring";
+        BuffDesc.uiSizeInBytes  = m_FrameConstantsSlotSize * MaxFramesInFlight;
+        BuffDesc.Usage          = USAGE_STAGING;
+        BuffDesc.BindFlags      = BIND_NONE;
+        BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+        m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_FrameConstants);
+        VERIFY_EXPR(m_FrameConstants != nullptr);
+
+        BuffDesc.Name           = "Ray counters readback";
+        BuffDesc.uiSizeInBytes  = RayCounterCount * sizeof(Uint32) * MaxFramesInFlight;
+        BuffDesc.CPUAccessFlags = CPU_ACCESS_READ;
+        m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_RayCountersReadback);
+        VERIFY_EXPR(m_RayCountersReadback != nullptr);
+
+        BuffDesc.Name           = "Ray counters";
+        BuffDesc.uiSizeInBytes  = RayCounterCount * sizeof(Uint32);
+        BuffDesc.Usage          = USAGE_DEFAULT;
+        BuffDesc.BindFlags      = BIND_UNORDERED_ACCESS;
+        BuffDesc.Mode           = BUFFER_MODE_RAW;
+        BuffDesc.CPUAccessFlags = CPU_ACCESS_NONE;
+        m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_RayCounters);
+        VERIFY_EXPR(m_RayCounters != nullptr);
+
+        // histogram is accumulated over the frame and cleared by Exposure.csh, so it must be zeroed initially
+        const std::vector<Uint32> Zeros(HistogramSize, 0u);
+        BufferData                ZeroData{Zeros.data(), Uint32(Zeros.size() * sizeof(Zeros[0]))};
+
+        BuffDesc.Name          = "Luminance histogram";
+        BuffDesc.uiSizeInBytes = HistogramSize * sizeof(Uint32);
+        m_pDevice->CreateBuffer(BuffDesc, &ZeroData, &m_Histogram);
+        VERIFY_EXPR(m_Histogram != nullptr);
+
+        static_assert(sizeof(ExposureState) <= HistogramSize * sizeof(Uint32), "zero data is too small");
+        ZeroData.DataSize      = sizeof(ExposureState);
+        BuffDesc.Name          = "Exposure";
+        BuffDesc.uiSizeInBytes = sizeof(ExposureState);
+        BuffDesc.BindFlags     = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+        m_pDevice->CreateBuffer(BuffDesc, &ZeroData, &m_Exposure);
+        VERIFY_EXPR(m_Exposure != nullptr);
+    }
+
+    auto Time = std::chrono::duration_cast<std::chrono::milliseconds>(TimePoint::clock::now() - LoadStartTime).count();
+    LOG_INFO_MESSAGE(m_Scenes.size(), " scenes are loaded in ", Time, " ms, ", m_MaterialArena.GetCount(), " materials, ",
+                     m_MaterialArena.GetSize(), " bytes in the material table");
+}
+
+// Scene is appended to the arenas after creation, only the new meshes and nodes are added to the acceleration structures.
+// Arena buffers that are recreated when they grow are kept by the device until the frames in flight are completed.
+void RT_Scene::LoadAddedScene(SceneRange& Scene)
+{
+    const Uint32 FirstMesh = Uint32(m_Meshes.size());
+    const Uint32 FirstNode = Uint32(m_Nodes.size());
+
+    TextureRequests TexRequests;
+    LoadScene(Scene, TexRequests);
+    StartTextureStreaming(std::move(TexRequests));
+
+    if (m_HasRayTracing)
+    {
+        CreateBLAS(FirstMesh);
+        CreateTLAS(FirstNode);
+    }
+    else
+        CreateNodeList();
+
+    // pipelines are recreated only if the new material textures exceed the capacity
+    ReserveMaterialTextures(Uint32(m_MaterialColorMaps.size()));
+
+    // the merged layout contains only the previous scenes, the benchmark creates it again
+    m_pMergedLayout.reset();
+    BindResources();
+    if (m_HasRayTracing)
+        CreateSBT();
+
+    // light grid and CPU tracer are rebuilt for the new scene bounds and geometry
+    m_SceneBounds = DE::AABB{};
+    if (m_LightCount > 0)
+        SetLightCount(m_LightCount);
+
+    if (m_CPUTracer.IsCreated())
+        CreateCPUTracer();
+
+    m_pContext->Flush();
+}
+
+void RT_Scene::LoadScene(SceneRange& Scene, TextureRequests& TexRequests)
+{
+    const char* Path = Scene.Path.c_str();
+
+    GLTFSceneInfo SceneInfo;
+    if (!ParseSceneFile(Path, SceneInfo))
+        LOG_ERROR_MESSAGE("Failed to parse '", Path, "', textures will be loaded synchronously");
+
+    // the cache is rebaked when any of the source files is changed
+    std::vector<const char*> SourceFiles{Path};
+    for (auto& BuffPath : SceneInfo.BufferPaths)
+        SourceFiles.push_back(BuffPath.c_str());
+    for (auto& TexPath : SceneInfo.TexturePaths)
+    {
+        if (TexPath.size())
+            SourceFiles.push_back(TexPath.c_str());
+    }
+
+    const String CachePath   = String{Path} + ".cache";
+    const Uint64 SourceStamp = SceneCache::ComputeSourceStamp(SourceFiles);
+
+    bool Loaded = LoadBakedScene(Scene, CachePath.c_str(), SourceStamp, TexRequests);
+    if (!Loaded)
+    {
+        LOG_INFO_MESSAGE("Baking scene '", Path, "' to '", CachePath, '\'');
+        if (BakeScene(Path, SceneInfo, CachePath.c_str(), SourceStamp))
+            Loaded = LoadBakedScene(Scene, CachePath.c_str(), SourceStamp, TexRequests);
+    }
+    if (!Loaded)
+    {
+        LOG_ERROR_MESSAGE("Failed to bake scene, loading '", Path, "' without cache");
+        LoadGLTFScene(Scene, SceneInfo, TexRequests);
+    }
+
+    // CPU tracer decodes the source images, baked textures may be compressed
+    m_BaseColorPaths.resize(Scene.FirstMaterial);
+    for (int TexId : SceneInfo.MaterialBaseColors)
+        m_BaseColorPaths.push_back(TexId >= 0 && size_t(TexId) < SceneInfo.TexturePaths.size() ? SceneInfo.TexturePaths[TexId] : String{});
+
+    LOG_INFO_MESSAGE("Scene '", Path, "': ", Scene.VertexCount, " vertices, ", Scene.TriangleCount, " triangles, ",
+                     Scene.MaterialCount, " materials, ", Scene.NodeCount, " nodes");
+}
+
+void RT_Scene::LoadGLTFScene(SceneRange& Scene, const GLTFSceneInfo& Info, TextureRequests& TexRequests)
+{
+    const auto& TexturePaths = Info.TexturePaths;
+
+    // create model
+    std::unique_ptr<GLTF::Model> Model;
+    {
+        // GLTF loader does not decode images that are found in the cache,
+        // all images are replaced by the placeholder and streamed later.
+        TextureDesc TexDesc;
+        TexDesc.Name      = "Texture placeholder for RT Scene";
+        TexDesc.Type      = RESOURCE_DIM_TEX_2D;
+        TexDesc.Usage     = USAGE_IMMUTABLE;
+        TexDesc.BindFlags = BIND_SHADER_RESOURCE;
+        TexDesc.Width     = 1;
+        TexDesc.Height    = 1;
+        TexDesc.Format    = TEX_FORMAT_RGBA8_UNORM;
+        TexDesc.MipLevels = 1;
+        const Uint32            White = 0xFFFFFFFF;
+        TextureSubResData       Level0Data{&White, sizeof(White)};
+        TextureData             InitData{&Level0Data, 1};
+        RefCntAutoPtr<ITexture> pPlaceholder;
+        m_pDevice->CreateTexture(TexDesc, &InitData, &pPlaceholder);
+        VERIFY_EXPR(pPlaceholder != nullptr);
+
+        GLTF::Model::TextureCacheType TexCache;
+        for (auto& TexPath : TexturePaths)
+        {
+            if (TexPath.size() && pPlaceholder)
+                TexCache.Textures.emplace(FileSystem::SimplifyPath(TexPath.c_str()), RefCntWeakPtr<ITexture>{pPlaceholder});
+        }
+
+        GLTF::Model::CreateInfo ModelCI;
+        ModelCI.FileName      = Scene.Path.c_str();
+        ModelCI.pTextureCache = &TexCache;
+
+        Model.reset(new GLTF::Model(m_pDevice, m_pContext, ModelCI));
+    }
+
+    // GLTF loader keeps geometry only in GPU memory, it is copied to the arenas with rebased indices
+    std::vector<Uint8> Vertices;
+    std::vector<Uint8> Indices;
+    std::vector<Uint8> Triangles;
+    if (!ReadBufferData(m_pDevice, m_pContext, Model->GetBuffer(GLTF::Model::BUFFER_ID_VERTEX_BASIC_ATTRIBS), Vertices) ||
+        !ReadBufferData(m_pDevice, m_pContext, Model->GetBuffer(GLTF::Model::BUFFER_ID_TRIANGLES), Triangles))
+        LOG_ERROR_MESSAGE("Failed to read scene geometry");
+    ReadBufferData(m_pDevice, m_pContext, Model->GetBuffer(GLTF::Model::BUFFER_ID_INDEX), Indices);
+
+    // BLAS uses positions only, hit shaders use compact vertex attributes
+    PackedVertexData Packed;
+    PackVertexAttribs(reinterpret_cast<const VertexAttribs*>(Vertices.data()), Vertices.size() / sizeof(VertexAttribs), Packed);
+
+    std::vector<SceneCache::Geometry>     Geometries;
+    std::vector<SceneCache::Mesh>         Meshes;
+    std::vector<SceneCache::Node>         Nodes;
+    String                                Names;
+    std::vector<MaterialAttribs>          Materials;
+    std::vector<SceneCache::MaterialInfo> MaterialInfos;
+    GetModelGeometries(*Model, Info.NodeMeshes, Geometries, Meshes, Nodes, Names);
+    GetModelMaterials(*Model, Materials, MaterialInfos);
+
+    // texture ids are the same as in GLTF::Model
+    Uint32 TextureCount = Uint32(TexturePaths.size());
+    for (auto& MatInfo : MaterialInfos)
+        TextureCount = std::max(TextureCount, Uint32(MatInfo.BaseColorTexture + 1));
+
+    SceneData Data;
+    Data.Positions     = ToArray(Packed.Positions.data(), Packed.Positions.size());
+    Data.HitAttribs    = ToArray(Packed.HitAttribs.data(), Packed.HitAttribs.size());
+    Data.HitUV1        = ToArray(Packed.UV1.data(), Packed.UV1.size());
+    Data.Indices       = ToArray(reinterpret_cast<const Uint32*>(Indices.data()), Indices.size() / sizeof(Uint32));
+    Data.Triangles     = ToArray(reinterpret_cast<const PrimitiveAttribs*>(Triangles.data()), Triangles.size() / sizeof(PrimitiveAttribs));
+    Data.Geometries    = ToArray(Geometries.data(), Geometries.size());
+    Data.Meshes        = ToArray(Meshes.data(), Meshes.size());
+    Data.Nodes         = ToArray(Nodes.data(), Nodes.size());
+    Data.Names         = ToArray(Names.data(), Names.size());
+    Data.Materials     = ToArray(Materials.data(), Materials.size());
+    Data.MaterialInfos = ToArray(MaterialInfos.data(), MaterialInfos.size());
+    Data.TextureCount  = TextureCount;
+    AppendScene(Scene, Data);
+
+    for (Uint32 i = 0; i < MaterialInfos.size(); ++i)
+    {
+        int       baseColorTexId = MaterialInfos[i].BaseColorTexture;
+        ITexture* pBaseColorTex  = baseColorTexId < 0 ? nullptr : Model->GetTexture(baseColorTexId);
+
+        // keep fallback texture until the streamed texture is loaded
+        if (baseColorTexId >= 0 && size_t(baseColorTexId) < TexturePaths.size() && TexturePaths[baseColorTexId].size())
+        {
+            const Uint32 RequestId   = Scene.FirstTexture + Uint32(baseColorTexId);
+            const auto   IsRequested = [RequestId](const TextureStreamer::Request& Req) { return Req.Id == RequestId; };
+            if (std::none_of(TexRequests.begin(), TexRequests.end(), IsRequested))
+                TexRequests.push_back({RequestId, TexturePaths[baseColorTexId]});
+        }
+        else if (pBaseColorTex != nullptr)
+            m_MaterialColorMaps[Scene.FirstMaterial + i] = pBaseColorTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+    }
+}
+
+bool RT_Scene::LoadBakedScene(SceneRange& Scene, const char* CachePath, Uint64 SourceStamp, TextureRequests& TexRequests)
+{
+    using ESection = SceneCache::ESection;
+
+    std::unique_ptr<SceneCache> pCache{new SceneCache{}};
+    if (!pCache->Open(CachePath, SourceStamp))
+        return false;
+
+    const auto& Cache = *pCache;
+
+    const auto Positions     = Cache.Get<float3>(ESection::Positions);
+    const auto HitAttribs    = Cache.Get<HitVertexAttribs>(ESection::HitVertexAttribs);
+    const auto HitUV1        = Cache.Get<Uint32>(ESection::HitVertexUV1);
+    const auto Indices       = Cache.Get<Uint32>(ESection::Indices);
+    const auto Triangles     = Cache.Get<PrimitiveAttribs>(ESection::Triangles);
+    const auto Geometries    = Cache.Get<SceneCache::Geometry>(ESection::Geometries);
+    const auto Meshes        = Cache.Get<SceneCache::Mesh>(ESection::Meshes);
+    const auto Nodes         = Cache.Get<SceneCache::Node>(ESection::Nodes);
+    const auto Names         = Cache.Get<char>(ESection::Names);
+    const auto Materials     = Cache.Get<MaterialAttribs>(ESection::Materials);
+    const auto MaterialInfos = Cache.Get<SceneCache::MaterialInfo>(ESection::MaterialInfos);
+    const auto Textures      = Cache.Get<SceneCache::Texture>(ESection::Textures);
+    const auto TextureMips   = Cache.Get<SceneCache::MipLevel>(ESection::TextureMips);
+    const auto TextureData   = Cache.Get<Uint8>(ESection::TextureData);
+
+    const bool IsValid = !Positions.empty() && HitAttribs.size() == Positions.size() &&
+        (HitUV1.empty() || HitUV1.size() == Positions.size()) && !Triangles.empty() && !Geometries.empty() && !Materials.empty() &&
+        !Meshes.empty() && !Nodes.empty() && MaterialInfos.size() == Materials.size() &&
+        std::all_of(Geometries.begin(), Geometries.end(), [&](const SceneCache::Geometry& Geom) {
+            return Geom.MaterialId < Materials.size() && Geom.NameOffset < Names.size();
+        }) &&
+        std::all_of(Meshes.begin(), Meshes.end(), [&](const SceneCache::Mesh& Mesh) {
+            return Mesh.GeometryCount > 0 && Mesh.FirstGeometry + Mesh.GeometryCount <= Geometries.size();
+        }) &&
+        std::all_of(Nodes.begin(), Nodes.end(), [&](const SceneCache::Node& Node) {
+            return Node.MeshId < Meshes.size() && Node.NameOffset < Names.size();
+        }) &&
+        std::all_of(MaterialInfos.begin(), MaterialInfos.end(), [&](const SceneCache::MaterialInfo& Info) {
+            return Info.BaseColorTexture < Int32(Textures.size());
+        }) &&
+        std::all_of(Textures.begin(), Textures.end(), [&](const SceneCache::Texture& Tex) {
+            return Tex.FirstMip + Tex.MipCount <= TextureMips.size();
+        }) &&
+        std::all_of(TextureMips.begin(), TextureMips.end(), [&](const SceneCache::MipLevel& Mip) {
+            return Mip.Offset + Mip.Size <= TextureData.size();
+        });
+
+    if (!IsValid)
+    {
+        LOG_ERROR_MESSAGE("Scene cache '", CachePath, "' is corrupted");
+        return false;
+    }
+
+    // arenas are filled directly from the mapped file, only indices and triangles are copied to rebase them
+    SceneData Data;
+    Data.Positions     = Positions;
+    Data.HitAttribs    = HitAttribs;
+    Data.HitUV1        = HitUV1;
+    Data.Indices       = Indices;
+    Data.Triangles     = Triangles;
+    Data.Geometries    = Geometries;
+    Data.Meshes        = Meshes;
+    Data.Nodes         = Nodes;
+    Data.Names         = Names;
+    Data.Materials     = Materials;
+    Data.MaterialInfos = MaterialInfos;
+    Data.TextureCount  = Textures.size();
+    AppendScene(Scene, Data);
+
+    // textures are streamed from the mapped file, the cache is closed when all textures are loaded
+    TexRequests.reserve(TexRequests.size() + Textures.size());
+
+    for (Uint32 i = 0; i < Textures.size(); ++i)
+    {
+        const auto& Tex = Textures[i];
+        if (Tex.MipCount == 0)
+            continue;
+
+        TextureStreamer::Request Req;
+        Req.Id              = Scene.FirstTexture + i;
+        Req.Image.Width     = Tex.Width;
+        Req.Image.Height    = Tex.Height;
+        Req.Image.Format    = TEXTURE_FORMAT(Tex.Format);
+        Req.Image.pExternal = TextureData.pData;
+        Req.Image.Mips.resize(Tex.MipCount);
+
+        for (Uint32 m = 0; m < Tex.MipCount; ++m)
+        {
+            const auto& Src   = TextureMips[Tex.FirstMip + m];
+            Req.Image.Mips[m] = {Src.Offset, Src.Stride, Src.Size};
+        }
+        TexRequests.push_back(std::move(Req));
+    }
+
+    Scene.pCache = std::move(pCache);
+    return true;
+}
+
+void RT_Scene::AppendScene(SceneRange& Scene, const SceneData& Data)
+{
+    const Uint32 NameOffset = Uint32(m_SceneNames.size());
+
+    Scene.FirstVertex   = m_PositionArena.GetCount();
+    Scene.FirstIndex    = m_IndexArena.GetCount();
+    Scene.FirstTriangle = m_TriangleArena.GetCount();
+    Scene.FirstMaterial = m_MaterialArena.GetCount();
+    Scene.FirstGeometry = Uint32(m_Geometries.size());
+    Scene.FirstMesh     = Uint32(m_Meshes.size());
+    Scene.FirstNode     = Uint32(m_Nodes.size());
+    Scene.FirstTexture  = m_TextureCount;
+    Scene.VertexCount   = Data.Positions.size();
+    Scene.TriangleCount = Data.Triangles.size();
+    Scene.MaterialCount = Data.Materials.size();
+    Scene.NodeCount     = Data.Nodes.size();
+
+    // vertex attributes and materials do not reference other data
+    m_PositionArena.Append(m_pContext, Data.Positions.pData, Data.Positions.size());
+    m_HitAttribsArena.Append(m_pContext, Data.HitAttribs.pData, Data.HitAttribs.size());
+    m_MaterialArena.Append(m_pContext, Data.Materials.pData, Data.Materials.size());
+
+    // UV1 is stored if any scene has it, scenes without UV1 use UV0 instead
+    if (!Data.HitUV1.empty() && m_HitUV1Arena.GetCount() < Scene.FirstVertex)
+    {
+        // the first scene with UV1, UV0 of the previous scenes is read back from the arena
+        std::vector<Uint32> UV0(Scene.FirstVertex, 0u);
+        std::vector<Uint8>  HitAttribs;
+        if (ReadBufferData(m_pDevice, m_pContext, m_HitAttribsArena.GetBuffer(), HitAttribs, Scene.FirstVertex * Uint32(sizeof(HitVertexAttribs))))
+        {
+            const auto* pAttribs = reinterpret_cast<const HitVertexAttribs*>(HitAttribs.data());
+            for (Uint32 i = 0; i < Scene.FirstVertex; ++i)
+                UV0[i] = pAttribs[i].UV0;
+        }
+        else
+            LOG_ERROR_MESSAGE("Failed to read UV0 of the previous scenes, their UV1 is zero");
+
+        m_HitUV1Arena.Append(m_pContext, UV0.data(), Uint32(UV0.size()));
+    }
+    if (!Data.HitUV1.empty() || m_HitUV1Arena.GetCount() > 0)
+    {
+        if (Data.HitUV1.size() == Data.HitAttribs.size())
+            m_HitUV1Arena.Append(m_pContext, Data.HitUV1.pData, Data.HitUV1.size());
+        else
+        {
+            std::vector<Uint32> UV0;
+            UV0.reserve(Data.HitAttribs.size());
+            for (auto& Attribs : Data.HitAttribs)
+                UV0.push_back(Attribs.UV0);
+            m_HitUV1Arena.Append(m_pContext, UV0.data(), Uint32(UV0.size()));
+        }
+    }
+
+    // BLAS indices stay relative to the first vertex of the scene, BLAS geometries use the vertex offset of the scene;
+    // triangle faces are read by the hit shaders from the shared arenas, so they are global
+    {
+        m_IndexArena.Append(m_pContext, Data.Indices.pData, Data.Indices.size());
+
+        std::vector<PrimitiveAttribs> Triangles{Data.Triangles.begin(), Data.Triangles.end()};
+        for (auto& Tri : Triangles)
+        {
+            Tri.Face.x += Scene.FirstVertex;
+            Tri.Face.y += Scene.FirstVertex;
+            Tri.Face.z += Scene.FirstVertex;
+            Tri.MaterialID += Scene.FirstMaterial;
+        }
+        m_TriangleArena.Append(m_pContext, Triangles.data(), Uint32(Triangles.size()));
+    }
+
+    for (auto Geom : Data.Geometries)
+    {
+        Geom.FirstIndex += Scene.FirstIndex;
+        Geom.FirstTriangle += Scene.FirstTriangle;
+        Geom.MaterialId += Scene.FirstMaterial;
+        Geom.NameOffset += NameOffset;
+        m_Geometries.push_back(Geom);
+    }
+    for (auto Mesh : Data.Meshes)
+    {
+        Mesh.FirstGeometry += Scene.FirstGeometry;
+        m_Meshes.push_back(Mesh);
+    }
+
+    // scene transform is baked into the nodes, so TLAS instances do not depend on the scene
+    for (auto Node : Data.Nodes)
+    {
+        Node.Transform = Node.Transform * Scene.Transform;
+        Node.MeshId += Scene.FirstMesh;
+        Node.NameOffset += NameOffset;
+        m_Nodes.push_back(Node);
+    }
+    for (auto Info : Data.MaterialInfos)
+    {
+        if (Info.BaseColorTexture >= 0)
+            Info.BaseColorTexture += Int32(Scene.FirstTexture);
+        m_MaterialInfos.push_back(Info);
+    }
+    m_SceneNames.append(Data.Names.begin(), Data.Names.end());
+    m_TextureCount += Data.TextureCount;
+
+    // use fallback texture until the streamed texture is loaded
+    m_MaterialColorMaps.resize(m_MaterialInfos.size(), m_pWhiteTexSRV);
+}
+
+bool RT_Scene::BakeScene(const char* Path, const GLTFSceneInfo& Info, const char* CachePath, Uint64 SourceStamp)
+{
+    const auto& TexturePaths = Info.TexturePaths;
+
+    // load model without textures, images are decoded and mipmapped on the CPU
+    std::unique_ptr<GLTF::Model> Model;
+    {
+        GLTF::Model::TextureCacheType TexCache;
+        RefCntAutoPtr<ITexture>       pPlaceholder{m_pWhiteTexSRV->GetTexture()};
+        for (auto& TexPath : TexturePaths)
+        {
+            if (TexPath.size())
+                TexCache.Textures.emplace(FileSystem::SimplifyPath(TexPath.c_str()), RefCntWeakPtr<ITexture>{pPlaceholder});
+        }
+
+        GLTF::Model::CreateInfo ModelCI;
+        ModelCI.FileName      = Path;
+        ModelCI.pTextureCache = &TexCache;
+
+        Model.reset(new GLTF::Model(m_pDevice, m_pContext, ModelCI));
+    }
+
+    // GLTF loader keeps geometry only in GPU memory
+    std::vector<Uint8> Vertices;
+    std::vector<Uint8> Indices;
+    std::vector<Uint8> Triangles;
+    if (!ReadBufferData(m_pDevice, m_pContext, Model->GetBuffer(GLTF::Model::BUFFER_ID_VERTEX_BASIC_ATTRIBS), Vertices) ||
+        !ReadBufferData(m_pDevice, m_pContext, Model->GetBuffer(GLTF::Model::BUFFER_ID_TRIANGLES), Triangles))
+    {
+        LOG_ERROR_MESSAGE("Failed to read scene geometry");
+        return false;
+    }
+    ReadBufferData(m_pDevice, m_pContext, Model->GetBuffer(GLTF::Model::BUFFER_ID_INDEX), Indices);
+
+    std::vector<SceneCache::Geometry>     Geometries;
+    std::vector<SceneCache::Mesh>         Meshes;
+    std::vector<SceneCache::Node>         Nodes;
+    String                                Names;
+    std::vector<MaterialAttribs>          Materials;
+    std::vector<SceneCache::MaterialInfo> MaterialInfos;
+    GetModelGeometries(*Model, Info.NodeMeshes, Geometries, Meshes, Nodes, Names);
+    GetModelMaterials(*Model, Materials, MaterialInfos);
+    Model.reset();
+
+    // only base color textures are used, embedded images are not supported
+    std::vector<Uint32> BakedTexIds;
+    for (auto& Info : MaterialInfos)
+    {
+        const int TexId = Info.BaseColorTexture;
+        if (TexId < 0 || size_t(TexId) >= TexturePaths.size() || TexturePaths[TexId].empty())
+        {
+            Info.BaseColorTexture = -1;
+            continue;
+        }
+
+        auto Iter             = std::find(BakedTexIds.begin(), BakedTexIds.end(), Uint32(TexId));
+        Info.BaseColorTexture = Int32(Iter - BakedTexIds.begin());
+        if (Iter == BakedTexIds.end())
+            BakedTexIds.push_back(Uint32(TexId));
+    }
+
+    // alpha of base color textures is used to find opaque triangles in geometries with alpha tested or blended materials
+    {
+        std::vector<AlphaCoverage> Coverage(BakedTexIds.size());
+        for (size_t m = 0; m < MaterialInfos.size(); ++m)
+        {
+            const int TexId = MaterialInfos[m].BaseColorTexture;
+            if (MaterialInfos[m].AlphaMode == GLTF::Material::ALPHA_MODE_OPAQUE || TexId < 0 || Coverage[TexId].IsValid())
+                continue;
+
+            TextureStreamer::ImageData Image;
+            if (!TextureStreamer::DecodeImage(TexturePaths[BakedTexIds[TexId]].c_str(), Image) || !Coverage[TexId].Init(Image))
+                LOG_ERROR_MESSAGE("Failed to load alpha of texture '", TexturePaths[BakedTexIds[TexId]], '\'');
         }
+
+        SplitAlphaGeometries(Materials, MaterialInfos, Coverage, Vertices, Indices, Triangles, Geometries, Meshes, Names);
     }
 
-    // create AS
-    BottomLevelASDesc ASDesc;
+    OptimizeGeometryLayout(Geometries, Vertices, Indices, Triangles);
+
+    PackedVertexData Packed;
+    PackVertexAttribs(reinterpret_cast<const VertexAttribs*>(Vertices.data()), Vertices.size() / sizeof(VertexAttribs), Packed);
+    Vertices.clear();
 
-    if (Opaque.TriangleInfos.size())
+    // color maps are compressed to BC7, compressed images are cached by the source file content,
+    // so only changed textures are encoded again when the scene is rebaked
+    String TexCacheDir = Path;
     {
-        ASDesc.Name          = "Opaque BLAS";
-        ASDesc.pTriangles    = Opaque.TriangleInfos.data();
-        ASDesc.TriangleCount = Uint32(Opaque.TriangleInfos.size());
-        m_pDevice->CreateBLAS(ASDesc, &m_pOpaqueBLAS);
-        VERIFY_EXPR(m_pOpaqueBLAS != nullptr);
+        const auto Pos = TexCacheDir.find_last_of("/\\");
+        TexCacheDir    = (Pos != String::npos ? TexCacheDir.substr(0, Pos + 1) : String{}) + "BCCache";
     }
 
-    if (Translucent.TriangleInfos.size())
+    TEXTURE_FORMAT ColorMapFormat = TEX_FORMAT_BC7_UNORM;
+    if (!m_pDevice->GetTextureFormatInfo(ColorMapFormat).Supported)
+    {
+        LOG_INFO_MESSAGE("BC7 is not supported, textures will not be compressed");
+        ColorMapFormat = TEX_FORMAT_UNKNOWN;
+    }
+    else if (!FileSystem::PathExists(TexCacheDir.c_str()) && !FileSystem::CreateDirectory(TexCacheDir.c_str()))
     {
-        ASDesc.Name          = "Translucent BLAS";
-        ASDesc.pTriangles    = Translucent.TriangleInfos.data();
-        ASDesc.TriangleCount = Uint32(Translucent.TriangleInfos.size());
-        m_pDevice->CreateBLAS(ASDesc, &m_pTranslucentBLAS);
-        VERIFY_EXPR(m_pTranslucentBLAS != nullptr);
+        LOG_ERROR_MESSAGE("Failed to create texture cache directory '", TexCacheDir, '\'');
+        ColorMapFormat = TEX_FORMAT_UNKNOWN;
     }
 
-    // create scratch buffer
-    RefCntAutoPtr<IBuffer> ScratchBuffer;
-    BufferDesc             BuffDesc;
-    BuffDesc.Name          = "BLAS Scratch Buffer";
-    BuffDesc.Usage         = USAGE_DEFAULT;
-    BuffDesc.BindFlags     = BIND_RAY_TRACING;
-    BuffDesc.uiSizeInBytes = max(m_pOpaqueBLAS ? m_pOpaqueBLAS->GetScratchBufferSizes().Build : 0,
-                                 m_pTranslucentBLAS ? m_pTranslucentBLAS->GetScratchBufferSizes().Build : 0);
-    m_pDevice->CreateBuffer(BuffDesc, nullptr, &ScratchBuffer);
-    VERIFY_EXPR(ScratchBuffer != nullptr);
+    std::vector<TextureStreamer::ImageData> Images(BakedTexIds.size());
+    {
+        std::atomic<Uint32> NextImage{0};
 
-    // build AS
-    BuildBLASAttribs Attribs;
-    Attribs.BLASTransitionMode          = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
-    Attribs.GeometryTransitionMode      = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
-    Attribs.pScratchBuffer              = ScratchBuffer;
-    Attribs.ScratchBufferTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        const auto DecodeImages = [&]() {
+            for (Uint32 i = NextImage.fetch_add(1); i < Images.size(); i = NextImage.fetch_add(1))
+            {
+                const auto& FilePath = TexturePaths[BakedTexIds[i]];
+                const bool  Loaded   = ColorMapFormat != TEX_FORMAT_UNKNOWN ?
+                    TextureCompressor::LoadCompressed(FilePath.c_str(), ColorMapFormat, TexCacheDir.c_str(), Images[i]) :
+                    TextureStreamer::DecodeImage(FilePath.c_str(), Images[i]);
+                if (!Loaded)
+                {
+                    LOG_ERROR_MESSAGE("Failed to load texture '", FilePath, '\'');
+                    Images[i] = {};
+                }
+            }
+        };
+
+        std::vector<std::thread> Workers;
+        for (Uint32 i = 1; i < std::thread::hardware_concurrency(); ++i)
+            Workers.emplace_back(DecodeImages);
 
-    if (m_pOpaqueBLAS)
+        DecodeImages();
+
+        for (auto& Worker : Workers)
+            Worker.join();
+    }
+
+    std::vector<SceneCache::Texture>  Textures(Images.size());
+    std::vector<SceneCache::MipLevel> TextureMips;
+    std::vector<Uint8>                TextureData;
+    for (size_t i = 0; i < Images.size(); ++i)
     {
-        Attribs.pBLAS             = m_pOpaqueBLAS;
-        Attribs.pTriangleData     = Opaque.TriangleData.data();
-        Attribs.TriangleDataCount = Uint32(Opaque.TriangleData.size());
-        m_pContext->BuildBLAS(Attribs);
+        const auto& Image = Images[i];
+        auto&       Tex   = Textures[i];
 
-        BuffDesc.Name          = "opaque primitives offsets";
-        BuffDesc.BindFlags     = BIND_SHADER_RESOURCE;
-        BuffDesc.uiSizeInBytes = Uint32(Opaque.PrimitiveOffsets.size() * sizeof(Opaque.PrimitiveOffsets[0]));
-        BuffDesc.Mode          = BUFFER_MODE_RAW;
+        Tex.Width    = Image.Width;
+        Tex.Height   = Image.Height;
+        Tex.Format   = Uint32(Image.Format);
+        Tex.FirstMip = Uint32(TextureMips.size());
+        Tex.MipCount = Uint32(Image.Mips.size());
+
+        for (auto& Mip : Image.Mips)
+            TextureMips.push_back({TextureData.size() + Mip.Offset, Mip.Stride, Mip.Size});
 
-        BufferData             BuffData{Opaque.PrimitiveOffsets.data(), BuffDesc.uiSizeInBytes};
-        RefCntAutoPtr<IBuffer> Buff;
-        m_pDevice->CreateBuffer(BuffDesc, &BuffData, &Buff);
-        VERIFY_EXPR(Buff != nullptr);
-        m_PrimitiveOffsets[0] = Buff->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE);
+        TextureData.insert(TextureData.end(), Image.Pixels.begin(), Image.Pixels.end());
     }
+    LOG_INFO_MESSAGE("Baked ", Textures.size(), " textures, ", TextureData.size() >> 20, " Mb");
+
+    using ESection = SceneCache::ESection;
+
+    SceneCache::Writer Writer;
+    Writer.AddSection(ESection::Positions, Packed.Positions);
+    Writer.AddSection(ESection::HitVertexAttribs, Packed.HitAttribs);
+    Writer.AddSection(ESection::HitVertexUV1, Packed.UV1.data(), Packed.UV1.size() * sizeof(Uint32), sizeof(Uint32));
+    Writer.AddSection(ESection::Indices, Indices.data(), Indices.size(), sizeof(Uint32));
+    Writer.AddSection(ESection::Triangles, Triangles.data(), Triangles.size(), sizeof(PrimitiveAttribs));
+    Writer.AddSection(ESection::Geometries, Geometries);
+    Writer.AddSection(ESection::Meshes, Meshes);
+    Writer.AddSection(ESection::Nodes, Nodes);
+    Writer.AddSection(ESection::Names, Names.data(), Names.size(), sizeof(char));
+    Writer.AddSection(ESection::Materials, Materials);
+    Writer.AddSection(ESection::MaterialInfos, MaterialInfos);
+    Writer.AddSection(ESection::Textures, Textures);
+    Writer.AddSection(ESection::TextureMips, TextureMips);
+    Writer.AddSection(ESection::TextureData, TextureData);
+    return Writer.Write(CachePath, SourceStamp);
+}
 
-    if (m_pTranslucentBLAS)
+void RT_Scene::StartTextureStreaming(TextureRequests&& TexRequests)
+{
+    // requests can not be added to the running streamer, they are started when the current requests are loaded
+    if (!m_TextureStreamer.IsCompleted())
     {
-        Attribs.pBLAS             = m_pTranslucentBLAS;
-        Attribs.pTriangleData     = Translucent.TriangleData.data();
-        Attribs.TriangleDataCount = Uint32(Translucent.TriangleData.size());
-        m_pContext->BuildBLAS(Attribs);
+        m_PendingTexRequests.insert(m_PendingTexRequests.end(), std::make_move_iterator(TexRequests.begin()), std::make_move_iterator(TexRequests.end()));
+        return;
+    }
 
-        BuffDesc.Name          = "translucent primitives offsets";
-        BuffDesc.BindFlags     = BIND_SHADER_RESOURCE;
-        BuffDesc.uiSizeInBytes = Uint32(Translucent.PrimitiveOffsets.size() * sizeof(Translucent.PrimitiveOffsets[0]));
-        BuffDesc.Mode          = BUFFER_MODE_RAW;
+    LOG_INFO_MESSAGE("Streaming ", TexRequests.size(), " textures");
+    m_TextureStreamer.Start(m_pDevice, std::move(TexRequests));
 
-        BufferData             BuffData{Translucent.PrimitiveOffsets.data(), BuffDesc.uiSizeInBytes};
-        RefCntAutoPtr<IBuffer> Buff;
-        m_pDevice->CreateBuffer(BuffDesc, &BuffData, &Buff);
-        VERIFY_EXPR(Buff != nullptr);
-        m_PrimitiveOffsets[1] = Buff->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE);
+    if (m_TextureStreamer.IsCompleted())
+    {
+        for (auto& Scene : m_Scenes)
+            Scene.pCache.reset();
     }
 }
 
-void RT_Scene::CreateTLAS()
+void RT_Scene::StreamTextures()
 {
-    std::vector<TLASBuildInstanceData> Instances;
+    if (m_TextureStreamer.IsCompleted())
+        return;
 
-    const auto     ScaleMat = float4x4::RotationX(PI_F) * float4x4::Scale(0.05f);
-    InstanceMatrix Transform;
+    bool Changed = false;
+    m_TextureStreamer.Update(m_pContext, [this, &Changed](Uint32 TexId, ITexture* pTexture) {
+        // keep fallback texture if loading failed
+        if (pTexture == nullptr)
+            return;
+
+        for (size_t i = 0; i < m_MaterialInfos.size(); ++i)
+        {
+            if (m_MaterialInfos[i].BaseColorTexture == int(TexId))
+            {
+                m_MaterialColorMaps[i] = pTexture->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+                Changed                = true;
+            }
+        }
+    });
 
-    for (int c = 0; c < 3; ++c)
-        for (int r = 0; r < 4; ++r)
-            Transform.data[c][r] = ScaleMat.m[c][r];
+    if (Changed)
+        BindResources();
 
-    if (m_pOpaqueBLAS)
+    if (m_TextureStreamer.IsCompleted() && !m_PendingTexRequests.empty())
+    {
+        TextureRequests Pending = std::move(m_PendingTexRequests);
+        m_PendingTexRequests.clear();
+        StartTextureStreaming(std::move(Pending));
+    }
+    else if (m_TextureStreamer.IsCompleted())
     {
-        Instances.emplace_back();
-        TLASBuildInstanceData& Inst = Instances.back();
+        // all baked texture data is copied to the GPU memory
+        for (auto& Scene : m_Scenes)
+            Scene.pCache.reset();
 
-        Inst.InstanceName                = "Opaque";
-        Inst.pBLAS                       = m_pOpaqueBLAS;
-        Inst.CustomId                    = 0;
-        Inst.Flags                       = RAYTRACING_INSTANCE_FORCE_OPAQUE;
-        Inst.Mask                        = 0xFF;
-        Inst.ContributionToHitGroupIndex = TLAS_INSTANCE_OFFSET_AUTO;
-        Inst.Transform                   = Transform;
+        auto Time = std::chrono::duration_cast<std::chrono::milliseconds>(TimePoint::clock::now() - m_StartTime).count();
+        LOG_INFO_MESSAGE("All textures are loaded in ", Time, " ms");
     }
+}
+
+bool RT_Scene::Update() noexcept
+{
+    if (m_Window == nullptr)
+        return false;
+
+    if (glfwWindowShouldClose(m_Window))
+        return false;
+
+    if (m_pSwapChain == nullptr)
+        return false;
+
+    glfwPollEvents();
 
-    if (m_pTranslucentBLAS)
+    if (m_ColorUAV == nullptr)
     {
-        Instances.emplace_back();
-        TLASBuildInstanceData& Inst = Instances.back();
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        return true;
+    }
+
+    auto time        = TimePoint::clock::now();
+    auto dt          = std::chrono::duration_cast<Seconds>(time - m_LastUpdateTime).count();
+    m_LastUpdateTime = time;
+    m_SceneTime      = std::chrono::duration_cast<Seconds>(time - m_StartTime).count();
 
-        Inst.InstanceName                = "Translucent";
-        Inst.pBLAS                       = m_pTranslucentBLAS;
-        Inst.CustomId                    = 0;
-        Inst.Flags                       = RAYTRACING_INSTANCE_FORCE_NO_OPAQUE;
-        Inst.Mask                        = 0xFF;
-        Inst.ContributionToHitGroupIndex = TLAS_INSTANCE_OFFSET_AUTO;
-        Inst.Transform                   = Transform;
+    DE::CameraPath::Frame Frame;
+    if (m_CameraPlayer.NextFrame(Frame))
+    {
+        // user input is ignored, camera depends only on the frame index
+        InputControllerBase NoInput;
+        m_SceneTime = Frame.Time;
+        m_Camera.SetPos(Frame.Position);
+        m_Camera.SetLookAt(Frame.Position + Frame.Direction);
+        m_Camera.Update(NoInput, m_CameraPlayer.GetTimeStep());
+
+        if (m_CameraPlayer.GetFrameIndex() == m_CameraPlayer.GetFrameCount())
+            LOG_INFO_MESSAGE("Camera path replay is finished");
     }
+    else
+    {
+        m_Camera.Update(m_InputController, dt);
+    }
+    m_InputController.ClearState();
 
-    // create
-    TopLevelASDesc TLASDesc;
-    TLASDesc.Name             = "TLAS";
-    TLASDesc.MaxInstanceCount = Uint32(Instances.size());
-    TLASDesc.Flags            = RAYTRACING_BUILD_AS_NONE;
-    m_pDevice->CreateTLAS(TLASDesc, &m_pTLAS);
-    VERIFY_EXPR(m_pTLAS != nullptr);
+    // dropped files are loaded in front of the camera
+    for (const auto& Path : m_DroppedScenes)
+        AddScene(Path.c_str(), float4x4::Translation(m_Camera.GetPos()));
+    m_DroppedScenes.clear();
 
-    // create scratch buffer
-    RefCntAutoPtr<IBuffer> ScratchBuffer;
-    BufferDesc             BuffDesc;
-    BuffDesc.Name          = "TLAS Scratch Buffer";
-    BuffDesc.Usage         = USAGE_DEFAULT;
-    BuffDesc.BindFlags     = BIND_RAY_TRACING;
-    BuffDesc.uiSizeInBytes = m_pTLAS->GetScratchBufferSizes().Build;
-    m_pDevice->CreateBuffer(BuffDesc, nullptr, &ScratchBuffer);
-    VERIFY_EXPR(ScratchBuffer != nullptr);
+    m_CameraRecorder.AddFrame(m_Camera.GetPos(), float3::MakeVector(m_Camera.GetWorldMatrix()[2]), m_SceneTime);
 
-    // create instance buffer
-    RefCntAutoPtr<IBuffer> InstanceBuffer;
-    BuffDesc.Name          = "TLAS Instance Buffer";
-    BuffDesc.Usage         = USAGE_DEFAULT;
-    BuffDesc.BindFlags     = BIND_RAY_TRACING;
-    BuffDesc.uiSizeInBytes = TLAS_INSTANCE_DATA_SIZE * Uint32(Instances.size());
-    m_pDevice->CreateBuffer(BuffDesc, nullptr, &InstanceBuffer);
-    VERIFY_EXPR(InstanceBuffer != nullptr);
-
-    // build
-    BuildTLASAttribs Attribs;
-    Attribs.pTLAS                        = m_pTLAS;
-    Attribs.pInstances                   = Instances.data();
-    Attribs.InstanceCount                = Uint32(Instances.size());
-    Attribs.HitGroupStride               = HitGroupStride;
-    Attribs.BindingMode                  = HIT_GROUP_BINDING_MODE_PER_INSTANCE;
-    Attribs.TLASTransitionMode           = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
-    Attribs.BLASTransitionMode           = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
-    Attribs.pInstanceBuffer              = InstanceBuffer;
-    Attribs.InstanceBufferTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
-    Attribs.pScratchBuffer               = ScratchBuffer;
-    Attribs.ScratchBufferTransitionMode  = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
-    m_pContext->BuildTLAS(Attribs);
+    Render();
+    return true;
 }
 
-void RT_Scene::CreateSBT()
+bool RT_Scene::RunBenchmark(const BenchmarkSettings& Settings) noexcept
 {
-    ShaderBindingTableDesc SBTDesc;
-    SBTDesc.Name = "SBT";
-    SBTDesc.pPSO = m_pRayTracingPSO;
-    m_pDevice->CreateSBT(SBTDesc, &m_pSBT);
+    if (m_pDevice == nullptr || m_ColorUAV == nullptr)
+        return false;
 
-    if (m_pSBT != nullptr)
+    DE::CameraPath Path;
+    if (!Path.Load(Settings.CameraPathFile.c_str()))
+        return false;
+
+    m_AnimateNodes = Settings.AnimateNodes && !Settings.UseCPUTracer;
+    m_Benchmark    = {};
+
+    if (!Settings.UseCPUTracer)
     {
-        // clang-format off
-        m_pSBT->BindRayGenShader("Main");
-        m_pSBT->BindMissShader("PrimaryMiss", PrimaryRayIndex);
-        m_pSBT->BindMissShader("ShadowMiss",  ShadowRayIndex);
-    
-        if (m_pOpaqueBLAS)
+        if (!SetUseRayQuery(Settings.UseRayQuery))
+            return false;
+
+        SetTraceScale(Settings.TraceScale);
+        SetTargetFPS(Settings.TargetFPS);
+        SetStochasticLights(Settings.StochasticLights);
+
+        if (Settings.LightCount != m_LightCount && !SetLightCount(Settings.LightCount))
+            return false;
+    }
+
+    if (Settings.UseCPUTracer)
+    {
+        if (Settings.AnimateNodes)
+            LOG_INFO_MESSAGE("Node animation is not supported by CPU tracer, nodes are static");
+
+        if (!m_CPUTracer.IsCreated() && !CreateCPUTracer())
+            return false;
+    }
+
+    // shadow rays are counted only by the benchmark, counters add an atomic per hit
+    m_CountRays = !Settings.UseCPUTracer;
+
+    // the same frames are rendered without shadow LOD to measure the saved time
+    const bool CompareShadowLOD = !Settings.UseCPUTracer && (Settings.ShadowDistance > 0.0f || Settings.ShadowRayLength > 0.0f);
+    if (CompareShadowLOD)
+    {
+        SetShadowLOD(0.0f, 0.0f);
+        RunBenchmarkFrames(Settings, Path);
+
+        m_ShadowLODReference = std::move(m_Benchmark);
+        m_Benchmark          = {};
+        SetShadowLOD(Settings.ShadowDistance, Settings.ShadowRayLength);
+    }
+
+    // the same frames are traced with all triangles merged to one opaque and one non-opaque BLAS,
+    // merged layout is static and hit shaders use untransformed normals, so only timings are comparable
+    if (Settings.CompareBLASLayout && !Settings.UseCPUTracer)
+    {
+        if (CreateMergedBLASLayout())
+        {
+            if (m_AnimateNodes)
+                LOG_INFO_MESSAGE("Merged BLAS layout is static, nodes are not animated in the BLAS layout pass");
+
+            UseMergedBLASLayout(true);
+            RunBenchmarkFrames(Settings, Path);
+            UseMergedBLASLayout(false);
+
+            m_BLASLayoutReference = std::move(m_Benchmark);
+            m_Benchmark           = {};
+        }
+        else
+            LOG_WARNING_MESSAGE("Failed to create merged BLAS layout, BLAS layout comparison is skipped");
+    }
+
+    RunBenchmarkFrames(Settings, Path);
+
+    const bool Succeeded  = WriteBenchmarkReport(Settings);
+    m_Benchmark           = {};
+    m_ShadowLODReference  = {};
+    m_BLASLayoutReference = {};
+    m_CountRays           = false;
+    m_pMergedLayout.reset();
+    return Succeeded;
+}
+
+void RT_Scene::RunBenchmarkFrames(const BenchmarkSettings& Settings, const DE::CameraPath& Path)
+{
+    m_Benchmark.CPUFrameTimes.reserve(Settings.FrameCount);
+    m_Benchmark.GPUFrameTimes.reserve(Settings.FrameCount);
+    m_Benchmark.TraceTimes.reserve(Settings.FrameCount);
+    m_Benchmark.TraceScales.reserve(Settings.FrameCount);
+
+    LOG_INFO_MESSAGE("Benchmark: ", Settings.FrameCount, " frames along the camera path '", Settings.CameraPathFile, "' with ", Path.GetFrameCount(), " frames");
+
+    // frame time is measured between ends of the consecutive frames, so it includes waiting for the GPU
+    TimePoint LastFrameEnd;
+    for (Uint32 i = 0, Count = Settings.WarmupFrames + Settings.FrameCount; i < Count; ++i)
+    {
+        if (i == Settings.WarmupFrames)
+            m_Benchmark.FirstFrameId = m_FrameId + 1;
+
+        // camera and animation depend only on the frame index
+        const auto& Frame = Path.GetFrame(i);
+        m_SceneTime       = Frame.Time;
+        m_Camera.SetPos(Frame.Position);
+        m_Camera.SetLookAt(Frame.Position + Frame.Direction);
+        m_Camera.Update(m_InputController, 0.0f);
+
+        if (Settings.UseCPUTracer)
         {
-            m_pSBT->BindHitGroups(m_pTLAS, "Opaque",      PrimaryRayIndex, "PrimaryOpaqueHit");
-            m_pSBT->BindHitGroups(m_pTLAS, "Opaque",      ShadowRayIndex,  "ShadowHit");
+            RenderCPU();
+
+            const auto& Stats = m_CPUTracer.GetLastFrameStats();
+            if (i >= Settings.WarmupFrames)
+            {
+                m_Benchmark.TraceTimes.push_back(float(Stats.RenderTime));
+                m_Benchmark.CPUTracerRays += Stats.PrimaryRays + Stats.ShadowRays;
+                m_Benchmark.CPUTracerTime += Stats.RenderTime;
+            }
         }
-        if (m_pTranslucentBLAS)
+        else
+            Render();
+
+        const auto FrameEnd = TimePoint::clock::now();
+        if (i > Settings.WarmupFrames)
+            m_Benchmark.CPUFrameTimes.push_back(std::chrono::duration_cast<Seconds>(FrameEnd - LastFrameEnd).count());
+        LastFrameEnd = FrameEnd;
+    }
+
+    // read timestamps of the frames in flight
+    m_pContext->WaitForIdle();
+    for (auto& Slot : m_FrameSlots)
+        ResolveFrameSlot(Slot);
+    for (auto& Queries : m_TraceQueries)
+        ResolveTraceQueries(Queries);
+}
+
+bool RT_Scene::WriteBenchmarkReport(const BenchmarkSettings& Settings) const
+{
+    const auto& ColorDesc = m_ColorUAV->GetTexture()->GetDesc();
+
+    // GPU time is preferred, CPU time is used if timestamp queries are not supported
+    const bool  HasGPUTimes = !m_Benchmark.GPUFrameTimes.empty();
+    const auto& FrameTimes  = HasGPUTimes ? m_Benchmark.GPUFrameTimes : m_Benchmark.CPUFrameTimes;
+    const auto& TraceTimes  = !m_Benchmark.TraceTimes.empty() ? m_Benchmark.TraceTimes : FrameTimes;
+
+    // traced region is scaled by dynamic resolution
+    double TracedArea = 1.0;
+    float  MinScale   = 1.0f;
+    float  MaxScale   = 1.0f;
+    if (!m_Benchmark.TraceScales.empty())
+    {
+        TracedArea = 0.0;
+        MinScale   = *std::min_element(m_Benchmark.TraceScales.begin(), m_Benchmark.TraceScales.end());
+        MaxScale   = *std::max_element(m_Benchmark.TraceScales.begin(), m_Benchmark.TraceScales.end());
+        for (float Scale : m_Benchmark.TraceScales)
+            TracedArea += double(Scale) * double(Scale);
+        TracedArea /= double(m_Benchmark.TraceScales.size());
+    }
+
+    // primary ray per traced pixel and the shadow rays that were counted by Lighting.fxh, see ResolveFrameSlot()
+    const bool   HasRayCounts = m_Benchmark.CountedFrames > 0;
+    const double PrimaryRays  = double(ColorDesc.Width) * double(ColorDesc.Height) * TracedArea;
+    const double TotalRays    = PrimaryRays + (HasRayCounts ? double(m_Benchmark.ShadowRays) / double(m_Benchmark.CountedFrames) : 0.0);
+    double       AvgTraceTime = 0.0;
+    for (float Time : TraceTimes)
+        AvgTraceTime += Time;
+    AvgTraceTime = TraceTimes.empty() ? 0.0 : AvgTraceTime / double(TraceTimes.size());
+
+    const auto BuildTimeMs = [](double Time) { return Time >= 0.0 ? nlohmann::json(Time * 1000.0) : nlohmann::json(nullptr); };
+
+    nlohmann::json Report;
+    Report["cameraPath"]         = Settings.CameraPathFile;
+    Report["width"]              = ColorDesc.Width;
+    Report["height"]             = ColorDesc.Height;
+    Report["frames"]             = Settings.FrameCount;
+    Report["warmupFrames"]       = Settings.WarmupFrames;
+    Report["animateNodes"]       = m_AnimateNodes;
+    Report["backend"]            = Settings.UseCPUTracer ? "cpu" : "gpu";
+    Report["tracePath"]          = Settings.UseCPUTracer ? "cpu" : (m_UseRayQuery ? "rayQuery" : "traceRays");
+    Report["targetFPS"]          = Settings.UseCPUTracer ? 0.0f : Settings.TargetFPS;
+    Report["lights"]             = m_LightCount;
+    Report["stochasticLights"]   = m_StochasticLights;
+    Report["traceScale"]         = {{"averageArea", TracedArea}, {"min", MinScale}, {"max", MaxScale}};
+    Report["frameTimeSource"]    = HasGPUTimes ? "gpu" : "cpu";
+    Report["frameTime"]          = GetTimeStatistics(FrameTimes);
+    Report["cpuFrameTime"]       = GetTimeStatistics(m_Benchmark.CPUFrameTimes);
+    Report["gpuFrameTime"]       = GetTimeStatistics(m_Benchmark.GPUFrameTimes);
+    Report["traceRaysTime"]      = GetTimeStatistics(m_Benchmark.TraceTimes);
+    Report["primaryRaysPerSec"]  = AvgTraceTime > 0.0 ? PrimaryRays / AvgTraceTime : 0.0;
+    Report["raysPerSec"]         = HasRayCounts && AvgTraceTime > 0.0 ? nlohmann::json(TotalRays / AvgTraceTime) : nlohmann::json(nullptr);
+    Report["blasBuildMs"]        = BuildTimeMs(m_BuildTimings.BLASBuild);
+    Report["blasCompactMs"]      = BuildTimeMs(m_BuildTimings.BLASCompact);
+    Report["tlasBuildMs"]        = BuildTimeMs(m_BuildTimings.TLASBuild);
+    Report["tlasBuilds"]         = m_TLAS.GetBuildCount();
+    Report["tlasRefits"]         = m_TLAS.GetRefitCount();
+    Report["blasCount"]          = m_MeshBLAS.size();
+    Report["blasCompactedBytes"] = m_MeshBLASSize;
+    Report["instanceCount"]      = m_TLAS.GetInstanceCount();
+    Report["materialBytes"]      = m_MaterialArena.GetSize();
+
+    for (auto& Scene : m_Scenes)
+    {
+        nlohmann::json SceneInfo;
+        SceneInfo["path"]      = Scene.Path;
+        SceneInfo["vertices"]  = Scene.VertexCount;
+        SceneInfo["triangles"] = Scene.TriangleCount;
+        SceneInfo["materials"] = Scene.MaterialCount;
+        SceneInfo["nodes"]     = Scene.NodeCount;
+        Report["scenes"].push_back(SceneInfo);
+    }
+
+    if (Settings.UseCPUTracer)
+    {
+        const double RaysPerSec = m_Benchmark.CPUTracerTime > 0.0 ? double(m_Benchmark.CPUTracerRays) / m_Benchmark.CPUTracerTime : 0.0;
+
+        nlohmann::json CPU;
+        CPU["threads"]           = m_CPUTracer.GetThreadCount();
+        CPU["bvhBuildMs"]        = m_CPUTracer.GetBuildTime() * 1000.0;
+        CPU["bvhNodes"]          = m_CPUTracer.GetNodeCount();
+        CPU["triangles"]         = m_CPUTracer.GetTriangleCount();
+        CPU["rays"]              = m_Benchmark.CPUTracerRays;
+        CPU["raysPerSec"]        = RaysPerSec;
+        CPU["raysPerSecPerCore"] = RaysPerSec / std::max(m_CPUTracer.GetThreadCount(), 1u);
+        Report["cpuTracer"]      = CPU;
+    }
+    else
+    {
+        const double Frames = std::max(m_Benchmark.CountedFrames, 1u);
+
+        nlohmann::json Shadows;
+        Shadows["distance"]            = m_ShadowDistance;
+        Shadows["rayLength"]           = m_ShadowRayLength > 0.0f ? m_ShadowRayLength : DefaultShadowRayLength;
+        Shadows["raysPerFrame"]        = double(m_Benchmark.ShadowRays) / Frames;
+        Shadows["skippedRaysPerFrame"] = double(m_Benchmark.SkippedShadowRays) / Frames;
+
+        // reference pass is rendered without shadow LOD, see RunBenchmark()
+        if (m_ShadowLODReference.CountedFrames > 0)
         {
-            m_pSBT->BindHitGroups(m_pTLAS, "Translucent", PrimaryRayIndex, "PrimaryOpaqueHit");
-            m_pSBT->BindHitGroups(m_pTLAS, "Translucent", ShadowRayIndex,  "ShadowHit");
+            const auto& RefTimes = !m_ShadowLODReference.TraceTimes.empty() ? m_ShadowLODReference.TraceTimes : m_ShadowLODReference.GPUFrameTimes;
+            double      RefTime  = 0.0;
+            for (float Time : RefTimes)
+                RefTime += Time;
+            RefTime = RefTimes.empty() ? 0.0 : RefTime / double(RefTimes.size());
+
+            Shadows["referenceRaysPerFrame"] = double(m_ShadowLODReference.ShadowRays) / double(m_ShadowLODReference.CountedFrames);
+            Shadows["referenceTraceMs"]      = RefTime * 1000.0;
+            Shadows["traceMs"]               = AvgTraceTime * 1000.0;
+            Shadows["savedMs"]               = (RefTime - AvgTraceTime) * 1000.0;
         }
-        // clang-format on
+        Report["shadows"] = Shadows;
+
+        // reference pass with the merged BLAS layout, see RunBenchmark()
+        if (m_pMergedLayout != nullptr && m_BLASLayoutReference.CountedFrames > 0)
+        {
+            const auto& RefTimes = !m_BLASLayoutReference.TraceTimes.empty() ? m_BLASLayoutReference.TraceTimes : m_BLASLayoutReference.GPUFrameTimes;
+            double      RefTime  = 0.0;
+            for (float Time : RefTimes)
+                RefTime += Time;
+            RefTime = RefTimes.empty() ? 0.0 : RefTime / double(RefTimes.size());
+
+            nlohmann::json Merged;
+            Merged["blasCount"]      = m_pMergedLayout->BLAS.size();
+            Merged["geometries"]     = m_pMergedLayout->GeometryCount;
+            Merged["compactedBytes"] = m_pMergedLayout->CompactedSize;
+            Merged["buildMs"]        = BuildTimeMs(m_pMergedLayout->BuildTime);
+            Merged["compactMs"]      = BuildTimeMs(m_pMergedLayout->CompactTime);
+            Merged["traceMs"]        = RefTime * 1000.0;
+            Merged["traceRaysTime"]  = GetTimeStatistics(m_BLASLayoutReference.TraceTimes);
+
+            Report["mergedBLASLayout"] = Merged;
+        }
+    }
+
+    const String Text = Report.dump(4);
+
+    FileWrapper File{Settings.ReportFile.c_str(), EFileAccessMode::Overwrite};
+    if (!File || !File->Write(Text.data(), Text.size()))
+    {
+        LOG_ERROR_MESSAGE("Failed to write benchmark report '", Settings.ReportFile, '\'');
+        return false;
+    }
+
+    LOG_INFO_MESSAGE("Benchmark report is written to '", Settings.ReportFile, "':\n", Text);
+    return true;
+}
+
+bool RT_Scene::StartReplay(const char* FilePath)
+{
+    if (m_CameraRecorder.IsActive())
+        m_CameraRecorder.Stop(RecordedCameraPathFile);
+
+    if (!m_CameraPlayer.Start(FilePath))
+        return false;
+
+    LOG_INFO_MESSAGE("Replay camera path '", FilePath, "' with ", m_CameraPlayer.GetFrameCount(), " frames");
+    return true;
+}
+
+void RT_Scene::SetMaxFrameLatency(Uint32 Latency)
+{
+    m_FrameLatency = clamp(Latency, 1u, MaxFramesInFlight);
+    LOG_INFO_MESSAGE("Max frame latency: ", m_FrameLatency);
+}
+
+void RT_Scene::SetTraceScale(float Scale)
+{
+    m_TraceScale = clamp(Scale, MinTraceScale, 1.0f);
+}
+
+void RT_Scene::SetTargetFPS(float FPS)
+{
+    m_TargetFrameTime = FPS > 0.0f ? 1.0 / FPS : 0.0;
+    m_LastFrameTime   = 0.0;
+
+    if (m_TargetFrameTime > 0.0)
+        LOG_INFO_MESSAGE("Dynamic resolution: target ", FPS, " FPS");
+    else
+        LOG_INFO_MESSAGE("Dynamic resolution is disabled, trace scale: ", m_TraceScale);
+}
+
+uint2 RT_Scene::GetTraceSize() const
+{
+    const auto& Desc = m_ColorUAV->GetTexture()->GetDesc();
+    return uint2{std::max(Uint32(float(Desc.Width) * m_TraceScale + 0.5f), 1u),
+                 std::max(Uint32(float(Desc.Height) * m_TraceScale + 0.5f), 1u)};
+}
+
+void RT_Scene::UpdateTraceScale()
+{
+    if (m_TargetFrameTime <= 0.0 || m_LastFrameTime <= 0.0)
+        return;
+
+    // frame time is mostly proportional to the number of traced pixels
+    const float Ratio = float(m_TargetFrameTime / m_LastFrameTime);
+    m_LastFrameTime   = 0.0;
+
+    if (std::abs(Ratio - 1.0f) < TraceScaleTolerance)
+        return;
+
+    const float Scale = m_TraceScale * std::sqrt(Ratio);
+    SetTraceScale(m_TraceScale + (Scale - m_TraceScale) * TraceScaleDamping);
+}
+
+bool RT_Scene::SetLightCount(Uint32 Count)
+{
+    if (Count > 0 && !m_SceneBounds.IsValid())
+    {
+        std::vector<Uint8> Positions;
+        std::vector<Uint8> Triangles;
+        if (!ReadBufferData(m_pDevice, m_pContext, m_PositionArena.GetBuffer(), Positions, m_PositionArena.GetSize()) ||
+            !ReadBufferData(m_pDevice, m_pContext, m_TriangleArena.GetBuffer(), Triangles, m_TriangleArena.GetSize()))
+        {
+            LOG_ERROR_MESSAGE("Failed to read scene geometry for light grid");
+            return false;
+        }
+
+        std::vector<DE::AABB> Bounds;
+        GetTriangleBounds(Positions, Triangles, m_SceneTime, Bounds);
+        for (const auto& Box : Bounds)
+            m_SceneBounds.Grow(Box);
+
+        if (!m_SceneBounds.IsValid())
+        {
+            LOG_ERROR_MESSAGE("Scene has no triangles for light grid");
+            return false;
+        }
+    }
+
+    // cubic cells, single cell for the placeholder buffers
+    float4 GridOrigin{0.0f, 0.0f, 0.0f, 1.0f};
+    uint3  GridSize{1, 1, 1};
+    if (Count > 0)
+    {
+        const float3 Extent   = m_SceneBounds.Max - m_SceneBounds.Min;
+        const float  CellSize = std::max(std::max(Extent.x, Extent.y), std::max(Extent.z, 1.0e-3f)) / float(LightGridResolution);
+
+        GridOrigin = float4{m_SceneBounds.Min, CellSize};
+        GridSize.x = std::max(Uint32(std::ceil(Extent.x / CellSize)), 1u);
+        GridSize.y = std::max(Uint32(std::ceil(Extent.y / CellSize)), 1u);
+        GridSize.z = std::max(Uint32(std::ceil(Extent.z / CellSize)), 1u);
+    }
+
+    // lights are the same in each run for the same count
+    std::vector<OmniLight> Lights(std::max(Count, 1u));
+    {
+        std::mt19937                          Rnd{Count};
+        std::uniform_real_distribution<float> Unorm{0.0f, 1.0f};
+        for (Uint32 i = 0; i < Count; ++i)
+        {
+            const float3 Pos = m_SceneBounds.Min + (m_SceneBounds.Max - m_SceneBounds.Min) * float3{Unorm(Rnd), Unorm(Rnd), Unorm(Rnd)};
+
+            auto& Light       = Lights[i];
+            Light.Position    = float4{Pos, GridOrigin.w * (0.5f + Unorm(Rnd))};
+            Light.Color       = float4{0.2f + 0.8f * Unorm(Rnd), 0.2f + 0.8f * Unorm(Rnd), 0.2f + 0.8f * Unorm(Rnd), 1.0f};
+            Light.Attenuation = float4{1.0f, 0.0f, 1.0f, 0.0f};
+        }
+    }
+
+    // old buffers are released when the frames in flight are completed
+    m_LightsBuffer = CreateSceneBuffer(m_pDevice, "Omni lights", BIND_SHADER_RESOURCE, Lights.data(), Lights.size() * sizeof(OmniLight));
+    {
+        BufferDesc BuffDesc;
+        BuffDesc.Name          = "Light grid cells";
+        BuffDesc.Usage         = USAGE_DEFAULT;
+        BuffDesc.BindFlags     = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+        BuffDesc.Mode          = BUFFER_MODE_RAW;
+        BuffDesc.uiSizeInBytes = GridSize.x * GridSize.y * GridSize.z * (MaxLightsPerCell + 1) * sizeof(Uint32);
+
+        m_LightGridCells = nullptr;
+        m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_LightGridCells);
+        if (m_LightGridCells == nullptr || m_LightsBuffer == nullptr)
+        {
+            LOG_ERROR_MESSAGE("Failed to create light grid buffers");
+            return false;
+        }
+    }
+
+    m_LightCount      = Count;
+    m_LightGridOrigin = GridOrigin;
+    m_LightGridSize   = GridSize;
+    m_LightGridDirty  = Count > 0;
+    BindResources();
+
+    if (Count > 0)
+        LOG_INFO_MESSAGE("Light grid: ", Count, " lights, ", GridSize.x, "x", GridSize.y, "x", GridSize.z, " cells of ", GridOrigin.w, " size");
+    return true;
+}
+
+void RT_Scene::SetStochasticLights(bool Enable)
+{
+    m_StochasticLights = Enable;
+    LOG_INFO_MESSAGE("Light grid shadows: ", Enable ? "single ray to the sampled light" : "ray per light");
+}
+
+void RT_Scene::SetShadowLOD(float Distance, float RayLength)
+{
+    m_ShadowDistance  = std::max(Distance, 0.0f);
+    m_ShadowRayLength = std::max(RayLength, 0.0f);
+
+    if (m_ShadowDistance > 0.0f || m_ShadowRayLength > 0.0f)
+        LOG_INFO_MESSAGE("Shadow LOD: distance ", m_ShadowDistance, ", ray length ", m_ShadowRayLength > 0.0f ? m_ShadowRayLength : DefaultShadowRayLength);
+    else
+        LOG_INFO_MESSAGE("Shadow LOD is disabled");
+}
+
+void RT_Scene::UpdateLightGrid()
+{
+    if (!m_LightGridDirty || m_LightCount == 0 || !m_pLightGridPSO || !m_pLightGridSRB)
+        return;
+
+    m_pContext->SetPipelineState(m_pLightGridPSO);
+    m_pContext->CommitShaderResources(m_pLightGridSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    DispatchComputeAttribs Attribs;
+    Attribs.ThreadGroupCountX = (m_LightGridSize.x * m_LightGridSize.y * m_LightGridSize.z + LightGridGroupSize - 1) / LightGridGroupSize;
+    m_pContext->DispatchCompute(Attribs);
+
+    m_LightGridDirty = false;
+}
+
+bool RT_Scene::SetUseRayQuery(bool Enable)
+{
+    if (Enable && (m_pRayQueryPSO == nullptr || m_pRayQuerySRB == nullptr))
+    {
+        if (m_pDevice->GetDeviceCaps().Features.RayTracing2 != DEVICE_FEATURE_STATE_ENABLED)
+            LOG_ERROR_MESSAGE("Inline ray tracing is not supported by the device");
+        else
+            LOG_ERROR_MESSAGE("Ray query pipeline is not created");
+        return false;
     }
+
+    m_UseRayQuery = Enable;
+    LOG_INFO_MESSAGE("Trace path: ", m_UseRayQuery ? "ray query in compute shader" : "ray tracing pipeline");
+    return true;
 }
 
-void RT_Scene::LoadScene(const char* Path)
+bool RT_Scene::CreateCPUTracer()
 {
-    // create model
+    // geometry is read back from the same buffers that are used by the ray tracing pipeline
+    std::vector<Uint8> Positions;
+    std::vector<Uint8> HitAttribs;
+    std::vector<Uint8> Triangles;
+    if (!ReadBufferData(m_pDevice, m_pContext, m_PositionArena.GetBuffer(), Positions, m_PositionArena.GetSize()) ||
+        !ReadBufferData(m_pDevice, m_pContext, m_HitAttribsArena.GetBuffer(), HitAttribs, m_HitAttribsArena.GetSize()) ||
+        !ReadBufferData(m_pDevice, m_pContext, m_TriangleArena.GetBuffer(), Triangles, m_TriangleArena.GetSize()))
     {
-        GLTF::Model::CreateInfo ModelCI;
-        ModelCI.FileName = Path;
-
-        m_Model.reset(new GLTF::Model(m_pDevice, m_pContext, ModelCI));
+        LOG_ERROR_MESSAGE("Failed to read scene geometry for CPU tracer");
+        return false;
     }
 
-    // create default resources
+    std::vector<CPUTracer::Geometry> Geometries;
+    Geometries.reserve(m_Geometries.size());
+    for (auto& Geom : m_Geometries)
+        Geometries.push_back({Geom.FirstTriangle, Geom.IndexCount / 3});
+
+    // same instances as in TLAS, transforms are taken at the current scene time
+    std::vector<CPUTracer::Instance> Instances;
+    for (size_t i = 0; i < m_NodeInstances.size(); ++i)
     {
-        static constexpr Uint32  TexDim = 8;
-        static const SamplerDesc Sam_LinearClamp{
-            FILTER_TYPE_LINEAR,
-            FILTER_TYPE_LINEAR,
-            FILTER_TYPE_LINEAR,
-            TEXTURE_ADDRESS_CLAMP,
-            TEXTURE_ADDRESS_CLAMP,
-            TEXTURE_ADDRESS_CLAMP};
+        if (m_NodeInstances[i] == InvalidInstanceId)
+            continue;
+
+        const auto&         Mesh = m_Meshes[m_Nodes[i].MeshId];
+        CPUTracer::Instance Inst;
+        Inst.Transform     = GetNodeTransform(i, m_SceneTime);
+        Inst.FirstGeometry = Mesh.FirstGeometry;
+        Inst.GeometryCount = Mesh.GeometryCount;
+        Instances.push_back(Inst);
+    }
 
-        TextureDesc TexDesc;
-        TexDesc.Name      = "White texture for RT Scene";
-        TexDesc.Type      = RESOURCE_DIM_TEX_2D;
-        TexDesc.Usage     = USAGE_IMMUTABLE;
-        TexDesc.BindFlags = BIND_SHADER_RESOURCE;
-        TexDesc.Width     = TexDim;
-        TexDesc.Height    = TexDim;
-        TexDesc.Format    = TEX_FORMAT_RGBA8_UNORM;
-        TexDesc.MipLevels = 1;
-        std::vector<Uint32>     Data(TexDim * TexDim, 0xFFFFFFFF);
-        TextureSubResData       Level0Data{Data.data(), TexDim * 4};
-        TextureData             InitData{&Level0Data, 1};
-        RefCntAutoPtr<ITexture> pWhiteTex;
-        m_pDevice->CreateTexture(TexDesc, &InitData, &pWhiteTex);
-        m_pWhiteTexSRV = pWhiteTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+    // source images are decoded because baked textures may be block compressed,
+    // materials that share the image reference the first decoded copy
+    std::vector<CPUTracer::ImageData> Images(m_MaterialInfos.size());
+    std::vector<size_t>               ImageSource(Images.size());
+    for (size_t i = 0; i < Images.size(); ++i)
+    {
+        const String& Path = i < m_BaseColorPaths.size() ? m_BaseColorPaths[i] : String{};
+        ImageSource[i]     = Path.empty() ? i : size_t(std::find(m_BaseColorPaths.begin(), m_BaseColorPaths.begin() + i, Path) - m_BaseColorPaths.begin());
+    }
+    {
+        std::atomic<Uint32> NextImage{0};
 
-        TexDesc.Name = "Black texture for RT Scene";
-        for (auto& c : Data) c = 0;
-        RefCntAutoPtr<ITexture> pBlackTex;
-        m_pDevice->CreateTexture(TexDesc, &InitData, &pBlackTex);
-        m_pBlackTexSRV = pBlackTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+        const auto DecodeImages = [&]() {
+            for (Uint32 i = NextImage.fetch_add(1); i < Images.size(); i = NextImage.fetch_add(1))
+            {
+                if (ImageSource[i] != i || i >= m_BaseColorPaths.size() || m_BaseColorPaths[i].empty())
+                    continue;
 
-        TexDesc.Name = "Default normal map for RT Scene";
-        for (auto& c : Data) c = 0x00FF7F7F;
-        RefCntAutoPtr<ITexture> pDefaultNormalMap;
-        m_pDevice->CreateTexture(TexDesc, &InitData, &pDefaultNormalMap);
-        m_pDefaultNormalMapSRV = pDefaultNormalMap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+                if (!TextureStreamer::DecodeImage(m_BaseColorPaths[i].c_str(), Images[i]))
+                {
+                    LOG_ERROR_MESSAGE("Failed to load texture '", m_BaseColorPaths[i], "' for CPU tracer");
+                    Images[i] = {};
+                }
+            }
+        };
 
-        StateTransitionDesc Barriers[] = {
-            {pWhiteTex, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, true},
-            {pBlackTex, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, true},
-            {pDefaultNormalMap, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, true}};
+        std::vector<std::thread> Workers;
+        for (Uint32 i = 1; i < std::thread::hardware_concurrency(); ++i)
+            Workers.emplace_back(DecodeImages);
 
-        m_pContext->TransitionResourceStates(_countof(Barriers), Barriers);
+        DecodeImages();
 
-        RefCntAutoPtr<ISampler> pDefaultSampler;
-        m_pDevice->CreateSampler(Sam_LinearClamp, &pDefaultSampler);
-        m_pWhiteTexSRV->SetSampler(pDefaultSampler);
-        m_pBlackTexSRV->SetSampler(pDefaultSampler);
-        m_pDefaultNormalMapSRV->SetSampler(pDefaultSampler);
+        for (auto& Worker : Workers)
+            Worker.join();
     }
-
-    // create materials
-    std::vector<MaterialAttribs> Materials;
-    Materials.reserve(m_Model->Materials.size());
-    m_MaterialColorMaps.reserve(m_Model->Materials.size());
-
-    for (auto& mat : m_Model->Materials)
+    for (size_t i = 0; i < Images.size(); ++i)
     {
-        int       baseColorTexId = mat.TextureIds[GLTF::Material::TEXTURE_ID_BASE_COLOR];
-        ITexture* pBaseColorTex  = baseColorTexId < 0 ? nullptr : m_Model->GetTexture(baseColorTexId);
-        //int physDescTexId = mat.TextureIds[GLTF::Material::TEXTURE_ID_PHYSICAL_DESC];
-        //ITexture* pPhysDescTex  = physDescTexId < 0 ? nullptr : m_Model->GetTexture(physDescTexId);
+        if (ImageSource[i] != i)
+            Images[i] = Images[ImageSource[i]];
+    }
 
-        m_MaterialColorMaps.emplace_back(pBaseColorTex ? pBaseColorTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE) : m_pWhiteTexSRV);
+    CPUTracer::SceneDesc Desc;
+    Desc.pPositions    = reinterpret_cast<const float3*>(Positions.data());
+    Desc.pHitVertices  = reinterpret_cast<const CPUTracer::HitVertex*>(HitAttribs.data());
+    Desc.VertexCount   = Uint32(std::min(Positions.size() / sizeof(float3), HitAttribs.size() / sizeof(CPUTracer::HitVertex)));
+    Desc.pTriangles    = reinterpret_cast<const CPUTracer::Triangle*>(Triangles.data());
+    Desc.TriangleCount = Uint32(Triangles.size() / sizeof(CPUTracer::Triangle));
+    Desc.pGeometries   = Geometries.data();
+    Desc.GeometryCount = Uint32(Geometries.size());
+    Desc.pInstances    = Instances.data();
+    Desc.InstanceCount = Uint32(Instances.size());
+
+    return m_CPUTracer.Create(Desc, std::move(Images));
+}
 
-        MaterialAttribs mtrAttribs;
-        //mtrAttribs.DiffuseFactor   = mat.extension.DiffuseFactor;
-        //mtrAttribs.SpecularFactor  = mat.extension.SpecularFactor;
-        mtrAttribs.BaseColorFactor = mat.Attribs.BaseColorFactor;
-        mtrAttribs.EmissiveFactor  = mat.Attribs.EmissiveFactor;
-        mtrAttribs.MetallicFactor  = mat.Attribs.MetallicFactor;
-        mtrAttribs.RoughnessFactor = mat.Attribs.RoughnessFactor;
+void RT_Scene::RenderCPU()
+{
+    const auto& ColorDesc = m_ColorUAV->GetTexture()->GetDesc();
 
-        Materials.push_back(mtrAttribs);
-    }
+    CameraAttribs Attribs;
+    GetCameraAttribs(m_Camera, Attribs);
 
-    // create buffers
-    {
-        BufferDesc BuffDesc;
-        BuffDesc.Name           = "Camera attribs buffer";
-        BuffDesc.uiSizeInBytes  = sizeof(CameraAttribs);
-        BuffDesc.Usage          = USAGE_DYNAMIC;
-        BuffDesc.BindFlags      = BIND_UNIFORM_BUFFER;
-        BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    CPUTracer::Camera Cam;
+    Cam.Position  = float3::MakeVector(Attribs.Position);
+    Cam.RayLT     = Attribs.FrustumRayLT;
+    Cam.RayLB     = Attribs.FrustumRayLB;
+    Cam.RayRT     = Attribs.FrustumRayRT;
+    Cam.RayRB     = Attribs.FrustumRayRB;
+    Cam.NearPlane = Attribs.ClipPlanes.x;
+    Cam.FarPlane  = Attribs.ClipPlanes.y;
 
-        m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_CameraAttribsCB);
-        VERIFY_EXPR(m_CameraAttribsCB != nullptr);
+    m_CPUTracer.Render(Cam, ColorDesc.Width, ColorDesc.Height, m_CPUColor, m_CPUDepth);
+}
 
-        BuffDesc.Name          = "Light attribs buffer";
-        BuffDesc.uiSizeInBytes = sizeof(LightAttribs);
-        m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_LightAttribsCB);
-        VERIFY_EXPR(m_LightAttribsCB != nullptr);
+bool RT_Scene::SaveCPUReference(const char* FilePath)
+{
+    if (m_ColorUAV == nullptr)
+        return false;
 
-        BuffDesc.Name           = "Material attribs buffer";
-        BuffDesc.uiSizeInBytes  = Uint32(Materials.size() * sizeof(Materials[0]));
-        BuffDesc.Usage          = USAGE_DEFAULT;
-        BuffDesc.BindFlags      = BIND_SHADER_RESOURCE;
-        BuffDesc.Mode           = BUFFER_MODE_RAW;
-        BuffDesc.CPUAccessFlags = CPU_ACCESS_NONE;
+    // BVH is rebuilt for animated nodes
+    if ((!m_CPUTracer.IsCreated() || m_AnimateNodes) && !CreateCPUTracer())
+        return false;
+
+    RenderCPU();
 
-        BufferData BuffData;
-        BuffData.pData    = Materials.data();
-        BuffData.DataSize = BuffDesc.uiSizeInBytes;
+    const auto& Stats     = m_CPUTracer.GetLastFrameStats();
+    const auto& ColorDesc = m_ColorUAV->GetTexture()->GetDesc();
+    LOG_INFO_MESSAGE("CPU tracer: ", ColorDesc.Width, "x", ColorDesc.Height, " in ", Stats.RenderTime * 1000.0, " ms, ",
+                     Stats.PrimaryRays, " primary and ", Stats.ShadowRays, " shadow rays, ",
+                     Stats.GetRaysPerSecond() * 1.0e-6, " Mrays/s, ", Stats.GetRaysPerSecondPerCore() * 1.0e-6, " Mrays/s per core");
 
-        m_pDevice->CreateBuffer(BuffDesc, &BuffData, &m_MaterialAttribsSB);
-        VERIFY_EXPR(m_MaterialAttribsSB != nullptr);
+    if (!WritePFM(FilePath, m_CPUColor, ColorDesc.Width, ColorDesc.Height))
+    {
+        LOG_ERROR_MESSAGE("Failed to write CPU reference image '", FilePath, '\'');
+        return false;
     }
+
+    LOG_INFO_MESSAGE("CPU reference image is saved to '", FilePath, '\'');
+    return true;
 }
 
-bool RT_Scene::Update() noexcept
+void RT_Scene::BeginFrame()
 {
-    if (m_Window == nullptr)
-        return false;
+    const auto WaitStart = TimePoint::clock::now();
 
-    if (glfwWindowShouldClose(m_Window))
-        return false;
+    // CPU may run ahead of GPU by m_FrameLatency frames
+    ++m_FrameId;
+    if (m_FrameId > m_FrameLatency)
+        m_pContext->WaitForFence(m_pFrameFence, m_FrameId - m_FrameLatency, false);
 
-    if (m_pSwapChain == nullptr)
-        return false;
+    auto&        Slot      = m_FrameSlots[m_FrameId % MaxFramesInFlight];
+    const Uint64 Completed = m_pFrameFence->GetCompletedValue();
+    Slot.CPUStart          = TimePoint::clock::now();
 
-    glfwPollEvents();
+    m_FrameStats.WaitTime += std::chrono::duration_cast<Seconds>(Slot.CPUStart - WaitStart).count();
+    m_FrameStats.QueueDepth += m_FrameId - 1 - std::min(Completed, m_FrameId - 1);
 
-    if (m_ColorUAV == nullptr)
+    // the frame that used this slot is completed, so the query data is available
+    ResolveFrameSlot(Slot);
+    Slot.FrameId = m_FrameId;
+
+    if (m_pDevice->GetDeviceCaps().Features.TimestampQueries == DEVICE_FEATURE_STATE_ENABLED)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds{10});
-        return true;
+        if (Slot.pBeginQuery == nullptr)
+        {
+            QueryDesc Desc;
+            Desc.Name = "Frame timestamp";
+            Desc.Type = QUERY_TYPE_TIMESTAMP;
+            m_pDevice->CreateQuery(Desc, &Slot.pBeginQuery);
+            m_pDevice->CreateQuery(Desc, &Slot.pEndQuery);
+        }
+        if (Slot.pBeginQuery != nullptr && Slot.pEndQuery != nullptr)
+        {
+            m_pContext->EndQuery(Slot.pBeginQuery);
+            Slot.Pending = true;
+        }
     }
+    else
+    {
+        // interval between frames includes waiting for the GPU
+        if (m_LastFrameStart != TimePoint{})
+            m_LastFrameTime = std::chrono::duration_cast<Seconds>(Slot.CPUStart - m_LastFrameStart).count();
+        m_LastFrameStart = Slot.CPUStart;
+    }
+}
 
-    auto time        = TimePoint::clock::now();
-    auto dt          = std::chrono::duration_cast<Seconds>(time - m_LastUpdateTime).count();
-    m_LastUpdateTime = time;
+void RT_Scene::ResolveFrameSlot(FrameSlot& Slot)
+{
+    if (Slot.RayCountsPending)
+    {
+        MapHelper<Uint32> Counters{m_pContext, m_RayCountersReadback, MAP_READ, MAP_FLAG_NONE};
+        if (Counters && Slot.FrameId >= m_Benchmark.FirstFrameId)
+        {
+            const Uint32* pSlot = &Counters[Uint32(Slot.FrameId % MaxFramesInFlight) * RayCounterCount];
+            m_Benchmark.ShadowRays += pSlot[0];
+            m_Benchmark.SkippedShadowRays += pSlot[1];
+            ++m_Benchmark.CountedFrames;
+        }
+        Slot.RayCountsPending = false;
+    }
 
-    m_Camera.Update(m_InputController, dt);
-    m_InputController.ClearState();
+    if (!Slot.Pending)
+        return;
 
-    Render();
-    return true;
+    QueryDataTimestamp Begin;
+    QueryDataTimestamp End;
+    if (Slot.pBeginQuery->GetData(&Begin, sizeof(Begin), false) &&
+        Slot.pEndQuery->GetData(&End, sizeof(End), false) &&
+        End.Frequency > 0)
+    {
+        const double Time = double(End.Counter - Begin.Counter) / double(End.Frequency);
+        m_FrameStats.GPUTime += Time;
+        ++m_FrameStats.GPUCount;
+        m_LastFrameTime = Time;
+
+        if (Slot.FrameId >= m_Benchmark.FirstFrameId)
+            m_Benchmark.GPUFrameTimes.push_back(float(Time));
+    }
+    Slot.pBeginQuery->Invalidate();
+    Slot.pEndQuery->Invalidate();
+    Slot.Pending = false;
 }
 
-void RT_Scene::Render()
+void RT_Scene::EndFrame()
 {
-    // update constants
+    auto& Slot = m_FrameSlots[m_FrameId % MaxFramesInFlight];
+    if (Slot.Pending)
+        m_pContext->EndQuery(Slot.pEndQuery);
+
+    m_pContext->SignalFence(m_pFrameFence, m_FrameId);
+    m_pContext->Flush();
+    m_pContext->FinishFrame();
+    if (m_pSwapChain)
+        m_pSwapChain->Present();
+    m_pDevice->ReleaseStaleResources();
+
+    m_FrameStats.CPUTime += std::chrono::duration_cast<Seconds>(TimePoint::clock::now() - Slot.CPUStart).count();
+    ++m_FrameStats.Count;
+
+    if (m_FrameStats.Count >= TraceStatFrames)
     {
-        float3 CameraWorldPos = float3::MakeVector(m_Camera.GetWorldMatrix()[3]);
-        auto   CameraViewProj = m_Camera.GetViewMatrix() * m_Camera.GetProjMatrix();
+        const auto& Stats = m_FrameStats;
+        LOG_INFO_MESSAGE("Frame: CPU ", Stats.CPUTime * 1000.0 / Stats.Count, " ms, wait ", Stats.WaitTime * 1000.0 / Stats.Count,
+                         " ms, GPU ", Stats.GPUCount > 0 ? Stats.GPUTime * 1000.0 / Stats.GPUCount : 0.0,
+                         " ms, queue depth ", double(Stats.QueueDepth) / Stats.Count, " (max latency ", m_FrameLatency, "), trace scale ", m_TraceScale);
+        m_FrameStats = {};
+    }
+}
 
-        ViewFrustum Frustum;
-        ExtractViewFrustumPlanesFromMatrix(CameraViewProj, Frustum, false);
+void RT_Scene::Render()
+{
+    BeginFrame();
 
-        for (uint i = 0; i < ViewFrustum::NUM_PLANES; ++i)
-        {
-            Plane3D& plane  = Frustum.GetPlane(static_cast<ViewFrustum::PLANE_IDX>(i));
-            float    invlen = 1.0f / length(plane.Normal);
-            plane.Normal *= invlen;
-            plane.Distance *= invlen;
-        }
+    // GPU has completed the frame that used this slot of the constants ring, see BeginFrame()
+    const Uint32 FrameSlotOffset = Uint32(m_FrameId % MaxFramesInFlight) * m_FrameConstantsSlotSize;
 
-        const auto GetPlaneIntersection = [&Frustum](ViewFrustum::PLANE_IDX lhs, ViewFrustum::PLANE_IDX rhs, float4& result) {
-            const Plane3D& lp = Frustum.GetPlane(lhs);
-            const Plane3D& rp = Frustum.GetPlane(rhs);
+    // swap pipelines at frame boundary
+    UpdateShaders();
 
-            const float3 dir = cross(lp.Normal, rp.Normal);
-            const float  len = dot(dir, dir);
+    // replace fallback textures by streamed textures
+    StreamTextures();
 
-            if (std::abs(len) <= 1.0e-5)
-                return false;
+    // traced region for this frame
+    UpdateTraceScale();
+    const uint2 TraceSize = m_ColorUAV ? GetTraceSize() : uint2{0, 0};
+    if (m_FrameId >= m_Benchmark.FirstFrameId)
+        m_Benchmark.TraceScales.push_back(m_TraceScale);
 
-            result = dir * (1.0f / sqrt(len));
-            return true;
-        };
+    // update constants
+    {
+        MapHelper<Uint8> FrameData{m_pContext, m_FrameConstants, MAP_WRITE, MAP_FLAG_NONE};
+        auto*            CamAttribs = reinterpret_cast<CameraAttribs*>(&FrameData[FrameSlotOffset]);
+        auto*            Lights     = reinterpret_cast<LightAttribs*>(&FrameData[FrameSlotOffset + FrameConstantsLightOffset]);
+
+        GetCameraAttribs(m_Camera, *CamAttribs);
+        CamAttribs->TraceSize       = uint4{TraceSize.x, TraceSize.y, 0, 0};
+        CamAttribs->ShadowDistance  = m_ShadowDistance;
+        CamAttribs->ShadowRayLength = m_ShadowRayLength > 0.0f ? m_ShadowRayLength : DefaultShadowRayLength;
+        CamAttribs->RayCounters     = uint4{m_CountRays ? 1u : 0u, 0, 0, 0};
+
+        // exponential adaptation that does not depend on the frame rate, the first frame is not adapted
+        const auto  Now       = TimePoint::clock::now();
+        const float DeltaTime = m_LastToneMapTime != TimePoint{} ? std::chrono::duration_cast<std::chrono::duration<float>>(Now - m_LastToneMapTime).count() : 0.0f;
+        m_LastToneMapTime     = Now;
+
+        CamAttribs->ToneMapParams = float4{HistogramMinLog2Lum, HistogramLog2LumRange, 1.0f - std::exp(-DeltaTime * ExposureAdaptationSpeed), ExposureKeyValue};
+
+        Lights->LightGridOrigin = m_LightGridOrigin;
+        Lights->LightGridSize   = uint4{m_LightGridSize.x, m_LightGridSize.y, m_LightGridSize.z, m_LightCount};
+        Lights->LightGridParams = uint4{MaxLightsPerCell, m_StochasticLights ? 1u : 0u, Uint32(m_FrameId), 0};
+    }
+    m_pContext->CopyBuffer(m_FrameConstants, FrameSlotOffset, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                           m_CameraAttribsCB, 0, sizeof(CameraAttribs), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_pContext->CopyBuffer(m_FrameConstants, FrameSlotOffset + FrameConstantsLightOffset, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                           m_LightAttribsCB, 0, sizeof(LightAttribs), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-        MapHelper<CameraAttribs> CamAttribs{m_pContext, m_CameraAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD};
-        MapHelper<LightAttribs>  LightAttribs{m_pContext, m_LightAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD};
+    // refit or rebuild TLAS if instances were moved
+    UpdateTLAS();
 
-        // clang-format off
-        GetPlaneIntersection(ViewFrustum::BOTTOM_PLANE_IDX, ViewFrustum::LEFT_PLANE_IDX,   CamAttribs->FrustumRayLB);
-        GetPlaneIntersection(ViewFrustum::LEFT_PLANE_IDX,   ViewFrustum::TOP_PLANE_IDX,    CamAttribs->FrustumRayLT);
-        GetPlaneIntersection(ViewFrustum::RIGHT_PLANE_IDX,  ViewFrustum::BOTTOM_PLANE_IDX, CamAttribs->FrustumRayRB);
-        GetPlaneIntersection(ViewFrustum::TOP_PLANE_IDX,    ViewFrustum::RIGHT_PLANE_IDX,  CamAttribs->FrustumRayRT);
-        // clang-format on
-        CamAttribs->Position   = -float4{CameraWorldPos, 1.0f};
-        CamAttribs->ClipPlanes = float2{0.1f, 1000.0f};
+    // assign lights to the grid cells if lights were changed
+    UpdateLightGrid();
 
-        LightAttribs->OmniLightCount.x = 1;
-        {
-            auto& light       = LightAttribs->OmniLights[0];
-            light.Position    = float4(m_Camera.GetPos().x, m_Camera.GetPos().y, m_Camera.GetPos().z, 0.0f);
-            light.Color       = float4(1.0f, 1.0f, 0.0f, 1.0f);
-            light.Attenuation = float4(0.0f, 0.3f, 0.0f, 0.0f);
-        }
+    if (m_CountRays)
+    {
+        const Uint32 Zero[RayCounterCount] = {};
+        m_pContext->UpdateBuffer(m_RayCounters, 0, sizeof(Zero), Zero, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     }
 
     // trace rays
-    if (m_pRayTracingSRB && m_pRayTracingPSO && m_pSBT && m_ColorUAV)
+    if (m_UseRayQuery && m_pRayQuerySRB && m_pRayQueryPSO && m_ColorUAV)
+    {
+        m_pRayQuerySRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_ColorBuffer")->Set(m_ColorUAV);
+        m_pRayQuerySRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_DepthBuffer")->Set(m_DepthUAV);
+
+        m_pContext->SetPipelineState(m_pRayQueryPSO);
+        m_pContext->CommitShaderResources(m_pRayQuerySRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+        DispatchComputeAttribs Attribs;
+        Attribs.ThreadGroupCountX = (TraceSize.x + RayQueryGroupSize - 1) / RayQueryGroupSize;
+        Attribs.ThreadGroupCountY = (TraceSize.y + RayQueryGroupSize - 1) / RayQueryGroupSize;
+
+        TraceWithTimings([&]() { m_pContext->DispatchCompute(Attribs); });
+    }
+    else if (m_pRayTracingSRB && m_pRayTracingPSO && m_pSBT && m_ColorUAV)
     {
         m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_GEN, "g_ColorBuffer")->Set(m_ColorUAV);
         m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_GEN, "g_DepthBuffer")->Set(m_DepthUAV);
@@ -889,35 +3661,63 @@ void RT_Scene::Render()
         m_pContext->CommitShaderResources(m_pRayTracingSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
         TraceRaysAttribs Attribs;
-        Attribs.DimensionX        = m_ColorUAV->GetTexture()->GetDesc().Width;
-        Attribs.DimensionY        = m_ColorUAV->GetTexture()->GetDesc().Height;
+        Attribs.DimensionX        = TraceSize.x;
+        Attribs.DimensionY        = TraceSize.y;
         Attribs.pSBT              = m_pSBT;
         Attribs.SBTTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
 
-        m_pContext->TraceRays(Attribs);
+        TraceWithTimings([&]() { m_pContext->TraceRays(Attribs); });
+    }
+
+    // counters are read when the frame is completed, see ResolveFrameSlot()
+    if (m_CountRays)
+    {
+        auto& Slot = m_FrameSlots[m_FrameId % MaxFramesInFlight];
+        m_pContext->CopyBuffer(m_RayCounters, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                               m_RayCountersReadback, Uint32(m_FrameId % MaxFramesInFlight) * RayCounterCount * sizeof(Uint32), RayCounterCount * sizeof(Uint32),
+                               RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        Slot.RayCountsPending = true;
     }
 
-    // blit to swapchain image
-    if (m_pToneMapSRB && m_pToneMapPSO && m_ColorUAV)
+    // tone mapping with the exposure of the previous frame, then the exposure is updated for the next frame
+    if (m_pToneMapSRB && m_pToneMapPSO && m_pExposureSRB && m_pExposurePSO && m_ToneMapUAV)
     {
-        m_pToneMapSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_ColorBuffer")->Set(m_ColorSRV);
-        m_pToneMapSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_DepthBuffer")->Set(m_DepthSRV);
+        const auto& Desc = m_ToneMapUAV->GetTexture()->GetDesc();
 
-        auto* pRTV = m_pSwapChain->GetCurrentBackBufferRTV();
-        m_pContext->SetRenderTargets(1, &pRTV, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pToneMapSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_ColorBuffer")->Set(m_ColorSRV);
+        m_pToneMapSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_DepthBuffer")->Set(m_DepthSRV);
+        m_pToneMapSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_OutputImage")->Set(m_ToneMapUAV);
 
         m_pContext->SetPipelineState(m_pToneMapPSO);
         m_pContext->CommitShaderResources(m_pToneMapSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-        DrawAttribs Attribs;
-        Attribs.NumVertices = 4;
-        m_pContext->Draw(Attribs);
+        DispatchComputeAttribs Attribs;
+        Attribs.ThreadGroupCountX = (Desc.Width + ToneMapGroupSize - 1) / ToneMapGroupSize;
+        Attribs.ThreadGroupCountY = (Desc.Height + ToneMapGroupSize - 1) / ToneMapGroupSize;
+        m_pContext->DispatchCompute(Attribs);
+
+        m_pContext->SetPipelineState(m_pExposurePSO);
+        m_pContext->CommitShaderResources(m_pExposureSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pContext->DispatchCompute(DispatchComputeAttribs{1, 1, 1});
+
+        // swapchain image can not be used as storage image, it may have sRGB format
+        if (m_pSwapChain)
+        {
+            CopyTextureAttribs CopyAttribs{m_ToneMapUAV->GetTexture(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                                           m_pSwapChain->GetCurrentBackBufferRTV()->GetTexture(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION};
+            m_pContext->CopyTexture(CopyAttribs);
+        }
     }
 
-    m_pContext->Flush();
-    m_pContext->FinishFrame();
-    m_pSwapChain->Present();
-    m_pDevice->ReleaseStaleResources();
+    EndFrame();
+
+    if (!m_FirstFrameRendered)
+    {
+        m_FirstFrameRendered = true;
+
+        auto Time = std::chrono::duration_cast<std::chrono::milliseconds>(TimePoint::clock::now() - m_StartTime).count();
+        LOG_INFO_MESSAGE("Time to first frame: ", Time, " ms");
+    }
 }
 
 void RT_Scene::GLFW_ErrorCallback(int code, const char* msg)
@@ -934,6 +3734,72 @@ void RT_Scene::GLFW_ResizeCallback(GLFWwindow* wnd, int w, int h)
     self->OnResize(w, h);
 }
 
+void RT_Scene::TraceWithTimings(const std::function<void()>& Trace)
+{
+    if (m_pDevice->GetDeviceCaps().Features.TimestampQueries != DEVICE_FEATURE_STATE_ENABLED)
+    {
+        Trace();
+        return;
+    }
+
+    auto& Queries     = m_TraceQueries[m_TraceQueryIndex];
+    m_TraceQueryIndex = (m_TraceQueryIndex + 1) % TraceQueryCount;
+
+    if (Queries.pBegin == nullptr)
+    {
+        QueryDesc Desc;
+        Desc.Name = "Trace rays timestamp";
+        Desc.Type = QUERY_TYPE_TIMESTAMP;
+        m_pDevice->CreateQuery(Desc, &Queries.pBegin);
+        m_pDevice->CreateQuery(Desc, &Queries.pEnd);
+    }
+
+    // read results of the frame that used these queries before, skip it if it is not completed yet
+    ResolveTraceQueries(Queries);
+
+    if (m_TraceTimeCount >= TraceStatFrames)
+    {
+        LOG_INFO_MESSAGE("Trace rays: ", m_TraceTimeSum * 1000.0 / m_TraceTimeCount, " ms (average of ", m_TraceTimeCount, " frames), TLAS builds: ", m_TLAS.GetBuildCount(), ", refits: ", m_TLAS.GetRefitCount());
+        m_TraceTimeSum   = 0.0;
+        m_TraceTimeCount = 0;
+    }
+
+    if (Queries.pBegin == nullptr || Queries.pEnd == nullptr)
+    {
+        Trace();
+        return;
+    }
+
+    m_pContext->EndQuery(Queries.pBegin);
+    Trace();
+    m_pContext->EndQuery(Queries.pEnd);
+    Queries.FrameId = m_FrameId;
+    Queries.Pending = true;
+}
+
+void RT_Scene::ResolveTraceQueries(TraceTimestamps& Queries)
+{
+    if (!Queries.Pending)
+        return;
+
+    QueryDataTimestamp Begin;
+    QueryDataTimestamp End;
+    if (Queries.pBegin->GetData(&Begin, sizeof(Begin), false) &&
+        Queries.pEnd->GetData(&End, sizeof(End), false) &&
+        End.Frequency > 0)
+    {
+        const double Time = double(End.Counter - Begin.Counter) / double(End.Frequency);
+        m_TraceTimeSum += Time;
+        ++m_TraceTimeCount;
+
+        if (Queries.FrameId >= m_Benchmark.FirstFrameId)
+            m_Benchmark.TraceTimes.push_back(float(Time));
+    }
+    Queries.pBegin->Invalidate();
+    Queries.pEnd->Invalidate();
+    Queries.Pending = false;
+}
+
 void RT_Scene::OnResize(Uint32 w, Uint32 h)
 {
     if (m_pSwapChain)
@@ -949,10 +3815,11 @@ void RT_Scene::OnResize(Uint32 w, Uint32 h)
         m_ColorUAV->GetTexture()->GetDesc().Height == h)
         return;
 
-    m_ColorUAV = nullptr;
-    m_ColorSRV = nullptr;
-    m_DepthUAV = nullptr;
-    m_DepthSRV = nullptr;
+    m_ColorUAV     = nullptr;
+    m_ColorSRV     = nullptr;
+    m_DepthUAV     = nullptr;
+    m_DepthSRV     = nullptr;
+    m_ToneMapUAV   = nullptr;
 
     if (w == 0 || h == 0)
         return;
@@ -993,6 +3860,19 @@ void RT_Scene::OnResize(Uint32 w, Uint32 h)
         m_DepthUAV = pDepthRT->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS);
         m_DepthSRV = pDepthRT->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
     }
+
+    // sRGB encoded image, it is written by ToneMapping.csh and copied to the swapchain
+    {
+        RefCntAutoPtr<ITexture> pToneMapRT;
+
+        RTDesc.Format            = TEX_FORMAT_RGBA8_UNORM;
+        RTDesc.ClearValue.Format = TEX_FORMAT_RGBA8_UNORM;
+        RTDesc.BindFlags         = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+        RTDesc.Name              = "Tone mapped image";
+        m_pDevice->CreateTexture(RTDesc, nullptr, &pToneMapRT);
+        if (pToneMapRT)
+            m_ToneMapUAV = pToneMapRT->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS);
+    }
 }
 
 void RT_Scene::GLFW_KeyCallback(GLFWwindow* wnd, int key, int, int action, int)
@@ -1020,8 +3900,36 @@ void RT_Scene::GLFW_KeyCallback(GLFWwindow* wnd, int key, int, int action, int)
         case GLFW_KEY_C: self->m_InputController.SetKeyState(InputKeys::MoveDown,     Flags); break;
 
         case GLFW_KEY_R: if (action == GLFW_RELEASE) self->ReloadShaders(); break;
+        case GLFW_KEY_T: if (action == GLFW_RELEASE) self->m_AnimateNodes = !self->m_AnimateNodes; break;
+        case GLFW_KEY_L: if (action == GLFW_RELEASE) self->SetMaxFrameLatency(self->m_FrameLatency % MaxFramesInFlight + 1); break;
+        case GLFW_KEY_G: if (action == GLFW_RELEASE) self->SaveCPUReference(CPUReferenceFile); break;
+        case GLFW_KEY_Q: if (action == GLFW_RELEASE) self->SetUseRayQuery(!self->m_UseRayQuery); break;
+        case GLFW_KEY_K: if (action == GLFW_RELEASE) self->SetLightCount(self->m_LightCount > 0 ? 0 : DefaultLightCount); break;
+        case GLFW_KEY_J: if (action == GLFW_RELEASE) self->SetStochasticLights(!self->m_StochasticLights); break;
+        case GLFW_KEY_H: if (action == GLFW_RELEASE) self->SetShadowLOD(self->m_ShadowDistance > 0.0f ? 0.0f : PresetShadowDistance, self->m_ShadowDistance > 0.0f ? 0.0f : PresetShadowRayLength); break;
             // clang-format on
     }
+
+    if (key == GLFW_KEY_V && action == GLFW_RELEASE)
+    {
+        // full resolution is restored when dynamic resolution is disabled
+        const bool Enable = !(self->m_TargetFrameTime > 0.0);
+        if (!Enable)
+            self->SetTraceScale(1.0f);
+        self->SetTargetFPS(Enable ? DefaultTargetFPS : 0.0f);
+    }
+
+    if (key == GLFW_KEY_P && action == GLFW_RELEASE && !self->m_CameraPlayer.IsActive())
+    {
+        auto& Recorder = self->m_CameraRecorder;
+        if (!Recorder.IsActive())
+        {
+            Recorder.Start();
+            LOG_INFO_MESSAGE("Camera path recording is started");
+        }
+        else if (Recorder.Stop(RecordedCameraPathFile))
+            LOG_INFO_MESSAGE("Camera path is saved to '", RecordedCameraPathFile, '\'');
+    }
 }
 
 void RT_Scene::GLFW_MouseButtonCallback(GLFWwindow* wnd, int button, int action, int)
@@ -1059,12 +3967,169 @@ void RT_Scene::GLFW_MouseWheelCallback(GLFWwindow* wnd, double, double dy)
 {
 }
 
+void RT_Scene::GLFW_DropCallback(GLFWwindow* wnd, int count, const char** paths)
+{
+    auto* self = static_cast<RT_Scene*>(glfwGetWindowUserPointer(wnd));
+    for (int i = 0; i < count; ++i)
+        self->m_DroppedScenes.push_back(paths[i]);
+}
+
 } // namespace Diligent
 
-int main()
+// Interactive mode:  RT_Sponza [--scene <file.gltf> [--scene-offset X,Y,Z] [--scene-rotation X,Y,Z] [--scene-scale S]]... [--replay <camera path>] [--size WxH] [--ray-query] [--trace-scale S] [--target-fps N] [--lights N] [--stochastic-lights] [--shadow-distance D] [--shadow-length L]
+// Benchmark mode:    RT_Sponza --benchmark <camera path> [--scene <file.gltf> [--scene-offset X,Y,Z] [--scene-rotation X,Y,Z] [--scene-scale S]]... [--frames N] [--warmup N] [--size WxH] [--report <file.json>] [--animate] [--cpu | --ray-query] [--trace-scale S] [--target-fps N] [--lights N] [--stochastic-lights] [--shadow-distance D] [--shadow-length L] [--compare-blas]
+// BVH benchmark:     RT_Sponza --bvh-benchmark <file.json> [--scene <file.gltf> [--scene-offset X,Y,Z] [--scene-rotation X,Y,Z] [--scene-scale S]]...
+// Scenes are loaded together, Sponza is loaded if no scene is specified.
+int main(int argc, char** argv)
 {
-    Diligent::RT_Scene Scene;
-    if (!Scene.Create({1280, 1024}))
+    using namespace Diligent;
+
+    RT_Scene::BenchmarkSettings Settings;
+    String                      ReplayFile;
+    String                      BVHReportFile;
+    uint2                       Size{1280, 1024};
+
+    // glTF scenes are added as is, the default Sponza is flipped and scaled in CreateScene()
+    struct SceneArgs
+    {
+        String Path;
+        float3 Offset;
+        float3 Rotation; // in degrees, applied before the scale
+        float  Scale = 1.0f;
+    };
+    std::vector<SceneArgs> Scenes;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const String Arg = argv[i];
+        if (Arg == "--animate")
+        {
+            Settings.AnimateNodes = true;
+            continue;
+        }
+        if (Arg == "--cpu")
+        {
+            Settings.UseCPUTracer = true;
+            continue;
+        }
+        if (Arg == "--ray-query")
+        {
+            Settings.UseRayQuery = true;
+            continue;
+        }
+        if (Arg == "--stochastic-lights")
+        {
+            Settings.StochasticLights = true;
+            continue;
+        }
+        if (Arg == "--compare-blas")
+        {
+            Settings.CompareBLASLayout = true;
+            continue;
+        }
+
+        const char* pValue = i + 1 < argc ? argv[++i] : nullptr;
+        if (pValue == nullptr)
+        {
+            LOG_ERROR_MESSAGE("Command line argument '", Arg, "' requires a value");
+            return -1;
+        }
+
+        if (Arg == "--benchmark")
+            Settings.CameraPathFile = pValue;
+        else if (Arg == "--replay")
+            ReplayFile = pValue;
+        else if (Arg == "--bvh-benchmark")
+            BVHReportFile = pValue;
+        else if (Arg == "--frames")
+            Settings.FrameCount = Uint32(std::strtoul(pValue, nullptr, 10));
+        else if (Arg == "--warmup")
+            Settings.WarmupFrames = Uint32(std::strtoul(pValue, nullptr, 10));
+        else if (Arg == "--report")
+            Settings.ReportFile = pValue;
+        else if (Arg == "--size")
+            std::sscanf(pValue, "%ux%u", &Size.x, &Size.y);
+        else if (Arg == "--trace-scale")
+            Settings.TraceScale = float(std::atof(pValue));
+        else if (Arg == "--target-fps")
+            Settings.TargetFPS = float(std::atof(pValue));
+        else if (Arg == "--lights")
+            Settings.LightCount = Uint32(std::strtoul(pValue, nullptr, 10));
+        else if (Arg == "--shadow-distance")
+            Settings.ShadowDistance = float(std::atof(pValue));
+        else if (Arg == "--shadow-length")
+            Settings.ShadowRayLength = float(std::atof(pValue));
+        else if (Arg == "--scene")
+        {
+            Scenes.emplace_back();
+            Scenes.back().Path = pValue;
+        }
+        else if (Arg == "--scene-offset" || Arg == "--scene-rotation" || Arg == "--scene-scale")
+        {
+            if (Scenes.empty())
+            {
+                LOG_ERROR_MESSAGE('\'', Arg, "' must follow '--scene'");
+                return -1;
+            }
+            auto& Args = Scenes.back();
+            if (Arg == "--scene-offset")
+                std::sscanf(pValue, "%f,%f,%f", &Args.Offset.x, &Args.Offset.y, &Args.Offset.z);
+            else if (Arg == "--scene-rotation")
+                std::sscanf(pValue, "%f,%f,%f", &Args.Rotation.x, &Args.Rotation.y, &Args.Rotation.z);
+            else
+                Args.Scale = float(std::atof(pValue));
+        }
+        else
+        {
+            LOG_ERROR_MESSAGE("Unknown command line argument '", Arg, '\'');
+            return -1;
+        }
+    }
+
+    RT_Scene Scene;
+    for (const auto& Args : Scenes)
+    {
+        const float3 Angles = Args.Rotation * (PI_F / 180.0f);
+        Scene.AddScene(Args.Path.c_str(),
+                       float4x4::RotationX(Angles.x) * float4x4::RotationY(Angles.y) * float4x4::RotationZ(Angles.z) *
+                           float4x4::Scale(Args.Scale) * float4x4::Translation(Args.Offset));
+    }
+
+    // BVH8 and CPU tracer do not need ray tracing support, so these benchmarks run with software Vulkan on GPU-less Linux CI
+    if (!BVHReportFile.empty())
+    {
+        if (!Scene.CreateHeadless(Size, false))
+            return -1;
+
+        return Scene.RunBVHBenchmark(BVHReportFile.c_str()) ? 0 : -1;
+    }
+
+    if (!Settings.CameraPathFile.empty())
+    {
+        if (!Scene.CreateHeadless(Size, !Settings.UseCPUTracer))
+            return -1;
+
+        return Scene.RunBenchmark(Settings) ? 0 : -1;
+    }
+
+    if (!Scene.Create(Size))
+        return -1;
+
+    if (Settings.UseRayQuery && !Scene.SetUseRayQuery(true))
+        return -1;
+
+    Scene.SetTraceScale(Settings.TraceScale);
+    if (Settings.TargetFPS > 0.0f)
+        Scene.SetTargetFPS(Settings.TargetFPS);
+
+    if (Settings.StochasticLights)
+        Scene.SetStochasticLights(true);
+    if (Settings.LightCount > 0 && !Scene.SetLightCount(Settings.LightCount))
+        return -1;
+    if (Settings.ShadowDistance > 0.0f || Settings.ShadowRayLength > 0.0f)
+        Scene.SetShadowLOD(Settings.ShadowDistance, Settings.ShadowRayLength);
+
+    if (!ReplayFile.empty() && !Scene.StartReplay(ReplayFile.c_str()))
         return -1;
 
     for (; Scene.Update();) {}
@@ -6,6 +6,9 @@
 
 #include <chrono>
 #include <array>
+#include <future>
+#include <functional>
+#include <memory>
 #include "GLFW/glfw3.h"
 
 #include "BasicMath.hpp"
@@ -14,19 +17,98 @@
 #include "DeviceContext.h"
 #include "GLTFLoader.hpp"
 #include "FirstPersonCamera.hpp"
+#include "TextureStreamer.hpp"
+#include "SceneCache.hpp"
+#include "TLASManager.hpp"
+#include "GPUArena.hpp"
+#include "CPUTracer.hpp"
+#include "BVH8.h"
+#include "Utils/CameraPath.h"
 
 namespace Diligent
 {
 
+// Information from glTF file that is used to detect changes and to load the scene without decoding images.
+struct GLTFSceneInfo
+{
+    std::vector<String> TexturePaths; // per glTF texture, path is empty for embedded images
+    std::vector<String> BufferPaths;
+    std::vector<int>    NodeMeshes;         // glTF mesh index per glTF node, -1 if the node has no mesh
+    std::vector<int>    MaterialBaseColors; // glTF texture index of the base color per glTF material, -1 if the material has no texture
+};
+
 class RT_Scene
 {
 public:
     RT_Scene();
     ~RT_Scene();
 
+    struct BenchmarkSettings
+    {
+        String CameraPathFile;
+        String ReportFile        = "benchmark.json";
+        Uint32 FrameCount        = 1000; // number of measured frames, camera path is looped
+        Uint32 WarmupFrames      = 32;
+        bool   AnimateNodes      = false;
+        bool   UseCPUTracer      = false; // frames are rendered by CPUTracer, GPU is used only to load the scene
+        bool   UseRayQuery       = false; // rays are traced inline in the compute shader instead of TraceRays with SBT
+        float  TraceScale        = 1.0f;  // initial scale of the traced region
+        float  TargetFPS         = 0.0f;  // trace scale is adjusted to hold this frame rate, 0 - scale is fixed
+        Uint32 LightCount        = 0;     // omni lights in the light grid
+        bool   StochasticLights  = false; // single shadow ray per hit for the light grid
+        float  ShadowDistance    = 0.0f;  // shadow LOD, see SetShadowLOD()
+        float  ShadowRayLength   = 0.0f;  // 0 - default length
+        bool   CompareBLASLayout = false; // the same frames are also traced with the merged two-BLAS layout, see CreateMergedBLASLayout()
+    };
+
+    // Adds glTF file to the scenes that are loaded by Create() or CreateHeadless(), Sponza is loaded if no scene was added.
+    // All scenes share the geometry and material buffers, Transform places the scene in world space.
+    // Scenes added after creation are loaded immediately, pipelines are recreated only if the material textures
+    // exceed the capacity of the pipelines, see ReserveMaterialTextures().
+    void AddScene(const char* Path, const float4x4& Transform);
+
     bool Create(uint2 size) noexcept;
     bool Update() noexcept;
 
+    // Replays the camera path in the window with fixed time step, interactive control is restored at the end of the path.
+    bool StartReplay(const char* FilePath);
+
+    // Creates device without window and swapchain, frames are tone mapped to the offscreen image.
+    // If RequireRayTracing is false the device may have no ray tracing support, then only the CPU tracer can render.
+    bool CreateHeadless(uint2 size, bool RequireRayTracing = true) noexcept;
+
+    // Renders frames along the camera path and writes JSON report with frame timings.
+    bool RunBenchmark(const BenchmarkSettings& Settings) noexcept;
+
+    // Builds DE::BVH8 for the world space triangles of the scene and writes JSON report
+    // with build times, SAH cost and refit for animated nodes.
+    bool RunBVHBenchmark(const char* ReportFile) noexcept;
+
+    // Max number of frames that CPU can submit ahead of GPU, in range [1, MaxFramesInFlight].
+    void SetMaxFrameLatency(Uint32 Latency);
+
+    // Selects RayQuery.csh or ray tracing pipeline, returns false if inline ray tracing is not supported.
+    bool SetUseRayQuery(bool Enable);
+
+    // Rays are traced for the scaled region of the color buffer, full resolution image is reconstructed in ToneMapping.csh.
+    void SetTraceScale(float Scale);
+
+    // Enables dynamic resolution that adjusts the trace scale to hold the frame rate, 0 disables it.
+    void SetTargetFPS(float FPS);
+
+    // Creates random omni lights in the scene bounds and the light grid for them, 0 disables the lights.
+    bool SetLightCount(Uint32 Count);
+
+    // Hit shaders cast a single shadow ray to the light that is randomly selected from the lights of the grid cell.
+    void SetStochasticLights(bool Enable);
+
+    // Shadow rays are not traced for hits farther than Distance from the camera and are limited by RayLength.
+    // Zero distance disables the culling, zero length sets the default length.
+    void SetShadowLOD(float Distance, float RayLength);
+
+    // Renders the current camera view with CPUTracer and writes the color to PFM file.
+    bool SaveCPUReference(const char* FilePath);
+
 private:
     static void GLFW_ErrorCallback(int code, const char* msg);
     static void GLFW_RefreshCallback(GLFWwindow* wnd);
@@ -35,17 +117,71 @@ private:
     static void GLFW_MouseButtonCallback(GLFWwindow* wnd, int button, int action, int mods);
     static void GLFW_CursorPosCallback(GLFWwindow* wnd, double xpos, double ypos);
     static void GLFW_MouseWheelCallback(GLFWwindow* wnd, double dx, double dy);
+    static void GLFW_DropCallback(GLFWwindow* wnd, int count, const char** paths);
+
+    struct ShaderPipelines
+    {
+        RefCntAutoPtr<IPipelineState>         RayTracingPSO;
+        RefCntAutoPtr<IShaderResourceBinding> RayTracingSRB;
+        RefCntAutoPtr<IPipelineState>         RayQueryPSO;
+        RefCntAutoPtr<IShaderResourceBinding> RayQuerySRB;
+        RefCntAutoPtr<IPipelineState>         LightGridPSO;
+        RefCntAutoPtr<IShaderResourceBinding> LightGridSRB;
+        RefCntAutoPtr<IPipelineState>         ToneMapPSO;
+        RefCntAutoPtr<IShaderResourceBinding> ToneMapSRB;
+        RefCntAutoPtr<IPipelineState>         ExposurePSO;
+        RefCntAutoPtr<IShaderResourceBinding> ExposureSRB;
+        Uint32                                RayTracingTextureCapacity = 0; // size of g_MaterialColorMaps in the signature
+        Uint32                                RayQueryTextureCapacity   = 0;
+    };
+
+    bool CreateDevice(bool EnableValidation, bool RequireRayTracing);
+    bool CreateScene(uint2 size);
 
-    void CreateRayTracingPSO();
-    void CreateToneMapPSO();
+    RefCntAutoPtr<IPipelineResourceSignature> CreateSceneSignature(const char* Name, SHADER_TYPE Stages) const;
+    void                                      ReserveMaterialTextures(Uint32 Count);
+
+    void CreateRayTracingPSO(ShaderPipelines& Pipelines) const;
+    void CreateRayQueryPSO(ShaderPipelines& Pipelines) const;
+    void CreateLightGridPSO(ShaderPipelines& Pipelines) const;
+    void UpdateLightGrid();
+    void CreateToneMapPSO(ShaderPipelines& Pipelines) const;
+    void SwapPipelines(ShaderPipelines& Pipelines);
     void BindResources();
     void ReloadShaders();
+    void UpdateShaders();
 
-    void CreateBLAS();
-    void CreateTLAS();
+    void CreateBLAS(Uint32 FirstMesh = 0);
+    void CreateTLAS(Uint32 FirstNode = 0);
+    void CreateNodeList();
+    void UpdateTLAS();
+    bool CreateMergedBLASLayout();
+    void UseMergedBLASLayout(bool Enable);
+    float4x4 GetNodeTransform(size_t NodeIndex, float Time) const;
+    void     GetTriangleBounds(const std::vector<Uint8>& Positions, const std::vector<Uint8>& Triangles, float Time, std::vector<DE::AABB>& Bounds) const;
     void CreateSBT();
-    void LoadScene(const char* Path);
+
+    struct SceneRange;
+    struct SceneData;
+    using TextureRequests = std::vector<TextureStreamer::Request>;
+
+    void LoadScenes();
+    void LoadAddedScene(SceneRange& Scene);
+    void LoadScene(SceneRange& Scene, TextureRequests& TexRequests);
+    void LoadGLTFScene(SceneRange& Scene, const GLTFSceneInfo& Info, TextureRequests& TexRequests);
+    bool LoadBakedScene(SceneRange& Scene, const char* CachePath, Uint64 SourceStamp, TextureRequests& TexRequests);
+    bool BakeScene(const char* Path, const GLTFSceneInfo& Info, const char* CachePath, Uint64 SourceStamp);
+    void AppendScene(SceneRange& Scene, const SceneData& Data);
+    void StartTextureStreaming(TextureRequests&& TexRequests);
+    void StreamTextures();
+    void BeginFrame();
+    void EndFrame();
     void Render();
+    void TraceWithTimings(const std::function<void()>& Trace);
+    bool CreateCPUTracer();
+    void RenderCPU();
+    void RunBenchmarkFrames(const BenchmarkSettings& Settings, const DE::CameraPath& Path);
+    bool WriteBenchmarkReport(const BenchmarkSettings& Settings) const;
     void OnResize(Uint32 w, Uint32 h);
 
 private:
@@ -67,31 +203,101 @@ private:
     static constexpr int  PrimaryRayIndex   = 0;
     static constexpr int  ShadowRayIndex    = 1;
 
+    static constexpr TLASManager::InstanceId InvalidInstanceId = ~0u;
+
+    static constexpr Uint32 MaxFramesInFlight = 3;
+
     RefCntAutoPtr<IDeviceContext> m_pContext;
     RefCntAutoPtr<IRenderDevice>  m_pDevice;
     RefCntAutoPtr<ISwapChain>     m_pSwapChain;
     RefCntAutoPtr<IEngineFactory> m_pEngineFactory;
-    GLFWwindow*                   m_Window = nullptr;
+    GLFWwindow*                   m_Window        = nullptr;
+    bool                          m_HasRayTracing = false; // BLAS, TLAS and ray tracing pipelines are not created without it
+
+    TEXTURE_FORMAT m_OutputFormat = TEX_FORMAT_RGBA8_UNORM_SRGB; // swapchain format, tone mapped image is copied to the swapchain
 
-    RefCntAutoPtr<IBottomLevelAS>         m_pOpaqueBLAS;
-    RefCntAutoPtr<IBottomLevelAS>         m_pTranslucentBLAS;
-    RefCntAutoPtr<ITopLevelAS>            m_pTLAS;
+    std::vector<RefCntAutoPtr<IBottomLevelAS>> m_MeshBLAS;         // per SceneCache::Mesh
+    Uint64                                     m_MeshBLASSize = 0; // compacted size in bytes
+    TLASManager                                m_TLAS;
+    std::vector<TLASManager::InstanceId>       m_NodeInstances; // per SceneCache::Node
+    bool                                       m_AnimateNodes = false;
     RefCntAutoPtr<IShaderBindingTable>    m_pSBT;
     RefCntAutoPtr<IPipelineState>         m_pRayTracingPSO;
     RefCntAutoPtr<IShaderResourceBinding> m_pRayTracingSRB;
+    Uint32                                m_RayTracingTextureCapacity = 0;
+
+    // inline ray tracing in the compute shader, created only if the device supports it
+    RefCntAutoPtr<IPipelineState>         m_pRayQueryPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_pRayQuerySRB;
+    Uint32                                m_RayQueryTextureCapacity = 0;
+    bool                                  m_UseRayQuery             = false;
 
     RefCntAutoPtr<IPipelineState>         m_pToneMapPSO;
     RefCntAutoPtr<IShaderResourceBinding> m_pToneMapSRB;
+    RefCntAutoPtr<IPipelineState>         m_pExposurePSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_pExposureSRB;
+    RefCntAutoPtr<IBuffer>                m_Histogram; // luminance histogram of the current frame, cleared by Exposure.csh
+    RefCntAutoPtr<IBuffer>                m_Exposure;  // ExposureState, the previous frame exposure is used for tone mapping
+    TimePoint                             m_LastToneMapTime;
 
-    std::unique_ptr<GLTF::Model>              m_Model;
+    // Omni lights are assigned to the cells of the world space grid by LightGrid.csh,
+    // hit shaders shade only the lights of the cell that contains the hit point.
+    RefCntAutoPtr<IBuffer>                m_LightsBuffer;
+    RefCntAutoPtr<IBuffer>                m_LightGridCells; // per cell: number of lights and MaxLightsPerCell light indices
+    RefCntAutoPtr<IPipelineState>         m_pLightGridPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_pLightGridSRB;
+    DE::AABB                              m_SceneBounds; // world space, computed on the first use
+    float4                                m_LightGridOrigin{0.0f, 0.0f, 0.0f, 1.0f}; // xyz - min corner, w - cell size
+    uint3                                 m_LightGridSize{1, 1, 1};
+    Uint32                                m_LightCount       = 0;
+    bool                                  m_LightGridDirty   = false; // grid is rebuilt only when lights are changed
+    bool                                  m_StochasticLights = false;
+
+    // Scenes are appended to the arenas that are shared by all scenes, so BLAS geometries, pipelines and
+    // resource bindings do not depend on the number of scenes. Arrays below contain all scenes with global indices.
+    struct SceneRange
+    {
+        String                      Path;
+        float4x4                    Transform; // to world space, baked into the nodes
+        Uint32                      FirstVertex   = 0;
+        Uint32                      FirstIndex    = 0;
+        Uint32                      FirstTriangle = 0;
+        Uint32                      FirstMaterial = 0;
+        Uint32                      FirstGeometry = 0;
+        Uint32                      FirstMesh     = 0;
+        Uint32                      FirstNode     = 0;
+        Uint32                      FirstTexture  = 0; // texture streamer request id
+        Uint32                      VertexCount   = 0;
+        Uint32                      TriangleCount = 0;
+        Uint32                      MaterialCount = 0;
+        Uint32                      NodeCount     = 0;
+        std::unique_ptr<SceneCache> pCache; // opened until baked textures are streamed
+    };
+    std::vector<SceneRange> m_Scenes;
+    Uint32                  m_TextureCount = 0; // texture ids of all scenes
+    std::vector<String>     m_DroppedScenes;    // added by the next Update()
+
+    GPUArena                                  m_PositionArena;   // float3, used by BLAS
+    GPUArena                                  m_HitAttribsArena; // HitVertexAttribs
+    GPUArena                                  m_HitUV1Arena;     // 2x half, empty while no scene has UV1, UV0 is copied for the scenes without UV1
+    RefCntAutoPtr<IBuffer>                    m_EmptyUV1;        // bound instead of the empty UV1 arena
+    GPUArena                                  m_IndexArena;      // Uint32, relative to the first vertex of the scene
+    GPUArena                                  m_TriangleArena;   // PrimitiveAttribs
+    GPUArena                                  m_MaterialArena;   // MaterialAttribs
+    std::vector<SceneCache::Geometry>         m_Geometries;
+    std::vector<SceneCache::Mesh>             m_Meshes;
+    std::vector<SceneCache::Node>             m_Nodes;
+    String                                    m_SceneNames;
+    std::vector<SceneCache::MaterialInfo>     m_MaterialInfos;
+    std::vector<String>                       m_BaseColorPaths; // source image per material, empty if the image is embedded
     RefCntAutoPtr<IBuffer>                    m_CameraAttribsCB;
     RefCntAutoPtr<IBuffer>                    m_LightAttribsCB;
-    RefCntAutoPtr<IBuffer>                    m_MaterialAttribsSB;
     std::vector<RefCntAutoPtr<ITextureView>>  m_MaterialColorMaps;
+    Uint32                                    m_MaterialTextureCapacity = 0; // size of g_MaterialColorMaps in the pipelines, see ReserveMaterialTextures()
     std::vector<RefCntAutoPtr<ITextureView>>  m_MaterialPhysicalDescMaps;
     std::vector<RefCntAutoPtr<ITextureView>>  m_MaterialNormalMaps;
     std::vector<RefCntAutoPtr<ITextureView>>  m_MaterialEmissiveMaps;
-    std::array<RefCntAutoPtr<IBufferView>, 2> m_PrimitiveOffsets;
+    RefCntAutoPtr<IBufferView>                m_PrimitiveOffsets; // first triangle per geometry
     RefCntAutoPtr<ITextureView>               m_pWhiteTexSRV;
     RefCntAutoPtr<ITextureView>               m_pBlackTexSRV;
     RefCntAutoPtr<ITextureView>               m_pDefaultNormalMapSRV;
@@ -102,10 +308,131 @@ private:
     RefCntAutoPtr<ITextureView> m_ColorSRV;
     RefCntAutoPtr<ITextureView> m_DepthUAV;
     RefCntAutoPtr<ITextureView> m_DepthSRV;
+    RefCntAutoPtr<ITextureView> m_ToneMapUAV; // used instead of swapchain in headless mode
+
+    TextureStreamer m_TextureStreamer;
+    TextureRequests m_PendingTexRequests; // requests of the scenes that are added while the streamer is running
+
+    // software reference of the ray tracing pass, created on the first use
+    CPUTracer           m_CPUTracer;
+    std::vector<float3> m_CPUColor;
+    std::vector<float>  m_CPUDepth;
+
+    // GPU time of the scene loading steps in seconds, negative if not measured
+    struct BuildTimings
+    {
+        double BLASBuild   = -1.0;
+        double BLASCompact = -1.0;
+        double TLASBuild   = -1.0;
+    };
+    BuildTimings m_BuildTimings;
+
+    // Per-frame data, the slot is reused when GPU has completed the frame that used it.
+    struct FrameSlot
+    {
+        TimePoint             CPUStart;
+        RefCntAutoPtr<IQuery> pBeginQuery;
+        RefCntAutoPtr<IQuery> pEndQuery;
+        Uint64                FrameId          = 0;
+        bool                  Pending          = false;
+        bool                  RayCountsPending = false; // ray counters are copied to the slot of m_RayCountersReadback
+    };
+    struct FrameStats
+    {
+        double CPUTime    = 0.0; // seconds
+        double WaitTime   = 0.0; // seconds
+        double GPUTime    = 0.0; // seconds
+        Uint64 QueueDepth = 0;   // sum of frames in flight at the beginning of each frame
+        Uint32 Count      = 0;
+        Uint32 GPUCount   = 0;
+    };
+    RefCntAutoPtr<IFence>                    m_pFrameFence;
+    RefCntAutoPtr<IBuffer>                   m_FrameConstants; // staging ring for camera and light attribs, slot per frame in flight
+    Uint32                                   m_FrameConstantsSlotSize = 0;
+    std::array<FrameSlot, MaxFramesInFlight> m_FrameSlots;
+    Uint64                                   m_FrameId      = 0; // fence value of the current frame
+    Uint32                                   m_FrameLatency = 2;
+    FrameStats                               m_FrameStats;
+
+    void ResolveFrameSlot(FrameSlot& Slot);
+
+    // shadow LOD and shadow ray statistics, see Lighting.fxh
+    RefCntAutoPtr<IBuffer> m_RayCounters;
+    RefCntAutoPtr<IBuffer> m_RayCountersReadback; // slot per frame in flight
+    float                  m_ShadowDistance  = 0.0f;
+    float                  m_ShadowRayLength = 0.0f;
+    bool                   m_CountRays       = false; // enabled by the benchmark
+
+    // dynamic resolution, frame time is measured with GPU timestamps or on CPU if they are not supported
+    float     m_TraceScale      = 1.0f;
+    double    m_TargetFrameTime = 0.0; // seconds, 0 - trace scale is fixed
+    double    m_LastFrameTime   = 0.0; // seconds, 0 - there is no new measurement since the last update
+    TimePoint m_LastFrameStart;
+
+    uint2 GetTraceSize() const;
+    void  UpdateTraceScale();
+
+    // ray tracing pass timings, queries are read back with a delay of TraceQueryCount frames
+    static constexpr Uint32 TraceQueryCount = 4;
+    static constexpr Uint32 TraceStatFrames = 256;
+    struct TraceTimestamps
+    {
+        RefCntAutoPtr<IQuery> pBegin;
+        RefCntAutoPtr<IQuery> pEnd;
+        Uint64                FrameId = 0;
+        bool                  Pending = false;
+    };
+    std::array<TraceTimestamps, TraceQueryCount> m_TraceQueries;
+    Uint32                                       m_TraceQueryIndex = 0;
+    double                                       m_TraceTimeSum    = 0.0;
+    Uint32                                       m_TraceTimeCount  = 0;
+
+    void ResolveTraceQueries(TraceTimestamps& Queries);
+
+    // per-frame samples of the benchmark run in seconds, only frames starting from FirstFrameId are recorded
+    struct BenchmarkSamples
+    {
+        Uint64             FirstFrameId = ~0ull;
+        std::vector<float> CPUFrameTimes;
+        std::vector<float> GPUFrameTimes;
+        std::vector<float> TraceTimes;
+        std::vector<float> TraceScales;
+        Uint64             ShadowRays        = 0;
+        Uint64             SkippedShadowRays = 0;
+        Uint32             CountedFrames     = 0; // frames with ray counters
+        Uint64             CPUTracerRays = 0;
+        double             CPUTracerTime = 0.0; // seconds
+    };
+    BenchmarkSamples m_Benchmark;
+    BenchmarkSamples m_ShadowLODReference;  // the same benchmark without shadow LOD
+    BenchmarkSamples m_BLASLayoutReference; // the same benchmark with the merged BLAS layout
+
+    // Layout with all nodes in one opaque and one non-opaque BLAS, it is created only by the benchmark
+    // to compare BLAS memory and trace time with the per-mesh BLAS, see CreateMergedBLASLayout().
+    struct MergedBLASLayout
+    {
+        std::vector<RefCntAutoPtr<IBottomLevelAS>> BLAS;
+        TLASManager                                TLAS;
+        RefCntAutoPtr<IBufferView>                 PrimitiveOffsets; // scene primitive offsets followed by the merged geometries
+        Uint64                                     CompactedSize = 0;
+        Uint32                                     GeometryCount = 0;
+        double                                     BuildTime     = -1.0; // seconds, negative if not measured
+        double                                     CompactTime   = -1.0;
+        bool                                       Active        = false;
+    };
+    std::unique_ptr<MergedBLASLayout> m_pMergedLayout;
+
+    TimePoint              m_StartTime;
+    bool                   m_FirstFrameRendered = false;
+    TimePoint              m_LastUpdateTime;
+    float                  m_SceneTime = 0.0f; // time of the node animation in seconds
+    FirstPersonCamera      m_Camera;
+    InputControllerGLFW    m_InputController;
+    DE::CameraPathRecorder m_CameraRecorder; // 'P' starts and stops recording
+    DE::CameraPathPlayer   m_CameraPlayer;
 
-    TimePoint           m_LastUpdateTime;
-    FirstPersonCamera   m_Camera;
-    InputControllerGLFW m_InputController;
+    // must be destroyed before device objects
+    std::future<ShaderPipelines> m_ShaderReloadTask;
 };
 
 } // namespace Diligent
@@ -0,0 +1,255 @@
+#include "SceneCache.hpp"
+#include "FileWrapper.hpp"
+#include "Align.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+#if PLATFORM_WIN32
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <Windows.h>
+#else
+#    include <fcntl.h>
+#    include <unistd.h>
+#    include <sys/mman.h>
+#endif
+
+namespace Diligent
+{
+namespace
+{
+
+Uint64 HashBytes(Uint64 Hash, const void* pData, size_t Size)
+{
+    // FNV-1a
+    const auto* pBytes = static_cast<const Uint8*>(pData);
+    for (size_t i = 0; i < Size; ++i)
+    {
+        Hash ^= pBytes[i];
+        Hash *= 0x100000001b3ull;
+    }
+    return Hash;
+}
+
+} // namespace
+
+
+void SceneCache::Writer::AddSection(ESection Section, const void* pData, size_t Size, Uint32 Stride)
+{
+    VERIFY_EXPR(Section < ESection::Count);
+    VERIFY_EXPR(Stride > 0 && Size % Stride == 0);
+
+    auto& Dst  = m_Sections[size_t(Section)];
+    Dst.pData  = pData;
+    Dst.Size   = Size;
+    Dst.Stride = Stride;
+}
+
+bool SceneCache::Writer::Write(const char* FilePath, Uint64 SourceStamp) const noexcept
+{
+    FileHeader Header;
+    Header.SourceStamp = SourceStamp;
+
+    Uint64 Offset = Align(Uint64(sizeof(Header)), Uint64(SectionAlign));
+    for (size_t i = 0; i < _countof(m_Sections); ++i)
+    {
+        Header.Sections[i].Offset = Offset;
+        Header.Sections[i].Size   = m_Sections[i].Size;
+        Header.Sections[i].Stride = m_Sections[i].Stride;
+        Offset                    = Align(Offset + m_Sections[i].Size, Uint64(SectionAlign));
+    }
+    Header.FileSize = Offset;
+
+    // write to the temporary file, so the cache is never left half-written
+    const String TempPath = String{FilePath} + ".tmp";
+    {
+        FileWrapper File{TempPath.c_str(), EFileAccessMode::Overwrite};
+        if (!File)
+        {
+            LOG_ERROR_MESSAGE("Failed to create scene cache file '", TempPath, '\'');
+            return false;
+        }
+
+        const Uint8 Zeros[SectionAlign] = {};
+        Uint64      Written             = 0;
+
+        const auto WriteData = [&File, &Written](const void* pData, size_t Size) {
+            if (Size == 0)
+                return true;
+            Written += Size;
+            return File->Write(pData, Size);
+        };
+        const auto WritePadding = [&](Uint64 NextOffset) {
+            VERIFY_EXPR(NextOffset >= Written && NextOffset - Written <= SectionAlign);
+            return WriteData(Zeros, size_t(NextOffset - Written));
+        };
+
+        bool Succeeded = WriteData(&Header, sizeof(Header));
+        for (size_t i = 0; i < _countof(m_Sections) && Succeeded; ++i)
+        {
+            Succeeded = WritePadding(Header.Sections[i].Offset) &&
+                WriteData(m_Sections[i].pData, m_Sections[i].Size);
+        }
+        Succeeded = Succeeded && WritePadding(Header.FileSize);
+
+        if (!Succeeded)
+        {
+            LOG_ERROR_MESSAGE("Failed to write scene cache file '", TempPath, '\'');
+            return false;
+        }
+    }
+
+    std::remove(FilePath);
+    if (std::rename(TempPath.c_str(), FilePath) != 0)
+    {
+        LOG_ERROR_MESSAGE("Failed to rename scene cache file '", TempPath, "' to '", FilePath, '\'');
+        std::remove(TempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+SceneCache::~SceneCache()
+{
+    Close();
+}
+
+bool SceneCache::Open(const char* FilePath, Uint64 SourceStamp) noexcept
+{
+    Close();
+
+#if PLATFORM_WIN32
+    HANDLE hFile = ::CreateFileA(FilePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER FileSize = {};
+    if (!::GetFileSizeEx(hFile, &FileSize) || Uint64(FileSize.QuadPart) < sizeof(FileHeader))
+    {
+        ::CloseHandle(hFile);
+        return false;
+    }
+
+    HANDLE hMapping = ::CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (hMapping == nullptr)
+    {
+        ::CloseHandle(hFile);
+        return false;
+    }
+
+    m_pData = static_cast<const Uint8*>(::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_pData == nullptr)
+    {
+        ::CloseHandle(hMapping);
+        ::CloseHandle(hFile);
+        return false;
+    }
+
+    m_hFile    = hFile;
+    m_hMapping = hMapping;
+    m_DataSize = Uint64(FileSize.QuadPart);
+#else
+    const int File = ::open(FilePath, O_RDONLY);
+    if (File < 0)
+        return false;
+
+    struct stat FileStat = {};
+    if (::fstat(File, &FileStat) != 0 || Uint64(FileStat.st_size) < sizeof(FileHeader))
+    {
+        ::close(File);
+        return false;
+    }
+
+    void* pMapped = ::mmap(nullptr, size_t(FileStat.st_size), PROT_READ, MAP_PRIVATE, File, 0);
+    ::close(File);
+    if (pMapped == MAP_FAILED)
+        return false;
+
+    m_pData    = static_cast<const Uint8*>(pMapped);
+    m_DataSize = Uint64(FileStat.st_size);
+#endif
+
+    const auto& Header = *reinterpret_cast<const FileHeader*>(m_pData);
+
+    bool IsValid = Header.Magic == Magic &&
+        Header.Version == Version &&
+        Header.SourceStamp == SourceStamp &&
+        Header.FileSize == m_DataSize &&
+        Header.SectionCount == Uint32(ESection::Count);
+
+    for (Uint32 i = 0; i < Header.SectionCount && IsValid; ++i)
+    {
+        const auto& Section = Header.Sections[i];
+        IsValid             = Section.Offset <= m_DataSize && Section.Size <= m_DataSize - Section.Offset;
+    }
+
+    if (!IsValid)
+    {
+        LOG_INFO_MESSAGE("Scene cache '", FilePath, "' is outdated");
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void SceneCache::Close() noexcept
+{
+#if PLATFORM_WIN32
+    if (m_pData != nullptr)
+        ::UnmapViewOfFile(m_pData);
+
+    if (m_hMapping != nullptr)
+        ::CloseHandle(m_hMapping);
+
+    if (m_hFile != nullptr)
+        ::CloseHandle(m_hFile);
+#else
+    if (m_pData != nullptr)
+        ::munmap(const_cast<Uint8*>(m_pData), size_t(m_DataSize));
+#endif
+
+    m_pData    = nullptr;
+    m_DataSize = 0;
+    m_hFile    = nullptr;
+    m_hMapping = nullptr;
+}
+
+bool SceneCache::GetSection(ESection Section, const void*& pData, Uint64& Size, Uint32& Stride) const
+{
+    if (m_pData == nullptr || Section >= ESection::Count)
+        return false;
+
+    const auto& Header = reinterpret_cast<const FileHeader*>(m_pData)->Sections[size_t(Section)];
+
+    pData  = m_pData + Header.Offset;
+    Size   = Header.Size;
+    Stride = Header.Stride;
+    return true;
+}
+
+Uint64 SceneCache::ComputeSourceStamp(const std::vector<const char*>& FilePaths)
+{
+    Uint64 Stamp = 0xcbf29ce484222325ull;
+    Stamp        = HashBytes(Stamp, &Version, sizeof(Version));
+
+    for (auto* pPath : FilePaths)
+    {
+        struct stat FileStat = {};
+        if (stat(pPath, &FileStat) != 0)
+            continue;
+
+        const Uint64 FileSize = Uint64(FileStat.st_size);
+        const Uint64 FileTime = Uint64(FileStat.st_mtime);
+
+        Stamp = HashBytes(Stamp, pPath, strlen(pPath));
+        Stamp = HashBytes(Stamp, &FileSize, sizeof(FileSize));
+        Stamp = HashBytes(Stamp, &FileTime, sizeof(FileTime));
+    }
+    return Stamp;
+}
+
+} // namespace Diligent
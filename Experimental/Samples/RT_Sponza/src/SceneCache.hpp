@@ -0,0 +1,194 @@
+#pragma once
+
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+// Single file with preprocessed scene data: geometry, materials and pre-mipped textures.
+// The file is memory mapped, arrays are used directly as initial data for GPU resources.
+class SceneCache
+{
+public:
+    static constexpr Uint32 Magic   = 0x53435452; // 'RTCS'
+    static constexpr Uint32 Version = 7;
+
+    enum class ESection : Uint32
+    {
+        Positions,        // float3
+        HitVertexAttribs, // HitVertexAttribs
+        HitVertexUV1,     // Uint32, 2x half, empty if the scene has no UV1
+        Indices,          // Uint32
+        Triangles,        // PrimitiveAttribs
+        Geometries,       // Geometry
+        Meshes,           // Mesh
+        Nodes,            // Node
+        Names,            // char, null-terminated geometry and node names
+        Materials,        // MaterialAttribs
+        MaterialInfos,    // MaterialInfo
+        Textures,         // Texture
+        TextureMips,      // MipLevel
+        TextureData,      // Uint8
+        Count
+    };
+
+    struct Geometry
+    {
+        Uint32 FirstIndex    = 0;
+        Uint32 IndexCount    = 0;
+        Uint32 VertexCount   = 0;
+        Uint32 FirstTriangle = 0;
+        Uint32 MaterialId    = 0;
+        Uint32 NameOffset    = 0; // in Names section
+        Uint32 Opaque        = 0; // 1 if all triangles are opaque, any-hit shader is not invoked
+    };
+
+    // Geometries of the mesh are contiguous, the mesh is shared between nodes that reference the same glTF mesh.
+    struct Mesh
+    {
+        Uint32 FirstGeometry = 0;
+        Uint32 GeometryCount = 0;
+    };
+
+    struct Node
+    {
+        float4x4 Transform;       // node to model space
+        Uint32   MeshId      = 0;
+        Uint32   NameOffset  = 0; // in Names section
+        Uint32   _padding[2] = {};
+    };
+
+    struct MaterialInfo
+    {
+        Int32  BaseColorTexture = -1; // index in Textures section
+        Uint32 AlphaMode        = 0;  // GLTF::Material::ALPHA_MODE
+    };
+
+    struct Texture
+    {
+        Uint32 Width    = 0;
+        Uint32 Height   = 0;
+        Uint32 Format   = 0; // TEXTURE_FORMAT
+        Uint32 FirstMip = 0; // in TextureMips section
+        Uint32 MipCount = 0;
+        Uint32 _padding = 0;
+    };
+
+    struct MipLevel
+    {
+        Uint64 Offset = 0; // in TextureData section
+        Uint32 Stride = 0; // row stride in bytes
+        Uint32 Size   = 0;
+    };
+
+    template <typename T>
+    struct Array
+    {
+        const T* pData = nullptr;
+        Uint32   Count = 0;
+
+        const T* begin() const { return pData; }
+        const T* end() const { return pData + Count; }
+        Uint32   size() const { return Count; }
+        bool     empty() const { return Count == 0; }
+
+        const T& operator[](size_t i) const
+        {
+            VERIFY_EXPR(i < Count);
+            return pData[i];
+        }
+    };
+
+    // Collects sections and writes them to the file.
+    class Writer
+    {
+    public:
+        // Data is referenced until Write() is called.
+        void AddSection(ESection Section, const void* pData, size_t Size, Uint32 Stride);
+
+        template <typename T>
+        void AddSection(ESection Section, const std::vector<T>& Data)
+        {
+            AddSection(Section, Data.data(), Data.size() * sizeof(T), sizeof(T));
+        }
+
+        bool Write(const char* FilePath, Uint64 SourceStamp) const noexcept;
+
+    private:
+        struct SectionData
+        {
+            const void* pData  = nullptr;
+            size_t      Size   = 0;
+            Uint32      Stride = 0;
+        };
+        SectionData m_Sections[size_t(ESection::Count)];
+    };
+
+    SceneCache() {}
+    ~SceneCache();
+
+    SceneCache(const SceneCache&) = delete;
+    SceneCache& operator=(const SceneCache&) = delete;
+
+    // Returns false if the file does not exist, has different version or was baked from different source files.
+    bool Open(const char* FilePath, Uint64 SourceStamp) noexcept;
+    void Close() noexcept;
+
+    bool IsOpened() const { return m_pData != nullptr; }
+
+    // Returns empty array if the section does not exist or element size does not match.
+    template <typename T>
+    Array<T> Get(ESection Section) const
+    {
+        Array<T>    Result;
+        const void* pData  = nullptr;
+        Uint64      Size   = 0;
+        Uint32      Stride = 0;
+        if (GetSection(Section, pData, Size, Stride) && Stride == sizeof(T))
+        {
+            Result.pData = static_cast<const T*>(pData);
+            Result.Count = Uint32(Size / sizeof(T));
+        }
+        return Result;
+    }
+
+    // Combines size and modification time of the files that the scene is baked from.
+    static Uint64 ComputeSourceStamp(const std::vector<const char*>& FilePaths);
+
+private:
+    struct SectionHeader
+    {
+        Uint64 Offset   = 0;
+        Uint64 Size     = 0;
+        Uint32 Stride   = 0;
+        Uint32 _padding = 0;
+    };
+
+    struct FileHeader
+    {
+        Uint32        Magic        = SceneCache::Magic;
+        Uint32        Version      = SceneCache::Version;
+        Uint64        SourceStamp  = 0;
+        Uint64        FileSize     = 0;
+        Uint32        SectionCount = Uint32(ESection::Count);
+        Uint32        _padding     = 0;
+        SectionHeader Sections[size_t(ESection::Count)];
+    };
+
+    static constexpr Uint32 SectionAlign = 256;
+
+    bool GetSection(ESection Section, const void*& pData, Uint64& Size, Uint32& Stride) const;
+
+private:
+    const Uint8* m_pData    = nullptr;
+    Uint64       m_DataSize = 0;
+
+    // platform specific handles
+    void* m_hFile    = nullptr;
+    void* m_hMapping = nullptr;
+};
+
+} // namespace Diligent
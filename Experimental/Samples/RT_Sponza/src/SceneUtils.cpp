@@ -0,0 +1,68 @@
+#include "SceneUtils.hpp"
+#include "RefCntAutoPtr.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Diligent
+{
+
+bool ReadBufferData(IRenderDevice* pDevice, IDeviceContext* pContext, IBuffer* pBuffer, std::vector<Uint8>& Data, Uint32 Size)
+{
+    if (pBuffer == nullptr)
+        return false;
+
+    Size = Size == 0 ? pBuffer->GetDesc().uiSizeInBytes : std::min(Size, pBuffer->GetDesc().uiSizeInBytes);
+
+    BufferDesc BuffDesc;
+    BuffDesc.Name           = "Scene bake readback buffer";
+    BuffDesc.Usage          = USAGE_STAGING;
+    BuffDesc.CPUAccessFlags = CPU_ACCESS_READ;
+    BuffDesc.uiSizeInBytes  = Size;
+
+    RefCntAutoPtr<IBuffer> pStaging;
+    pDevice->CreateBuffer(BuffDesc, nullptr, &pStaging);
+    if (pStaging == nullptr)
+        return false;
+
+    pContext->CopyBuffer(pBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, pStaging, 0, Size, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    pContext->WaitForIdle();
+
+    void* pMapped = nullptr;
+    pContext->MapBuffer(pStaging, MAP_READ, MAP_FLAG_NONE, pMapped);
+    if (pMapped == nullptr)
+        return false;
+
+    Data.resize(Size);
+    std::memcpy(Data.data(), pMapped, Size);
+    pContext->UnmapBuffer(pStaging, MAP_READ);
+    return true;
+}
+
+nlohmann::json GetTimeStatistics(std::vector<float> Samples)
+{
+    nlohmann::json Stats;
+    Stats["samples"] = Samples.size();
+    if (Samples.empty())
+        return Stats;
+
+    std::sort(Samples.begin(), Samples.end());
+
+    const auto Percentile = [&Samples](double P) {
+        const size_t Rank = size_t(std::ceil(P * double(Samples.size())));
+        return Samples[std::min(std::max(Rank, size_t{1}), Samples.size()) - 1] * 1000.0;
+    };
+
+    double Sum = 0.0;
+    for (float Time : Samples)
+        Sum += Time;
+
+    Stats["averageMs"] = Sum * 1000.0 / double(Samples.size());
+    Stats["p95Ms"]     = Percentile(0.95);
+    Stats["p99Ms"]     = Percentile(0.99);
+    Stats["maxMs"]     = Samples.back() * 1000.0;
+    return Stats;
+}
+
+} // namespace Diligent
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+
+#include "tinygltf/json.hpp"
+
+namespace Diligent
+{
+
+// Copies buffer content to the CPU memory, waits for GPU.
+// Size is the number of bytes from the beginning of the buffer, 0 - whole buffer.
+bool ReadBufferData(IRenderDevice* pDevice, IDeviceContext* pContext, IBuffer* pBuffer, std::vector<Uint8>& Data, Uint32 Size = 0);
+
+// Average and nearest-rank percentiles of the samples in milliseconds.
+nlohmann::json GetTimeStatistics(std::vector<float> Samples);
+
+} // namespace Diligent
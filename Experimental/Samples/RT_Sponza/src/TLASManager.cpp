@@ -0,0 +1,202 @@
+#include "TLASManager.hpp"
+
+#include <algorithm>
+
+namespace Diligent
+{
+
+bool TLASManager::Create(IRenderDevice* pDevice, const char* Name, Uint32 MaxInstanceCount, const Settings& Settings)
+{
+    Release();
+
+    if (pDevice == nullptr)
+        return false;
+
+    m_pDevice          = pDevice;
+    m_Name             = Name;
+    m_MaxInstanceCount = max(MaxInstanceCount, 1u);
+    m_Settings         = Settings;
+
+    TopLevelASDesc TLASDesc;
+    TLASDesc.Name             = m_Name.c_str();
+    TLASDesc.MaxInstanceCount = m_MaxInstanceCount;
+    TLASDesc.Flags            = RAYTRACING_BUILD_AS_ALLOW_UPDATE | RAYTRACING_BUILD_AS_PREFER_FAST_TRACE;
+    m_pDevice->CreateTLAS(TLASDesc, &m_pTLAS);
+    if (m_pTLAS == nullptr)
+    {
+        LOG_ERROR_MESSAGE("Failed to create TLAS '", m_Name, '\'');
+        return false;
+    }
+
+    // scratch buffer is used for both build and update
+    const String ScratchName = m_Name + " scratch buffer";
+    const auto&  Sizes       = m_pTLAS->GetScratchBufferSizes();
+
+    BufferDesc BuffDesc;
+    BuffDesc.Name          = ScratchName.c_str();
+    BuffDesc.Usage         = USAGE_DEFAULT;
+    BuffDesc.BindFlags     = BIND_RAY_TRACING;
+    BuffDesc.uiSizeInBytes = max(Sizes.Build, Sizes.Update);
+    m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_pScratchBuffer);
+
+    const String InstanceName = m_Name + " instance buffer";
+    BuffDesc.Name             = InstanceName.c_str();
+    BuffDesc.uiSizeInBytes    = TLAS_INSTANCE_DATA_SIZE * m_MaxInstanceCount;
+    m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_pInstanceBuffer);
+
+    if (m_pScratchBuffer == nullptr || m_pInstanceBuffer == nullptr)
+    {
+        LOG_ERROR_MESSAGE("Failed to create buffers for TLAS '", m_Name, '\'');
+        Release();
+        return false;
+    }
+
+    m_InstancesChanged = true;
+    m_Built            = false;
+    return true;
+}
+
+void TLASManager::Release()
+{
+    m_pTLAS           = nullptr;
+    m_pScratchBuffer  = nullptr;
+    m_pInstanceBuffer = nullptr;
+    m_Built           = false;
+    m_RefitCount      = 0;
+}
+
+TLASManager::InstanceId TLASManager::AddInstance(const char* Name, IBottomLevelAS* pBLAS, Uint32 CustomId, RAYTRACING_INSTANCE_FLAGS Flags, const float4x4& Transform)
+{
+    VERIFY_EXPR(pBLAS != nullptr);
+
+    Instance Inst;
+    Inst.Name           = Name;
+    Inst.pBLAS          = pBLAS;
+    Inst.CustomId       = CustomId;
+    Inst.Flags          = Flags;
+    Inst.Transform      = Transform;
+    Inst.BuildTransform = Transform;
+    m_Instances.push_back(std::move(Inst));
+
+    m_InstancesChanged = true;
+    return InstanceId(m_Instances.size() - 1);
+}
+
+void TLASManager::SetTransform(InstanceId Id, const float4x4& Transform)
+{
+    auto& Inst = m_Instances[Id];
+    if (Inst.Transform == Transform)
+        return;
+
+    Inst.Transform = Transform;
+    Inst.Dirty     = true;
+}
+
+void TLASManager::SetBLAS(InstanceId Id, IBottomLevelAS* pBLAS)
+{
+    auto& Inst = m_Instances[Id];
+    if (Inst.pBLAS == pBLAS)
+        return;
+
+    // BLAS can not be changed by update
+    Inst.pBLAS         = pBLAS;
+    m_InstancesChanged = true;
+}
+
+bool TLASManager::NeedRebuild() const
+{
+    if (m_InstancesChanged || !m_Built || m_RefitCount >= m_Settings.RebuildPeriod)
+        return true;
+
+    // Refit keeps the hierarchy of the last build, the bounding boxes of moved instances grow
+    // and overlap with others. Count instances that are far from the position at the last build.
+    const float MaxDistSqr = m_Settings.RebuildDistance * m_Settings.RebuildDistance;
+    const auto  MaxMoved   = Uint32(m_Settings.RebuildMovedRatio * float(m_Instances.size()));
+    Uint32      Moved      = 0;
+
+    for (auto& Inst : m_Instances)
+    {
+        const float3 Delta = float3::MakeVector(Inst.Transform[3]) - float3::MakeVector(Inst.BuildTransform[3]);
+        if (dot(Delta, Delta) > MaxDistSqr)
+            ++Moved;
+    }
+    return Moved > MaxMoved;
+}
+
+TLASManager::EUpdateResult TLASManager::Update(IDeviceContext* pContext)
+{
+    if (m_pTLAS == nullptr || m_Instances.empty())
+        return EUpdateResult::None;
+
+    const bool AnyDirty = m_InstancesChanged || std::any_of(m_Instances.begin(), m_Instances.end(), [](const Instance& Inst) { return Inst.Dirty; });
+    if (m_Built && !AnyDirty)
+        return EUpdateResult::None;
+
+    const bool InstancesChanged = m_InstancesChanged;
+    if (m_Instances.size() > m_MaxInstanceCount)
+    {
+        if (!Create(m_pDevice, m_Name.c_str(), Uint32(m_Instances.size()), m_Settings))
+            return EUpdateResult::None;
+    }
+
+    const bool Rebuild = NeedRebuild();
+
+    // update requires the same instances in the same order, all of them are uploaded
+    m_BuildInstances.resize(m_Instances.size());
+    for (size_t i = 0; i < m_Instances.size(); ++i)
+    {
+        auto& Inst = m_Instances[i];
+        auto& Dst  = m_BuildInstances[i];
+
+        Dst.InstanceName                = Inst.Name.c_str();
+        Dst.pBLAS                       = Inst.pBLAS;
+        Dst.CustomId                    = Inst.CustomId;
+        Dst.Flags                       = Inst.Flags;
+        Dst.Mask                        = 0xFF;
+        Dst.ContributionToHitGroupIndex = TLAS_INSTANCE_OFFSET_AUTO;
+        ToInstanceMatrix(Inst.Transform, Dst.Transform);
+
+        Inst.Dirty = false;
+        if (Rebuild)
+            Inst.BuildTransform = Inst.Transform;
+    }
+
+    BuildTLASAttribs Attribs;
+    Attribs.pTLAS                        = m_pTLAS;
+    Attribs.pInstances                   = m_BuildInstances.data();
+    Attribs.InstanceCount                = Uint32(m_BuildInstances.size());
+    Attribs.HitGroupStride               = m_Settings.HitGroupStride;
+    Attribs.BindingMode                  = HIT_GROUP_BINDING_MODE_PER_INSTANCE;
+    Attribs.TLASTransitionMode           = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+    Attribs.BLASTransitionMode           = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+    Attribs.pInstanceBuffer              = m_pInstanceBuffer;
+    Attribs.InstanceBufferTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+    Attribs.pScratchBuffer               = m_pScratchBuffer;
+    Attribs.ScratchBufferTransitionMode  = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+    Attribs.Update                       = !Rebuild;
+    pContext->BuildTLAS(Attribs);
+
+    m_InstancesChanged = false;
+    m_Built            = true;
+
+    if (Rebuild)
+    {
+        m_RefitCount = 0;
+        ++m_BuildCount;
+        return InstancesChanged ? EUpdateResult::InstancesChanged : EUpdateResult::Rebuilt;
+    }
+
+    ++m_RefitCount;
+    ++m_TotalRefitCount;
+    return EUpdateResult::Refitted;
+}
+
+void TLASManager::ToInstanceMatrix(const float4x4& Src, InstanceMatrix& Dst)
+{
+    // InstanceMatrix is a row-major 3x4 matrix for column vectors, float4x4 is for row vectors
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 4; ++c)
+            Dst.data[r][c] = Src.m[c][r];
+}
+
+} // namespace Diligent
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+
+namespace Diligent
+{
+
+// Top level AS that is kept between frames with its scratch and instance buffers.
+// Instance transforms can be changed every frame, the TLAS is refitted when only transforms were changed
+// and rebuilt when the instance set was changed, periodically or when too many instances moved far away
+// from their transforms at the last build, because the refitted hierarchy becomes less efficient for tracing.
+class TLASManager
+{
+public:
+    using InstanceId = Uint32;
+
+    struct Settings
+    {
+        Uint32 HitGroupStride    = 1;
+        Uint32 RebuildPeriod     = 64;    // max number of refits between builds
+        float  RebuildMovedRatio = 0.25f; // part of the instances that moved far away
+        float  RebuildDistance   = 1.0f;  // in world space units
+    };
+
+    enum class EUpdateResult
+    {
+        None,             // nothing has been changed
+        Refitted,         // only transforms has been changed
+        Rebuilt,          // instances are the same, hit group offsets are not changed
+        InstancesChanged, // instance set has been changed, SBT must be updated
+    };
+
+    TLASManager() {}
+
+    TLASManager(const TLASManager&) = delete;
+    TLASManager& operator=(const TLASManager&) = delete;
+
+    bool Create(IRenderDevice* pDevice, const char* Name, Uint32 MaxInstanceCount, const Settings& Settings);
+    void Release();
+
+    // Instance name must be unique, instances are added to the TLAS on the next update.
+    InstanceId AddInstance(const char* Name, IBottomLevelAS* pBLAS, Uint32 CustomId, RAYTRACING_INSTANCE_FLAGS Flags, const float4x4& Transform);
+    void       SetTransform(InstanceId Id, const float4x4& Transform);
+    void       SetBLAS(InstanceId Id, IBottomLevelAS* pBLAS);
+
+    // Records build or refit commands if any instance was changed.
+    EUpdateResult Update(IDeviceContext* pContext);
+
+    ITopLevelAS*    GetTLAS() const { return m_pTLAS; }
+    Uint32          GetInstanceCount() const { return Uint32(m_Instances.size()); }
+    const char*     GetInstanceName(InstanceId Id) const { return m_Instances[Id].Name.c_str(); }
+    const float4x4& GetTransform(InstanceId Id) const { return m_Instances[Id].Transform; }
+
+    Uint32 GetBuildCount() const { return m_BuildCount; }
+    Uint32 GetRefitCount() const { return m_TotalRefitCount; }
+
+private:
+    bool NeedRebuild() const;
+
+    static void ToInstanceMatrix(const float4x4& Src, InstanceMatrix& Dst);
+
+private:
+    struct Instance
+    {
+        String                        Name;
+        RefCntAutoPtr<IBottomLevelAS> pBLAS;
+        Uint32                        CustomId = 0;
+        RAYTRACING_INSTANCE_FLAGS     Flags    = RAYTRACING_INSTANCE_NONE;
+        float4x4                      Transform;
+        float4x4                      BuildTransform; // transform at the last build
+        bool                          Dirty = true;
+    };
+
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+    RefCntAutoPtr<ITopLevelAS>   m_pTLAS;
+    RefCntAutoPtr<IBuffer>       m_pScratchBuffer;
+    RefCntAutoPtr<IBuffer>       m_pInstanceBuffer;
+    String                       m_Name;
+    Uint32                       m_MaxInstanceCount = 0;
+    Settings                     m_Settings;
+
+    std::vector<Instance>              m_Instances;
+    std::vector<TLASBuildInstanceData> m_BuildInstances;
+
+    bool   m_InstancesChanged = true;
+    bool   m_Built            = false;
+    Uint32 m_RefitCount       = 0; // since the last build
+    Uint32 m_BuildCount       = 0;
+    Uint32 m_TotalRefitCount  = 0;
+};
+
+} // namespace Diligent
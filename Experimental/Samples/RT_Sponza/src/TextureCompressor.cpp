@@ -0,0 +1,618 @@
+#include "TextureCompressor.hpp"
+#include "FileWrapper.hpp"
+#include "DataBlobImpl.hpp"
+#include "FileSystem.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <functional>
+
+#if PLATFORM_WIN32
+#    include <process.h>
+#else
+#    include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define TEXCOMP_USE_SSE2 1
+#    include <emmintrin.h>
+#else
+#    define TEXCOMP_USE_SSE2 0
+#endif
+
+namespace Diligent
+{
+namespace
+{
+
+static constexpr Uint32 BlockDim  = 4;
+static constexpr Uint32 BlockSize = 16; // in bytes, same for BC5 and BC7
+
+// 4x4 block of RGBA8 pixels in 0..255 range.
+struct PixelBlock
+{
+    float Pixels[16][4];
+};
+
+void FetchBlock(const Uint8* pSrc, Uint32 Width, Uint32 Height, Uint32 Stride, Uint32 BlockX, Uint32 BlockY, PixelBlock& Block)
+{
+    for (Uint32 y = 0; y < BlockDim; ++y)
+    {
+        // clamp to the image border, used for mips that are smaller than the block
+        const Uint8* pRow = pSrc + size_t(std::min(BlockY * BlockDim + y, Height - 1)) * Stride;
+        for (Uint32 x = 0; x < BlockDim; ++x)
+        {
+            const Uint8* pTexel = pRow + size_t(std::min(BlockX * BlockDim + x, Width - 1)) * 4;
+            for (Uint32 c = 0; c < 4; ++c)
+                Block.Pixels[y * BlockDim + x][c] = float(pTexel[c]);
+        }
+    }
+}
+
+class BitWriter
+{
+public:
+    void Write(Uint32 Value, Uint32 NumBits)
+    {
+        for (Uint32 i = 0; i < NumBits; ++i, ++m_Pos)
+            m_Data[m_Pos >> 3] |= Uint8(((Value >> i) & 1u) << (m_Pos & 7));
+    }
+
+    void CopyTo(Uint8* pDst) const
+    {
+        VERIFY_EXPR(m_Pos == 128);
+        std::memcpy(pDst, m_Data, sizeof(m_Data));
+    }
+
+private:
+    Uint8  m_Data[16] = {};
+    Uint32 m_Pos      = 0;
+};
+
+
+// BC7 mode 6: single subset, RGBA 7.7.7.7 endpoints with unique p-bit, 4-bit indices.
+class BC7Mode6Encoder
+{
+public:
+    void Encode(const PixelBlock& Block, Uint8* pDst)
+    {
+        float Endpoints[2][4];
+        ComputePrincipalAxisEndpoints(Block, Endpoints);
+
+        BestError = FLT_MAX;
+        TryEndpoints(Block, Endpoints);
+
+        // least squares refinement of the endpoints for the selected indices
+        for (Uint32 Iter = 0; Iter < 2; ++Iter)
+        {
+            if (!RefineEndpoints(Block, BestIndices, Endpoints) || !TryEndpoints(Block, Endpoints))
+                break;
+        }
+
+        Pack(pDst);
+    }
+
+private:
+    static constexpr Uint32 Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    struct QuantizedEndpoint
+    {
+        Uint32 Color[4] = {}; // 7 bits
+        Uint32 PBit     = 0;
+    };
+
+    static void ComputePrincipalAxisEndpoints(const PixelBlock& Block, float Endpoints[2][4])
+    {
+        float Mean[4] = {};
+        float Min[4]  = {255.f, 255.f, 255.f, 255.f};
+        float Max[4]  = {};
+        for (auto& Pixel : Block.Pixels)
+        {
+            for (Uint32 c = 0; c < 4; ++c)
+            {
+                Mean[c] += Pixel[c] / 16.f;
+                Min[c] = std::min(Min[c], Pixel[c]);
+                Max[c] = std::max(Max[c], Pixel[c]);
+            }
+        }
+
+        float Cov[4][4] = {};
+        for (auto& Pixel : Block.Pixels)
+        {
+            for (Uint32 i = 0; i < 4; ++i)
+                for (Uint32 j = 0; j < 4; ++j)
+                    Cov[i][j] += (Pixel[i] - Mean[i]) * (Pixel[j] - Mean[j]);
+        }
+
+        // power iteration, starts from the bounding box diagonal
+        float Axis[4] = {Max[0] - Min[0], Max[1] - Min[1], Max[2] - Min[2], Max[3] - Min[3]};
+        for (Uint32 Iter = 0; Iter < 8; ++Iter)
+        {
+            float Next[4] = {};
+            float Len     = 0.f;
+            for (Uint32 i = 0; i < 4; ++i)
+            {
+                for (Uint32 j = 0; j < 4; ++j)
+                    Next[i] += Cov[i][j] * Axis[j];
+                Len = std::max(Len, std::abs(Next[i]));
+            }
+            if (Len < 1.0e-6f)
+                break;
+
+            for (Uint32 i = 0; i < 4; ++i)
+                Axis[i] = Next[i] / Len;
+        }
+
+        float AxisLenSq = 0.f;
+        for (Uint32 c = 0; c < 4; ++c)
+            AxisLenSq += Axis[c] * Axis[c];
+
+        if (AxisLenSq < 1.0e-6f)
+        {
+            // solid color block
+            for (Uint32 c = 0; c < 4; ++c)
+                Endpoints[0][c] = Endpoints[1][c] = Mean[c];
+            return;
+        }
+
+        float MinT = FLT_MAX;
+        float MaxT = -FLT_MAX;
+        for (auto& Pixel : Block.Pixels)
+        {
+            float T = 0.f;
+            for (Uint32 c = 0; c < 4; ++c)
+                T += (Pixel[c] - Mean[c]) * Axis[c];
+            T /= AxisLenSq;
+            MinT = std::min(MinT, T);
+            MaxT = std::max(MaxT, T);
+        }
+
+        for (Uint32 c = 0; c < 4; ++c)
+        {
+            Endpoints[0][c] = Mean[c] + Axis[c] * MinT;
+            Endpoints[1][c] = Mean[c] + Axis[c] * MaxT;
+        }
+    }
+
+    static QuantizedEndpoint Quantize(const float Endpoint[4])
+    {
+        QuantizedEndpoint Best;
+        float             BestError = FLT_MAX;
+
+        for (Uint32 PBit = 0; PBit < 2; ++PBit)
+        {
+            QuantizedEndpoint Result;
+            float             Error = 0.f;
+            Result.PBit             = PBit;
+
+            for (Uint32 c = 0; c < 4; ++c)
+            {
+                const float Value = std::min(std::max(Endpoint[c], 0.f), 255.f);
+                const int   Q     = int((Value - float(PBit)) * 0.5f + 0.5f);
+                Result.Color[c]   = Uint32(std::min(std::max(Q, 0), 127));
+
+                const float Diff = float(Result.Color[c] * 2 + PBit) - Value;
+                Error += Diff * Diff;
+            }
+
+            if (Error < BestError)
+            {
+                BestError = Error;
+                Best      = Result;
+            }
+        }
+        return Best;
+    }
+
+    bool TryEndpoints(const PixelBlock& Block, const float Endpoints[2][4])
+    {
+        const QuantizedEndpoint Q0 = Quantize(Endpoints[0]);
+        const QuantizedEndpoint Q1 = Quantize(Endpoints[1]);
+
+        // palette in SoA layout
+        alignas(16) float Palette[4][16];
+        for (Uint32 i = 0; i < 16; ++i)
+        {
+            for (Uint32 c = 0; c < 4; ++c)
+            {
+                const Uint32 E0 = Q0.Color[c] * 2 + Q0.PBit;
+                const Uint32 E1 = Q1.Color[c] * 2 + Q1.PBit;
+                Palette[c][i]   = float(((64 - Weights[i]) * E0 + Weights[i] * E1 + 32) >> 6);
+            }
+        }
+
+        Uint8 Indices[16];
+        float Error = 0.f;
+        for (Uint32 p = 0; p < 16; ++p)
+        {
+            alignas(16) float Dist[16];
+            ComputeDistances(Palette, Block.Pixels[p], Dist);
+
+            Uint32 BestIdx = 0;
+            for (Uint32 i = 1; i < 16; ++i)
+            {
+                if (Dist[i] < Dist[BestIdx])
+                    BestIdx = i;
+            }
+            Indices[p] = Uint8(BestIdx);
+            Error += Dist[BestIdx];
+        }
+
+        if (Error >= BestError)
+            return false;
+
+        BestError = Error;
+        BestQ[0]  = Q0;
+        BestQ[1]  = Q1;
+        std::memcpy(BestIndices, Indices, sizeof(Indices));
+        return true;
+    }
+
+    static void ComputeDistances(const float Palette[4][16], const float Pixel[4], float Dist[16])
+    {
+#if TEXCOMP_USE_SSE2
+        const __m128 R = _mm_set1_ps(Pixel[0]);
+        const __m128 G = _mm_set1_ps(Pixel[1]);
+        const __m128 B = _mm_set1_ps(Pixel[2]);
+        const __m128 A = _mm_set1_ps(Pixel[3]);
+
+        for (Uint32 i = 0; i < 16; i += 4)
+        {
+            const __m128 DR = _mm_sub_ps(_mm_load_ps(&Palette[0][i]), R);
+            const __m128 DG = _mm_sub_ps(_mm_load_ps(&Palette[1][i]), G);
+            const __m128 DB = _mm_sub_ps(_mm_load_ps(&Palette[2][i]), B);
+            const __m128 DA = _mm_sub_ps(_mm_load_ps(&Palette[3][i]), A);
+
+            const __m128 D = _mm_add_ps(_mm_add_ps(_mm_mul_ps(DR, DR), _mm_mul_ps(DG, DG)),
+                                        _mm_add_ps(_mm_mul_ps(DB, DB), _mm_mul_ps(DA, DA)));
+            _mm_store_ps(&Dist[i], D);
+        }
+#else
+        for (Uint32 i = 0; i < 16; ++i)
+        {
+            Dist[i] = 0.f;
+            for (Uint32 c = 0; c < 4; ++c)
+            {
+                const float D = Palette[c][i] - Pixel[c];
+                Dist[i] += D * D;
+            }
+        }
+#endif
+    }
+
+    static bool RefineEndpoints(const PixelBlock& Block, const Uint8 Indices[16], float Endpoints[2][4])
+    {
+        float A = 0.f, B = 0.f, C = 0.f;
+        float X0[4] = {};
+        float X1[4] = {};
+
+        for (Uint32 p = 0; p < 16; ++p)
+        {
+            const float W  = float(Weights[Indices[p]]) / 64.f;
+            const float IW = 1.f - W;
+
+            A += IW * IW;
+            B += IW * W;
+            C += W * W;
+            for (Uint32 c = 0; c < 4; ++c)
+            {
+                X0[c] += IW * Block.Pixels[p][c];
+                X1[c] += W * Block.Pixels[p][c];
+            }
+        }
+
+        const float Det = A * C - B * B;
+        if (std::abs(Det) < 1.0e-6f)
+            return false;
+
+        for (Uint32 c = 0; c < 4; ++c)
+        {
+            Endpoints[0][c] = (C * X0[c] - B * X1[c]) / Det;
+            Endpoints[1][c] = (A * X1[c] - B * X0[c]) / Det;
+        }
+        return true;
+    }
+
+    void Pack(Uint8* pDst)
+    {
+        // the MSB of the first index is implicit zero
+        if (BestIndices[0] >= 8)
+        {
+            std::swap(BestQ[0], BestQ[1]);
+            for (auto& Idx : BestIndices)
+                Idx = Uint8(15 - Idx);
+        }
+
+        BitWriter Bits;
+        Bits.Write(1u << 6, 7); // mode 6
+        for (Uint32 c = 0; c < 4; ++c)
+        {
+            Bits.Write(BestQ[0].Color[c], 7);
+            Bits.Write(BestQ[1].Color[c], 7);
+        }
+        Bits.Write(BestQ[0].PBit, 1);
+        Bits.Write(BestQ[1].PBit, 1);
+
+        Bits.Write(BestIndices[0], 3);
+        for (Uint32 p = 1; p < 16; ++p)
+            Bits.Write(BestIndices[p], 4);
+
+        Bits.CopyTo(pDst);
+    }
+
+private:
+    float             BestError = FLT_MAX;
+    QuantizedEndpoint BestQ[2];
+    Uint8             BestIndices[16] = {};
+};
+
+constexpr Uint32 BC7Mode6Encoder::Weights[16];
+
+
+// BC4 block for a single channel, 8 interpolated values.
+void EncodeBC4(const PixelBlock& Block, Uint32 Channel, Uint8* pDst)
+{
+    Uint32 MinValue = 255;
+    Uint32 MaxValue = 0;
+    for (auto& Pixel : Block.Pixels)
+    {
+        MinValue = std::min(MinValue, Uint32(Pixel[Channel]));
+        MaxValue = std::max(MaxValue, Uint32(Pixel[Channel]));
+    }
+
+    pDst[0] = Uint8(MaxValue);
+    pDst[1] = Uint8(MinValue);
+
+    Uint64 Indices = 0;
+    if (MaxValue > MinValue)
+    {
+        // E0 > E1: 0 - E0, 1 - E1, 2..7 - interpolated from E0 to E1
+        Uint32 Palette[8] = {MaxValue, MinValue};
+        for (Uint32 i = 1; i < 7; ++i)
+            Palette[i + 1] = ((7 - i) * MaxValue + i * MinValue + 3) / 7;
+
+        for (Uint32 p = 0; p < 16; ++p)
+        {
+            const int Value   = int(Block.Pixels[p][Channel]);
+            Uint32    BestIdx = 0;
+            for (Uint32 i = 1; i < 8; ++i)
+            {
+                if (std::abs(int(Palette[i]) - Value) < std::abs(int(Palette[BestIdx]) - Value))
+                    BestIdx = i;
+            }
+            Indices |= Uint64(BestIdx) << (p * 3);
+        }
+    }
+
+    for (Uint32 i = 0; i < 6; ++i)
+        pDst[2 + i] = Uint8(Indices >> (i * 8));
+}
+
+Uint64 HashBytes(Uint64 Hash, const void* pData, size_t Size)
+{
+    // FNV-1a
+    const auto* pBytes = static_cast<const Uint8*>(pData);
+    for (size_t i = 0; i < Size; ++i)
+    {
+        Hash ^= pBytes[i];
+        Hash *= 0x100000001b3ull;
+    }
+    return Hash;
+}
+
+struct CacheFileHeader
+{
+    static constexpr Uint32 MagicNumber = 0x58544342; // 'BCTX'
+
+    Uint32 Magic    = MagicNumber;
+    Uint32 Version  = TextureCompressor::Version;
+    Uint32 Format   = 0;
+    Uint32 Width    = 0;
+    Uint32 Height   = 0;
+    Uint32 MipCount = 0;
+};
+
+} // namespace
+
+
+bool TextureCompressor::IsSupported(const ImageData& Src, TEXTURE_FORMAT Format)
+{
+    if (Format != TEX_FORMAT_BC7_UNORM && Format != TEX_FORMAT_BC5_UNORM)
+        return false;
+
+    return Src.Format == TEX_FORMAT_RGBA8_UNORM &&
+        Src.Width % BlockDim == 0 &&
+        Src.Height % BlockDim == 0 &&
+        !Src.Mips.empty() &&
+        Src.GetData() != nullptr;
+}
+
+bool TextureCompressor::Compress(const ImageData& Src, TEXTURE_FORMAT Format, ImageData& Dst)
+{
+    if (!IsSupported(Src, Format))
+        return false;
+
+    Dst           = {};
+    Dst.Width     = Src.Width;
+    Dst.Height    = Src.Height;
+    Dst.Format    = Format;
+    Dst.pExternal = nullptr;
+    Dst.Mips.resize(Src.Mips.size());
+
+    size_t TotalSize = 0;
+    for (size_t Mip = 0; Mip < Src.Mips.size(); ++Mip)
+    {
+        const Uint32 BlocksX = (std::max(Src.Width >> Mip, 1u) + BlockDim - 1) / BlockDim;
+        const Uint32 BlocksY = (std::max(Src.Height >> Mip, 1u) + BlockDim - 1) / BlockDim;
+
+        auto& Level  = Dst.Mips[Mip];
+        Level.Offset = TotalSize;
+        Level.Stride = BlocksX * BlockSize;
+        Level.Size   = Level.Stride * BlocksY;
+        TotalSize += Level.Size;
+    }
+    Dst.Pixels.resize(TotalSize);
+
+    BC7Mode6Encoder BC7;
+    PixelBlock      Block;
+
+    for (size_t Mip = 0; Mip < Src.Mips.size(); ++Mip)
+    {
+        const Uint32 Width   = std::max(Src.Width >> Mip, 1u);
+        const Uint32 Height  = std::max(Src.Height >> Mip, 1u);
+        const Uint32 BlocksX = (Width + BlockDim - 1) / BlockDim;
+        const Uint32 BlocksY = (Height + BlockDim - 1) / BlockDim;
+        const Uint8* pSrc    = Src.GetData() + Src.Mips[Mip].Offset;
+        Uint8*       pDst    = Dst.Pixels.data() + Dst.Mips[Mip].Offset;
+
+        for (Uint32 by = 0; by < BlocksY; ++by)
+        {
+            for (Uint32 bx = 0; bx < BlocksX; ++bx, pDst += BlockSize)
+            {
+                FetchBlock(pSrc, Width, Height, Src.Mips[Mip].Stride, bx, by, Block);
+
+                if (Format == TEX_FORMAT_BC7_UNORM)
+                {
+                    BC7.Encode(Block, pDst);
+                }
+                else
+                {
+                    EncodeBC4(Block, 0, pDst);
+                    EncodeBC4(Block, 1, pDst + BlockSize / 2);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool TextureCompressor::LoadCompressed(const char* FilePath, TEXTURE_FORMAT Format, const char* CacheDir, ImageData& Image)
+{
+    RefCntAutoPtr<DataBlobImpl> pFileData{MakeNewRCObj<DataBlobImpl>{}(0)};
+    {
+        FileWrapper File{FilePath, EFileAccessMode::Read};
+        if (!File)
+            return false;
+
+        File->Read(pFileData);
+    }
+
+    Uint64 Hash = 0xcbf29ce484222325ull;
+    Hash        = HashBytes(Hash, pFileData->GetDataPtr(), pFileData->GetSize());
+    Hash        = HashBytes(Hash, &Format, sizeof(Format));
+    Hash        = HashBytes(Hash, &Version, sizeof(Version));
+
+    char HashStr[32];
+    std::snprintf(HashStr, sizeof(HashStr), "%016llx", static_cast<unsigned long long>(Hash));
+    const String CacheFile = String{CacheDir} + '/' + HashStr + ".bctex";
+
+    if (ReadCacheFile(CacheFile.c_str(), Format, Image))
+        return true;
+
+    ImageData Decoded;
+    if (!TextureStreamer::DecodeImage(FilePath, Decoded))
+        return false;
+
+    if (!Compress(Decoded, Format, Image))
+    {
+        Image = std::move(Decoded);
+        return true;
+    }
+
+    if (!WriteCacheFile(CacheFile.c_str(), Image))
+        LOG_ERROR_MESSAGE("Failed to write compressed texture '", CacheFile, '\'');
+
+    return true;
+}
+
+bool TextureCompressor::ReadCacheFile(const char* CacheFile, TEXTURE_FORMAT Format, ImageData& Image)
+{
+    if (!FileSystem::PathExists(CacheFile))
+        return false;
+
+    RefCntAutoPtr<DataBlobImpl> pData{MakeNewRCObj<DataBlobImpl>{}(0)};
+    {
+        FileWrapper File{CacheFile, EFileAccessMode::Read};
+        if (!File)
+            return false;
+
+        File->Read(pData);
+    }
+
+    const auto*  pBytes = static_cast<const Uint8*>(pData->GetDataPtr());
+    const size_t Size   = pData->GetSize();
+
+    CacheFileHeader Header;
+    if (Size < sizeof(Header))
+        return false;
+
+    std::memcpy(&Header, pBytes, sizeof(Header));
+    if (Header.Magic != CacheFileHeader::MagicNumber || Header.Version != Version || Header.Format != Uint32(Format) || Header.MipCount == 0)
+        return false;
+
+    const size_t MipsSize = sizeof(MipLevel) * Header.MipCount;
+    if (Size < sizeof(Header) + MipsSize)
+        return false;
+
+    Image        = {};
+    Image.Width  = Header.Width;
+    Image.Height = Header.Height;
+    Image.Format = TEXTURE_FORMAT(Header.Format);
+    Image.Mips.resize(Header.MipCount);
+    std::memcpy(Image.Mips.data(), pBytes + sizeof(Header), MipsSize);
+
+    const size_t PixelsSize = Size - sizeof(Header) - MipsSize;
+    for (auto& Mip : Image.Mips)
+    {
+        if (Mip.Offset + Mip.Size > PixelsSize)
+            return false;
+    }
+
+    Image.Pixels.assign(pBytes + sizeof(Header) + MipsSize, pBytes + Size);
+    return true;
+}
+
+bool TextureCompressor::WriteCacheFile(const char* CacheFile, const ImageData& Image)
+{
+    CacheFileHeader Header;
+    Header.Format   = Uint32(Image.Format);
+    Header.Width    = Image.Width;
+    Header.Height   = Image.Height;
+    Header.MipCount = Uint32(Image.Mips.size());
+
+    // Cache files may be written from multiple threads and processes, the file is renamed when it is complete.
+    // Temporary name is unique per process, thread and call, so writers never share the temporary file.
+    static std::atomic<Uint32> TempCounter{0};
+#if PLATFORM_WIN32
+    const auto ProcessId = _getpid();
+#else
+    const auto ProcessId = getpid();
+#endif
+    const String TempPath = String{CacheFile} + '.' + std::to_string(ProcessId) + '.' +
+        std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + '.' + std::to_string(TempCounter++) + ".tmp";
+    {
+        FileWrapper File{TempPath.c_str(), EFileAccessMode::Overwrite};
+        if (!File)
+            return false;
+
+        if (!File->Write(&Header, sizeof(Header)) ||
+            !File->Write(Image.Mips.data(), sizeof(MipLevel) * Image.Mips.size()) ||
+            !File->Write(Image.Pixels.data(), Image.Pixels.size()))
+            return false;
+    }
+
+    std::remove(CacheFile);
+    if (std::rename(TempPath.c_str(), CacheFile) != 0)
+    {
+        std::remove(TempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace Diligent
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "TextureStreamer.hpp"
+
+namespace Diligent
+{
+
+// CPU encoders for block compressed texture formats:
+//  - BC7 (mode 6) for color maps,
+//  - BC5 for normal maps, only RG channels are stored.
+// Compressed images are cached on disk by the hash of the source file content.
+class TextureCompressor
+{
+public:
+    using ImageData = TextureStreamer::ImageData;
+    using MipLevel  = TextureStreamer::MipLevel;
+
+    static constexpr Uint32 Version = 1;
+
+    // Returns false if the format is not supported or image size is not a multiple of the block size.
+    static bool IsSupported(const ImageData& Src, TEXTURE_FORMAT Format);
+
+    // Encodes all mip levels of RGBA8 image.
+    static bool Compress(const ImageData& Src, TEXTURE_FORMAT Format, ImageData& Dst);
+
+    // Loads compressed image from the cache, on cache miss decodes the file, compresses it and saves to the cache.
+    // If the image can not be compressed, uncompressed RGBA8 image is returned. Cache directory must exist.
+    static bool LoadCompressed(const char* FilePath, TEXTURE_FORMAT Format, const char* CacheDir, ImageData& Image);
+
+private:
+    static bool ReadCacheFile(const char* CacheFile, TEXTURE_FORMAT Format, ImageData& Image);
+    static bool WriteCacheFile(const char* CacheFile, const ImageData& Image);
+};
+
+} // namespace Diligent
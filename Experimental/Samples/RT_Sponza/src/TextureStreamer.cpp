@@ -0,0 +1,462 @@
+#include "TextureStreamer.hpp"
+#include "TextureUtilities.h"
+#include "GraphicsAccessories.hpp"
+#include "Align.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Diligent
+{
+
+TextureStreamer::~TextureStreamer()
+{
+    Stop();
+}
+
+bool TextureStreamer::Start(IRenderDevice* pDevice, std::vector<Request>&& Requests, const Settings& Config) noexcept
+{
+    Stop();
+
+    if (pDevice == nullptr)
+    {
+        LOG_ERROR_MESSAGE("Failed to start texture streaming: invalid arguments");
+        return false;
+    }
+
+    m_pDevice      = pDevice;
+    m_Settings     = Config;
+    m_Requests     = std::move(Requests);
+    m_LoadedCount  = 0;
+    m_NextRequest  = 0;
+    m_Stop         = false;
+    m_DecodedBytes = 0;
+
+    m_Settings.StagingSize = Align(m_Settings.StagingSize, StagingAlign);
+
+    // create staging ring
+    {
+        BufferDesc BuffDesc;
+        BuffDesc.Name           = "Texture staging ring";
+        BuffDesc.Usage          = USAGE_STAGING;
+        BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+        BuffDesc.uiSizeInBytes  = m_Settings.StagingSize;
+
+        m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_pStagingBuffer);
+        if (m_pStagingBuffer == nullptr)
+        {
+            LOG_ERROR_MESSAGE("Failed to create staging buffer for texture streaming");
+            return false;
+        }
+
+        FenceDesc Desc;
+        Desc.Name = "Texture staging ring sync";
+        m_pDevice->CreateFence(Desc, &m_pFence);
+        if (m_pFence == nullptr)
+        {
+            LOG_ERROR_MESSAGE("Failed to create fence for texture streaming");
+            m_pStagingBuffer = nullptr;
+            return false;
+        }
+
+        m_FenceValue  = 0;
+        m_StagingHead = 0;
+        m_StagingUsed = 0;
+        m_FrameUsed   = 0;
+    }
+
+    // glTF samplers are ignored, all scene textures use the same sampler
+    {
+        SamplerDesc SamLinearWrap{
+            FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR,
+            TEXTURE_ADDRESS_WRAP, TEXTURE_ADDRESS_WRAP, TEXTURE_ADDRESS_WRAP};
+
+        m_pDevice->CreateSampler(SamLinearWrap, &m_pSampler);
+        VERIFY_EXPR(m_pSampler != nullptr);
+    }
+
+    Uint32 ThreadCount = m_Settings.ThreadCount;
+    if (ThreadCount == 0)
+        ThreadCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+
+    ThreadCount = std::min(std::max(1u, ThreadCount), Uint32(m_Requests.size()));
+
+    for (Uint32 i = 0; i < ThreadCount; ++i)
+        m_Workers.emplace_back([this]() { WorkerThread(); });
+
+    return true;
+}
+
+void TextureStreamer::Stop() noexcept
+{
+    {
+        std::lock_guard<std::mutex> Lock{m_DecodedGuard};
+        m_Stop = true;
+    }
+    m_DecodedReleased.notify_all();
+
+    for (auto& Worker : m_Workers)
+        Worker.join();
+
+    m_Workers.clear();
+    m_Decoded.clear();
+    m_DecodedBytes = 0;
+    m_pUpload.reset();
+    m_StagingFrames.clear();
+
+    // GPU may still use these objects, the device keeps them in the release queue
+    m_pStagingBuffer = nullptr;
+    m_pFence         = nullptr;
+    m_pSampler       = nullptr;
+}
+
+void TextureStreamer::WorkerThread()
+{
+    for (;;)
+    {
+        if (m_Stop)
+            return;
+
+        const Uint32 Index = m_NextRequest.fetch_add(1);
+        if (Index >= m_Requests.size())
+            return;
+
+        const auto&  Req = m_Requests[Index];
+        DecodedImage Decoded;
+        Decoded.RequestIndex = Index;
+
+        if (Req.FilePath.empty())
+        {
+            // pre-mipped image, external pixel data is not copied
+            Decoded.Image = Req.Image;
+        }
+        else if (!DecodeImage(Req.FilePath.c_str(), Decoded.Image))
+        {
+            // empty image is passed to the main thread to report an error
+            LOG_ERROR_MESSAGE("Failed to load texture '", Req.FilePath, '\'');
+            Decoded.Image = {};
+        }
+
+        const size_t ImageBytes = Decoded.Image.Pixels.size();
+
+        std::unique_lock<std::mutex> Lock{m_DecodedGuard};
+
+        // limit memory that is used by decoded images, the queue must accept at least one image
+        m_DecodedReleased.wait(Lock, [this, ImageBytes]() {
+            return m_Stop || m_Decoded.empty() || (m_DecodedBytes + ImageBytes <= m_Settings.MaxDecodedBytes);
+        });
+
+        if (m_Stop)
+            return;
+
+        m_DecodedBytes += ImageBytes;
+        m_Decoded.push_back(std::move(Decoded));
+    }
+}
+
+bool TextureStreamer::DecodeImage(const char* FilePath, ImageData& Result)
+{
+    RefCntAutoPtr<Image> pImage;
+    try
+    {
+        CreateImageFromFile(FilePath, &pImage, nullptr);
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    if (pImage == nullptr || pImage->GetData() == nullptr)
+        return false;
+
+    const auto& Desc = pImage->GetDesc();
+    if (Desc.ComponentType != VT_UINT8 || Desc.NumComponents == 0 || Desc.NumComponents > 4 || Desc.Width == 0 || Desc.Height == 0)
+    {
+        LOG_ERROR_MESSAGE("Texture '", FilePath, "' has unsupported format");
+        return false;
+    }
+
+    const Uint32 MipCount = ComputeMipLevelsCount(Desc.Width, Desc.Height);
+
+    Result.Width     = Desc.Width;
+    Result.Height    = Desc.Height;
+    Result.Format    = TEX_FORMAT_RGBA8_UNORM;
+    Result.pExternal = nullptr;
+    Result.Mips.resize(MipCount);
+
+    size_t TotalSize = 0;
+    for (Uint32 Mip = 0; Mip < MipCount; ++Mip)
+    {
+        auto& Level  = Result.Mips[Mip];
+        Level.Offset = TotalSize;
+        Level.Stride = std::max(Desc.Width >> Mip, 1u) * 4;
+        Level.Size   = Level.Stride * std::max(Desc.Height >> Mip, 1u);
+        TotalSize += Level.Size;
+    }
+    Result.Pixels.resize(TotalSize);
+
+    // convert to RGBA8
+    {
+        const auto*  pSrc  = static_cast<const Uint8*>(pImage->GetData()->GetDataPtr());
+        auto*        pDst  = Result.Pixels.data();
+        const Uint32 Comps = Desc.NumComponents;
+
+        for (Uint32 y = 0; y < Desc.Height; ++y)
+        {
+            const Uint8* pSrcRow = pSrc + size_t(y) * Desc.RowStride;
+            for (Uint32 x = 0; x < Desc.Width; ++x, pDst += 4)
+            {
+                const Uint8* pTexel = pSrcRow + size_t(x) * Comps;
+
+                pDst[0] = pTexel[0];
+                pDst[1] = Comps > 1 ? pTexel[1] : pTexel[0];
+                pDst[2] = Comps > 2 ? pTexel[2] : (Comps > 1 ? 0 : pTexel[0]);
+                pDst[3] = Comps > 3 ? pTexel[3] : 0xFF;
+            }
+        }
+    }
+
+    // generate mipmaps with 2x2 box filter
+    for (Uint32 Mip = 1; Mip < MipCount; ++Mip)
+    {
+        const Uint32 SrcWidth  = std::max(Desc.Width >> (Mip - 1), 1u);
+        const Uint32 SrcHeight = std::max(Desc.Height >> (Mip - 1), 1u);
+        const Uint32 DstWidth  = std::max(Desc.Width >> Mip, 1u);
+        const Uint32 DstHeight = std::max(Desc.Height >> Mip, 1u);
+        const Uint8* pSrc      = Result.Pixels.data() + Result.Mips[Mip - 1].Offset;
+        Uint8*       pDst      = Result.Pixels.data() + Result.Mips[Mip].Offset;
+
+        for (Uint32 y = 0; y < DstHeight; ++y)
+        {
+            const Uint8* pRow0 = pSrc + size_t(std::min(y * 2 + 0, SrcHeight - 1)) * SrcWidth * 4;
+            const Uint8* pRow1 = pSrc + size_t(std::min(y * 2 + 1, SrcHeight - 1)) * SrcWidth * 4;
+
+            for (Uint32 x = 0; x < DstWidth; ++x, pDst += 4)
+            {
+                const Uint32 x0 = std::min(x * 2 + 0, SrcWidth - 1) * 4;
+                const Uint32 x1 = std::min(x * 2 + 1, SrcWidth - 1) * 4;
+
+                for (Uint32 c = 0; c < 4; ++c)
+                    pDst[c] = Uint8((Uint32(pRow0[x0 + c]) + pRow0[x1 + c] + pRow1[x0 + c] + pRow1[x1 + c] + 2) / 4);
+            }
+        }
+    }
+    return true;
+}
+
+bool TextureStreamer::BeginUpload(UploadState& Upload)
+{
+    const auto& Image = Upload.Decoded.Image;
+    if (Image.Mips.empty() || Image.GetData() == nullptr)
+        return false;
+
+    TextureDesc TexDesc;
+    TexDesc.Name      = m_Requests[Upload.Decoded.RequestIndex].FilePath.c_str();
+    TexDesc.Type      = RESOURCE_DIM_TEX_2D;
+    TexDesc.Usage     = USAGE_DEFAULT;
+    TexDesc.BindFlags = BIND_SHADER_RESOURCE;
+    TexDesc.Width     = Image.Width;
+    TexDesc.Height    = Image.Height;
+    TexDesc.Format    = Image.Format;
+    TexDesc.MipLevels = Uint32(Image.Mips.size());
+
+    m_pDevice->CreateTexture(TexDesc, nullptr, &Upload.pTexture);
+    if (Upload.pTexture == nullptr)
+        return false;
+
+    Upload.pTexture->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE)->SetSampler(m_pSampler);
+    Upload.NextMip = 0;
+    return true;
+}
+
+Uint32 TextureStreamer::AllocStaging(Uint32 Size)
+{
+    const Uint32 Capacity = m_Settings.StagingSize;
+
+    Size = Align(Size, StagingAlign);
+
+    // waiting for GPU would never free enough space
+    if (Size > Capacity)
+    {
+        LOG_ERROR_MESSAGE("Staging allocation of ", Size, " bytes is larger than the staging buffer (", Capacity, " bytes)");
+        return ~0u;
+    }
+
+    // ring is empty, start from the beginning so the allocation is not split by the tail
+    if (m_StagingUsed == 0)
+        m_StagingHead = 0;
+
+    // allocation must be contiguous, skip the tail of the buffer
+    Uint32 Offset = m_StagingHead;
+    Uint32 Waste  = 0;
+    if (Offset + Size > Capacity)
+    {
+        Waste  = Capacity - Offset;
+        Offset = 0;
+    }
+
+    if (m_StagingUsed + Waste + Size > Capacity)
+        return ~0u;
+
+    m_StagingUsed += Waste + Size;
+    m_FrameUsed += Waste + Size;
+    m_StagingHead = (Offset + Size) % Capacity;
+    return Offset;
+}
+
+void TextureStreamer::ReleaseStaging()
+{
+    const Uint64 CompletedValue = m_pFence->GetCompletedValue();
+
+    while (m_StagingFrames.size() && m_StagingFrames.front().FenceValue <= CompletedValue)
+    {
+        VERIFY_EXPR(m_StagingUsed >= m_StagingFrames.front().Size);
+        m_StagingUsed -= m_StagingFrames.front().Size;
+        m_StagingFrames.pop_front();
+    }
+}
+
+void TextureStreamer::Update(IDeviceContext* pContext, const OnLoaded_t& OnLoaded) noexcept
+{
+    if (m_pStagingBuffer == nullptr || IsCompleted())
+        return;
+
+    ReleaseStaging();
+
+    struct MipCopy
+    {
+        ITexture* pTexture = nullptr;
+        Uint32    Mip      = 0;
+        Uint32    Width    = 0;
+        Uint32    Height   = 0;
+        Uint32    Offset   = 0;
+        Uint32    Stride   = 0;
+    };
+    std::vector<MipCopy>                      Copies;
+    std::vector<std::unique_ptr<UploadState>> Completed;
+    std::vector<std::unique_ptr<UploadState>> Failed; // kept alive until the queued copies are submitted
+
+    Uint8* pStaging = nullptr;
+    Uint32 Budget   = m_Settings.UploadBudget;
+    bool   Stalled  = false;
+
+    while (!Stalled)
+    {
+        if (m_pUpload == nullptr)
+        {
+            std::unique_ptr<UploadState> pUpload{new UploadState{}};
+            {
+                std::lock_guard<std::mutex> Lock{m_DecodedGuard};
+                if (m_Decoded.empty())
+                    break;
+
+                pUpload->Decoded = std::move(m_Decoded.front());
+                m_Decoded.pop_front();
+                m_DecodedBytes -= pUpload->Decoded.Image.Pixels.size();
+            }
+            m_DecodedReleased.notify_all();
+
+            if (!BeginUpload(*pUpload))
+            {
+                ++m_LoadedCount;
+                OnLoaded(m_Requests[pUpload->Decoded.RequestIndex].Id, nullptr);
+                continue;
+            }
+            m_pUpload = std::move(pUpload);
+        }
+
+        auto&        Upload   = *m_pUpload;
+        const auto&  Image    = Upload.Decoded.Image;
+        const Uint32 MipCount = Uint32(Image.Mips.size());
+
+        for (; Upload.NextMip < MipCount; ++Upload.NextMip)
+        {
+            const Uint32 Mip    = Upload.NextMip;
+            const Uint32 Width  = std::max(Image.Width >> Mip, 1u);
+            const Uint32 Height = std::max(Image.Height >> Mip, 1u);
+            const Uint32 Stride = Image.Mips[Mip].Stride;
+            const Uint32 Size   = Image.Mips[Mip].Size;
+            const Uint8* pData  = Image.GetData() + Image.Mips[Mip].Offset;
+
+            // at least one mip level must be uploaded per frame
+            if (Size > Budget && Budget != m_Settings.UploadBudget)
+            {
+                Stalled = true;
+                break;
+            }
+
+            if (Size > m_Settings.StagingSize)
+            {
+                // too big for the staging ring, use the context upload heap
+                TextureSubResData SubRes{pData, Stride};
+                pContext->UpdateTexture(Upload.pTexture, Mip, 0, Box{0, Width, 0, Height}, SubRes, RESOURCE_STATE_TRANSITION_MODE_NONE, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+            }
+            else
+            {
+                const Uint32 Offset = AllocStaging(Size);
+                if (Offset == ~0u)
+                {
+                    // allocation failed in the empty ring, it will never succeed
+                    if (m_StagingUsed == 0)
+                    {
+                        Failed.push_back(std::move(m_pUpload));
+                        break;
+                    }
+
+                    // wait until GPU releases staging memory
+                    Stalled = true;
+                    break;
+                }
+
+                if (pStaging == nullptr)
+                {
+                    void* pMapped = nullptr;
+                    pContext->MapBuffer(m_pStagingBuffer, MAP_WRITE, MAP_FLAG_NONE, pMapped);
+                    pStaging = static_cast<Uint8*>(pMapped);
+                    VERIFY_EXPR(pStaging != nullptr);
+                }
+                std::memcpy(pStaging + Offset, pData, Size);
+
+                Copies.push_back({Upload.pTexture, Mip, Width, Height, Offset, Stride});
+            }
+
+            Budget -= std::min(Size, Budget);
+        }
+
+        if (m_pUpload != nullptr && Upload.NextMip == MipCount)
+            Completed.push_back(std::move(m_pUpload));
+    }
+
+    if (pStaging != nullptr)
+        pContext->UnmapBuffer(m_pStagingBuffer, MAP_WRITE);
+
+    for (auto& Copy : Copies)
+    {
+        TextureSubResData SubRes{m_pStagingBuffer, Copy.Offset, Copy.Stride};
+        pContext->UpdateTexture(Copy.pTexture, Copy.Mip, 0, Box{0, Copy.Width, 0, Copy.Height}, SubRes, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    }
+
+    if (m_FrameUsed > 0)
+    {
+        pContext->SignalFence(m_pFence, ++m_FenceValue);
+        m_StagingFrames.push_back({m_FenceValue, m_FrameUsed});
+        m_FrameUsed = 0;
+    }
+
+    for (auto& pUpload : Completed)
+    {
+        StateTransitionDesc Barrier{pUpload->pTexture, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, true};
+        pContext->TransitionResourceStates(1, &Barrier);
+
+        ++m_LoadedCount;
+        OnLoaded(m_Requests[pUpload->Decoded.RequestIndex].Id, pUpload->pTexture);
+    }
+
+    for (auto& pUpload : Failed)
+    {
+        ++m_LoadedCount;
+        OnLoaded(m_Requests[pUpload->Decoded.RequestIndex].Id, nullptr);
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+
+namespace Diligent
+{
+
+// Decodes images and generates mipmaps on worker threads, pre-mipped images are passed as is.
+// Textures are uploaded through the staging ring within a per-frame budget.
+class TextureStreamer
+{
+public:
+    struct MipLevel
+    {
+        Uint64 Offset = 0; // in bytes
+        Uint32 Stride = 0; // row stride in bytes
+        Uint32 Size   = 0;
+    };
+
+    // Texture with all mip levels.
+    struct ImageData
+    {
+        Uint32                Width     = 0;
+        Uint32                Height    = 0;
+        TEXTURE_FORMAT        Format    = TEX_FORMAT_RGBA8_UNORM;
+        std::vector<MipLevel> Mips;
+        std::vector<Uint8>    Pixels;              // owned pixel data
+        const Uint8*          pExternal = nullptr; // pixel data that is owned by the caller, used instead of Pixels
+
+        const Uint8* GetData() const { return pExternal != nullptr ? pExternal : Pixels.data(); }
+    };
+
+    struct Request
+    {
+        Uint32    Id = 0; // user defined
+        String    FilePath;
+        ImageData Image; // used if FilePath is empty, external data must be valid until the texture is loaded
+    };
+
+    struct Settings
+    {
+        Uint32 ThreadCount     = 0; // 0 - hardware concurrency minus main thread
+        Uint32 StagingSize     = 32u << 20;
+        Uint32 UploadBudget    = 8u << 20; // bytes per frame
+        Uint64 MaxDecodedBytes = 256u << 20;
+    };
+
+    // pTexture is null if image decoding or uploading failed
+    using OnLoaded_t = std::function<void(Uint32 Id, ITexture* pTexture)>;
+
+    TextureStreamer() {}
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    bool Start(IRenderDevice* pDevice, std::vector<Request>&& Requests, const Settings& Config = {}) noexcept;
+    void Stop() noexcept;
+
+    // Must be called once per frame on the thread that owns the context.
+    void Update(IDeviceContext* pContext, const OnLoaded_t& OnLoaded) noexcept;
+
+    // Loads the image and generates mipmaps with 2x2 box filter, result is in RGBA8 format.
+    static bool DecodeImage(const char* FilePath, ImageData& Image);
+
+    bool   IsCompleted() const { return m_LoadedCount == m_Requests.size(); }
+    Uint32 GetLoadedCount() const { return m_LoadedCount; }
+
+private:
+    struct DecodedImage
+    {
+        Uint32    RequestIndex = 0;
+        ImageData Image;
+    };
+
+    struct UploadState
+    {
+        DecodedImage            Decoded;
+        RefCntAutoPtr<ITexture> pTexture;
+        Uint32                  NextMip = 0;
+    };
+
+    struct StagingFrame
+    {
+        Uint64 FenceValue = 0;
+        Uint32 Size       = 0;
+    };
+
+    void WorkerThread();
+
+    bool   BeginUpload(UploadState& Upload);
+    Uint32 AllocStaging(Uint32 Size);
+    void   ReleaseStaging();
+
+private:
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+    Settings                     m_Settings;
+    std::vector<Request>         m_Requests;
+    Uint32                       m_LoadedCount = 0;
+
+    // decoding
+    std::vector<std::thread> m_Workers;
+    std::atomic<Uint32>      m_NextRequest{0};
+    std::atomic<bool>        m_Stop{false};
+    std::mutex               m_DecodedGuard;
+    std::condition_variable  m_DecodedReleased;
+    std::deque<DecodedImage> m_Decoded;
+    Uint64                   m_DecodedBytes = 0;
+
+    // uploading
+    std::unique_ptr<UploadState> m_pUpload;
+    RefCntAutoPtr<ISampler>      m_pSampler;
+
+    // staging ring
+    static constexpr Uint32 StagingAlign = 256;
+
+    RefCntAutoPtr<IBuffer>   m_pStagingBuffer;
+    RefCntAutoPtr<IFence>    m_pFence;
+    Uint64                   m_FenceValue  = 0;
+    Uint32                   m_StagingHead = 0; // next free byte
+    Uint32                   m_StagingUsed = 0;
+    Uint32                   m_FrameUsed   = 0; // allocated in the current frame
+    std::deque<StagingFrame> m_StagingFrames;
+};
+
+} // namespace Diligent
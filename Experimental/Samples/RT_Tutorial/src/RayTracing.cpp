@@ -7,6 +7,7 @@
 #include "ImGuiUtils.hpp"
 #include "AdvancedMath.hpp"
 #include "PlatformMisc.hpp"
+#include "Timer.hpp"
 
 namespace Diligent
 {
@@ -16,6 +17,12 @@ SampleBase* CreateSample()
     return new RayTracing();
 }
 
+namespace
+{
+// camera path is recorded to and replayed from the working directory
+constexpr char CameraPathFile[] = "camera_path.bin";
+} // namespace
+
 RayTracing::RayTracing() :
     m_ShaderDebugger{SHADER_TRACE_DLL}
 {
@@ -70,6 +77,9 @@ void RayTracing::CreateRayTracingPSO()
 {
     using EDbgMode = DE::EShaderDebugMode;
 
+    const Timer Timer;
+    const auto  CacheStats = m_ShaderDebugger.GetShaderCacheStats();
+
     try
     {
         m_pRayTracingPSO = nullptr;
@@ -149,6 +159,10 @@ void RayTracing::CreateRayTracingPSO()
 
         m_ShaderDebugger.CreateSRB(m_pRayTracingPSO, &m_pRayTracingSRB);
         CHECK_THROW(m_pRayTracingSRB != nullptr);
+
+        const auto NewStats = m_ShaderDebugger.GetShaderCacheStats();
+        LOG_INFO_MESSAGE("Ray tracing PSO created in ", Timer.GetElapsedTime() * 1000.0, " ms, shader cache hits: ",
+                         NewStats.Hits - CacheStats.Hits, ", misses: ", NewStats.Misses - CacheStats.Misses);
     }
     catch (...)
     {
@@ -607,8 +621,12 @@ void RayTracing::Initialize(const SampleInitInfo& InitInfo)
 
     m_MaxRecursionDepth = std::min(m_MaxRecursionDepth, m_pDevice->GetDeviceProperties().MaxRayTracingRecursionDepth);
 
-    m_ShaderDebugger.Initialize(m_pEngineFactory, m_pDevice);
+    m_ShaderDebugger.Initialize(m_pEngineFactory, m_pDevice, SHADER_CACHE_PATH);
+#ifdef SHADER_COMPILER_WORKER
+    m_ShaderDebugger.InitCompilerWorkers(SHADER_COMPILER_WORKER);
+#endif
     m_ShaderDebugger.InitDebugOutput(DEBUG_TRACE_PATH);
+    m_ShaderDebugger.InitTimings([this](const DE::DebugPassTimings& Timings) { m_DebuggerTimings = Timings; });
 
     CreateGraphicsPSO();
     CreateRayTracingPSO();
@@ -806,17 +824,32 @@ void RayTracing::Update(double CurrTime, double ElapsedTime)
     SampleBase::Update(CurrTime, ElapsedTime);
     UpdateUI();
 
-    m_AnimationTime += static_cast<float>(std::min(m_MaxAnimationTimeDelta, ElapsedTime));
+    DE::CameraPath::Frame ReplayFrame;
+    if (m_CameraPlayer.NextFrame(ReplayFrame))
+    {
+        // user input is ignored, camera and animation depend only on the frame index
+        InputControllerBase NoInput;
+        m_AnimationTime = ReplayFrame.Time;
+        m_Camera.SetPos(ReplayFrame.Position);
+        m_Camera.SetLookAt(ReplayFrame.Position + ReplayFrame.Direction);
+        m_Camera.Update(NoInput, m_CameraPlayer.GetTimeStep());
+    }
+    else
+    {
+        m_AnimationTime += static_cast<float>(std::min(m_MaxAnimationTimeDelta, ElapsedTime));
 
-    m_Camera.Update(m_InputController, static_cast<float>(ElapsedTime));
+        m_Camera.Update(m_InputController, static_cast<float>(ElapsedTime));
 
-    float3 oldPos = m_Camera.GetPos();
-    if (oldPos.y < -5.7f)
-    {
-        oldPos.y = -5.7f;
-        m_Camera.SetPos(oldPos);
+        float3 oldPos = m_Camera.GetPos();
+        if (oldPos.y < -5.7f)
+        {
+            oldPos.y = -5.7f;
+            m_Camera.SetPos(oldPos);
+        }
     }
 
+    m_CameraRecorder.AddFrame(m_Camera.GetPos(), float3::MakeVector(m_Camera.GetWorldMatrix()[2]), m_AnimationTime);
+
     if (GetInputController().GetKeyState(InputKeys::ControlDown) & INPUT_KEY_STATE_FLAG_KEY_WAS_DOWN)
     {
         m_pImmediateContext->WaitForIdle();
@@ -924,6 +957,53 @@ void RayTracing::UpdateUI()
         ImGui::Text("Sphere");
         ImGui::SliderInt("Reflection blur", &m_Constants.SphereReflectionBlur, 1, 16);
         ImGui::ColorEdit3("Color mask", m_Constants.SphereReflectionColorMask.Data(), ImGuiColorEditFlags_NoAlpha);
+
+        ImGui::Separator();
+        ImGui::Text("Camera path");
+        if (m_CameraPlayer.IsActive())
+        {
+            ImGui::Text("Replay: frame %u of %u", m_CameraPlayer.GetFrameIndex(), m_CameraPlayer.GetFrameCount());
+            if (ImGui::Button("Stop replay"))
+                m_CameraPlayer.Stop();
+        }
+        else if (m_CameraRecorder.IsActive())
+        {
+            if (ImGui::Button("Stop recording"))
+                m_CameraRecorder.Stop(CameraPathFile);
+        }
+        else
+        {
+            if (ImGui::Button("Record"))
+                m_CameraRecorder.Start();
+            ImGui::SameLine();
+            if (ImGui::Button("Replay"))
+                m_CameraPlayer.Start(CameraPathFile);
+        }
+
+        ImGui::Separator();
+        ImGui::Text("Shader debugger GPU time");
+        {
+            using DE::EDebugPass;
+
+            // clang-format off
+            const std::pair<EDebugPass, const char*> Passes[] = {
+                {EDebugPass::Instrumented, "Instrumented pass"},
+                {EDebugPass::HeatmapPass1, "Heatmap pass 1"   },
+                {EDebugPass::HeatmapPass2, "Heatmap pass 2"   },
+                {EDebugPass::HeatmapPass3, "Heatmap pass 3"   },
+                {EDebugPass::Readback,     "Trace readback"   }
+            };
+            // clang-format on
+
+            for (auto& Pass : Passes)
+            {
+                const double Duration = m_DebuggerTimings[Pass.first];
+                if (Duration >= 0.0)
+                    ImGui::Text("%s: %.3f ms", Pass.second, Duration);
+                else
+                    ImGui::Text("%s: -", Pass.second);
+            }
+        }
     }
     ImGui::End();
 }
@@ -4,6 +4,7 @@
 #include "BasicMath.hpp"
 #include "FirstPersonCamera.hpp"
 #include "ShaderDebugger.h"
+#include "Utils/CameraPath.h"
 
 namespace Diligent
 {
@@ -65,6 +66,9 @@ private:
     bool              m_EnableCubes[NumCubes] = {true, true, true, true};
     FirstPersonCamera m_Camera;
 
+    DE::CameraPathRecorder m_CameraRecorder;
+    DE::CameraPathPlayer   m_CameraPlayer;
+
     bool  m_ClockHeatmap  = false;
     bool  m_DebugShader   = false;
     bool  m_ProfileShader = false;
@@ -73,7 +77,8 @@ private:
     TEXTURE_FORMAT          m_ColorBufferFormat = TEX_FORMAT_RGBA8_UNORM;
     RefCntAutoPtr<ITexture> m_pColorRT;
 
-    DE::ShaderDebugger m_ShaderDebugger;
+    DE::ShaderDebugger   m_ShaderDebugger;
+    DE::DebugPassTimings m_DebuggerTimings; // last received
 };
 
 } // namespace Diligent
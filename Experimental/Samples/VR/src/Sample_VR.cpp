@@ -186,7 +186,8 @@ bool Sample_VR::Initialize()
 {
     // engine initialization
     {
-        m_VRDevice.reset(new VREmulatorVk{});
+        m_Emulator = new VREmulatorVk{};
+        m_VRDevice.reset(m_Emulator);
         //m_VRDevice.reset(new OpenVRDeviceVk{});
         //m_VRDevice.reset(new OpenXRDeviceVk{});
 
@@ -235,13 +236,16 @@ bool Sample_VR::Initialize()
     return true;
 }
 
-void Sample_VR::Run()
+void Sample_VR::Run(const char* ReplayFile)
 {
     if (!Initialize())
         return;
 
+    if (ReplayFile != nullptr && (m_Emulator == nullptr || !m_Emulator->StartReplay(ReplayFile)))
+        return;
+
     Diligent::Timer Timer;
-    auto            PrevTime = Timer.GetElapsedTime();
+    auto            PrevTime = m_Emulator != nullptr ? m_Emulator->GetTime() : Timer.GetElapsedTime();
 
     for (;;)
     {
@@ -250,7 +254,8 @@ void Sample_VR::Run()
 
         EHmdStatus status = m_VRDevice->GetStatus();
 
-        auto CurrTime    = Timer.GetElapsedTime();
+        // emulator time is recorded and replayed with the camera path
+        auto CurrTime    = m_Emulator != nullptr ? m_Emulator->GetTime() : Timer.GetElapsedTime();
         auto ElapsedTime = CurrTime - PrevTime;
         PrevTime         = CurrTime;
 
@@ -278,9 +283,14 @@ void Sample_VR::Run()
 
 } // namespace DEVR
 
-int main()
+// Sample_VR [--replay <camera path>]
+int main(int argc, char** argv)
 {
+    const char* replayFile = nullptr;
+    if (argc == 3 && std::string{argv[1]} == "--replay")
+        replayFile = argv[2];
+
     DEVR::Sample_VR sample;
-    sample.Run();
+    sample.Run(replayFile);
     return 0;
 }
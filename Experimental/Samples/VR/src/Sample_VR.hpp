@@ -4,11 +4,13 @@
 
 namespace DEVR
 {
+class VREmulatorVk;
 
 class Sample_VR
 {
 public:
-    void Run();
+    // Camera path is replayed if the emulator is used.
+    void Run(const char* ReplayFile = nullptr);
 
 private:
     bool Initialize();
@@ -26,6 +28,7 @@ private:
     RefCntAutoPtr<IRenderDevice>  m_pDevice;
     RefCntAutoPtr<IDeviceContext> m_pContext;
     std::unique_ptr<IVRDevice>    m_VRDevice;
+    VREmulatorVk*                 m_Emulator = nullptr; // not null if VR device is emulated
 
     RefCntAutoPtr<ITexture>     m_DepthTexture;
     const TEXTURE_FORMAT        m_DepthFormat = TEX_FORMAT_D32_FLOAT;
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <vector>
+#include <cfloat>
+#include <cmath>
+
+#include "BasicMath.hpp"
+#include "PlatformMisc.hpp"
+#include "DebugUtilities.hpp"
+
+namespace DE
+{
+using namespace Diligent;
+
+struct AABB
+{
+    float3 Min{+FLT_MAX, +FLT_MAX, +FLT_MAX};
+    float3 Max{-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+    AABB() {}
+    AABB(const float3& InMin, const float3& InMax) :
+        Min{InMin}, Max{InMax} {}
+
+    void Grow(const float3& Point)
+    {
+        Min = std::min(Min, Point);
+        Max = std::max(Max, Point);
+    }
+
+    void Grow(const AABB& Box)
+    {
+        Min = std::min(Min, Box.Min);
+        Max = std::max(Max, Box.Max);
+    }
+
+    bool   IsValid() const { return Min.x <= Max.x && Min.y <= Max.y && Min.z <= Max.z; }
+    float3 Center() const { return (Min + Max) * 0.5f; }
+
+    // Half of the surface area, enough for SAH where only the ratio is used.
+    float HalfArea() const
+    {
+        if (!IsValid())
+            return 0.0f;
+        const float3 d = Max - Min;
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+
+    bool Overlaps(const AABB& Box) const
+    {
+        return Min.x <= Box.Max.x && Max.x >= Box.Min.x &&
+            Min.y <= Box.Max.y && Max.y >= Box.Min.y &&
+            Min.z <= Box.Max.z && Max.z >= Box.Min.z;
+    }
+};
+
+
+// BVH with 8 children per node, child boxes are quantized to 8 bits per plane relative to the node.
+// Built from the binary BVH (binned SAH, subtrees are built in parallel) by collapsing the largest
+// children until the node is full. Primitives are referenced by index in the bounds array
+// that is passed to Build(), the BVH doesn't store the geometry.
+// Nodes are position independent: children are referenced by index and always follow the parent,
+// so the tree can be saved and loaded without fixups.
+class BVH8
+{
+public:
+    static constexpr Uint32 Width       = 8;
+    static constexpr Uint32 MaxLeafSize = 3; // limited by Node::Meta encoding
+
+    struct BuildSettings
+    {
+        Uint32 BinCount    = 16;
+        Uint32 LeafSize    = MaxLeafSize; // max number of primitives per leaf, in range [1, MaxLeafSize]
+        Uint32 ThreadCount = 0;           // 0 - hardware concurrency
+        Uint32 TaskSize    = 4096;        // subtrees with more primitives are built by other threads
+    };
+
+    struct BuildStats
+    {
+        double BinaryBuildTime = 0.0; // seconds
+        double CollapseTime    = 0.0; // seconds
+        Uint32 BinaryNodeCount = 0;
+        Uint32 ThreadCount     = 0;
+    };
+
+    // Child slot is either empty, inner node or leaf with 1..MaxLeafSize primitives.
+    // Child box is Origin + Q * 2^Exponent for the lower and upper planes.
+    struct Node
+    {
+        float3 Origin;
+        Int8   Exponent[3] = {};
+        Uint8  InnerMask   = 0; // bit per slot, inner children are stored contiguously from ChildBase in slot order
+        Uint32 ChildBase   = 0; // index of the first inner child node
+        Uint32 PrimBase    = 0; // index in primitive indices of the first primitive in the leaf children
+        Uint8  Meta[Width] = {}; // leaf: primitive count in the high 3 bits, offset from PrimBase in the low 5 bits; 0 - empty slot
+        Uint8  QMin[3][Width] = {};
+        Uint8  QMax[3][Width] = {};
+
+        bool IsEmpty(Uint32 Slot) const { return !IsInner(Slot) && Meta[Slot] == 0; }
+        bool IsInner(Uint32 Slot) const { return (InnerMask >> Slot) & 1; }
+        bool IsLeaf(Uint32 Slot) const { return !IsInner(Slot) && Meta[Slot] != 0; }
+
+        Uint32 GetChildNode(Uint32 Slot) const { return ChildBase + PlatformMisc::CountOneBits(Uint32(InnerMask) & ((1u << Slot) - 1u)); }
+        Uint32 GetFirstPrim(Uint32 Slot) const { return PrimBase + (Meta[Slot] & 0x1F); }
+        Uint32 GetPrimCount(Uint32 Slot) const { return Meta[Slot] >> 5; }
+
+        // Scale is the same for all children, see GetScale().
+        AABB   GetChildBounds(Uint32 Slot, const float3& Scale) const;
+        AABB   GetChildBounds(Uint32 Slot) const { return GetChildBounds(Slot, GetScale()); }
+        float3 GetScale() const { return {std::ldexp(1.0f, Exponent[0]), std::ldexp(1.0f, Exponent[1]), std::ldexp(1.0f, Exponent[2])}; }
+    };
+    static_assert(sizeof(Node) == 80, "node must fit in 80 bytes");
+
+    bool Build(const AABB* pPrimBounds, Uint32 PrimCount, const BuildSettings& Settings);
+    bool Build(const AABB* pPrimBounds, Uint32 PrimCount) { return Build(pPrimBounds, PrimCount, BuildSettings{}); }
+
+    // Updates boxes for deformed primitives, topology is not changed, so the tree quality
+    // degrades with large deformations. Number and order of primitives must be the same as in Build().
+    void Refit(const AABB* pPrimBounds);
+
+    void Clear();
+
+    // Flat layout: header, nodes and primitive indices, native byte order.
+    void Serialize(std::vector<Uint8>& Data) const;
+    bool Deserialize(const void* pData, size_t Size);
+
+    bool Save(const char* FilePath) const;
+    bool Load(const char* FilePath);
+
+    // Expected cost of the random ray, normalized by the root area: traversal cost for each node
+    // and primitive test for each primitive in the leaves, weighted by the probability to hit the box.
+    float ComputeSAHCost(float TraversalCost = 1.0f) const;
+
+    bool        IsEmpty() const { return m_Nodes.empty(); }
+    const AABB& GetBounds() const { return m_Bounds; }
+    Uint32      GetNodeCount() const { return Uint32(m_Nodes.size()); }
+    Uint32      GetPrimCount() const { return Uint32(m_PrimIndices.size()); }
+    Uint32      GetMaxDepth() const;
+
+    const std::vector<Node>&   GetNodes() const { return m_Nodes; }
+    const std::vector<Uint32>& GetPrimIndices() const { return m_PrimIndices; }
+    const BuildStats&          GetBuildStats() const { return m_Stats; }
+
+    // Visits leaves that are intersected by the ray in front to back order of the child boxes.
+    // OnPrimitive(PrimIndex, TMax) returns the new TMax, leaves behind it are culled:
+    // return TMax to find all intersections, distance to the hit for the closest hit and value below TMin to stop the traversal.
+    template <typename PrimitiveHandler>
+    void TraverseRay(const float3& Origin, const float3& Dir, float TMin, float TMax, PrimitiveHandler&& OnPrimitive) const;
+
+    // Calls OnPrimitive(PrimIndex) for the primitives in the leaves that overlap the box.
+    template <typename PrimitiveHandler>
+    void QueryBox(const AABB& Box, PrimitiveHandler&& OnPrimitive) const;
+
+    static constexpr Uint32 StackSize = 1024; // enough for the tree depth limited by the builder
+
+private:
+    std::vector<Node>   m_Nodes;
+    std::vector<Uint32> m_PrimIndices;
+    AABB                m_Bounds;
+    BuildStats          m_Stats;
+};
+
+
+inline AABB BVH8::Node::GetChildBounds(Uint32 Slot, const float3& Scale) const
+{
+    return AABB{
+        Origin + float3{float(QMin[0][Slot]), float(QMin[1][Slot]), float(QMin[2][Slot])} * Scale,
+        Origin + float3{float(QMax[0][Slot]), float(QMax[1][Slot]), float(QMax[2][Slot])} * Scale};
+}
+
+template <typename PrimitiveHandler>
+void BVH8::TraverseRay(const float3& Origin, const float3& Dir, float TMin, float TMax, PrimitiveHandler&& OnPrimitive) const
+{
+    if (m_Nodes.empty())
+        return;
+
+    // PrimCount is 0 for inner node
+    struct Entry
+    {
+        Uint32 Index;
+        Uint32 PrimCount;
+        float  TNear;
+    };
+
+    const float3 InvDir{1.0f / Dir.x, 1.0f / Dir.y, 1.0f / Dir.z};
+
+    Entry  Stack[StackSize];
+    Uint32 Top   = 0;
+    Stack[Top++] = {0, 0, TMin};
+
+    while (Top > 0)
+    {
+        const Entry E = Stack[--Top];
+        if (E.TNear > TMax)
+            continue;
+
+        if (E.PrimCount > 0)
+        {
+            for (Uint32 p = 0; p < E.PrimCount; ++p)
+            {
+                TMax = OnPrimitive(m_PrimIndices[E.Index + p], TMax);
+                if (TMax < TMin)
+                    return;
+            }
+            continue;
+        }
+
+        const Node&  N     = m_Nodes[E.Index];
+        const float3 Scale = N.GetScale();
+
+        // hit children sorted from far to near
+        Entry  Hits[Width];
+        Uint32 HitCount = 0;
+        for (Uint32 s = 0; s < Width; ++s)
+        {
+            if (N.IsEmpty(s))
+                continue;
+
+            const AABB   Box  = N.GetChildBounds(s, Scale);
+            const float3 T0   = (Box.Min - Origin) * InvDir;
+            const float3 T1   = (Box.Max - Origin) * InvDir;
+            const float3 TLo  = std::min(T0, T1);
+            const float3 THi  = std::max(T0, T1);
+            const float  Near = std::max(std::max(TLo.x, TLo.y), std::max(TLo.z, TMin));
+            const float  Far  = std::min(std::min(THi.x, THi.y), std::min(THi.z, TMax));
+            if (!(Near <= Far))
+                continue;
+
+            const Entry Hit = N.IsInner(s) ? Entry{N.GetChildNode(s), 0, Near} : Entry{N.GetFirstPrim(s), N.GetPrimCount(s), Near};
+
+            Uint32 i = HitCount++;
+            for (; i > 0 && Hits[i - 1].TNear < Near; --i)
+                Hits[i] = Hits[i - 1];
+            Hits[i] = Hit;
+        }
+
+        VERIFY_EXPR(Top + HitCount <= StackSize);
+        for (Uint32 i = 0; i < HitCount; ++i)
+            Stack[Top++] = Hits[i];
+    }
+}
+
+template <typename PrimitiveHandler>
+void BVH8::QueryBox(const AABB& Box, PrimitiveHandler&& OnPrimitive) const
+{
+    if (m_Nodes.empty() || !m_Bounds.Overlaps(Box))
+        return;
+
+    Uint32 Stack[StackSize];
+    Uint32 Top   = 0;
+    Stack[Top++] = 0;
+
+    while (Top > 0)
+    {
+        const Node&  N     = m_Nodes[Stack[--Top]];
+        const float3 Scale = N.GetScale();
+        for (Uint32 s = 0; s < Width; ++s)
+        {
+            if (N.IsEmpty(s) || !N.GetChildBounds(s, Scale).Overlaps(Box))
+                continue;
+
+            if (N.IsInner(s))
+            {
+                VERIFY_EXPR(Top < StackSize);
+                Stack[Top++] = N.GetChildNode(s);
+                continue;
+            }
+
+            for (Uint32 p = 0, First = N.GetFirstPrim(s), Count = N.GetPrimCount(s); p < Count; ++p)
+                OnPrimitive(m_PrimIndices[First + p]);
+        }
+    }
+}
+
+} // namespace DE
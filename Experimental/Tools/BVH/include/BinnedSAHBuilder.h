@@ -0,0 +1,30 @@
+#pragma once
+
+#include "BVH8.h"
+
+namespace DE
+{
+
+// Intermediate binary tree that is collapsed to BVH8.
+struct BinaryBVH
+{
+    struct Node
+    {
+        AABB   Bounds;
+        Uint32 Left      = 0; // right child is Left + 1
+        Uint32 FirstPrim = 0; // in PrimIndices
+        Uint32 PrimCount = 0; // 0 for inner node
+    };
+
+    std::vector<Node>   Nodes; // root is the first node
+    std::vector<Uint32> PrimIndices;
+};
+
+// Top-down build with binned SAH on primitive centroids. Subtrees larger than Settings.TaskSize
+// are pushed to the task queue and built by the worker threads, nodes are allocated with atomic counter.
+// Left child contains primitives on the lower side of the split axis. Settings.LeafSize is not limited
+// by BVH8::MaxLeafSize, so the tree can be used by other node layouts too.
+// Returns number of threads that were used.
+Uint32 BuildBinaryBVH(const AABB* pPrimBounds, Uint32 PrimCount, const BVH8::BuildSettings& Settings, BinaryBVH& Tree);
+
+} // namespace DE
@@ -0,0 +1,371 @@
+#include "BVH8.h"
+#include "BinnedSAHBuilder.h"
+#include "FileWrapper.hpp"
+
+#include <chrono>
+#include <cstring>
+
+namespace DE
+{
+namespace
+{
+
+using Clock   = std::chrono::high_resolution_clock;
+using Seconds = std::chrono::duration<double>;
+
+struct FileHeader
+{
+    static constexpr Uint32 CurrentMagic   = 0x38485642; // 'BVH8'
+    static constexpr Uint32 CurrentVersion = 1;
+
+    Uint32 Magic     = CurrentMagic;
+    Uint32 Version   = CurrentVersion;
+    Uint32 NodeSize  = sizeof(BVH8::Node);
+    Uint32 NodeCount = 0;
+    Uint32 PrimCount = 0;
+    float3 BoundsMin;
+    float3 BoundsMax;
+};
+
+// Returns exponent of the smallest power of two step that covers [Min, Max] with 255 steps,
+// the check uses the same arithmetic as BVH8::Node::GetChildBounds().
+Int8 GetStepExponent(float Min, float Max)
+{
+    if (!(Max > Min))
+        return -126;
+
+    int Exp = clamp(int(std::ceil(std::log2((Max - Min) / 255.0f))), -126, 127);
+    while (Exp < 127 && Min + 255.0f * std::ldexp(1.0f, Exp) < Max)
+        ++Exp;
+    return Int8(Exp);
+}
+
+// Node box is the union of the child boxes, invalid box - empty slot.
+// Child boxes are rounded outwards, so the decoded box always contains the source box.
+void EncodeNode(BVH8::Node& N, const AABB (&ChildBounds)[BVH8::Width])
+{
+    AABB Bounds;
+    for (const auto& Box : ChildBounds)
+    {
+        if (Box.IsValid())
+            Bounds.Grow(Box);
+    }
+
+    N.Origin = Bounds.Min;
+    for (Uint32 a = 0; a < 3; ++a)
+        N.Exponent[a] = GetStepExponent(Bounds.Min[a], Bounds.Max[a]);
+
+    const float3 Step = N.GetScale();
+    for (Uint32 s = 0; s < BVH8::Width; ++s)
+    {
+        const AABB& Box = ChildBounds[s];
+        for (Uint32 a = 0; a < 3; ++a)
+        {
+            if (N.IsEmpty(s))
+            {
+                N.QMin[a][s] = 0;
+                N.QMax[a][s] = 0;
+                continue;
+            }
+
+            const float Origin = N.Origin[a];
+
+            int Lo = clamp(int(std::floor((Box.Min[a] - Origin) / Step[a])), 0, 255);
+            int Hi = clamp(int(std::ceil((Box.Max[a] - Origin) / Step[a])), 0, 255);
+
+            // subtraction is rounded, so the plane may be inside the box by one step
+            while (Lo > 0 && Origin + float(Lo) * Step[a] > Box.Min[a])
+                --Lo;
+            while (Hi < 255 && Origin + float(Hi) * Step[a] < Box.Max[a])
+                ++Hi;
+
+            N.QMin[a][s] = Uint8(Lo);
+            N.QMax[a][s] = Uint8(Hi);
+        }
+    }
+}
+
+// Breadth-first: the largest inner child is replaced by its children until the node has 8 slots,
+// so children of the wide node are stored contiguously after the parent.
+void CollapseTree(const BinaryBVH& Tree, std::vector<BVH8::Node>& Nodes, std::vector<Uint32>& PrimIndices)
+{
+    struct PendingNode
+    {
+        Uint32 Node;
+        Uint32 Source; // node in the binary tree
+    };
+    std::vector<PendingNode> Queue;
+    Queue.reserve(Tree.Nodes.size() / 4 + 1);
+    Queue.push_back({0, 0});
+
+    Nodes.resize(1);
+    PrimIndices.reserve(Tree.PrimIndices.size());
+
+    for (size_t q = 0; q < Queue.size(); ++q)
+    {
+        const PendingNode Pending = Queue[q];
+        const auto&       Source  = Tree.Nodes[Pending.Source];
+
+        // only the root may be a leaf
+        Uint32 Children[BVH8::Width];
+        Uint32 ChildCount = 0;
+        if (Source.PrimCount > 0)
+            Children[ChildCount++] = Pending.Source;
+        else
+        {
+            Children[ChildCount++] = Source.Left;
+            Children[ChildCount++] = Source.Left + 1;
+        }
+
+        while (ChildCount < BVH8::Width)
+        {
+            Uint32 Largest     = BVH8::Width;
+            float  LargestArea = -1.0f;
+            for (Uint32 c = 0; c < ChildCount; ++c)
+            {
+                const auto& Child = Tree.Nodes[Children[c]];
+                if (Child.PrimCount == 0 && Child.Bounds.HalfArea() > LargestArea)
+                {
+                    Largest     = c;
+                    LargestArea = Child.Bounds.HalfArea();
+                }
+            }
+            if (Largest == BVH8::Width)
+                break;
+
+            const Uint32 Left      = Tree.Nodes[Children[Largest]].Left;
+            Children[Largest]      = Left;
+            Children[ChildCount++] = Left + 1;
+        }
+
+        BVH8::Node N;
+        N.ChildBase = Uint32(Nodes.size());
+        N.PrimBase  = Uint32(PrimIndices.size());
+
+        AABB   ChildBounds[BVH8::Width];
+        Uint32 InnerCount = 0;
+        for (Uint32 c = 0; c < ChildCount; ++c)
+        {
+            const auto& Child = Tree.Nodes[Children[c]];
+            ChildBounds[c]    = Child.Bounds;
+
+            if (Child.PrimCount == 0)
+            {
+                N.InnerMask |= Uint8(1u << c);
+                Queue.push_back({N.ChildBase + InnerCount++, Children[c]});
+            }
+            else
+            {
+                N.Meta[c] = Uint8((Child.PrimCount << 5) | (Uint32(PrimIndices.size()) - N.PrimBase));
+                PrimIndices.insert(PrimIndices.end(), Tree.PrimIndices.begin() + Child.FirstPrim, Tree.PrimIndices.begin() + Child.FirstPrim + Child.PrimCount);
+            }
+        }
+
+        EncodeNode(N, ChildBounds);
+        Nodes[Pending.Node] = N;
+        Nodes.resize(Nodes.size() + InnerCount);
+    }
+}
+
+} // namespace
+
+
+bool BVH8::Build(const AABB* pPrimBounds, Uint32 PrimCount, const BuildSettings& Settings)
+{
+    Clear();
+    if (pPrimBounds == nullptr || PrimCount == 0)
+        return false;
+
+    const auto StartTime = Clock::now();
+
+    BuildSettings BinarySettings = Settings;
+    BinarySettings.LeafSize      = clamp(Settings.LeafSize, 1u, MaxLeafSize);
+
+    BinaryBVH Tree;
+    m_Stats.ThreadCount     = BuildBinaryBVH(pPrimBounds, PrimCount, BinarySettings, Tree);
+    m_Stats.BinaryNodeCount = Uint32(Tree.Nodes.size());
+
+    const auto CollapseTime = Clock::now();
+
+    CollapseTree(Tree, m_Nodes, m_PrimIndices);
+    m_Bounds = Tree.Nodes[0].Bounds;
+
+    const auto EndTime = Clock::now();
+
+    m_Stats.BinaryBuildTime = std::chrono::duration_cast<Seconds>(CollapseTime - StartTime).count();
+    m_Stats.CollapseTime    = std::chrono::duration_cast<Seconds>(EndTime - CollapseTime).count();
+    return true;
+}
+
+void BVH8::Refit(const AABB* pPrimBounds)
+{
+    if (m_Nodes.empty())
+        return;
+
+    // children are always after the parent, so the reverse order is bottom-up
+    std::vector<AABB> NodeBounds(m_Nodes.size());
+    for (size_t i = m_Nodes.size(); i-- > 0;)
+    {
+        Node& N = m_Nodes[i];
+
+        AABB ChildBounds[Width];
+        for (Uint32 s = 0; s < Width; ++s)
+        {
+            if (N.IsInner(s))
+                ChildBounds[s] = NodeBounds[N.GetChildNode(s)];
+            else if (N.IsLeaf(s))
+            {
+                for (Uint32 p = 0, First = N.GetFirstPrim(s), Count = N.GetPrimCount(s); p < Count; ++p)
+                    ChildBounds[s].Grow(pPrimBounds[m_PrimIndices[First + p]]);
+            }
+            else
+                continue;
+
+            NodeBounds[i].Grow(ChildBounds[s]);
+        }
+        EncodeNode(N, ChildBounds);
+    }
+    m_Bounds = NodeBounds[0];
+}
+
+void BVH8::Clear()
+{
+    m_Nodes.clear();
+    m_PrimIndices.clear();
+    m_Bounds = {};
+    m_Stats  = {};
+}
+
+void BVH8::Serialize(std::vector<Uint8>& Data) const
+{
+    FileHeader Header;
+    Header.NodeCount = GetNodeCount();
+    Header.PrimCount = GetPrimCount();
+    Header.BoundsMin = m_Bounds.Min;
+    Header.BoundsMax = m_Bounds.Max;
+
+    const size_t NodesSize = sizeof(Node) * m_Nodes.size();
+    const size_t PrimsSize = sizeof(Uint32) * m_PrimIndices.size();
+
+    Data.resize(sizeof(Header) + NodesSize + PrimsSize);
+    std::memcpy(Data.data(), &Header, sizeof(Header));
+    if (NodesSize > 0)
+        std::memcpy(Data.data() + sizeof(Header), m_Nodes.data(), NodesSize);
+    if (PrimsSize > 0)
+        std::memcpy(Data.data() + sizeof(Header) + NodesSize, m_PrimIndices.data(), PrimsSize);
+}
+
+bool BVH8::Deserialize(const void* pData, size_t Size)
+{
+    Clear();
+
+    FileHeader Header;
+    if (pData == nullptr || Size < sizeof(Header))
+        return false;
+
+    std::memcpy(&Header, pData, sizeof(Header));
+    if (Header.Magic != FileHeader::CurrentMagic ||
+        Header.Version != FileHeader::CurrentVersion ||
+        Header.NodeSize != sizeof(Node) ||
+        Size != sizeof(Header) + sizeof(Node) * size_t{Header.NodeCount} + sizeof(Uint32) * size_t{Header.PrimCount})
+        return false;
+
+    const auto* pBytes = static_cast<const Uint8*>(pData) + sizeof(Header);
+    m_Nodes.resize(Header.NodeCount);
+    m_PrimIndices.resize(Header.PrimCount);
+    if (Header.NodeCount > 0)
+        std::memcpy(m_Nodes.data(), pBytes, sizeof(Node) * m_Nodes.size());
+    if (Header.PrimCount > 0)
+        std::memcpy(m_PrimIndices.data(), pBytes + sizeof(Node) * m_Nodes.size(), sizeof(Uint32) * m_PrimIndices.size());
+
+    m_Bounds = AABB{Header.BoundsMin, Header.BoundsMax};
+    return true;
+}
+
+bool BVH8::Save(const char* FilePath) const
+{
+    FileWrapper File{FilePath, EFileAccessMode::Overwrite};
+    if (!File)
+    {
+        LOG_ERROR_MESSAGE("Failed to create BVH file '", FilePath, '\'');
+        return false;
+    }
+
+    std::vector<Uint8> Data;
+    Serialize(Data);
+
+    if (!File->Write(Data.data(), Data.size()))
+    {
+        LOG_ERROR_MESSAGE("Failed to write BVH file '", FilePath, '\'');
+        return false;
+    }
+    return true;
+}
+
+bool BVH8::Load(const char* FilePath)
+{
+    Clear();
+
+    FileWrapper File{FilePath, EFileAccessMode::Read};
+    if (!File)
+    {
+        LOG_ERROR_MESSAGE("Failed to open BVH file '", FilePath, '\'');
+        return false;
+    }
+
+    std::vector<Uint8> Data(File->GetSize());
+    if (Data.empty() || !File->Read(Data.data(), Data.size()) || !Deserialize(Data.data(), Data.size()))
+    {
+        LOG_ERROR_MESSAGE("BVH file '", FilePath, "' is invalid or has incompatible version");
+        return false;
+    }
+    return true;
+}
+
+float BVH8::ComputeSAHCost(float TraversalCost) const
+{
+    const float RootArea = m_Bounds.HalfArea();
+    if (m_Nodes.empty() || !(RootArea > 0.0f))
+        return 0.0f;
+
+    double Cost = 0.0;
+    for (const auto& N : m_Nodes)
+    {
+        const float3 Scale = N.GetScale();
+
+        AABB Bounds;
+        for (Uint32 s = 0; s < Width; ++s)
+        {
+            if (N.IsEmpty(s))
+                continue;
+
+            const AABB Box = N.GetChildBounds(s, Scale);
+            Bounds.Grow(Box);
+
+            if (N.IsLeaf(s))
+                Cost += double(N.GetPrimCount(s)) * Box.HalfArea();
+        }
+        Cost += double(TraversalCost) * Bounds.HalfArea();
+    }
+    return float(Cost / RootArea);
+}
+
+Uint32 BVH8::GetMaxDepth() const
+{
+    std::vector<Uint32> Depth(m_Nodes.size(), 1);
+
+    Uint32 MaxDepth = 0;
+    for (size_t i = 0; i < m_Nodes.size(); ++i)
+    {
+        const Node& N = m_Nodes[i];
+        for (Uint32 s = 0; s < Width; ++s)
+        {
+            if (N.IsInner(s))
+                Depth[N.GetChildNode(s)] = Depth[i] + 1;
+        }
+        MaxDepth = std::max(MaxDepth, Depth[i]);
+    }
+    return MaxDepth;
+}
+
+} // namespace DE
@@ -0,0 +1,265 @@
+#include "BinnedSAHBuilder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace DE
+{
+namespace
+{
+
+constexpr Uint32 MaxBinCount = 64;
+constexpr Uint32 MaxSAHDepth = 64; // deeper nodes are split at the median, so the tree depth is limited
+
+struct BuildTask
+{
+    Uint32 NodeIndex = 0;
+    Uint32 Begin     = 0;
+    Uint32 End       = 0;
+    Uint32 Depth     = 0;
+};
+
+// Workers take tasks until the queue is empty and there are no running tasks that may add new ones.
+class TaskQueue
+{
+public:
+    void Push(const BuildTask& Task)
+    {
+        {
+            std::lock_guard<std::mutex> Lock{m_Guard};
+            m_Tasks.push_back(Task);
+            ++m_Pending;
+        }
+        m_Condition.notify_one();
+    }
+
+    bool Pop(BuildTask& Task)
+    {
+        std::unique_lock<std::mutex> Lock{m_Guard};
+        m_Condition.wait(Lock, [this]() { return !m_Tasks.empty() || m_Pending == 0; });
+        if (m_Tasks.empty())
+            return false;
+
+        Task = m_Tasks.back();
+        m_Tasks.pop_back();
+        return true;
+    }
+
+    void Complete()
+    {
+        bool Finished;
+        {
+            std::lock_guard<std::mutex> Lock{m_Guard};
+            Finished = --m_Pending == 0;
+        }
+        if (Finished)
+            m_Condition.notify_all();
+    }
+
+private:
+    std::mutex              m_Guard;
+    std::condition_variable m_Condition;
+    std::vector<BuildTask>  m_Tasks;
+    Uint32                  m_Pending = 0; // queued and running tasks
+};
+
+struct BuildContext
+{
+    BuildContext(const AABB* _pPrimBounds, const BVH8::BuildSettings& _Settings, BinaryBVH& _Tree) :
+        pPrimBounds{_pPrimBounds}, Settings{_Settings}, Tree{_Tree}
+    {}
+
+    const AABB* const          pPrimBounds;
+    const BVH8::BuildSettings& Settings;
+    BinaryBVH&                 Tree;
+    std::vector<float3>        Centroids;
+    std::atomic<Uint32>        NodeCount{1};
+    TaskQueue                  Queue;
+
+    void   BuildNode(Uint32 NodeIndex, Uint32 Begin, Uint32 End, Uint32 Depth);
+    Uint32 SplitSAH(Uint32 Begin, Uint32 End, const AABB& CentroidBounds) const;
+};
+
+// Returns the end of the left half or Begin if centroids can't be separated by bins.
+Uint32 BuildContext::SplitSAH(Uint32 Begin, Uint32 End, const AABB& CentroidBounds) const
+{
+    struct Bin
+    {
+        AABB   Bounds;
+        Uint32 Count = 0;
+    };
+
+    const Uint32 BinCount = Settings.BinCount;
+    Uint32*      Indices  = Tree.PrimIndices.data();
+
+    float  BestCost  = FLT_MAX;
+    Uint32 BestAxis  = 0;
+    Uint32 BestSplit = 0;
+    float  BestScale = 0.0f;
+
+    for (Uint32 Axis = 0; Axis < 3; ++Axis)
+    {
+        const float Extent = CentroidBounds.Max[Axis] - CentroidBounds.Min[Axis];
+        if (!(Extent > 0.0f))
+            continue;
+
+        const float Scale = float(BinCount) / Extent;
+
+        Bin Bins[MaxBinCount];
+        for (Uint32 i = Begin; i < End; ++i)
+        {
+            const Uint32 PrimIndex = Indices[i];
+            const Uint32 BinIndex  = std::min(BinCount - 1, Uint32((Centroids[PrimIndex][Axis] - CentroidBounds.Min[Axis]) * Scale));
+            Bins[BinIndex].Bounds.Grow(pPrimBounds[PrimIndex]);
+            ++Bins[BinIndex].Count;
+        }
+
+        // cost of the right side for the split before each bin
+        float RightCost[MaxBinCount];
+        {
+            AABB   Bounds;
+            Uint32 Count = 0;
+            for (Uint32 b = BinCount - 1; b > 0; --b)
+            {
+                Bounds.Grow(Bins[b].Bounds);
+                Count += Bins[b].Count;
+                RightCost[b] = float(Count) * Bounds.HalfArea();
+            }
+        }
+
+        AABB   Bounds;
+        Uint32 Count = 0;
+        for (Uint32 b = 1; b < BinCount; ++b)
+        {
+            Bounds.Grow(Bins[b - 1].Bounds);
+            Count += Bins[b - 1].Count;
+
+            const float Cost = float(Count) * Bounds.HalfArea() + RightCost[b];
+            if (Count > 0 && Count < End - Begin && Cost < BestCost)
+            {
+                BestCost  = Cost;
+                BestAxis  = Axis;
+                BestSplit = b;
+                BestScale = Scale;
+            }
+        }
+    }
+
+    if (BestSplit == 0)
+        return Begin;
+
+    const float Min = CentroidBounds.Min[BestAxis];
+    return Uint32(std::partition(Indices + Begin, Indices + End,
+                                 [&](Uint32 PrimIndex) {
+                                     return std::min(BinCount - 1, Uint32((Centroids[PrimIndex][BestAxis] - Min) * BestScale)) < BestSplit;
+                                 }) -
+                  Indices);
+}
+
+void BuildContext::BuildNode(Uint32 NodeIndex, Uint32 Begin, Uint32 End, Uint32 Depth)
+{
+    Uint32* Indices = Tree.PrimIndices.data();
+
+    // left child is built by this or another thread, this thread continues with the right child
+    for (;;)
+    {
+        auto& Node = Tree.Nodes[NodeIndex];
+
+        AABB CentroidBounds;
+        for (Uint32 i = Begin; i < End; ++i)
+        {
+            Node.Bounds.Grow(pPrimBounds[Indices[i]]);
+            CentroidBounds.Grow(Centroids[Indices[i]]);
+        }
+
+        const Uint32 Count = End - Begin;
+        if (Count <= Settings.LeafSize)
+        {
+            Node.FirstPrim = Begin;
+            Node.PrimCount = Count;
+            return;
+        }
+
+        Uint32 Mid = Depth < MaxSAHDepth ? SplitSAH(Begin, End, CentroidBounds) : Begin;
+        if (Mid == Begin || Mid == End)
+        {
+            // all centroids are in the same bin or the tree is too deep
+            const float3 Extent = CentroidBounds.Max - CentroidBounds.Min;
+            const Uint32 Axis   = Extent.x > Extent.y ? (Extent.x > Extent.z ? 0 : 2) : (Extent.y > Extent.z ? 1 : 2);
+
+            Mid = Begin + Count / 2;
+            std::nth_element(Indices + Begin, Indices + Mid, Indices + End,
+                             [&](Uint32 Lhs, Uint32 Rhs) { return Centroids[Lhs][Axis] < Centroids[Rhs][Axis]; });
+        }
+
+        const Uint32 Left = NodeCount.fetch_add(2);
+        VERIFY_EXPR(Left + 1 < Tree.Nodes.size());
+
+        Node.Left = Left;
+        ++Depth;
+
+        if (Mid - Begin > Settings.TaskSize)
+            Queue.Push({Left, Begin, Mid, Depth});
+        else
+            BuildNode(Left, Begin, Mid, Depth);
+
+        NodeIndex = Left + 1;
+        Begin     = Mid;
+    }
+}
+
+} // namespace
+
+
+Uint32 BuildBinaryBVH(const AABB* pPrimBounds, Uint32 PrimCount, const BVH8::BuildSettings& Settings, BinaryBVH& Tree)
+{
+    VERIFY_EXPR(PrimCount > 0);
+
+    BVH8::BuildSettings BuildSettings = Settings;
+    BuildSettings.BinCount            = clamp(Settings.BinCount, 2u, MaxBinCount);
+    BuildSettings.LeafSize            = std::max(Settings.LeafSize, 1u);
+
+    // every split produces two non-empty children, so the tree can't have more than 2N-1 nodes
+    Tree.Nodes.clear();
+    Tree.Nodes.resize(PrimCount * 2 - 1);
+    Tree.PrimIndices.resize(PrimCount);
+    for (Uint32 i = 0; i < PrimCount; ++i)
+        Tree.PrimIndices[i] = i;
+
+    BuildContext Ctx{pPrimBounds, BuildSettings, Tree};
+
+    Ctx.Centroids.resize(PrimCount);
+    for (Uint32 i = 0; i < PrimCount; ++i)
+        Ctx.Centroids[i] = pPrimBounds[i].Center();
+
+    const Uint32 ThreadCount = std::min(Settings.ThreadCount > 0 ? Settings.ThreadCount : std::max(std::thread::hardware_concurrency(), 1u),
+                                        std::max(PrimCount / std::max(BuildSettings.TaskSize, 1u), 1u));
+
+    Ctx.Queue.Push({0, 0, PrimCount, 0});
+
+    const auto BuildTasks = [&Ctx]() {
+        BuildTask Task;
+        while (Ctx.Queue.Pop(Task))
+        {
+            Ctx.BuildNode(Task.NodeIndex, Task.Begin, Task.End, Task.Depth);
+            Ctx.Queue.Complete();
+        }
+    };
+
+    std::vector<std::thread> Workers;
+    for (Uint32 i = 1; i < ThreadCount; ++i)
+        Workers.emplace_back(BuildTasks);
+
+    BuildTasks();
+
+    for (auto& Worker : Workers)
+        Worker.join();
+
+    Tree.Nodes.resize(Ctx.NodeCount.load());
+    return ThreadCount;
+}
+
+} // namespace DE
@@ -1,8 +1,10 @@
 #include "ShaderDebugger.h"
+#include "SpvCompilerPool.h"
 
 #include "DataBlobImpl.hpp"
 #include "FileSystem.hpp"
 #include "Align.hpp"
+#include "HashUtils.hpp"
 
 #include "../include/VulkanUtilities/VulkanHeaders.h"
 #include "RenderDeviceVk.h"
@@ -11,6 +13,11 @@
 #include "spirv-tools/optimizer.hpp"
 #include "spirv-tools/libspirv.h"
 
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+
 #include <Windows.h>
 #undef CreateDirectory
 
@@ -250,7 +257,11 @@ ShaderDebugger::ShaderDebugInfo::ShaderDebugInfo(ShaderDebugInfo&& other) :
     ClockHeatmapShader{std::move(other.ClockHeatmapShader)},
     pDebugInfo{other.pDebugInfo},
     DebugShader{std::move(other.DebugShader)},
-    ProfileShader{std::move(other.ProfileShader)}
+    pProfiltInfo{other.pProfiltInfo},
+    ProfileShader{std::move(other.ProfileShader)},
+    Type{other.Type},
+    Source{std::move(other.Source)},
+    Macros{std::move(other.Macros)}
 {
     other.pDebugInfo   = nullptr;
     other.pProfiltInfo = nullptr;
@@ -269,6 +280,7 @@ ShaderDebugger::ShaderDebugger(const char* CompilerLib)
     if (CompilerLib == nullptr)
         CompilerLib = "SpvCompiler.dll";
 
+    m_SpvCompilerPath = CompilerLib;
     m_pSpvCompilerLib = ::LoadLibraryA(CompilerLib);
     if (m_pSpvCompilerLib)
     {
@@ -287,6 +299,11 @@ ShaderDebugger::ShaderDebugger(const char* CompilerLib)
 
 ShaderDebugger::~ShaderDebugger()
 {
+    m_pCompilerPool.reset();
+
+    if (m_CacheFilePath.size())
+        SaveShaderCache();
+
     if (m_pSpvCompilerLib)
     {
         for (auto& Sh : m_DbgShaders)
@@ -304,7 +321,7 @@ ShaderDebugger::~ShaderDebugger()
     }
 }
 
-bool ShaderDebugger::Initialize(IEngineFactory* pFactory, IRenderDevice* pDevice) noexcept
+bool ShaderDebugger::Initialize(IEngineFactory* pFactory, IRenderDevice* pDevice, const char* CacheFilePath) noexcept
 {
     if (pFactory == nullptr || pDevice == nullptr)
     {
@@ -337,6 +354,14 @@ bool ShaderDebugger::Initialize(IEngineFactory* pFactory, IRenderDevice* pDevice
         default: UNEXPECTED("unknown vulkan version");
     }
 
+    // used as shader cache key
+    {
+        const auto& Props = pRenderDeviceVk.RawPtr<RenderDeviceVkImpl>()->GetPhysicalDevice().GetProperties();
+        static_assert(sizeof(m_DeviceUUID) == VK_UUID_SIZE, "UUID size mismatch");
+        std::memcpy(m_DeviceUUID, Props.pipelineCacheUUID, sizeof(m_DeviceUUID));
+        m_DriverVersion = Props.driverVersion;
+    }
+
     // create fence
     {
         FenceDesc Desc;
@@ -346,6 +371,13 @@ bool ShaderDebugger::Initialize(IEngineFactory* pFactory, IRenderDevice* pDevice
 
     m_pEngineFactory = pFactory;
     m_pRenderDevice  = pDevice;
+
+    if (CacheFilePath != nullptr)
+    {
+        m_CacheFilePath = CacheFilePath;
+        m_CompilerHash  = ComputeCompilerHash();
+        LoadShaderCache();
+    }
     return true;
 }
 
@@ -409,6 +441,40 @@ bool ShaderDebugger::InitDebugOutput(ShaderDebugCallback_t&& CB) noexcept
     return true;
 }
 
+bool ShaderDebugger::InitTimings(DebugTimingCallback_t&& CB) noexcept
+{
+    if (m_pRenderDevice == nullptr)
+    {
+        LOG_ERROR_MESSAGE("Failed to initialize debugger timings");
+        return false;
+    }
+
+    if (m_pRenderDevice->GetDeviceCaps().Features.TimestampQueries != DEVICE_FEATURE_STATE_ENABLED)
+    {
+        LOG_ERROR_MESSAGE("Failed to initialize debugger timings: timestamp queries are not enabled");
+        return false;
+    }
+
+    m_TimingCallback = std::move(CB);
+    return true;
+}
+
+bool ShaderDebugger::InitCompilerWorkers(const char* WorkerPath, Uint32 WorkerCount) noexcept
+{
+    if (m_pSpvCompilerLib == nullptr)
+    {
+        LOG_ERROR_MESSAGE("Failed to initialize compiler workers: compiler is not loaded");
+        return false;
+    }
+
+    std::unique_ptr<SpvCompilerPool> pPool{new SpvCompilerPool{}};
+    if (!pPool->Initialize(WorkerPath, m_SpvCompilerPath.c_str(), WorkerCount))
+        return false;
+
+    m_pCompilerPool = std::move(pPool);
+    return true;
+}
+
 void ShaderDebugger::CompileFromFile(IShader** ppShader, SHADER_TYPE Type, const char* pFilePath, const char* pName, const ShaderMacro* pMacro, EShaderDebugMode Mode) noexcept
 {
     if (!m_pRenderDevice)
@@ -542,8 +608,8 @@ bool ShaderDebugger::CreatePipeline(const GraphicsPipelineStateCreateInfo& PSOCr
         switch (Mode)
         {
             // clang-format off
-            case EShaderDebugMode::Trace:        pShader = Iter->second.DebugShader;        traces.emplace_back(Iter->second.Name.c_str(), Iter->second.pDebugInfo);   break;
-            case EShaderDebugMode::Profiling:    pShader = Iter->second.ProfileShader;      traces.emplace_back(Iter->second.Name.c_str(), Iter->second.pProfiltInfo); break;
+            case EShaderDebugMode::Trace:        pShader = Iter->second.DebugShader;        traces.emplace_back(Iter->second.Name.c_str(), GetDebugInfo(Iter->second, EShaderDebugMode::Trace));   break;
+            case EShaderDebugMode::Profiling:    pShader = Iter->second.ProfileShader;      traces.emplace_back(Iter->second.Name.c_str(), GetDebugInfo(Iter->second, EShaderDebugMode::Profiling)); break;
             case EShaderDebugMode::ClockHeatmap: pShader = Iter->second.ClockHeatmapShader; break;
                 // clang-format on
         }
@@ -635,8 +701,8 @@ bool ShaderDebugger::CreatePipeline(const ComputePipelineStateCreateInfo& PSOCre
         switch (Mode)
         {
             // clang-format off
-            case EShaderDebugMode::Trace:        CreateInfo.pCS = Iter->second.DebugShader;        traces.emplace_back(Iter->second.Name.c_str(), Iter->second.pDebugInfo);   break;
-            case EShaderDebugMode::Profiling:    CreateInfo.pCS = Iter->second.ProfileShader;      traces.emplace_back(Iter->second.Name.c_str(), Iter->second.pProfiltInfo); break;
+            case EShaderDebugMode::Trace:        CreateInfo.pCS = Iter->second.DebugShader;        traces.emplace_back(Iter->second.Name.c_str(), GetDebugInfo(Iter->second, EShaderDebugMode::Trace));   break;
+            case EShaderDebugMode::Profiling:    CreateInfo.pCS = Iter->second.ProfileShader;      traces.emplace_back(Iter->second.Name.c_str(), GetDebugInfo(Iter->second, EShaderDebugMode::Profiling)); break;
             case EShaderDebugMode::ClockHeatmap: CreateInfo.pCS = Iter->second.ClockHeatmapShader; break;
                 // clang-format on
         }
@@ -699,8 +765,8 @@ bool ShaderDebugger::CreatePipeline(const RayTracingPipelineStateCreateInfo& PSO
         switch (Mode)
         {
             // clang-format off
-            case EShaderDebugMode::Trace:        pShader = Iter->second.DebugShader;        traces.emplace_back(Iter->second.Name.c_str(), Iter->second.pDebugInfo);   break;
-            case EShaderDebugMode::Profiling:    pShader = Iter->second.ProfileShader;      traces.emplace_back(Iter->second.Name.c_str(), Iter->second.pProfiltInfo); break;
+            case EShaderDebugMode::Trace:        pShader = Iter->second.DebugShader;        traces.emplace_back(Iter->second.Name.c_str(), GetDebugInfo(Iter->second, EShaderDebugMode::Trace));   break;
+            case EShaderDebugMode::Profiling:    pShader = Iter->second.ProfileShader;      traces.emplace_back(Iter->second.Name.c_str(), GetDebugInfo(Iter->second, EShaderDebugMode::Profiling)); break;
             case EShaderDebugMode::ClockHeatmap: pShader = Iter->second.ClockHeatmapShader; break;
                 // clang-format on
         }
@@ -852,26 +918,38 @@ bool ShaderDebugger::BeginDebugging(IDeviceContext* pContext, IPipelineState*& p
     m_DbgModes.push_back(std::move(DbgMode));
 
     pPipeline = iter->second.DebugPipeline;
+
+    BeginTimestamp(pContext, EDebugPass::Instrumented);
     return true;
 }
 
 void ShaderDebugger::EndTrace(IDeviceContext* pContext) noexcept
 {
+    EndTimestamp(pContext, EDebugPass::Instrumented);
+
     if (m_StorageBuffers.empty())
+    {
+        SubmitTimings(pContext);
         return;
+    }
 
     // copy to staging buffer
+    BeginTimestamp(pContext, EDebugPass::Readback);
     for (auto& SB : m_StorageBuffers)
     {
         pContext->CopyBuffer(SB.pStorageBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
                              SB.pReadbackBuffer, 0, SB.pReadbackBuffer->GetDesc().uiSizeInBytes, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     }
+    EndTimestamp(pContext, EDebugPass::Readback);
+    SubmitTimings(pContext);
 
     pContext->SignalFence(m_pFence, ++m_FenceValue);
 }
 
 void ShaderDebugger::ReadTrace(IDeviceContext* pContext) noexcept
 {
+    ReadTimings();
+
     if (m_DbgModes.empty())
         return;
 
@@ -901,6 +979,9 @@ void ShaderDebugger::ParseDebugOutput(IDeviceContext* pContext, DebugMode& DbgMo
         std::vector<const char*> TempStrings;
         for (auto& Info : DbgMode.Traces)
         {
+            if (Info.Compiled == nullptr)
+                continue;
+
             ShaderTraceResult* pResult = nullptr;
             if (m_CompilerFn.ParseShaderTrace(Info.Compiled, pMapped, DbgMode.pStorageView->GetDesc().ByteWidth, &pResult))
             {
@@ -1094,6 +1175,8 @@ bool ShaderDebugger::BeginClockHeatmap(IDeviceContext* pContext, IPipelineState*
     m_DbgModes.push_back(std::move(DbgMode));
 
     pPipeline = iter->second.DebugPipeline;
+
+    BeginTimestamp(pContext, EDebugPass::Instrumented);
     return true;
 }
 
@@ -1129,8 +1212,11 @@ bool ShaderDebugger::EndClockHeatmap(IDeviceContext* pContext, ITextureView* pRT
     if (pLineStorageView == nullptr)
         return false;
 
+    EndTimestamp(pContext, EDebugPass::Instrumented);
+
     // pass 1
     {
+        BeginTimestamp(pContext, EDebugPass::HeatmapPass1);
         pContext->SetPipelineState(m_pHeatmapPass1);
         m_pHeatSRB1->GetVariableByName(SHADER_TYPE_COMPUTE, "un_Heatmap")->Set(DbgMode.pStorageView);
         m_pHeatSRB1->GetVariableByName(SHADER_TYPE_COMPUTE, "un_MaxValues")->Set(pLineStorageView);
@@ -1139,10 +1225,13 @@ bool ShaderDebugger::EndClockHeatmap(IDeviceContext* pContext, ITextureView* pRT
         DispatchComputeAttribs Attribs;
         Attribs.ThreadGroupCountX = (Dim.x + m_HeatmapPass1LocalSize - 1) / m_HeatmapPass1LocalSize;
         pContext->DispatchCompute(Attribs);
+
+        EndTimestamp(pContext, EDebugPass::HeatmapPass1);
     }
 
     // pass 2
     {
+        BeginTimestamp(pContext, EDebugPass::HeatmapPass2);
         pContext->SetPipelineState(m_pHeatmapPass2);
         m_pHeatSRB2->GetVariableByName(SHADER_TYPE_COMPUTE, "un_Heatmap")->Set(DbgMode.pStorageView);
         m_pHeatSRB2->GetVariableByName(SHADER_TYPE_COMPUTE, "un_MaxValues")->Set(pLineStorageView);
@@ -1151,6 +1240,8 @@ bool ShaderDebugger::EndClockHeatmap(IDeviceContext* pContext, ITextureView* pRT
         DispatchComputeAttribs Attribs;
         Attribs.ThreadGroupCountX = 1;
         pContext->DispatchCompute(Attribs);
+
+        EndTimestamp(pContext, EDebugPass::HeatmapPass2);
     }
 
     // pass 3
@@ -1161,6 +1252,8 @@ bool ShaderDebugger::EndClockHeatmap(IDeviceContext* pContext, ITextureView* pRT
         if (pPSO == nullptr || m_pHeatSRB3 == nullptr)
             return false;
 
+        BeginTimestamp(pContext, EDebugPass::HeatmapPass3);
+
         pContext->SetRenderTargets(1, &pRTV, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
         pContext->SetPipelineState(pPSO);
@@ -1172,12 +1265,152 @@ bool ShaderDebugger::EndClockHeatmap(IDeviceContext* pContext, ITextureView* pRT
         pContext->Draw(Attribs);
 
         pContext->SetRenderTargets(0, nullptr, nullptr, RESOURCE_STATE_TRANSITION_MODE_NONE);
+
+        EndTimestamp(pContext, EDebugPass::HeatmapPass3);
     }
 
     m_DbgModes.pop_back();
     return true;
 }
 
+RefCntAutoPtr<IQuery> ShaderDebugger::AllocTimestampQuery()
+{
+    if (m_FreeQueries.size())
+    {
+        auto pQuery = std::move(m_FreeQueries.back());
+        m_FreeQueries.pop_back();
+        return pQuery;
+    }
+
+    QueryDesc Desc;
+    Desc.Name = "Debugger timestamp";
+    Desc.Type = QUERY_TYPE_TIMESTAMP;
+
+    RefCntAutoPtr<IQuery> pQuery;
+    m_pRenderDevice->CreateQuery(Desc, &pQuery);
+    VERIFY_EXPR(pQuery != nullptr);
+
+    return pQuery;
+}
+
+void ShaderDebugger::BeginTimestamp(IDeviceContext* pContext, EDebugPass Pass)
+{
+    if (!m_TimingCallback)
+        return;
+
+    TimestampScope Scope;
+    Scope.Pass   = Pass;
+    Scope.pBegin = AllocTimestampQuery();
+
+    if (Scope.pBegin == nullptr)
+        return;
+
+    pContext->EndQuery(Scope.pBegin);
+    m_CurTimestamps.push_back(std::move(Scope));
+}
+
+void ShaderDebugger::EndTimestamp(IDeviceContext* pContext, EDebugPass Pass)
+{
+    // find the last opened scope for this pass
+    for (auto iter = m_CurTimestamps.rbegin(); iter != m_CurTimestamps.rend(); ++iter)
+    {
+        if (iter->Pass != Pass)
+            continue;
+
+        if (iter->pEnd != nullptr)
+            return;
+
+        iter->pEnd = AllocTimestampQuery();
+        if (iter->pEnd != nullptr)
+            pContext->EndQuery(iter->pEnd);
+        return;
+    }
+}
+
+void ShaderDebugger::SubmitTimings(IDeviceContext* pContext)
+{
+    if (m_CurTimestamps.empty())
+        return;
+
+    pContext->SignalFence(m_pFence, ++m_FenceValue);
+
+    PendingTimestamps Frame;
+    Frame.Scopes     = std::move(m_CurTimestamps);
+    Frame.FenceValue = m_FenceValue;
+    m_PendingTimestamps.push_back(std::move(Frame));
+    m_CurTimestamps.clear();
+
+    // don't report the oldest frames if GPU is too far behind,
+    // their queries are still in use and are recycled when the fence is signaled
+    for (size_t i = MaxPendingTimings; i < m_PendingTimestamps.size(); ++i)
+        m_PendingTimestamps[m_PendingTimestamps.size() - 1 - i].Dropped = true;
+}
+
+void ShaderDebugger::ReadTimings()
+{
+    if (m_PendingTimestamps.empty())
+        return;
+
+    const Uint64 CompletedValue = m_pFence->GetCompletedValue();
+
+    while (m_PendingTimestamps.size())
+    {
+        auto& Frame = m_PendingTimestamps.front();
+
+        // GPU has not finished the frame yet, try again in the next frame
+        if (Frame.FenceValue > CompletedValue)
+            return;
+
+        DebugPassTimings Timings;
+        bool             Ready = !Frame.Dropped;
+
+        for (auto& Scope : Frame.Scopes)
+        {
+            // timings are not reported or scope was not closed
+            if (!Ready || Scope.pEnd == nullptr)
+                continue;
+
+            QueryDataTimestamp Begin;
+            QueryDataTimestamp End;
+
+            if (!Scope.pBegin->GetData(&Begin, sizeof(Begin), false) ||
+                !Scope.pEnd->GetData(&End, sizeof(End), false))
+            {
+                Ready = false;
+                continue;
+            }
+
+            const Uint64 Ticks = End.Counter > Begin.Counter ? End.Counter - Begin.Counter : 0;
+            auto&        Dur   = Timings[Scope.Pass];
+
+            Dur = std::max(Dur, 0.0) + double(Ticks) * 1000.0 / double(std::max<Uint64>(End.Frequency, 1));
+        }
+
+        // the fence is signaled, so GPU no longer uses these queries
+        ReleaseTimestamps(Frame.Scopes);
+        m_PendingTimestamps.pop_front();
+
+        if (Ready && m_TimingCallback)
+            m_TimingCallback(Timings);
+    }
+}
+
+void ShaderDebugger::ReleaseTimestamps(TimestampScopes_t& Scopes)
+{
+    for (auto& Scope : Scopes)
+    {
+        for (auto* pQuery : {&Scope.pBegin, &Scope.pEnd})
+        {
+            if (*pQuery == nullptr)
+                continue;
+
+            (*pQuery)->Invalidate();
+            m_FreeQueries.push_back(std::move(*pQuery));
+        }
+    }
+    Scopes.clear();
+}
+
 void ShaderDebugger::CreateClockHeatmapPipelines()
 {
     // pass 1
@@ -1425,6 +1658,144 @@ SPV_COMP_DEBUG_MODE ConvertDebugMode(EShaderDebugMode Mode)
     return SPV_COMP_DEBUG_MODE(~0u);
 }
 
+using IncludedFiles_t = std::unordered_map<String, String>;
+
+bool ReadSourceFile(IShaderSourceInputStreamFactory* pFactory, const char* pFilePath, String& Source)
+{
+    RefCntAutoPtr<IFileStream> pSourceStream;
+    pFactory->CreateInputStream(pFilePath, &pSourceStream);
+
+    if (pSourceStream == nullptr)
+        return false;
+
+    RefCntAutoPtr<DataBlobImpl> pFileData{MakeNewRCObj<DataBlobImpl>{}(0)};
+    pSourceStream->ReadBlob(pFileData);
+
+    Source.assign(static_cast<const char*>(pFileData->GetDataPtr()), pFileData->GetSize());
+    return true;
+}
+
+// Returns the first character of the line that is not a whitespace or comment, InComment is the block comment state.
+size_t FindLineStart(const String& Source, size_t Pos, size_t LineEnd, bool& InComment)
+{
+    size_t First = LineEnd;
+    for (size_t i = Pos; i < LineEnd; ++i)
+    {
+        if (InComment)
+        {
+            if (Source.compare(i, 2, "*/") == 0)
+            {
+                InComment = false;
+                ++i;
+            }
+            continue;
+        }
+        if (Source.compare(i, 2, "//") == 0)
+            break;
+        if (Source.compare(i, 2, "/*") == 0)
+        {
+            InComment = true;
+            ++i;
+            continue;
+        }
+        if (First == LineEnd && Source[i] != ' ' && Source[i] != '\t' && Source[i] != '\r' && Source[i] != '\n')
+            First = i;
+    }
+    return First;
+}
+
+// Replaces '#include "file"' and '#include <file>' directives by the file content, directives in comments are skipped.
+// Inactive branches are not evaluated, so includes in conditional blocks that can not be loaded are left to the compiler.
+// '#line' directives keep line numbers in compiler messages, file names are written only if NamedLines is set,
+// glslang accepts them only with GL_GOOGLE_include_directive or GL_GOOGLE_cpp_style_line_directive.
+bool ExpandIncludes(IShaderSourceInputStreamFactory* pFactory, const char* pFilePath, const String& Source, IncludedFiles_t& Included, String& Result, Uint32 Depth, bool NamedLines)
+{
+    static constexpr Uint32 MaxIncludeDepth = 32;
+
+    if (Depth > MaxIncludeDepth)
+    {
+        LOG_ERROR_MESSAGE("Shader '", pFilePath, "' error: include depth exceeds ", MaxIncludeDepth);
+        return false;
+    }
+
+    const auto LineDirective = [NamedLines](Uint32 Line, const String& File) {
+        return "#line " + std::to_string(Line) + (NamedLines ? " \"" + File + "\"\n" : String{"\n"});
+    };
+
+    bool   InComment   = false;
+    Uint32 BranchDepth = 0;
+    Uint32 Line        = 1;
+    for (size_t Pos = 0; Pos < Source.size(); ++Line)
+    {
+        size_t LineEnd = Source.find('\n', Pos);
+        LineEnd        = (LineEnd == String::npos ? Source.size() : LineEnd + 1);
+
+        const size_t First = FindLineStart(Source, Pos, LineEnd, InComment);
+        if (First >= LineEnd || Source[First] != '#')
+        {
+            Result.append(Source, Pos, LineEnd - Pos);
+            Pos = LineEnd;
+            continue;
+        }
+
+        const size_t DirBegin  = Source.find_first_not_of(" \t", First + 1);
+        const size_t DirEnd    = std::min(Source.find_first_not_of("abcdefghijklmnopqrstuvwxyz", DirBegin), LineEnd);
+        const String Directive = DirBegin < DirEnd ? Source.substr(DirBegin, DirEnd - DirBegin) : String{};
+
+        if (Directive == "if" || Directive == "ifdef" || Directive == "ifndef")
+            ++BranchDepth;
+        else if (Directive == "endif" && BranchDepth > 0)
+            --BranchDepth;
+
+        const size_t NameBegin = Directive == "include" ? Source.find_first_of("\"<", DirEnd) : String::npos;
+        const size_t NameEnd   = NameBegin < LineEnd ? Source.find(Source[NameBegin] == '<' ? '>' : '"', NameBegin + 1) : String::npos;
+
+        if (NameEnd >= LineEnd)
+        {
+            Result.append(Source, Pos, LineEnd - Pos);
+            Pos = LineEnd;
+            continue;
+        }
+
+        const String Name = Source.substr(NameBegin + 1, NameEnd - NameBegin - 1);
+
+        auto Iter = Included.find(Name);
+        if (Iter == Included.end())
+        {
+            String Content;
+            if (!ReadSourceFile(pFactory, Name.c_str(), Content))
+            {
+                if (BranchDepth > 0)
+                {
+                    // the branch may be inactive, the compiler reports the error otherwise
+                    Result.append(Source, Pos, LineEnd - Pos);
+                    Pos = LineEnd;
+                    continue;
+                }
+                LOG_ERROR_MESSAGE("Shader '", pFilePath, "' error: failed to load included file '", Name, '\'');
+                return false;
+            }
+            Iter = Included.emplace(Name, std::move(Content)).first;
+        }
+
+        Result += LineDirective(1, Name);
+        if (!ExpandIncludes(pFactory, Name.c_str(), Iter->second, Included, Result, Depth + 1, NamedLines))
+            return false;
+        Result += "\n" + LineDirective(Line + 1, pFilePath);
+
+        Pos = LineEnd;
+    }
+    return true;
+}
+
+bool ExpandIncludes(IShaderSourceInputStreamFactory* pFactory, const char* pFilePath, const String& Source, IncludedFiles_t& Included, String& Result)
+{
+    const bool NamedLines = Source.find("GL_GOOGLE_include_directive") != String::npos ||
+        Source.find("GL_GOOGLE_cpp_style_line_directive") != String::npos;
+
+    return ExpandIncludes(pFactory, pFilePath, Source, Included, Result, 0, NamedLines);
+}
+
 String DebugModeToString(EShaderDebugMode Mode)
 {
     switch (Mode)
@@ -1440,6 +1811,78 @@ String DebugModeToString(EShaderDebugMode Mode)
     return " (unknown)";
 }
 
+// FNV-1a, unlike std::hash the result is the same between application runs
+class StableHasher
+{
+public:
+    void Update(const void* pData, size_t Size)
+    {
+        const auto* pBytes = static_cast<const Uint8*>(pData);
+        for (size_t i = 0; i < Size; ++i)
+        {
+            m_Hash ^= pBytes[i];
+            m_Hash *= 0x100000001b3ull;
+        }
+    }
+
+    template <typename T>
+    void Update(const T& Value)
+    {
+        Update(&Value, sizeof(Value));
+    }
+
+    void UpdateStr(const char* pStr, size_t Len)
+    {
+        Update(Len);
+        Update(pStr, Len);
+    }
+
+    Uint64 Get() const { return m_Hash; }
+
+private:
+    Uint64 m_Hash = 0xcbf29ce484222325ull;
+};
+
+// Source must be passed with expanded includes, otherwise changes in included files are not detected.
+Uint64 ComputeShaderCacheKey(const ShaderParams& Params, const String& ExpandedSource)
+{
+    StableHasher Hasher;
+    Hasher.UpdateStr(ExpandedSource.c_str(), ExpandedSource.size());
+    Hasher.UpdateStr(Params.defines, strlen(Params.defines));
+    Hasher.UpdateStr(Params.entryName, strlen(Params.entryName));
+    Hasher.Update(Params.shaderType);
+    Hasher.Update(Params.version);
+    Hasher.Update(Params.mode);
+    Hasher.Update(Params.optimization);
+    Hasher.Update(Params.autoMapBindings);
+    Hasher.Update(Params.autoMapLocations);
+    Hasher.Update(Params.debugDescriptorSetIndex);
+    Hasher.Update(Params.includeDirsCount);
+    for (Uint32 i = 0; i < Params.includeDirsCount; ++i)
+        Hasher.UpdateStr(Params.includeDirs[i], strlen(Params.includeDirs[i]));
+    return Hasher.Get();
+}
+
+struct ShaderCacheHeader
+{
+    static constexpr Uint32 MagicNumber    = 0x48434453; // 'SDCH'
+    static constexpr Uint32 CurrentVersion = 2;
+
+    Uint32 Magic          = MagicNumber;
+    Uint32 Version        = CurrentVersion;
+    Uint8  DeviceUUID[16] = {};
+    Uint32 DriverVersion  = 0;
+    Uint32 EntryCount     = 0;
+    Uint64 CompilerHash   = 0;
+};
+
+struct ShaderCacheFileEntry
+{
+    Uint64 Key       = 0;
+    Uint32 SpirvSize = 0; // in bytes
+    Uint32 Reserved  = 0;
+};
+
 } // namespace
 
 
@@ -1451,7 +1894,8 @@ bool ShaderDebugger::CreateShader(SHADER_TYPE           Type,
                                   const ShaderMacro*    pMacros,
                                   SPV_COMP_OPTIMIZATION OptMode,
                                   CompiledShader**      ppDbgInfo,
-                                  IShader**             ppShader)
+                                  IShader**             ppShader,
+                                  bool                  AllowCache)
 {
     if (ppDbgInfo != nullptr)
         *ppDbgInfo = nullptr;
@@ -1494,6 +1938,81 @@ bool ShaderDebugger::CreateShader(SHADER_TYPE           Type,
     Params.autoMapLocations        = false;
     Params.debugDescriptorSetIndex = 0;
 
+    String Name = pName;
+    Name += DebugModeToString(DbgMode);
+
+    const auto CreateFromSpirv = [&](const Uint32* pSpirv, Uint32 SpirvSize) //
+    {
+        ShaderCreateInfo ShaderCI;
+        ShaderCI.UseCombinedTextureSamplers = true;
+        ShaderCI.Desc.ShaderType            = Type;
+        ShaderCI.Desc.Name                  = Name.c_str();
+        ShaderCI.SourceLanguage             = SHADER_SOURCE_LANGUAGE_DEFAULT;
+        ShaderCI.ByteCode                   = pSpirv;
+        ShaderCI.ByteCodeSize               = SpirvSize;
+        m_pRenderDevice->CreateShader(ShaderCI, ppShader);
+    };
+
+    // on cache hit the debug info is not returned, it is compiled when the trace is parsed, see GetDebugInfo()
+    bool   UseCache = (AllowCache && m_CacheFilePath.size());
+    Uint64 CacheKey = 0;
+
+    if (UseCache)
+    {
+        // includes are resolved the same way as by the compiler: relative to the working directory
+        RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
+        m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
+
+        String          Expanded;
+        IncludedFiles_t Included;
+        UseCache = ExpandIncludes(pShaderSourceFactory, pName, String{pSource, SourceLen}, Included, Expanded);
+        CacheKey = UseCache ? ComputeShaderCacheKey(Params, Expanded) : 0;
+    }
+
+    if (UseCache)
+    {
+        std::vector<Uint32> Spirv;
+        {
+            std::lock_guard<std::mutex> Lock{m_CacheGuard};
+
+            auto iter = m_ShaderCache.find(CacheKey);
+            if (iter != m_ShaderCache.end())
+            {
+                iter->second.Used = true;
+                Spirv             = iter->second.Spirv;
+                ++m_CacheStats.Hits;
+            }
+            else
+                ++m_CacheStats.Misses;
+        }
+
+        if (Spirv.size())
+        {
+            CreateFromSpirv(Spirv.data(), Uint32(Spirv.size() * sizeof(Uint32)));
+            return (*ppShader != nullptr);
+        }
+    }
+
+    const auto CreateAndCache = [&](const Uint32* pSpirv, Uint32 SpirvSize) //
+    {
+        CreateFromSpirv(pSpirv, SpirvSize);
+
+        if (UseCache && *ppShader != nullptr)
+            AddToShaderCache(CacheKey, pSpirv, SpirvSize);
+    };
+
+    // debug info must be kept in this process to parse the trace
+    if (ppDbgInfo == nullptr && m_pCompilerPool)
+    {
+        const auto Result = m_pCompilerPool->Compile(Params, pName, CreateAndCache);
+        if (Result != SpvCompilerPool::ECompileResult::WorkerError)
+            return (Result == SpvCompilerPool::ECompileResult::Succeeded && *ppShader != nullptr);
+
+        // fallback to in-process compilation
+    }
+
+    std::lock_guard<std::mutex> Lock{m_CompilerGuard};
+
     if (!m_CompilerFn.Compile(&Params, &compiled))
     {
         if (compiled)
@@ -1520,18 +2039,7 @@ bool ShaderDebugger::CreateShader(SHADER_TYPE           Type,
         return false;
     }
 
-    ShaderCreateInfo ShaderCI;
-    ShaderCI.UseCombinedTextureSamplers = true;
-
-    String Name = pName;
-    Name += DebugModeToString(DbgMode);
-
-    ShaderCI.Desc.ShaderType = Type;
-    ShaderCI.Desc.Name       = Name.c_str();
-    ShaderCI.SourceLanguage  = SHADER_SOURCE_LANGUAGE_DEFAULT;
-    ShaderCI.ByteCode        = pSpirv;
-    ShaderCI.ByteCodeSize    = SpirvSize;
-    m_pRenderDevice->CreateShader(ShaderCI, ppShader);
+    CreateAndCache(pSpirv, SpirvSize);
 
     if (ppDbgInfo != nullptr && *ppShader != nullptr)
     {
@@ -1545,6 +2053,269 @@ bool ShaderDebugger::CreateShader(SHADER_TYPE           Type,
     return (*ppShader != nullptr);
 }
 
+// SpvCompiler has no version query, the library binary is hashed to detect glslang updates.
+Uint64 ShaderDebugger::ComputeCompilerHash() const
+{
+    char Path[MAX_PATH] = {};
+    if (m_pSpvCompilerLib == nullptr || ::GetModuleFileNameA(HMODULE(m_pSpvCompilerLib), Path, _countof(Path)) == 0)
+        return 0;
+
+    std::vector<Uint8> Data;
+    try
+    {
+        CFile File{FileOpenAttribs{Path, EFileAccessMode::Read}};
+
+        Data.resize(File.GetSize());
+        CHECK_THROW(File.Read(Data.data(), Data.size()));
+    }
+    catch (...)
+    {
+        LOG_WARNING_MESSAGE("Failed to read shader compiler '", Path, "', compiler updates will not invalidate the shader cache");
+        return 0;
+    }
+
+    StableHasher Hasher;
+    Hasher.Update(Data.data(), Data.size());
+    return Hasher.Get();
+}
+
+bool ShaderDebugger::LoadShaderCache()
+{
+    if (!FileSystem::PathExists(m_CacheFilePath.c_str()))
+        return false;
+
+    std::vector<Uint8> Data;
+    try
+    {
+        CFile File{FileOpenAttribs{m_CacheFilePath.c_str(), EFileAccessMode::Read}};
+
+        Data.resize(File.GetSize());
+        CHECK_THROW(File.Read(Data.data(), Data.size()));
+    }
+    catch (...)
+    {
+        LOG_ERROR_MESSAGE("Failed to read shader cache '", m_CacheFilePath, '\'');
+        return false;
+    }
+
+    ShaderCacheHeader Header;
+    if (Data.size() < sizeof(Header))
+    {
+        LOG_ERROR_MESSAGE("Shader cache '", m_CacheFilePath, "' is corrupted");
+        return false;
+    }
+    std::memcpy(&Header, Data.data(), sizeof(Header));
+
+    if (Header.Magic != ShaderCacheHeader::MagicNumber || Header.Version != ShaderCacheHeader::CurrentVersion)
+    {
+        LOG_INFO_MESSAGE("Shader cache '", m_CacheFilePath, "' has incompatible format and will be rebuilt");
+        return false;
+    }
+
+    if (std::memcmp(Header.DeviceUUID, m_DeviceUUID, sizeof(m_DeviceUUID)) != 0 || Header.DriverVersion != m_DriverVersion || Header.CompilerHash != m_CompilerHash)
+    {
+        LOG_INFO_MESSAGE("Shader cache '", m_CacheFilePath, "' was created for another device, driver or compiler and will be rebuilt");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> Lock{m_CacheGuard};
+
+    size_t Offset = sizeof(Header);
+    for (Uint32 i = 0; i < Header.EntryCount; ++i)
+    {
+        ShaderCacheFileEntry Entry;
+        if (Offset + sizeof(Entry) > Data.size())
+            break;
+
+        std::memcpy(&Entry, Data.data() + Offset, sizeof(Entry));
+        Offset += sizeof(Entry);
+
+        if (Entry.SpirvSize % sizeof(Uint32) != 0 || Offset + Entry.SpirvSize > Data.size())
+            break;
+
+        auto& Spirv = m_ShaderCache[Entry.Key].Spirv;
+        Spirv.resize(Entry.SpirvSize / sizeof(Uint32));
+        std::memcpy(Spirv.data(), Data.data() + Offset, Entry.SpirvSize);
+        Offset += Entry.SpirvSize;
+    }
+
+    if (m_ShaderCache.size() != Header.EntryCount)
+    {
+        LOG_ERROR_MESSAGE("Shader cache '", m_CacheFilePath, "' is corrupted");
+        m_ShaderCache.clear();
+        return false;
+    }
+
+    LOG_INFO_MESSAGE("Loaded ", m_ShaderCache.size(), " shaders from cache '", m_CacheFilePath, '\'');
+    return true;
+}
+
+bool ShaderDebugger::SaveShaderCache() noexcept
+{
+    std::lock_guard<std::mutex> Lock{m_CacheGuard};
+
+    if (m_CacheFilePath.empty())
+    {
+        LOG_ERROR_MESSAGE("Failed to save shader cache: cache file is not specified");
+        return false;
+    }
+
+    if (!m_CacheChanged)
+        return true;
+
+    // remove shaders that were not used in this session
+    for (auto iter = m_ShaderCache.begin(); iter != m_ShaderCache.end();)
+    {
+        if (iter->second.Used)
+            ++iter;
+        else
+            iter = m_ShaderCache.erase(iter);
+    }
+
+    ShaderCacheHeader Header;
+    std::memcpy(Header.DeviceUUID, m_DeviceUUID, sizeof(m_DeviceUUID));
+    Header.DriverVersion = m_DriverVersion;
+    Header.EntryCount    = Uint32(m_ShaderCache.size());
+    Header.CompilerHash  = m_CompilerHash;
+
+    try
+    {
+        CFile File{FileOpenAttribs{m_CacheFilePath.c_str(), EFileAccessMode::Overwrite}};
+
+        CHECK_THROW(File.Write(&Header, sizeof(Header)));
+
+        for (auto& Item : m_ShaderCache)
+        {
+            ShaderCacheFileEntry Entry;
+            Entry.Key       = Item.first;
+            Entry.SpirvSize = Uint32(Item.second.Spirv.size() * sizeof(Uint32));
+
+            CHECK_THROW(File.Write(&Entry, sizeof(Entry)));
+            CHECK_THROW(File.Write(Item.second.Spirv.data(), Entry.SpirvSize));
+        }
+    }
+    catch (...)
+    {
+        LOG_ERROR_MESSAGE("Failed to write shader cache '", m_CacheFilePath, '\'');
+        return false;
+    }
+
+    m_CacheChanged = false;
+    return true;
+}
+
+void ShaderDebugger::AddToShaderCache(Uint64 Key, const Uint32* pSpirv, Uint32 SpirvSize)
+{
+    std::lock_guard<std::mutex> Lock{m_CacheGuard};
+
+    auto& Entry = m_ShaderCache[Key];
+    Entry.Spirv.assign(pSpirv, pSpirv + SpirvSize / sizeof(Uint32));
+    Entry.Used     = true;
+    m_CacheChanged = true;
+}
+
+ShaderCacheStats ShaderDebugger::GetShaderCacheStats() const noexcept
+{
+    std::lock_guard<std::mutex> Lock{m_CacheGuard};
+    return m_CacheStats;
+}
+
+bool ShaderDebugger::CompileShaderVariants(SHADER_TYPE        Type,
+                                           const char*        pSource,
+                                           Uint32             SourceLen,
+                                           const char*        pName,
+                                           const ShaderMacro* pMacro,
+                                           EShaderDebugMode   Mode,
+                                           ShaderDebugInfo&   DbgInfo,
+                                           IShader**          ppShader)
+{
+    if (!CreateShader(Type, pSource, SourceLen, pName, EShaderDebugMode::None, pMacro, SPV_COMP_OPTIMIZATION_NONE, nullptr, ppShader))
+        return false;
+
+    if (Mode == EShaderDebugMode::None)
+        return true;
+
+    // check features
+    const auto& Caps = m_pRenderDevice->GetDeviceCaps();
+    switch (Type)
+    {
+        case SHADER_TYPE_VERTEX:
+        case SHADER_TYPE_GEOMETRY:
+        case SHADER_TYPE_HULL:
+        case SHADER_TYPE_DOMAIN:
+            if (Caps.Features.VertexPipelineUAVWritesAndAtomics != DEVICE_FEATURE_STATE_ENABLED)
+                return true; // can't write trace
+            break;
+        case SHADER_TYPE_PIXEL:
+            if (Caps.Features.PixelUAVWritesAndAtomics != DEVICE_FEATURE_STATE_ENABLED)
+                return true; // can't write trace
+            break;
+    }
+
+    DbgInfo.Origin = *ppShader;
+    DbgInfo.Name   = pName;
+
+    // validate name
+    for (auto& c : DbgInfo.Name)
+    {
+        if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_')
+            continue;
+
+        c = '_';
+    }
+
+    if (!!(Mode & EShaderDebugMode::Trace))
+        if (CreateShader(Type, pSource, SourceLen, pName, EShaderDebugMode::Trace, pMacro, SPV_COMP_OPTIMIZATION_NONE, &DbgInfo.pDebugInfo, &DbgInfo.DebugShader))
+            DbgInfo.Mode = DbgInfo.Mode | EShaderDebugMode::Trace;
+
+    const bool TraceFromCache = !!(DbgInfo.Mode & EShaderDebugMode::Trace) && DbgInfo.pDebugInfo == nullptr;
+
+    if (Caps.Features.ShaderClock == DEVICE_FEATURE_STATE_ENABLED)
+    {
+        if (!!(Mode & EShaderDebugMode::Profiling))
+            if (CreateShader(Type, pSource, SourceLen, pName, EShaderDebugMode::Profiling, pMacro, SPV_COMP_OPTIMIZATION_NONE, &DbgInfo.pProfiltInfo, &DbgInfo.ProfileShader))
+                DbgInfo.Mode = DbgInfo.Mode | EShaderDebugMode::Profiling;
+
+        if (!!(Mode & EShaderDebugMode::ClockHeatmap))
+            if (CreateShader(Type, pSource, SourceLen, pName, EShaderDebugMode::ClockHeatmap, pMacro, SPV_COMP_OPTIMIZATION_NONE, nullptr, &DbgInfo.ClockHeatmapShader))
+                DbgInfo.Mode = DbgInfo.Mode | EShaderDebugMode::ClockHeatmap;
+    }
+
+    // source is kept to compile the debug info of the cached variants
+    const bool ProfileFromCache = !!(DbgInfo.Mode & EShaderDebugMode::Profiling) && DbgInfo.pProfiltInfo == nullptr;
+    if (TraceFromCache || ProfileFromCache)
+    {
+        DbgInfo.Type = Type;
+        DbgInfo.Source.assign(pSource, SourceLen);
+        if (pMacro != nullptr)
+        {
+            for (; pMacro->Name != nullptr && pMacro->Definition != nullptr; ++pMacro)
+                DbgInfo.Macros.emplace_back(pMacro->Name, pMacro->Definition);
+        }
+    }
+    return true;
+}
+
+// The compiler output does not depend on the process, so the debug info matches the cached SPIR-V.
+CompiledShader* ShaderDebugger::GetDebugInfo(ShaderDebugInfo& Info, EShaderDebugMode Mode)
+{
+    auto& pDbgInfo = (Mode == EShaderDebugMode::Trace ? Info.pDebugInfo : Info.pProfiltInfo);
+    if (pDbgInfo != nullptr || Info.Source.empty())
+        return pDbgInfo;
+
+    std::vector<ShaderMacro> Macros;
+    Macros.reserve(Info.Macros.size() + 1);
+    for (auto& Macro : Info.Macros)
+        Macros.push_back({Macro.first.c_str(), Macro.second.c_str()});
+    Macros.push_back({nullptr, nullptr});
+
+    RefCntAutoPtr<IShader> pShader;
+    if (!CreateShader(Info.Type, Info.Source.c_str(), Uint32(Info.Source.size()), Info.Name.c_str(), Mode, Macros.data(), SPV_COMP_OPTIMIZATION_NONE, &pDbgInfo, &pShader, false))
+        LOG_ERROR_MESSAGE("Shader '", Info.Name, "' error: failed to compile debug info, trace will not be parsed");
+
+    return pDbgInfo;
+}
+
 void ShaderDebugger::CompileFromSource(IShader** ppShader, SHADER_TYPE Type, const char* pSource, Uint32 SourceLen, const char* pName, const ShaderMacro* pMacro, EShaderDebugMode Mode) noexcept
 {
     if (!m_pRenderDevice)
@@ -1553,59 +2324,146 @@ void ShaderDebugger::CompileFromSource(IShader** ppShader, SHADER_TYPE Type, con
     if (SourceLen == 0)
         SourceLen = Uint32(strlen(pSource));
 
-    if (!CreateShader(Type, pSource, SourceLen, pName, EShaderDebugMode::None, pMacro, SPV_COMP_OPTIMIZATION_NONE, nullptr, ppShader))
+    ShaderDebugInfo DbgInfo;
+    if (!CompileShaderVariants(Type, pSource, SourceLen, pName, pMacro, Mode, DbgInfo, ppShader))
         return;
 
-    if (Mode != EShaderDebugMode::None && *ppShader != nullptr)
+    if (!!DbgInfo.Mode)
+        m_DbgShaders.emplace(static_cast<const void*>(*ppShader), std::move(DbgInfo));
+}
+
+size_t ShaderDebugger::ComputeMacroHash(const ShaderMacro* pMacros) noexcept
+{
+    size_t Hash = 0;
+    if (pMacros != nullptr)
     {
-        // check features
-        const auto& Caps = m_pRenderDevice->GetDeviceCaps();
-        switch (Type)
+        for (auto* pMacro = pMacros; pMacro->Name != nullptr && pMacro->Definition != nullptr; ++pMacro)
         {
-            case SHADER_TYPE_VERTEX:
-            case SHADER_TYPE_GEOMETRY:
-            case SHADER_TYPE_HULL:
-            case SHADER_TYPE_DOMAIN:
-                if (Caps.Features.VertexPipelineUAVWritesAndAtomics != DEVICE_FEATURE_STATE_ENABLED)
-                    return; // can't write trace
-                break;
-            case SHADER_TYPE_PIXEL:
-                if (Caps.Features.PixelUAVWritesAndAtomics != DEVICE_FEATURE_STATE_ENABLED)
-                    return; // can't write trace
-                break;
+            HashCombine(Hash, CStringHash<Char>{}(pMacro->Name));
+            HashCombine(Hash, CStringHash<Char>{}(pMacro->Definition));
         }
+    }
+    return Hash;
+}
 
-        ShaderDebugInfo DbgInfo;
-        DbgInfo.Origin = *ppShader;
-        DbgInfo.Name   = pName;
+void ShaderDebugger::CompilePermutationsFromSource(ShaderPermutations_t&     Permutations,
+                                                   SHADER_TYPE               Type,
+                                                   const char*               pSource,
+                                                   Uint32                    SourceLen,
+                                                   const char*               pName,
+                                                   const ShaderMacro* const* ppMacros,
+                                                   Uint32                    MacroSetCount,
+                                                   EShaderDebugMode          Mode) noexcept
+{
+    if (!m_pRenderDevice)
+    {
+        LOG_ERROR_MESSAGE("Shader debugger is not initialized");
+        return;
+    }
 
-        // validate name
-        for (auto& c : DbgInfo.Name)
-        {
-            if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_')
-                continue;
+    if (SourceLen == 0)
+        SourceLen = Uint32(strlen(pSource));
 
-            c = '_';
-        }
+    struct Permutation
+    {
+        size_t                 Hash    = 0;
+        const ShaderMacro*     pMacros = nullptr;
+        RefCntAutoPtr<IShader> pShader;
+        ShaderDebugInfo        DbgInfo;
+    };
 
-        if (!!(Mode & EShaderDebugMode::Trace))
-            if (CreateShader(Type, pSource, SourceLen, pName, EShaderDebugMode::Trace, pMacro, SPV_COMP_OPTIMIZATION_NONE, &DbgInfo.pDebugInfo, &DbgInfo.DebugShader))
-                DbgInfo.Mode = DbgInfo.Mode | EShaderDebugMode::Trace;
+    std::vector<Permutation> Jobs;
+    Jobs.reserve(MacroSetCount);
 
-        if (Caps.Features.ShaderClock == DEVICE_FEATURE_STATE_ENABLED)
-        {
-            if (!!(Mode & EShaderDebugMode::Profiling))
-                if (CreateShader(Type, pSource, SourceLen, pName, EShaderDebugMode::Profiling, pMacro, SPV_COMP_OPTIMIZATION_NONE, &DbgInfo.pProfiltInfo, &DbgInfo.ProfileShader))
-                    DbgInfo.Mode = DbgInfo.Mode | EShaderDebugMode::Profiling;
+    for (Uint32 i = 0; i < MacroSetCount; ++i)
+    {
+        const size_t Hash = ComputeMacroHash(ppMacros[i]);
+
+        if (Permutations.count(Hash) ||
+            std::find_if(Jobs.begin(), Jobs.end(), [Hash](const Permutation& Job) { return Job.Hash == Hash; }) != Jobs.end())
+            continue;
+
+        Jobs.emplace_back();
+        Jobs.back().Hash    = Hash;
+        Jobs.back().pMacros = ppMacros[i];
+    }
 
-            if (!!(Mode & EShaderDebugMode::ClockHeatmap))
-                if (CreateShader(Type, pSource, SourceLen, pName, EShaderDebugMode::ClockHeatmap, pMacro, SPV_COMP_OPTIMIZATION_NONE, nullptr, &DbgInfo.ClockHeatmapShader))
-                    DbgInfo.Mode = DbgInfo.Mode | EShaderDebugMode::ClockHeatmap;
+    if (Jobs.empty())
+        return;
+
+    // In-process compiler calls are serialized by m_CompilerGuard, so threads are used only with the compiler workers,
+    // debug variants are still compiled in-process one by one. Debug info is registered after all threads are finished.
+    std::atomic<Uint32> NextJob{0};
+    const auto          Worker = [&]() //
+    {
+        for (Uint32 i = NextJob++; i < Jobs.size(); i = NextJob++)
+        {
+            auto& Job = Jobs[i];
+            CompileShaderVariants(Type, pSource, SourceLen, pName, Job.pMacros, Mode, Job.DbgInfo, &Job.pShader);
         }
+    };
+
+    const Uint32             ThreadCount = m_pCompilerPool ? std::min(std::max(1u, m_pCompilerPool->GetWorkerCount()), Uint32(Jobs.size())) : 1u;
+    std::vector<std::thread> Threads;
+    Threads.reserve(ThreadCount);
+
+    for (Uint32 i = 1; i < ThreadCount; ++i)
+        Threads.emplace_back(Worker);
+
+    Worker();
+
+    for (auto& Thread : Threads)
+        Thread.join();
+
+    for (auto& Job : Jobs)
+    {
+        if (Job.pShader == nullptr)
+            continue;
+
+        if (!!Job.DbgInfo.Mode)
+            m_DbgShaders.emplace(static_cast<const void*>(Job.pShader.RawPtr()), std::move(Job.DbgInfo));
+
+        Permutations.emplace(Job.Hash, std::move(Job.pShader));
+    }
+}
+
+void ShaderDebugger::CompilePermutationsFromFile(ShaderPermutations_t&     Permutations,
+                                                 SHADER_TYPE               Type,
+                                                 const char*               pFilePath,
+                                                 const char*               pName,
+                                                 const ShaderMacro* const* ppMacros,
+                                                 Uint32                    MacroSetCount,
+                                                 EShaderDebugMode          Mode) noexcept
+{
+    if (!m_pRenderDevice)
+    {
+        LOG_ERROR_MESSAGE("Shader debugger is not initialized");
+        return;
+    }
 
-        if (!!DbgInfo.Mode)
-            m_DbgShaders.emplace(static_cast<const void*>(*ppShader), std::move(DbgInfo));
+    RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
+    m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
+
+    // source file and all included files are loaded once for all permutations
+    String          Source;
+    String          Expanded;
+    IncludedFiles_t Included;
+    if (!ReadSourceFile(pShaderSourceFactory, pFilePath, Source))
+    {
+        LOG_ERROR_MESSAGE("Failed to load shader source file '", pFilePath, '\'');
+        return;
     }
+
+    if (!ExpandIncludes(pShaderSourceFactory, pFilePath, Source, Included, Expanded))
+    {
+        LOG_WARNING_MESSAGE("Includes of '", pFilePath, "' are resolved by the compiler for each permutation");
+        Expanded = std::move(Source);
+    }
+
+    if (pName == nullptr)
+        pName = pFilePath;
+
+    CompilePermutationsFromSource(Permutations, Type, Expanded.c_str(), Uint32(Expanded.size()), pName, ppMacros, MacroSetCount, Mode);
 }
 
 } // namespace DE
@@ -2,6 +2,9 @@
 
 #include <unordered_map>
 #include <functional>
+#include <deque>
+#include <memory>
+#include <mutex>
 
 #include "EngineFactory.h"
 #include "RenderDevice.h"
@@ -16,6 +19,7 @@ namespace DE
 using namespace Diligent;
 
 class SharedSRB;
+class SpvCompilerPool;
 
 enum class EShaderDebugMode : Uint32
 {
@@ -87,19 +91,82 @@ public:
 using ShaderDebugCallback_t = std::function<void(const char* shaderName, const std::vector<const char*>& output)>;
 
 
+enum class EDebugPass : Uint32
+{
+    Instrumented, // draw, dispatch or trace rays with debug pipeline
+    HeatmapPass1,
+    HeatmapPass2,
+    HeatmapPass3,
+    Readback, // copy trace to staging buffer
+    Count
+};
+
+// GPU time in milliseconds, negative if pass was not executed in this frame
+struct DebugPassTimings
+{
+    double Duration[Uint32(EDebugPass::Count)];
+
+    DebugPassTimings()
+    {
+        for (auto& Dur : Duration)
+            Dur = -1.0;
+    }
+
+    double  operator[](EDebugPass Pass) const { return Duration[Uint32(Pass)]; }
+    double& operator[](EDebugPass Pass) { return Duration[Uint32(Pass)]; }
+};
+
+using DebugTimingCallback_t = std::function<void(const DebugPassTimings& timings)>;
+
+struct ShaderCacheStats
+{
+    Uint32 Hits   = 0;
+    Uint32 Misses = 0;
+};
+
+// key is a hash of macro set, see ShaderDebugger::ComputeMacroHash()
+using ShaderPermutations_t = std::unordered_map<size_t, RefCntAutoPtr<IShader>>;
+
+
 class ShaderDebugger
 {
 public:
     explicit ShaderDebugger(const char* CompilerLib);
     ~ShaderDebugger();
 
-    bool Initialize(IEngineFactory* pFactory, IRenderDevice* pDevice) noexcept;
+    // Shaders and their debug variants are stored in the cache file, cache is invalidated
+    // when device UUID, driver version or compiler library changes. Entries are keyed
+    // by the source with expanded includes, so editing an included file misses the cache.
+    // Compiler debug info can not be serialized, for the cached debug variants it is compiled on the first use.
+    bool Initialize(IEngineFactory* pFactory, IRenderDevice* pDevice, const char* CacheFilePath = nullptr) noexcept;
+    bool SaveShaderCache() noexcept; // also called in destructor
+
+    ShaderCacheStats GetShaderCacheStats() const noexcept;
+
     bool InitDebugOutput(const char* Folder) noexcept;
     bool InitDebugOutput(ShaderDebugCallback_t&& CB) noexcept;
 
+    // Measures GPU time of debugger passes with timestamp queries,
+    // results are returned from ReadTrace() a few frames later.
+    bool InitTimings(DebugTimingCallback_t&& CB) noexcept;
+
+    // Shaders without debug info are compiled in separate processes,
+    // WorkerCount = 0 means one worker per hardware thread.
+    // Workers are available only on Win32, on failure shaders are compiled in-process.
+    bool InitCompilerWorkers(const char* WorkerPath, Uint32 WorkerCount = 0) noexcept;
+
     void CompileFromSource(IShader** ppShader, SHADER_TYPE Type, const char* pSource, Uint32 SourceLen, const char* pName, const ShaderMacro* pMacro = nullptr, EShaderDebugMode Mode = EShaderDebugMode::None) noexcept;
     void CompileFromFile(IShader** ppShader, SHADER_TYPE Type, const char* pFilePath, const char* pName, const ShaderMacro* pMacro = nullptr, EShaderDebugMode Mode = EShaderDebugMode::None) noexcept;
 
+    // Compiles one shader with different macro sets, includes are loaded once for all permutations.
+    // Shaders are compiled in parallel only by the compiler workers, see InitCompilerWorkers(). The in-process
+    // compiler is not thread-safe, without workers and for the debug variants permutations are compiled one by one.
+    // Permutations that already exist in the table are skipped.
+    void CompilePermutationsFromSource(ShaderPermutations_t& Permutations, SHADER_TYPE Type, const char* pSource, Uint32 SourceLen, const char* pName, const ShaderMacro* const* ppMacros, Uint32 MacroSetCount, EShaderDebugMode Mode = EShaderDebugMode::None) noexcept;
+    void CompilePermutationsFromFile(ShaderPermutations_t& Permutations, SHADER_TYPE Type, const char* pFilePath, const char* pName, const ShaderMacro* const* ppMacros, Uint32 MacroSetCount, EShaderDebugMode Mode = EShaderDebugMode::None) noexcept;
+
+    static size_t ComputeMacroHash(const ShaderMacro* pMacro) noexcept;
+
     bool CreatePipeline(const GraphicsPipelineStateCreateInfo& PSOCreateInfo, IPipelineState** ppPipeline) noexcept;
     bool CreatePipeline(const ComputePipelineStateCreateInfo& PSOCreateInfo, IPipelineState** ppPipeline) noexcept;
     bool CreatePipeline(const RayTracingPipelineStateCreateInfo& PSOCreateInfo, IPipelineState** ppPipeline) noexcept;
@@ -144,6 +211,11 @@ private:
         CompiledShader*        pProfiltInfo = nullptr;
         RefCntAutoPtr<IShader> ProfileShader;
 
+        // set if the debug variants are created from the shader cache, see GetDebugInfo()
+        SHADER_TYPE                            Type = SHADER_TYPE_UNKNOWN;
+        String                                 Source;
+        std::vector<std::pair<String, String>> Macros;
+
         ShaderDebugInfo() {}
         ShaderDebugInfo(ShaderDebugInfo&&);
         ~ShaderDebugInfo();
@@ -208,7 +280,32 @@ private:
         Uint32                 Capacity = 0;
     };
 
+    struct TimestampScope
+    {
+        EDebugPass            Pass = EDebugPass::Count;
+        RefCntAutoPtr<IQuery> pBegin;
+        RefCntAutoPtr<IQuery> pEnd;
+    };
+
+    using TimestampScopes_t = std::vector<TimestampScope>;
+
+    struct PendingTimestamps
+    {
+        TimestampScopes_t Scopes;
+        Uint64            FenceValue = 0;     // queries are reused only after the fence has reached this value
+        bool              Dropped    = false; // GPU was too far behind, timings are not reported
+    };
+
+    struct ShaderCacheEntry
+    {
+        std::vector<Uint32> Spirv;
+        bool                Used = false; // unused entries are removed when cache is saved
+    };
+
+    using ShaderCache_t = std::unordered_map<Uint64, ShaderCacheEntry>;
+
     static constexpr Uint32 DefaultBufferSize = 8u << 20;
+    static constexpr Uint32 MaxPendingTimings = 8; // frames
 
     using DebugShaders_t       = std::unordered_map<const void*, ShaderDebugInfo>;
     using DebugPipelines_t     = std::unordered_map<PipelineKey, PipelineDebugInfo, PipelineKeyHash>;
@@ -226,15 +323,39 @@ private:
                       const ShaderMacro*    pMacro,
                       SPV_COMP_OPTIMIZATION OptMode,
                       CompiledShader**      ppDbgInfo,
-                      IShader**             ppShader);
+                      IShader**             ppShader,
+                      bool                  AllowCache = true);
+
+    bool CompileShaderVariants(SHADER_TYPE        Type,
+                               const char*        pSource,
+                               Uint32             SourceLen,
+                               const char*        pName,
+                               const ShaderMacro* pMacro,
+                               EShaderDebugMode   Mode,
+                               ShaderDebugInfo&   DbgInfo,
+                               IShader**          ppShader);
+
+    CompiledShader* GetDebugInfo(ShaderDebugInfo& Info, EShaderDebugMode Mode);
 
     bool AllocBuffer(IDeviceContext* pContext, DebugMode& Dbg, Uint32 Size);
 
     bool BeginDebugging(IDeviceContext* pContext, IPipelineState*& pPipeline, const uint4& Header, SHADER_TYPE Stages, EShaderDebugMode Mode);
     void ParseDebugOutput(IDeviceContext* pContext, DebugMode& DbgMode) const;
 
+    bool   LoadShaderCache();
+    Uint64 ComputeCompilerHash() const;
+    void   AddToShaderCache(Uint64 Key, const Uint32* pSpirv, Uint32 SpirvSize);
+
     void DefaultShaderDebugCallback(const char* Name, const std::vector<const char*>& Output) const;
 
+    RefCntAutoPtr<IQuery> AllocTimestampQuery();
+
+    void BeginTimestamp(IDeviceContext* pContext, EDebugPass Pass);
+    void EndTimestamp(IDeviceContext* pContext, EDebugPass Pass);
+    void SubmitTimings(IDeviceContext* pContext);
+    void ReadTimings();
+    void ReleaseTimestamps(TimestampScopes_t& Scopes);
+
     void CreateClockHeatmapPipelines() noexcept(false);
     void GetClockHeatmapPipeline(TEXTURE_FORMAT Format, IPipelineState*& pPipeline) noexcept;
 
@@ -254,6 +375,11 @@ private:
     DebugModes_t          m_DbgModes;
     Uint32                m_BufferAlign = 256; // min align for storage buffer
 
+    DebugTimingCallback_t              m_TimingCallback;
+    TimestampScopes_t                  m_CurTimestamps;     // scopes recorded in the current frame
+    std::deque<PendingTimestamps>      m_PendingTimestamps; // submitted frames, waiting for GPU
+    std::vector<RefCntAutoPtr<IQuery>> m_FreeQueries;
+
     RefCntAutoPtr<IPipelineState>         m_pHeatmapPass1;
     RefCntAutoPtr<IPipelineState>         m_pHeatmapPass2;
     HeatmapPipelineMap_t                  m_pHeatmapPass3;
@@ -263,8 +389,21 @@ private:
     static constexpr Uint32               m_HeatmapPass1LocalSize = 32;
 
     void*            m_pSpvCompilerLib;
+    String           m_SpvCompilerPath;
     SpvCompilerFn    m_CompilerFn  = {};
     SPV_COMP_VERSION m_CompilerVer = SPV_COMP_VERSION_VULKAN_1_0;
+    std::mutex       m_CompilerGuard; // compiler library is not guaranteed to be thread-safe
+
+    std::unique_ptr<SpvCompilerPool> m_pCompilerPool;
+
+    String             m_CacheFilePath;
+    Uint8              m_DeviceUUID[16] = {}; // VkPhysicalDeviceProperties::pipelineCacheUUID
+    Uint32             m_DriverVersion  = 0;
+    Uint64             m_CompilerHash   = 0; // hash of the compiler library
+    ShaderCache_t      m_ShaderCache;
+    ShaderCacheStats   m_CacheStats;
+    bool               m_CacheChanged = false;
+    mutable std::mutex m_CacheGuard;
 };
 
 
@@ -0,0 +1,367 @@
+#include "SpvCompilerPool.h"
+#include "SpvCompilerProtocol.h"
+
+#include "DebugUtilities.hpp"
+
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+
+#if PLATFORM_WIN32
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <Windows.h>
+#endif
+
+namespace DE
+{
+namespace
+{
+namespace Protocol = SpvCompilerProtocol;
+
+#if PLATFORM_WIN32
+bool WriteAll(void* hPipe, const void* pData, Uint32 Size)
+{
+    const auto* pBytes = static_cast<const char*>(pData);
+    while (Size > 0)
+    {
+        DWORD Written = 0;
+        if (!::WriteFile(HANDLE(hPipe), pBytes, Size, &Written, nullptr) || Written == 0)
+            return false;
+
+        pBytes += Written;
+        Size -= Written;
+    }
+    return true;
+}
+
+bool ReadAll(void* hPipe, void* pData, Uint32 Size)
+{
+    auto* pBytes = static_cast<char*>(pData);
+    while (Size > 0)
+    {
+        DWORD Read = 0;
+        if (!::ReadFile(HANDLE(hPipe), pBytes, Size, &Read, nullptr) || Read == 0)
+            return false;
+
+        pBytes += Read;
+        Size -= Read;
+    }
+    return true;
+}
+
+void CloseHandleSafe(void*& Handle)
+{
+    if (Handle != nullptr && Handle != INVALID_HANDLE_VALUE)
+        ::CloseHandle(HANDLE(Handle));
+    Handle = nullptr;
+}
+
+#else
+
+// Worker processes are implemented only for Win32, where SpvCompiler is available as a DLL.
+// StartWorker() fails, so ShaderDebugger keeps compiling in-process.
+bool WriteAll(void*, const void*, Uint32) { return false; }
+bool ReadAll(void*, void*, Uint32) { return false; }
+
+#endif
+
+} // namespace
+
+
+SpvCompilerPool::~SpvCompilerPool()
+{
+    Release();
+}
+
+bool SpvCompilerPool::Initialize(const char* WorkerPath, const char* CompilerLib, Uint32 WorkerCount) noexcept
+{
+    Release();
+
+    if (WorkerPath == nullptr || CompilerLib == nullptr)
+    {
+        LOG_ERROR_MESSAGE("Failed to initialize compiler workers: invalid arguments");
+        return false;
+    }
+
+    if (WorkerCount == 0)
+        WorkerCount = std::max(1u, std::thread::hardware_concurrency());
+
+    m_WorkerPath  = WorkerPath;
+    m_CompilerLib = CompilerLib;
+
+    for (Uint32 i = 0; i < WorkerCount; ++i)
+    {
+        std::unique_ptr<Worker> pWorker{new Worker{}};
+        if (!StartWorker(*pWorker))
+            break;
+
+        m_FreeWorkers.push_back(pWorker.get());
+        m_Workers.push_back(std::move(pWorker));
+    }
+
+    if (m_Workers.empty())
+    {
+        LOG_ERROR_MESSAGE("Failed to start compiler worker '", m_WorkerPath, '\'');
+        return false;
+    }
+
+    LOG_INFO_MESSAGE("Started ", m_Workers.size(), " shader compiler workers");
+    return true;
+}
+
+void SpvCompilerPool::Release() noexcept
+{
+    std::unique_lock<std::mutex> Lock{m_Guard};
+
+    // wait for running compilations
+    m_WorkerReleased.wait(Lock, [this]() { return m_FreeWorkers.size() == m_Workers.size(); });
+
+    for (auto& pWorker : m_Workers)
+        StopWorker(*pWorker);
+
+    m_Workers.clear();
+    m_FreeWorkers.clear();
+}
+
+SpvCompilerPool::Worker* SpvCompilerPool::AcquireWorker()
+{
+    std::unique_lock<std::mutex> Lock{m_Guard};
+
+    if (m_Workers.empty())
+        return nullptr;
+
+    m_WorkerReleased.wait(Lock, [this]() { return !m_FreeWorkers.empty(); });
+
+    auto* pWorker = m_FreeWorkers.back();
+    m_FreeWorkers.pop_back();
+    return pWorker;
+}
+
+void SpvCompilerPool::ReleaseWorker(Worker* pWorker)
+{
+    {
+        std::lock_guard<std::mutex> Lock{m_Guard};
+        m_FreeWorkers.push_back(pWorker);
+    }
+    m_WorkerReleased.notify_all();
+}
+
+#if PLATFORM_WIN32
+bool SpvCompilerPool::StartWorker(Worker& W)
+{
+    std::lock_guard<std::mutex> Lock{m_StartGuard};
+
+    static std::atomic<Uint32> WorkerIndex{0};
+
+    W.MappingName = "Local\\DE_SpvCompilerWorker_" + std::to_string(::GetCurrentProcessId()) + "_" + std::to_string(WorkerIndex++);
+
+    W.Mapping = ::CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, Protocol::SharedMemorySize, W.MappingName.c_str());
+    if (W.Mapping == nullptr)
+    {
+        LOG_ERROR_MESSAGE("Failed to create shared memory for compiler worker");
+        return false;
+    }
+
+    W.pShared = static_cast<char*>(::MapViewOfFile(HANDLE(W.Mapping), FILE_MAP_ALL_ACCESS, 0, 0, Protocol::SharedMemorySize));
+    if (W.pShared == nullptr)
+    {
+        LOG_ERROR_MESSAGE("Failed to map shared memory for compiler worker");
+        StopWorker(W);
+        return false;
+    }
+
+    // create pipes, only worker ends are inherited
+    SECURITY_ATTRIBUTES SecAttribs = {};
+    SecAttribs.nLength             = sizeof(SecAttribs);
+    SecAttribs.bInheritHandle      = TRUE;
+
+    HANDLE InRead   = nullptr;
+    HANDLE InWrite  = nullptr;
+    HANDLE OutRead  = nullptr;
+    HANDLE OutWrite = nullptr;
+
+    if (!::CreatePipe(&InRead, &InWrite, &SecAttribs, 0))
+    {
+        LOG_ERROR_MESSAGE("Failed to create pipe for compiler worker");
+        StopWorker(W);
+        return false;
+    }
+    if (!::CreatePipe(&OutRead, &OutWrite, &SecAttribs, 0))
+    {
+        LOG_ERROR_MESSAGE("Failed to create pipe for compiler worker");
+        ::CloseHandle(InRead);
+        ::CloseHandle(InWrite);
+        StopWorker(W);
+        return false;
+    }
+    ::SetHandleInformation(InWrite, HANDLE_FLAG_INHERIT, 0);
+    ::SetHandleInformation(OutRead, HANDLE_FLAG_INHERIT, 0);
+
+    STARTUPINFOA StartupInfo = {};
+    StartupInfo.cb           = sizeof(StartupInfo);
+    StartupInfo.dwFlags      = STARTF_USESTDHANDLES;
+    StartupInfo.hStdInput    = InRead;
+    StartupInfo.hStdOutput   = OutWrite;
+    StartupInfo.hStdError    = ::GetStdHandle(STD_ERROR_HANDLE);
+
+    String CmdLine = '"' + m_WorkerPath + "\" \"" + m_CompilerLib + "\" " + W.MappingName;
+
+    PROCESS_INFORMATION ProcInfo = {};
+    const BOOL          Created  = ::CreateProcessA(nullptr, &CmdLine[0], nullptr, nullptr, TRUE, CREATE_NO_WINDOW, nullptr, nullptr, &StartupInfo, &ProcInfo);
+
+    ::CloseHandle(InRead);
+    ::CloseHandle(OutWrite);
+
+    if (!Created)
+    {
+        LOG_ERROR_MESSAGE("Failed to start compiler worker process '", m_WorkerPath, '\'');
+        ::CloseHandle(InWrite);
+        ::CloseHandle(OutRead);
+        StopWorker(W);
+        return false;
+    }
+
+    ::CloseHandle(ProcInfo.hThread);
+
+    W.Process = ProcInfo.hProcess;
+    W.StdIn   = InWrite;
+    W.StdOut  = OutRead;
+    return true;
+}
+
+void SpvCompilerPool::StopWorker(Worker& W)
+{
+    if (W.StdIn != nullptr)
+    {
+        Protocol::Request Req;
+        Req.Command = Protocol::ECommand::Exit;
+        WriteAll(W.StdIn, &Req, sizeof(Req));
+    }
+
+    CloseHandleSafe(W.StdIn);
+    CloseHandleSafe(W.StdOut);
+
+    if (W.Process != nullptr)
+    {
+        if (::WaitForSingleObject(HANDLE(W.Process), 1000) != WAIT_OBJECT_0)
+            ::TerminateProcess(HANDLE(W.Process), 1);
+
+        CloseHandleSafe(W.Process);
+    }
+
+    if (W.pShared != nullptr)
+        ::UnmapViewOfFile(W.pShared);
+    W.pShared = nullptr;
+
+    CloseHandleSafe(W.Mapping);
+}
+
+#else
+
+bool SpvCompilerPool::StartWorker(Worker&)
+{
+    LOG_WARNING_MESSAGE("Compiler worker processes are not supported on this platform, shaders will be compiled in-process");
+    return false;
+}
+
+void SpvCompilerPool::StopWorker(Worker&)
+{
+}
+
+#endif
+
+SpvCompilerPool::ECompileResult SpvCompilerPool::Compile(const ShaderParams& Params, const char* pName, const OnCompiled_t& OnCompiled) noexcept
+{
+    VERIFY_EXPR(Params.shaderSourcesCount == 1);
+
+    Worker* pWorker = AcquireWorker();
+    if (pWorker == nullptr)
+        return ECompileResult::WorkerError;
+
+    // restart worker if it was terminated
+    if (pWorker->pShared == nullptr && !StartWorker(*pWorker))
+    {
+        ReleaseWorker(pWorker);
+        return ECompileResult::WorkerError;
+    }
+
+    Protocol::Request Req;
+    Req.ShaderType              = Params.shaderType;
+    Req.Version                 = Params.version;
+    Req.Mode                    = Params.mode;
+    Req.Optimization            = Params.optimization;
+    Req.DebugDescriptorSetIndex = Params.debugDescriptorSetIndex;
+    Req.AutoMapBindings         = Params.autoMapBindings;
+    Req.AutoMapLocations        = Params.autoMapLocations;
+
+    // copy input to the shared memory
+    Uint32     Offset   = 0;
+    bool       Overflow = false;
+    const auto Append   = [pWorker, &Offset, &Overflow](const char* pStr, size_t Len, unsigned& OutOffset, unsigned& OutSize) //
+    {
+        if (Offset + Len > Protocol::SharedMemorySize)
+        {
+            Overflow = true;
+            return;
+        }
+        std::memcpy(pWorker->pShared + Offset, pStr, Len);
+        OutOffset = Offset;
+        OutSize   = Uint32(Len);
+        Offset += Uint32(Len);
+    };
+
+    const char* pEntry = Params.entryName != nullptr ? Params.entryName : "main";
+
+    Append(Params.shaderSources[0], Params.shaderSourceLengths ? size_t(Params.shaderSourceLengths[0]) : strlen(Params.shaderSources[0]), Req.SourceOffset, Req.SourceSize);
+    Append(Params.defines ? Params.defines : "", Params.defines ? strlen(Params.defines) : 0, Req.DefinesOffset, Req.DefinesSize);
+    Append(pEntry, strlen(pEntry), Req.EntryOffset, Req.EntrySize);
+
+    if (Overflow)
+    {
+        ReleaseWorker(pWorker);
+        return ECompileResult::WorkerError;
+    }
+
+    Protocol::Response Resp;
+    if (!WriteAll(pWorker->StdIn, &Req, sizeof(Req)) ||
+        !ReadAll(pWorker->StdOut, &Resp, sizeof(Resp)) ||
+        Resp.Magic != Protocol::Magic)
+    {
+        LOG_ERROR_MESSAGE("Shader '", pName, "' error: compiler worker process terminated");
+
+        // will be restarted for the next shader
+        StopWorker(*pWorker);
+        ReleaseWorker(pWorker);
+        return ECompileResult::WorkerError;
+    }
+
+    // don't trust the worker response, it may be corrupted by the crashed compiler
+    if (!Protocol::IsInSharedMemory(Resp.LogOffset, Resp.LogSize) ||
+        !Protocol::IsInSharedMemory(Resp.SpirvOffset, Resp.SpirvSize) ||
+        Resp.SpirvOffset % sizeof(Uint32) != 0 ||
+        Resp.SpirvSize % sizeof(Uint32) != 0)
+    {
+        LOG_ERROR_MESSAGE("Shader '", pName, "' error: invalid response from compiler worker");
+
+        StopWorker(*pWorker);
+        ReleaseWorker(pWorker);
+        return ECompileResult::WorkerError;
+    }
+
+    if (!Resp.Succeeded)
+    {
+        LOG_ERROR_MESSAGE("Shader '", pName, "' compilation failed with errors:\n", String(pWorker->pShared + Resp.LogOffset, Resp.LogSize));
+        ReleaseWorker(pWorker);
+        return ECompileResult::Failed;
+    }
+
+    OnCompiled(reinterpret_cast<const Uint32*>(pWorker->pShared + Resp.SpirvOffset), Resp.SpirvSize);
+
+    ReleaseWorker(pWorker);
+    return ECompileResult::Succeeded;
+}
+
+} // namespace DE
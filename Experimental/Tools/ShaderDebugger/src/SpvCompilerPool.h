@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "BasicTypes.h"
+#include "SpvCompiler.h"
+
+namespace DE
+{
+using namespace Diligent;
+
+// Runs SpvCompiler in separate worker processes, each worker compiles one shader at a time.
+// Compiler crash terminates only the worker, it will be restarted for the next shader.
+class SpvCompilerPool
+{
+public:
+    enum class ECompileResult
+    {
+        Succeeded,
+        Failed,      // compilation errors
+        WorkerError, // worker process is not available or terminated
+    };
+
+    // pSpirv points to the worker shared memory and is valid only inside the callback
+    using OnCompiled_t = std::function<void(const Uint32* pSpirv, Uint32 SpirvSize)>;
+
+    SpvCompilerPool() {}
+    ~SpvCompilerPool();
+
+    SpvCompilerPool(const SpvCompilerPool&) = delete;
+    SpvCompilerPool& operator=(const SpvCompilerPool&) = delete;
+
+    bool Initialize(const char* WorkerPath, const char* CompilerLib, Uint32 WorkerCount) noexcept;
+    void Release() noexcept;
+
+    bool   IsInitialized() const { return !m_Workers.empty(); }
+    Uint32 GetWorkerCount() const { return Uint32(m_Workers.size()); }
+
+    // thread-safe, blocks until one of the workers is free
+    ECompileResult Compile(const ShaderParams& Params, const char* pName, const OnCompiled_t& OnCompiled) noexcept;
+
+private:
+    struct Worker
+    {
+        void*  Process = nullptr;
+        void*  StdIn   = nullptr; // write end of the worker stdin
+        void*  StdOut  = nullptr; // read end of the worker stdout
+        void*  Mapping = nullptr;
+        char*  pShared = nullptr;
+        String MappingName;
+    };
+
+    Worker* AcquireWorker();
+    void    ReleaseWorker(Worker* pWorker);
+
+    bool StartWorker(Worker& W);
+    void StopWorker(Worker& W);
+
+private:
+    String m_WorkerPath;
+    String m_CompilerLib;
+
+    std::vector<std::unique_ptr<Worker>> m_Workers;
+    std::vector<Worker*>                 m_FreeWorkers;
+    std::mutex                           m_Guard;
+    std::condition_variable              m_WorkerReleased;
+    std::mutex                           m_StartGuard; // child processes must not inherit pipes of other workers
+};
+
+} // namespace DE
@@ -0,0 +1,62 @@
+#pragma once
+
+// Protocol between SpvCompilerPool and SpvCompilerWorker processes.
+// Request and response headers are sent through the worker stdin/stdout pipes,
+// source, defines, SPIRV binary and log are placed in the shared memory of the worker.
+
+namespace DE
+{
+namespace SpvCompilerProtocol
+{
+
+static constexpr unsigned Magic            = 0x43565053; // 'SPVC'
+static constexpr unsigned SharedMemorySize = 32u << 20;
+
+// Offsets and sizes come from the other process and must be validated before use.
+inline bool IsInSharedMemory(unsigned Offset, unsigned Size)
+{
+    return Offset <= SharedMemorySize && Size <= SharedMemorySize - Offset;
+}
+
+enum class ECommand : unsigned
+{
+    Compile = 1,
+    Exit    = 2,
+};
+
+struct Request
+{
+    unsigned Magic   = SpvCompilerProtocol::Magic;
+    ECommand Command = ECommand::Compile;
+
+    unsigned ShaderType              = 0; // SPV_COMP_SHADER_TYPE
+    unsigned Version                 = 0; // SPV_COMP_VERSION
+    unsigned Mode                    = 0; // SPV_COMP_DEBUG_MODE
+    unsigned Optimization            = 0; // SPV_COMP_OPTIMIZATION
+    unsigned DebugDescriptorSetIndex = ~0u;
+    unsigned AutoMapBindings         = 0;
+    unsigned AutoMapLocations        = 0;
+
+    // offsets and sizes in the shared memory
+    unsigned SourceOffset  = 0;
+    unsigned SourceSize    = 0;
+    unsigned DefinesOffset = 0;
+    unsigned DefinesSize   = 0;
+    unsigned EntryOffset   = 0;
+    unsigned EntrySize     = 0;
+};
+
+struct Response
+{
+    unsigned Magic     = SpvCompilerProtocol::Magic;
+    unsigned Succeeded = 0;
+
+    // offsets and sizes in the shared memory, SPIRV size is in bytes
+    unsigned SpirvOffset = 0;
+    unsigned SpirvSize   = 0;
+    unsigned LogOffset   = 0;
+    unsigned LogSize     = 0;
+};
+
+} // namespace SpvCompilerProtocol
+} // namespace DE
@@ -0,0 +1,184 @@
+// Shader compiler worker process, see SpvCompilerPool.
+// Usage: SpvCompilerWorker <SpvCompiler.dll> <shared memory name>
+
+#include "SpvCompiler.h"
+#include "SpvCompilerProtocol.h"
+
+#include <string>
+#include <cstring>
+#include <algorithm>
+
+#ifndef NOMINMAX
+#    define NOMINMAX
+#endif
+#include <Windows.h>
+
+namespace
+{
+using namespace DE;
+namespace Protocol = SpvCompilerProtocol;
+
+bool WriteAll(HANDLE hPipe, const void* pData, unsigned Size)
+{
+    const auto* pBytes = static_cast<const char*>(pData);
+    while (Size > 0)
+    {
+        DWORD Written = 0;
+        if (!::WriteFile(hPipe, pBytes, Size, &Written, nullptr) || Written == 0)
+            return false;
+
+        pBytes += Written;
+        Size -= Written;
+    }
+    return true;
+}
+
+bool ReadAll(HANDLE hPipe, void* pData, unsigned Size)
+{
+    auto* pBytes = static_cast<char*>(pData);
+    while (Size > 0)
+    {
+        DWORD Read = 0;
+        if (!::ReadFile(hPipe, pBytes, Size, &Read, nullptr) || Read == 0)
+            return false;
+
+        pBytes += Read;
+        Size -= Read;
+    }
+    return true;
+}
+
+Protocol::Response Compile(const SpvCompilerFn& CompilerFn, const Protocol::Request& Req, char* pShared)
+{
+    Protocol::Response Resp;
+
+    if (!Protocol::IsInSharedMemory(Req.SourceOffset, Req.SourceSize) ||
+        !Protocol::IsInSharedMemory(Req.DefinesOffset, Req.DefinesSize) ||
+        !Protocol::IsInSharedMemory(Req.EntryOffset, Req.EntrySize))
+    {
+        static constexpr char Error[] = "invalid request";
+        Resp.LogSize                  = sizeof(Error) - 1;
+        std::memcpy(pShared, Error, Resp.LogSize);
+        return Resp;
+    }
+
+    // source and defines must be copied because output overwrites the shared memory
+    const std::string Defines{pShared + Req.DefinesOffset, Req.DefinesSize};
+    const std::string Entry{pShared + Req.EntryOffset, Req.EntrySize};
+    const std::string Source{pShared + Req.SourceOffset, Req.SourceSize};
+    const char*       pSource       = Source.c_str();
+    const int         SourceLen     = int(Source.size());
+    const char*       includeDirs[] = {""};
+
+    ShaderParams Params;
+    Params.shaderSources           = &pSource;
+    Params.shaderSourceLengths     = &SourceLen;
+    Params.shaderSourcesCount      = 1;
+    Params.entryName               = Entry.c_str();
+    Params.defines                 = Defines.c_str();
+    Params.includeDirs             = includeDirs;
+    Params.includeDirsCount        = _countof(includeDirs);
+    Params.shaderType              = SPV_COMP_SHADER_TYPE(Req.ShaderType);
+    Params.version                 = SPV_COMP_VERSION(Req.Version);
+    Params.mode                    = SPV_COMP_DEBUG_MODE(Req.Mode);
+    Params.optimization            = SPV_COMP_OPTIMIZATION(Req.Optimization);
+    Params.autoMapBindings         = Req.AutoMapBindings != 0;
+    Params.autoMapLocations        = Req.AutoMapLocations != 0;
+    Params.debugDescriptorSetIndex = Req.DebugDescriptorSetIndex;
+
+    const auto WriteLog = [&Resp, pShared](const char* pLog) //
+    {
+        Resp.LogOffset = 0;
+        Resp.LogSize   = unsigned(std::min(strlen(pLog), size_t(Protocol::SharedMemorySize)));
+        std::memcpy(pShared, pLog, Resp.LogSize);
+    };
+
+    CompiledShader* pCompiled = nullptr;
+    if (!CompilerFn.Compile(&Params, &pCompiled))
+    {
+        const char* pLog = "";
+        if (pCompiled)
+            CompilerFn.GetShaderLog(pCompiled, &pLog);
+
+        WriteLog(pLog);
+
+        if (pCompiled)
+            CompilerFn.ReleaseShader(pCompiled);
+        return Resp;
+    }
+
+    const unsigned* pSpirv    = nullptr;
+    unsigned        SpirvSize = 0;
+
+    if (!CompilerFn.GetShaderBinary(pCompiled, &pSpirv, &SpirvSize))
+    {
+        WriteLog("failed to get SPIRV binary");
+        CompilerFn.ReleaseShader(pCompiled);
+        return Resp;
+    }
+
+    if (SpirvSize > Protocol::SharedMemorySize)
+    {
+        WriteLog("SPIRV binary is too big");
+        CompilerFn.ReleaseShader(pCompiled);
+        return Resp;
+    }
+
+    std::memcpy(pShared, pSpirv, SpirvSize);
+    Resp.Succeeded   = 1;
+    Resp.SpirvOffset = 0;
+    Resp.SpirvSize   = SpirvSize;
+
+    CompilerFn.ReleaseShader(pCompiled);
+    return Resp;
+}
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+        return 1;
+
+    HMODULE hCompilerLib = ::LoadLibraryA(argv[1]);
+    if (hCompilerLib == nullptr)
+        return 2;
+
+    SpvCompilerFn CompilerFn        = {};
+    auto*         pGetSpvCompilerFn = reinterpret_cast<decltype(GetSpvCompilerFn)*>(::GetProcAddress(hCompilerLib, "GetSpvCompilerFn"));
+    if (pGetSpvCompilerFn == nullptr)
+        return 3;
+
+    pGetSpvCompilerFn(&CompilerFn);
+    if (CompilerFn.Compile == nullptr)
+        return 3;
+
+    HANDLE hMapping = ::OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, argv[2]);
+    if (hMapping == nullptr)
+        return 4;
+
+    auto* pShared = static_cast<char*>(::MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, Protocol::SharedMemorySize));
+    if (pShared == nullptr)
+        return 5;
+
+    HANDLE hInput  = ::GetStdHandle(STD_INPUT_HANDLE);
+    HANDLE hOutput = ::GetStdHandle(STD_OUTPUT_HANDLE);
+
+    for (;;)
+    {
+        Protocol::Request Req;
+        if (!ReadAll(hInput, &Req, sizeof(Req)) || Req.Magic != Protocol::Magic || Req.Command != Protocol::ECommand::Compile)
+            break;
+
+        Protocol::Response Resp = Compile(CompilerFn, Req, pShared);
+
+        if (!WriteAll(hOutput, &Resp, sizeof(Resp)))
+            break;
+    }
+
+    ::UnmapViewOfFile(pShared);
+    ::CloseHandle(hMapping);
+    ::FreeLibrary(hCompilerLib);
+    return 0;
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "FileWrapper.hpp"
+
+namespace DE
+{
+using namespace Diligent;
+
+// Camera transform per frame, used to render the same frames in different runs.
+// File format: header followed by the array of frames, native byte order.
+class CameraPath
+{
+public:
+    static constexpr Uint32 Magic   = 0x50414352; // 'RCAP'
+    static constexpr Uint32 Version = 1;
+
+    struct Frame
+    {
+        float3 Position;
+        float3 Direction;   // normalized view direction
+        float  Time = 0.0f; // animation time of the sample in seconds
+    };
+
+    bool Load(const char* FilePath) noexcept
+    {
+        m_Frames.clear();
+
+        FileWrapper File{FilePath, EFileAccessMode::Read};
+        if (!File)
+        {
+            LOG_ERROR_MESSAGE("Failed to open camera path file '", FilePath, '\'');
+            return false;
+        }
+
+        FileHeader Header;
+        if (!File->Read(&Header, sizeof(Header)) ||
+            Header.Magic != Magic ||
+            Header.Version != Version ||
+            Header.FrameSize != sizeof(Frame))
+        {
+            LOG_ERROR_MESSAGE("Camera path file '", FilePath, "' has invalid header");
+            return false;
+        }
+
+        m_Frames.resize(Header.FrameCount);
+        if (Header.FrameCount == 0 || !File->Read(m_Frames.data(), sizeof(Frame) * m_Frames.size()))
+        {
+            LOG_ERROR_MESSAGE("Failed to read frames from camera path file '", FilePath, '\'');
+            m_Frames.clear();
+            return false;
+        }
+        return true;
+    }
+
+    bool Save(const char* FilePath) const noexcept
+    {
+        FileWrapper File{FilePath, EFileAccessMode::Overwrite};
+        if (!File)
+        {
+            LOG_ERROR_MESSAGE("Failed to create camera path file '", FilePath, '\'');
+            return false;
+        }
+
+        FileHeader Header;
+        Header.FrameCount = GetFrameCount();
+
+        if (!File->Write(&Header, sizeof(Header)) ||
+            (!m_Frames.empty() && !File->Write(m_Frames.data(), sizeof(Frame) * m_Frames.size())))
+        {
+            LOG_ERROR_MESSAGE("Failed to write camera path file '", FilePath, '\'');
+            return false;
+        }
+        return true;
+    }
+
+    void AddFrame(const Frame& Frame) { m_Frames.push_back(Frame); }
+    void Clear() { m_Frames.clear(); }
+
+    bool         IsEmpty() const { return m_Frames.empty(); }
+    Uint32       GetFrameCount() const { return Uint32(m_Frames.size()); }
+    const Frame& GetFrame(Uint32 Index) const { return m_Frames[Index % m_Frames.size()]; }
+
+private:
+    struct FileHeader
+    {
+        Uint32 Magic      = CameraPath::Magic;
+        Uint32 Version    = CameraPath::Version;
+        Uint32 FrameSize  = sizeof(Frame);
+        Uint32 FrameCount = 0;
+    };
+
+    std::vector<Frame> m_Frames;
+};
+
+
+// Records camera frames while active, the path is written to the file when recording is stopped.
+class CameraPathRecorder
+{
+public:
+    void Start()
+    {
+        m_Path.Clear();
+        m_Active = true;
+    }
+
+    bool Stop(const char* FilePath)
+    {
+        m_Active = false;
+        return !m_Path.IsEmpty() && m_Path.Save(FilePath);
+    }
+
+    bool IsActive() const { return m_Active; }
+
+    void AddFrame(const float3& Position, const float3& Direction, float Time)
+    {
+        if (m_Active)
+            m_Path.AddFrame({Position, normalize(Direction), Time});
+    }
+
+private:
+    CameraPath m_Path;
+    bool       m_Active = false;
+};
+
+
+// Replays camera path one frame per update independently of the real frame rate:
+// camera and animation time are taken from the recorded frame, other updates use the fixed time step.
+class CameraPathPlayer
+{
+public:
+    static constexpr float DefaultTimeStep = 1.0f / 60.0f;
+
+    bool Start(const char* FilePath, float TimeStep = DefaultTimeStep)
+    {
+        m_FrameIndex = 0;
+        m_TimeStep   = TimeStep;
+        m_Active     = m_Path.Load(FilePath);
+        return m_Active;
+    }
+
+    void Stop() { m_Active = false; }
+
+    bool   IsActive() const { return m_Active; }
+    float  GetTimeStep() const { return m_TimeStep; }
+    Uint32 GetFrameIndex() const { return m_FrameIndex; }
+    Uint32 GetFrameCount() const { return m_Path.GetFrameCount(); }
+
+    // Returns false when all frames have been played.
+    bool NextFrame(CameraPath::Frame& Frame)
+    {
+        if (!m_Active || m_FrameIndex >= m_Path.GetFrameCount())
+        {
+            m_Active = false;
+            return false;
+        }
+        Frame = m_Path.GetFrame(m_FrameIndex++);
+        return true;
+    }
+
+private:
+    CameraPath m_Path;
+    Uint32     m_FrameIndex = 0;
+    float      m_TimeStep   = DefaultTimeStep;
+    bool       m_Active     = false;
+};
+
+} // namespace DE
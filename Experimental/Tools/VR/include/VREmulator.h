@@ -5,6 +5,7 @@
 
 #include "IVRDevice.h"
 #include "RefCntAutoPtr.hpp"
+#include "Utils/CameraPath.h"
 
 namespace DEVR
 {
@@ -26,6 +27,14 @@ public:
     uint2 GetRenderTargetDimension() const noexcept override;
     bool  GetRenderTargets(ITexture** ppLeft, ITexture** ppRight) noexcept override;
 
+    // Replays recorded camera angles and time, mouse input is ignored until the end of the path.
+    // 'P' key starts and stops recording to "camera_path.bin".
+    bool StartReplay(const char* filePath) noexcept;
+    bool IsReplaying() const noexcept { return m_CameraPlayer.IsActive(); }
+
+    // Seconds since Create(), recorded time while the camera path is replayed.
+    double GetTime() const noexcept { return m_Time; }
+
 private:
     static void GLFW_ErrorCallback(int code, const char* msg);
     static void GLFW_RefreshCallback(GLFWwindow* wnd);
@@ -59,6 +68,10 @@ private:
     RefCntAutoPtr<IShaderResourceBinding> m_pSRB;
 
     TimePoint m_lastUpdateTime;
+    double    m_Time = 0.0;
+
+    DE::CameraPathRecorder m_CameraRecorder;
+    DE::CameraPathPlayer   m_CameraPlayer;
 };
 
 } // namespace DEVR
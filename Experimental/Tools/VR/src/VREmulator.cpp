@@ -53,6 +53,19 @@ float4x4 RotateY(float angle)
         0.0f, 0.0f, 0.0f, 1.0f};
 }
 
+constexpr char CameraPathFile[] = "camera_path.bin";
+
+// Camera angles are stored in the camera path as direction, pitch is in range [-PI/2, PI/2].
+float3 AnglesToDirection(const float2& angles)
+{
+    return float3{std::sin(angles.x) * std::cos(angles.y), std::sin(angles.y), std::cos(angles.x) * std::cos(angles.y)};
+}
+
+float2 DirectionToAngles(const float3& dir)
+{
+    return float2{std::atan2(dir.x, dir.z), std::asin(clamp(dir.y, -1.0f, 1.0f))};
+}
+
 } // namespace
 
 
@@ -73,6 +86,9 @@ VREmulatorVk::VREmulatorVk()
 
 VREmulatorVk::~VREmulatorVk()
 {
+    if (m_CameraRecorder.IsActive())
+        m_CameraRecorder.Stop(CameraPathFile);
+
     if (m_Window)
     {
         glfwDestroyWindow(m_Window);
@@ -137,15 +153,31 @@ bool VREmulatorVk::BeginFrame() noexcept
     auto dt          = std::chrono::duration_cast<Seconds>(time - m_lastUpdateTime).count();
     m_lastUpdateTime = time;
 
+    DE::CameraPath::Frame frame;
+    if (m_CameraPlayer.NextFrame(frame))
+    {
+        m_CameraAngle = DirectionToAngles(frame.Direction);
+        m_Time        = frame.Time;
+    }
+    else
+        m_Time += dt;
+
     m_CameraAngle.x = Wrap(m_CameraAngle.x, -PI_F, PI_F);
     m_CameraAngle.y = Wrap(m_CameraAngle.y, -PI_F, PI_F);
     m_camera.pose   = RotateX(-m_CameraAngle.y) * RotateY(-m_CameraAngle.x);
 
-    (void)(dt);
-
+    m_CameraRecorder.AddFrame(m_camera.position, AnglesToDirection(m_CameraAngle), float(m_Time));
     return true;
 }
 
+bool VREmulatorVk::StartReplay(const char* filePath) noexcept
+{
+    if (m_CameraRecorder.IsActive())
+        m_CameraRecorder.Stop(CameraPathFile);
+
+    return m_CameraPlayer.Start(filePath);
+}
+
 bool VREmulatorVk::EndFrame() noexcept
 {
     if (m_pSwapChain == nullptr)
@@ -383,6 +415,15 @@ void VREmulatorVk::GLFW_ResizeCallback(GLFWwindow* wnd, int w, int h)
 
 void VREmulatorVk::GLFW_KeyCallback(GLFWwindow* wnd, int key, int, int action, int)
 {
+    auto* self = static_cast<VREmulatorVk*>(glfwGetWindowUserPointer(wnd));
+
+    if (key == GLFW_KEY_P && action == GLFW_RELEASE && !self->m_CameraPlayer.IsActive())
+    {
+        if (!self->m_CameraRecorder.IsActive())
+            self->m_CameraRecorder.Start();
+        else if (self->m_CameraRecorder.Stop(CameraPathFile))
+            LOG_INFO_MESSAGE("Camera path is saved to '", CameraPathFile, '\'');
+    }
 }
 
 void VREmulatorVk::GLFW_MouseButtonCallback(GLFWwindow* wnd, int button, int action, int)
@@ -398,7 +439,7 @@ void VREmulatorVk::GLFW_CursorPosCallback(GLFWwindow* wnd, double xpos, double y
     auto*  self = static_cast<VREmulatorVk*>(glfwGetWindowUserPointer(wnd));
     float2 pos  = {float(xpos), float(ypos)};
 
-    if (self->m_MousePressed)
+    if (self->m_MousePressed && !self->m_CameraPlayer.IsActive())
     {
         float2 delta = pos - self->m_LastCursorPos;
         self->m_CameraAngle += float2{delta.x, -delta.y} * 0.01f;